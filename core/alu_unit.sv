@@ -35,20 +35,59 @@ module alu_unit(
     logic[XLEN:0] add_sub_result;
     logic add_sub_carry_in;
     logic[XLEN-1:0] shift_result;
+    logic[XLEN-1:0] ext_result;
+    logic[XLEN:0] logic_in2;
+
+    logic[XLEN-1:0] clz_input;
+    logic[4:0] clz_result;
+    logic[XLEN-1:0] crc32c_b;
+    logic[XLEN-1:0] crc32c_h;
+    logic[XLEN-1:0] crc32c_w;
 
     logic[XLEN:0] adder_in1;
     logic[XLEN:0] adder_in2;
 
     logic[XLEN-1:0] result;
+
+    //CRC32C (Castagnoli) polynomial in reversed bit order
+    localparam logic[31:0] CRC32C_POLY = 32'h82F63B78;
+
+    //One byte of a reflected CRC32C, least significant bit first
+    //No initial or final inversion; that is left to software
+    function automatic logic[31:0] crc32c_byte(input logic[31:0] crc, input logic[7:0] data);
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ ({32{crc[0] ^ data[i]}} & CRC32C_POLY);
+        return crc;
+    endfunction
+
+    //Toeplitz hash of the 32 input bits in data (first bit in data[31])
+    //with the 64-bit key window {key_hi, key_lo}, split into the parts
+    //contributed by each half of the window:
+    //  hash = toeplitz_hi(key_hi, data) ^ toeplitz_lo(key_lo, data)
+    function automatic logic[31:0] toeplitz_hi(input logic[31:0] key, input logic[31:0] data);
+        toeplitz_hi = 0;
+        for (int i = 0; i < 32; i++)
+            toeplitz_hi ^= {32{data[31-i]}} & (key << i);
+    endfunction
+
+    function automatic logic[31:0] toeplitz_lo(input logic[31:0] key, input logic[31:0] data);
+        toeplitz_lo = 0;
+        for (int i = 1; i < 32; i++)
+            toeplitz_lo ^= {32{data[31-i]}} & (key >> (32-i));
+    endfunction
+
     //implementation
     ////////////////////////////////////////////////////
 
+    //andn, orn and xnor invert the second operand of the logic ops
+    assign logic_in2 = alu_inputs.in2 ^ {33{alu_inputs.logic_invert}};
+
     //Logic ops put through the adder carry chain to reduce resources
     always_comb begin
         case (alu_inputs.logic_op)
-            ALU_LOGIC_XOR : adder_in1 = alu_inputs.in1 ^ alu_inputs.in2;
-            ALU_LOGIC_OR : adder_in1 = alu_inputs.in1 | alu_inputs.in2;
-            ALU_LOGIC_AND : adder_in1 = alu_inputs.in1 & alu_inputs.in2;
+            ALU_LOGIC_XOR : adder_in1 = alu_inputs.in1 ^ logic_in2;
+            ALU_LOGIC_OR : adder_in1 = alu_inputs.in1 | logic_in2;
+            ALU_LOGIC_AND : adder_in1 = alu_inputs.in1 & logic_in2;
             ALU_LOGIC_ADD : adder_in1 = alu_inputs.in1;
         endcase
         case (alu_inputs.logic_op)
@@ -66,13 +105,56 @@ module alu_unit(
             .shift_amount(alu_inputs.shift_amount),
             .arith(alu_inputs.arith),
             .lshift(alu_inputs.lshift),
+            .rotate(alu_inputs.rotate),
             .shifted_result(shift_result)
         );
 
+    ////////////////////////////////////////////////////
+    //Zbb and hash operations
+    //CTZ is CLZ of the bit-reversed input
+    always_comb begin
+        for (int i = 0; i < XLEN; i++)
+            clz_input[i] = (alu_inputs.ext_op == ALU_EXT_CTZ) ? alu_inputs.in1[XLEN-1-i] : alu_inputs.in1[i];
+    end
+
+    clz ext_clz (
+            .clz_input(clz_input),
+            .clz(clz_result)
+        );
+
+    assign crc32c_b = crc32c_byte(alu_inputs.in1[31:0], alu_inputs.in2[7:0]);
+    assign crc32c_h = crc32c_byte(crc32c_b, alu_inputs.in2[15:8]);
+    assign crc32c_w = crc32c_byte(crc32c_byte(crc32c_h, alu_inputs.in2[23:16]), alu_inputs.in2[31:24]);
+
+    always_comb begin
+        case (alu_inputs.ext_op)
+            ALU_EXT_CLZ, ALU_EXT_CTZ : ext_result = (clz_input == 0) ? 32 : 32'(clz_result);
+            ALU_EXT_CPOP : ext_result = 32'($countones(alu_inputs.in1[31:0]));
+            ALU_EXT_SEXT_B : ext_result = 32'(signed'(alu_inputs.in1[7:0]));
+            ALU_EXT_SEXT_H : ext_result = 32'(signed'(alu_inputs.in1[15:0]));
+            ALU_EXT_ZEXT_H : ext_result = {16'b0, alu_inputs.in1[15:0]};
+            //The adder computes in1 - in2 with signed or unsigned sign padding (as for SLT[U])
+            ALU_EXT_MIN : ext_result = add_sub_result[XLEN] ? alu_inputs.in1[31:0] : alu_inputs.in2[31:0];
+            ALU_EXT_MAX : ext_result = add_sub_result[XLEN] ? alu_inputs.in2[31:0] : alu_inputs.in1[31:0];
+            ALU_EXT_ORC_B : begin
+                for (int i = 0; i < 4; i++)
+                    ext_result[i*8 +: 8] = {8{|alu_inputs.in1[i*8 +: 8]}};
+            end
+            ALU_EXT_REV8 : ext_result = {alu_inputs.in1[7:0], alu_inputs.in1[15:8], alu_inputs.in1[23:16], alu_inputs.in1[31:24]};
+            ALU_EXT_CRC32C_B : ext_result = crc32c_b;
+            ALU_EXT_CRC32C_H : ext_result = crc32c_h;
+            ALU_EXT_CRC32C_W : ext_result = crc32c_w;
+            ALU_EXT_TOEPLITZ_HI : ext_result = toeplitz_hi(alu_inputs.in1[31:0], alu_inputs.in2[31:0]);
+            ALU_EXT_TOEPLITZ_LO : ext_result = toeplitz_lo(alu_inputs.in1[31:0], alu_inputs.in2[31:0]);
+            default : ext_result = '0;
+        endcase
+    end
+
     always_comb begin
         result = (alu_inputs.shifter_path ? shift_result : add_sub_result[31:0]);
         result[31:1] &= {31{~alu_inputs.slt_path}};
         result[0] = alu_inputs.slt_path ? add_sub_result[XLEN] : result[0];
+        result = (alu_inputs.ext_op != ALU_EXT_NONE) ? ext_result : result;
     end
 
     ////////////////////////////////////////////////////
@@ -29,6 +29,7 @@ module barrel_shifter (
         input logic[4:0] shift_amount,
         input logic arith,
         input logic lshift,
+        input logic rotate,
         output logic[31:0] shifted_result
         );
 
@@ -39,7 +40,10 @@ module barrel_shifter (
     //Performs a 63-bit right shift
     //Left shift is handled by placing the left shift in the upper portion shifted by (~shift_amount + 1)
     //with the value initially shifted by one so that only the complement of the shift_amount is needed
-    assign shift_in = lshift ? {shifter_input, 31'b0} : {{31{arith}}, shifter_input};
+    //Rotates fill the otherwise shifted-in bits with a copy of the input
+    assign shift_in = lshift ?
+        {shifter_input, (rotate ? shifter_input[31:1] : 31'b0)} :
+        {(rotate ? shifter_input[30:0] : {31{arith}}), shifter_input};
     assign adjusted_shift_amount = shift_amount ^ {5{lshift}};
     assign shifted_result = 32'(shift_in >> adjusted_shift_amount);
 endmodule
@@ -52,10 +52,15 @@ module branch_predictor (
     endfunction
 
     localparam BRANCH_ADDR_W = $clog2(BRANCH_TABLE_ENTRIES);
-    localparam BTAG_W = get_memory_width() - BRANCH_ADDR_W - 2;
+    localparam BTAG_W = get_memory_width() - BRANCH_ADDR_W - 2 + USE_RVC;
 
+    //With compressed instructions, the tables are still indexed by word
+    //and the halfword address bit becomes part of the tag
     function logic[BTAG_W-1:0] get_tag (input logic[31:0] pc);
-        return pc[BRANCH_ADDR_W+2 +: BTAG_W];
+        if (USE_RVC)
+            return {pc[BRANCH_ADDR_W+2 +: BTAG_W-1], pc[1]};
+        else
+            return pc[BRANCH_ADDR_W+2 +: BTAG_W];
     endfunction
 
     typedef struct packed {
@@ -64,6 +69,7 @@ module branch_predictor (
         logic is_branch;
         logic is_return;
         logic is_call;
+        logic is_compressed;
         branch_predictor_metadata_t metadata;
     } branch_table_entry_t;
 
@@ -81,6 +87,8 @@ module branch_predictor (
     logic [BRANCH_PREDICTOR_WAYS-1:0] target_update_way;
     logic [$clog2(BRANCH_PREDICTOR_WAYS > 1 ? BRANCH_PREDICTOR_WAYS : 2)-1:0] hit_way;
     logic tag_match;
+    logic index_match;
+    logic [BRANCH_ADDR_W-1:0] if_index;
     logic use_predicted_pc;
     /////////////////////////////////////////
 
@@ -118,7 +126,16 @@ module branch_predictor (
     endgenerate
     assign tag_match = |tag_matches;
 
-    assign use_predicted_pc = USE_BRANCH_PREDICTOR & tag_match;
+    //The tables are read with the address of the next fetch before the size of
+    //the current instruction is known. If fetch then continues in another word
+    //than assumed, the entries read do not belong to it.
+    always_ff @(posedge clk) begin
+        if (bp.new_mem_request)
+            if_index <= bp.next_pc[2 +: BRANCH_ADDR_W];
+    end
+    assign index_match = ~USE_RVC | (if_index == bp.if_pc[2 +: BRANCH_ADDR_W]);
+
+    assign use_predicted_pc = USE_BRANCH_PREDICTOR & tag_match & index_match;
 
     //Predicted PC and whether the prediction is valid
     assign bp.predicted_pc = predicted_pc[hit_way];
@@ -126,6 +143,7 @@ module branch_predictor (
     assign bp.is_branch = if_entry[hit_way].is_branch;
     assign bp.is_return = if_entry[hit_way].is_return;
     assign bp.is_call = if_entry[hit_way].is_call;
+    assign bp.is_compressed = if_entry[hit_way].is_compressed;
 
     ////////////////////////////////////////////////////
     //Execution stage update
@@ -134,6 +152,7 @@ module branch_predictor (
     assign ex_entry.is_branch = br_results.is_branch_ex;
     assign ex_entry.is_return = br_results.is_return_ex;
     assign ex_entry.is_call = br_results.is_call_ex;
+    assign ex_entry.is_compressed = br_results.is_compressed_ex;
 
 
     //2-bit saturating counter
@@ -101,7 +101,7 @@ module branch_unit(
     assign branch_taken = result | branch_inputs.jalr | branch_inputs.jal;
 
     assign jump_base = branch_inputs.jalr ? branch_inputs.rs1 : branch_inputs.issue_pc;
-    assign new_pc = jump_base + (branch_taken ? 32'(signed'(branch_inputs.pc_offset)) : 4);
+    assign new_pc = jump_base + (branch_taken ? 32'(signed'(branch_inputs.pc_offset)) : (branch_inputs.compressed ? 2 : 4));
 
     always_ff @(posedge clk) begin
         if (instruction_is_completing | ~branch_issued_r) begin
@@ -125,8 +125,9 @@ module branch_unit(
             end
         end
 
-        assign potential_branch_exception = new_pc[1] & issue.new_request;
-        assign br_exception.valid = new_pc_ex[1] & branch_taken_ex & branch_issued_r;
+        //With compressed instructions, targets only need to be halfword aligned
+        assign potential_branch_exception = ~USE_RVC & new_pc[1] & issue.new_request;
+        assign br_exception.valid = ~USE_RVC & new_pc_ex[1] & branch_taken_ex & branch_issued_r;
         assign br_exception.code = INST_ADDR_MISSALIGNED;
         assign br_exception.tval = new_pc_ex;
         assign br_exception.id = jmp_id;
@@ -146,10 +147,12 @@ module branch_unit(
     //Predictor support
     logic is_return;
     logic is_call;
+    logic is_compressed;
     always_ff @(posedge clk) begin
         if (instruction_is_completing | ~branch_issued_r) begin
             is_return <= branch_inputs.is_return;
             is_call <= branch_inputs.is_call;
+            is_compressed <= branch_inputs.compressed;
             pc_ex <= branch_inputs.issue_pc;
         end
     end
@@ -161,6 +164,7 @@ module branch_unit(
     assign br_results.is_branch_ex = ~jal_jalr_ex;
     assign br_results.is_return_ex = is_return;
     assign br_results.is_call_ex = is_call;
+    assign br_results.is_compressed_ex = is_compressed;
 
     assign branch_flush = instruction_is_completing && (branch_inputs.issue_pc[31:1] != new_pc_ex[31:1]);
 
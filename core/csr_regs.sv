@@ -56,6 +56,9 @@ module csr_regs
         //WB
         input logic [$clog2(MAX_COMPLETE_COUNT)-1:0] retire_inc,
 
+        //Hardware performance monitor
+        input logic [HPM_NEVENTS-1:0] hpm_events,
+
         //External
         input logic interrupt,
         input logic timer_interrupt,
@@ -91,6 +94,9 @@ module csr_regs
     localparam INST_RET_INC_W = 2;
     logic [INST_RET_INC_W-1:0] inst_ret_inc;
 
+    logic[COUNTER_W-1:0] mhpmcounter [NUM_HPM_COUNTERS];
+    hpm_event_t mhpmevent [NUM_HPM_COUNTERS];
+
     //write_logic
     logic supervisor_write;
     logic machine_write;
@@ -148,7 +154,7 @@ module csr_regs
 
     ////////////////////////////////////////////////////
     //Machine ISA register
-    const misa_t misa = '{default:0, mxlen:1, A:(USE_AMO), I:1, M:(USE_MUL && USE_DIV), S:(ENABLE_S_MODE), U:(ENABLE_U_MODE)};
+    const misa_t misa = '{default:0, mxlen:1, A:(USE_AMO), C:(USE_RVC), I:1, M:(USE_MUL && USE_DIV), S:(ENABLE_S_MODE), U:(ENABLE_U_MODE)};
 
     ////////////////////////////////////////////////////
     //Machine Version Registers
@@ -373,9 +379,14 @@ generate if (ENABLE_M_MODE) begin
     ////////////////////////////////////////////////////
     //MEPC
     //Can be software written, written on exception with
-    //exception causing PC.  Lower two bits tied to zero.
+    //exception causing PC.  Lower two bits tied to zero
+    //(only the lowest bit with compressed instructions).
     always_ff @(posedge clk) begin
-        mepc[1:0] <= '0;
+        mepc[0] <= 0;
+        if (~USE_RVC)
+            mepc[1] <= 0;
+        else if (mwrite_decoder[MEPC[7:0]] | gc_exception.valid)
+            mepc[1] <= gc_exception.valid ? exception_pc[1] : updated_csr[1];
         if (mwrite_decoder[MEPC[7:0]] | gc_exception.valid)
             mepc[XLEN-1:2] <= gc_exception.valid ? exception_pc[XLEN-1:2] : updated_csr[XLEN-1:2];
     end
@@ -495,6 +506,29 @@ endgenerate
         end
     end
 
+    ////////////////////////////////////////////////////
+    //Hardware Performance Monitor
+    //mhpmcounter3 and up count the cycles in which the event selected by
+    //the corresponding mhpmevent is present. Unknown events count nothing.
+    always_ff @(posedge clk) begin
+        for (int i = 0; i < NUM_HPM_COUNTERS; i++) begin
+            if (rst) begin
+                mhpmcounter[i] <= 0;
+                mhpmevent[i] <= HPM_EVENT_NONE;
+            end else begin
+                if (machine_write && csr_addr == 12'(MHPMEVENT3 + i))
+                    mhpmevent[i] <= (updated_csr < HPM_NEVENTS) ? hpm_event_t'(updated_csr) : HPM_EVENT_NONE;
+
+                if (machine_write && csr_addr == 12'(MHPMCOUNTER3 + i))
+                    mhpmcounter[i][XLEN-1:0] <= updated_csr;
+                else if (machine_write && csr_addr == 12'(MHPMCOUNTER3H + i))
+                    mhpmcounter[i][COUNTER_W-1:XLEN] <= updated_csr[COUNTER_W-XLEN-1:0];
+                else
+                    mhpmcounter[i] <= mhpmcounter[i] + COUNTER_W'(hpm_events[mhpmevent[i]]);
+            end
+        end
+    end
+
      always_comb begin
         invalid_addr = 0;
         case(csr_addr)
@@ -547,7 +581,24 @@ endgenerate
             TIMEH : selected_csr = 32'(mcycle[COUNTER_W-1:XLEN]);
             INSTRETH : selected_csr = 32'(minst_ret[COUNTER_W-1:XLEN]);
 
-            default : begin selected_csr = 0; invalid_addr = 1; end
+            default : begin
+                selected_csr = 0;
+                invalid_addr = 1;
+                for (int i = 0; i < NUM_HPM_COUNTERS; i++) begin
+                    if (csr_addr == 12'(MHPMCOUNTER3 + i) || csr_addr == 12'(HPMCOUNTER3 + i)) begin
+                        selected_csr = mhpmcounter[i][XLEN-1:0];
+                        invalid_addr = 0;
+                    end
+                    if (csr_addr == 12'(MHPMCOUNTER3H + i) || csr_addr == 12'(HPMCOUNTER3H + i)) begin
+                        selected_csr = 32'(mhpmcounter[i][COUNTER_W-1:XLEN]);
+                        invalid_addr = 0;
+                    end
+                    if (csr_addr == 12'(MHPMEVENT3 + i)) begin
+                        selected_csr = 32'(mhpmevent[i]);
+                        invalid_addr = 0;
+                    end
+                end
+            end
         endcase
     end
     always_ff @(posedge clk) begin
@@ -75,6 +75,7 @@ module decode_and_issue (
         output logic tr_alu_operand_stall,
         output logic tr_ls_operand_stall,
         output logic tr_div_operand_stall,
+        output logic [NUM_UNITS-1:0] tr_unit_needed_issue_stage,
 
         output logic tr_alu_op,
         output logic tr_branch_or_jump_op,
@@ -153,7 +154,7 @@ module decode_and_issue (
     ////////////////////////////////////////////////////
     //Register File Support
     assign uses_rs1 = !(opcode_trim inside {LUI_T, AUIPC_T, JAL_T, FENCE_T} || csr_imm_op || environment_op);
-    assign uses_rs2 = opcode_trim inside {BRANCH_T, STORE_T, ARITH_T, AMO_T, CUSTOM0_T};
+    assign uses_rs2 = opcode_trim inside {BRANCH_T, STORE_T, ARITH_T, AMO_T, CUSTOM0_T, CUSTOM1_T};
     assign uses_rd = !(opcode_trim inside {BRANCH_T, STORE_T, FENCE_T} || environment_op);
 
     always_ff @(posedge clk) begin
@@ -178,17 +179,19 @@ module decode_and_issue (
             issue.uses_rs1 <= uses_rs1;
             issue.uses_rs2 <= uses_rs2;
             issue.uses_rd <= uses_rd;
+            issue.compressed <= decode.compressed;
         end
     end
 
     ////////////////////////////////////////////////////
     //Unit Determination
     assign unit_needed[BRANCH_UNIT_ID] = opcode_trim inside {BRANCH_T, JAL_T, JALR_T};
-    assign unit_needed[ALU_UNIT_WB_ID] =  ((opcode_trim == ARITH_T) && ~decode.instruction[25]) || (opcode_trim inside {ARITH_IMM_T, AUIPC_T, LUI_T, JAL_T, JALR_T});
+    assign unit_needed[ALU_UNIT_WB_ID] =  ((opcode_trim == ARITH_T) && ~mult_div_op) || (opcode_trim inside {ARITH_IMM_T, AUIPC_T, LUI_T, JAL_T, JALR_T, CUSTOM1_T});
     assign unit_needed[LS_UNIT_WB_ID] = opcode_trim inside {LOAD_T, STORE_T, AMO_T};
     assign unit_needed[GC_UNIT_ID] = opcode_trim inside {SYSTEM_T, FENCE_T};
 
-    assign mult_div_op = (opcode_trim == ARITH_T) && decode.instruction[25];
+    //Zbb min/max also have instruction[25] set
+    assign mult_div_op = (opcode_trim == ARITH_T) && (fn7 == 7'b0000001);
     generate if (USE_MUL)
         assign unit_needed[MUL_UNIT_WB_ID] = mult_div_op && ~fn3[2];
     endgenerate
@@ -250,7 +253,7 @@ module decode_and_issue (
         if (opcode_trim inside {LUI_T, AUIPC_T}) //LUI or AUIPC
             pre_alu_rs2 = {decode.instruction[31:12], 12'b0};
         else if (opcode_trim inside {JAL_T, JALR_T}) //LUI or AUIPC //JAL JALR
-            pre_alu_rs2 = 4;
+            pre_alu_rs2 = decode.compressed ? 2 : 4;
         else //ARITH_IMM
             pre_alu_rs2 = 32'(signed'(decode.instruction[31:20]));
     end
@@ -293,27 +296,79 @@ module decode_and_issue (
         alu_logic_op = opcode[2] ? ALU_LOGIC_ADD : alu_logic_op;
     end
 
+    //Zbb: andn, orn, xnor (fn7 0100000 with the XOR, OR, AND fn3), min[u], max[u],
+    //rol, ror[i] and the unary operations encoded in the rs2 field
+    logic zbb_logic_invert;
+    logic zbb_min_max;
+    logic zbb_rotate;
+    assign zbb_logic_invert = USE_ZBB && (opcode_trim == ARITH_T) && (fn7 == 7'b0100000) && fn3 inside {XOR_fn3, OR_fn3, AND_fn3};
+    assign zbb_min_max = USE_ZBB && (opcode_trim == ARITH_T) && (fn7 == 7'b0000101);
+    assign zbb_rotate = USE_ZBB && (fn7 == 7'b0110000) && (
+        ((opcode_trim == ARITH_T) && fn3 inside {SLL_fn3, SRA_fn3}) ||
+        ((opcode_trim == ARITH_IMM_T) && (fn3 == SRA_fn3))
+    );
+
+    alu_ext_op_t alu_ext_op;
+    always_comb begin
+        alu_ext_op = ALU_EXT_NONE;
+        if (USE_ZBB && (opcode_trim == ARITH_IMM_T) && (fn3 == SLL_fn3) && (fn7 == 7'b0110000)) begin
+            case (rs2_addr)
+                5'b00000 : alu_ext_op = ALU_EXT_CLZ;
+                5'b00001 : alu_ext_op = ALU_EXT_CTZ;
+                5'b00010 : alu_ext_op = ALU_EXT_CPOP;
+                5'b00100 : alu_ext_op = ALU_EXT_SEXT_B;
+                default : alu_ext_op = ALU_EXT_SEXT_H;
+            endcase
+        end
+        else if (USE_ZBB && (opcode_trim == ARITH_IMM_T) && (fn3 == SRA_fn3) && (fn7 == 7'b0010100))
+            alu_ext_op = ALU_EXT_ORC_B;
+        else if (USE_ZBB && (opcode_trim == ARITH_IMM_T) && (fn3 == SRA_fn3) && (fn7 == 7'b0110100))
+            alu_ext_op = ALU_EXT_REV8;
+        else if (USE_ZBB && (opcode_trim == ARITH_T) && (fn7 == 7'b0000100))
+            alu_ext_op = ALU_EXT_ZEXT_H;
+        else if (zbb_min_max)
+            alu_ext_op = fn3[1] ? ALU_EXT_MAX : ALU_EXT_MIN;
+        else if (USE_HASH && (opcode_trim == CUSTOM1_T)) begin
+            case (fn7[2:0])
+                3'b000 : alu_ext_op = ALU_EXT_CRC32C_B;
+                3'b001 : alu_ext_op = ALU_EXT_CRC32C_H;
+                3'b010 : alu_ext_op = ALU_EXT_CRC32C_W;
+                3'b100 : alu_ext_op = ALU_EXT_TOEPLITZ_HI;
+                default : alu_ext_op = ALU_EXT_TOEPLITZ_LO;
+            endcase
+        end
+    end
+
     alu_logic_op_t alu_logic_op_r;
     logic alu_subtract;
     logic alu_lshift;
+    logic alu_rotate;
+    logic alu_logic_invert;
     logic alu_shifter_path;
     logic alu_slt_path;
+    alu_ext_op_t alu_ext_op_r;
 
     always_ff @(posedge clk) begin
         if (issue_stage_ready) begin
-            alu_logic_op_r <= alu_logic_op;
-            alu_subtract <= ~opcode[2] & (fn3 inside {SLTU_fn3, SLT_fn3} || sub_instruction);//opcode[2] covers LUI,AUIPC,JAL,JALR
+            alu_logic_op_r <= zbb_min_max ? ALU_LOGIC_ADD : alu_logic_op;
+            alu_subtract <= ~opcode[2] & (fn3 inside {SLTU_fn3, SLT_fn3} || sub_instruction || zbb_min_max);//opcode[2] covers LUI,AUIPC,JAL,JALR
             alu_lshift <= ~fn3[2];
+            alu_rotate <= zbb_rotate;
+            alu_logic_invert <= zbb_logic_invert;
             alu_shifter_path <= ~(opcode[2] | fn3 inside {SLT_fn3, SLTU_fn3, XOR_fn3, OR_fn3, AND_fn3, ADD_SUB_fn3}); //opcode[2] LUI AUIPC JAL JALR
             alu_slt_path <= ~opcode[2] & fn3 inside {SLT_fn3, SLTU_fn3};
+            alu_ext_op_r <= alu_ext_op;
         end
     end
     assign alu_inputs.logic_op = alu_logic_op_r;
     assign alu_inputs.subtract = alu_subtract;
     assign alu_inputs.arith = alu_rs1_data[XLEN-1] & issue.instruction[30];//shift in bit
     assign alu_inputs.lshift = alu_lshift;
+    assign alu_inputs.rotate = alu_rotate;
+    assign alu_inputs.logic_invert = alu_logic_invert;
     assign alu_inputs.shifter_path = alu_shifter_path;
     assign alu_inputs.slt_path = alu_slt_path;
+    assign alu_inputs.ext_op = alu_ext_op_r;
 
     assign alu_rs1_data = rs1_use_regfile ? rs_data[RS1] : pre_alu_rs1_r;
     assign alu_rs2_data = rs2_use_regfile ? rs_data[RS2] : pre_alu_rs2_r;
@@ -455,6 +510,7 @@ endgenerate
     assign branch_inputs.jal = issue.opcode[3];//(opcode == JAL);
     assign branch_inputs.jalr = ~issue.opcode[3] & issue.opcode[2];//(opcode == JALR);
 
+    assign branch_inputs.compressed = issue.compressed;
     assign branch_inputs.issue_pc = issue.pc;
     assign branch_inputs.issue_pc_valid = issue.stage_valid;
     assign branch_inputs.rs1 = rs_data[RS1];
@@ -600,11 +656,12 @@ endgenerate
         assign tr_alu_operand_stall = tr_operand_stall & unit_needed_issue_stage[ALU_UNIT_WB_ID] & ~unit_needed_issue_stage[BRANCH_UNIT_ID];
         assign tr_ls_operand_stall = tr_operand_stall & unit_needed_issue_stage[LS_UNIT_WB_ID];
         assign tr_div_operand_stall = tr_operand_stall & unit_needed_issue_stage[DIV_UNIT_WB_ID];
+        assign tr_unit_needed_issue_stage = unit_needed_issue_stage;
 
         //Instruction Mix
         always_ff @(posedge clk) begin
             if (issue_stage_ready) begin
-                tr_alu_op <= instruction_issued && (opcode_trim inside {ARITH_T, ARITH_IMM_T, AUIPC_T, LUI_T} && ~tr_mul_op && ~tr_div_op);
+                tr_alu_op <= instruction_issued && (opcode_trim inside {ARITH_T, ARITH_IMM_T, AUIPC_T, LUI_T, CUSTOM1_T} && ~tr_mul_op && ~tr_div_op);
                 tr_branch_or_jump_op <= instruction_issued && (opcode_trim inside {JAL_T, JALR_T, BRANCH_T});
                 tr_load_op <= instruction_issued && is_load;
                 tr_lr <= instruction_issued && load_reserve;
@@ -51,6 +51,7 @@ module fetch(
         //Instruction Metadata
         output logic [31:0] if_pc,
         output logic [31:0] fetch_instruction,
+        output logic fetch_compressed,
 
         tlb_interface.mem tlb,
         local_memory_interface.master instruction_bram,
@@ -79,12 +80,40 @@ module fetch(
     typedef struct packed{
         logic address_valid;
         logic [NUM_SUB_UNITS_W-1:0] subunit_id;
+        logic [31:2] word_addr;
+        logic fill;
+        logic use_rb;
+        logic [15:0] rb_half;
+        logic size_pending;
     } fetch_attributes_t;
     fetch_attributes_t fetch_attr_next;
     fetch_attributes_t fetch_attr;
 
     logic [31:0] next_pc;
     logic [31:0] pc;
+    logic [31:0] fetch_pc;
+    logic fetch_pc_valid;
+    logic [31:0] request_addr;
+
+    //Compressed instruction support
+    logic pc_size_pending;
+    logic size_resolved;
+    logic size_unknown;
+    logic fill;
+    logic use_rb;
+    logic rb_compressed;
+    logic rb_valid;
+    logic [31:2] rb_addr;
+    logic [15:0] rb_half;
+    logic fwd_rb_valid;
+    logic [31:2] fwd_rb_addr;
+    logic [15:0] fwd_rb_half;
+
+    logic [31:0] fetch_word;
+    logic [15:0] first_half;
+    logic [31:0] expanded_instruction;
+    logic fetch_response;
+    logic data_response;
 
     logic flush_or_rst;
     fifo_interface #(.DATA_WIDTH($bits(fetch_attributes_t))) fetch_attr_fifo();
@@ -99,38 +128,89 @@ module fetch(
     //Implementation
     ////////////////////////////////////////////////////
     //Fetch PC
+    //With compressed instructions, the address of the instruction following
+    //a sequential fetch is only known once the fetched instruction returns
+    //and its size is known.  Until then, pc holds the address of the last
+    //fetched instruction and no new request is made.
     always_ff @(posedge clk) begin
-        if (rst)
+        if (rst) begin
             pc <= RESET_VEC;
-        else if (new_mem_request | gc_fetch_flush)
-            pc <= {next_pc[31:2], 2'b0};
+            pc_size_pending <= 0;
+        end
+        else if (gc_fetch_flush) begin
+            pc <= {next_pc[31:1], 1'b0};
+            pc_size_pending <= 0;
+        end
+        else if (new_mem_request) begin
+            pc <= size_unknown ? fetch_pc : {next_pc[31:1], 1'b0};
+            pc_size_pending <= size_unknown;
+        end
+        else if (size_resolved) begin
+            pc <= fetch_pc;
+            pc_size_pending <= 0;
+        end
     end
 
-    logic [31:0] pc_plus_4;
-    assign pc_plus_4 = pc + 4;
+    assign size_resolved = pc_size_pending & fetch_response & fetch_attr.size_pending;
+    assign fetch_pc = pc + (size_resolved ? (fetch_attr.fill ? 0 : (fetch_compressed ? 2 : 4)) : 0);
+    assign fetch_pc_valid = ~pc_size_pending | size_resolved;
+    assign size_unknown = USE_RVC & (fill | ~bp.use_prediction);
+
     always_comb begin
         if (gc_fetch_pc_override)
             next_pc = gc_fetch_pc;
         else if (branch_flush)
             next_pc = bp.branch_flush_pc;
+        else if (fill)
+            next_pc = fetch_pc;
         else if (bp.use_prediction)
             next_pc = bp.is_return ? ras.addr : bp.predicted_pc;
         else
-            next_pc = pc_plus_4;
+            next_pc = fetch_pc + 4;
     end
 
     assign bp.new_mem_request = new_mem_request | gc_fetch_flush;
     assign bp.next_pc = next_pc;
-    assign bp.if_pc = pc;
+    assign bp.if_pc = fetch_pc;
 
-    assign ras.pop = bp.use_prediction & bp.is_return & ~branch_flush & ~gc_fetch_pc_override & new_mem_request;
-    assign ras.push = bp.use_prediction & bp.is_call & ~branch_flush & ~gc_fetch_pc_override & new_mem_request;
-    assign ras.new_addr = pc_plus_4;
-    assign ras.branch_fetched = bp.use_prediction & bp.is_branch & new_mem_request; //flush not needed as FIFO resets inside of RAS
+    assign ras.pop = bp.use_prediction & bp.is_return & ~branch_flush & ~gc_fetch_pc_override & pc_id_assigned;
+    assign ras.push = bp.use_prediction & bp.is_call & ~branch_flush & ~gc_fetch_pc_override & pc_id_assigned;
+    assign ras.new_addr = fetch_pc + (bp.is_compressed ? 2 : 4);
+    assign ras.branch_fetched = bp.use_prediction & bp.is_branch & pc_id_assigned; //flush not needed as FIFO resets inside of RAS
+
+    ////////////////////////////////////////////////////
+    //Realignment buffer
+    //Holds the upper half of the last fetched word for instructions that
+    //start there.  A request for such an instruction reads the following
+    //word, unless the buffered half is a compressed instruction.  Then the
+    //buffered word is read again, so the following word (which may be
+    //beyond the end of the memory) neither faults nor stalls.  After a jump to the upper half of a word that is not buffered,
+    //the word is read first by a fill request, which has no ID.
+    always_ff @(posedge clk) begin
+        if (flush_or_rst)
+            rb_valid <= 0;
+        else
+            rb_valid <= fwd_rb_valid;
+    end
+
+    always_ff @(posedge clk) begin
+        rb_addr <= fwd_rb_addr;
+        rb_half <= fwd_rb_half;
+    end
+
+    assign data_response = |unit_data_valid;
+    assign fwd_rb_valid = data_response | rb_valid;
+    assign fwd_rb_addr = data_response ? fetch_attr.word_addr : rb_addr;
+    assign fwd_rb_half = data_response ? fetch_word[31:16] : rb_half;
+
+    assign use_rb = USE_RVC & fetch_pc[1] & fwd_rb_valid & (fwd_rb_addr == fetch_pc[31:2]);
+    assign fill = USE_RVC & fetch_pc[1] & ~use_rb;
+    assign rb_compressed = fwd_rb_half[1:0] != 2'b11;
+    assign request_addr = {fetch_pc[31:2] + 30'(use_rb & ~rb_compressed), 2'b0};
 
     ////////////////////////////////////////////////////
     //TLB
-    assign tlb.virtual_address = pc;
+    assign tlb.virtual_address = request_addr;
     assign tlb.execute = 1;
     assign tlb.rnw = 0;
 
@@ -143,16 +223,21 @@ module fetch(
     //Issue Control Signals
     assign flush_or_rst = (rst | gc_fetch_flush);
 
-    assign new_mem_request = tlb.complete & pc_id_available & units_ready & ~gc_fetch_hold;
-    assign pc_id_assigned = new_mem_request;
+    assign new_mem_request = tlb.complete & (pc_id_available | fill) & units_ready & fetch_pc_valid & ~gc_fetch_hold;
+    assign pc_id_assigned = new_mem_request & ~fill;
 
     //////////////////////////////////////////////
     //Subunit Tracking
     assign fetch_attr_fifo.push = new_mem_request;
     assign fetch_attr_fifo.potential_push = new_mem_request;
-    assign fetch_attr_fifo.pop = fetch_complete;
+    assign fetch_attr_fifo.pop = fetch_response;
     one_hot_to_integer #(NUM_SUB_UNITS) hit_way_conv (.*, .one_hot(sub_unit_address_match), .int_out(fetch_attr_next.subunit_id));
     assign fetch_attr_next.address_valid = |sub_unit_address_match;
+    assign fetch_attr_next.word_addr = request_addr[31:2];
+    assign fetch_attr_next.fill = fill;
+    assign fetch_attr_next.use_rb = use_rb;
+    assign fetch_attr_next.rb_half = fwd_rb_half;
+    assign fetch_attr_next.size_pending = size_unknown;
 
     assign fetch_attr_fifo.data_in = fetch_attr_next;
 
@@ -192,11 +277,26 @@ module fetch(
 
     ////////////////////////////////////////////////////
     //Instruction metada updates
-    assign if_pc = pc;
-    assign fetch_instruction = unit_data_array[fetch_attr.subunit_id];
-    assign fetch_complete = (|unit_data_valid) | (fetch_attr_fifo.valid & ~fetch_attr.address_valid);//allow instruction to propagate to decode if address is invalid
+    assign if_pc = fetch_pc;
+    assign fetch_word = unit_data_array[fetch_attr.subunit_id];
+    assign fetch_response = data_response | (fetch_attr_fifo.valid & ~fetch_attr.address_valid);//allow instruction to propagate to decode if address is invalid
+    assign fetch_complete = fetch_response & ~fetch_attr.fill;
     assign fetch_address_valid = fetch_attr.address_valid;
 
+    assign first_half = fetch_attr.use_rb ? fetch_attr.rb_half : fetch_word[15:0];
+    assign fetch_compressed = USE_RVC & (first_half[1:0] != 2'b11);
+
+    rvc_expander rvc_expander_block (.instruction(first_half), .expanded(expanded_instruction));
+
+    always_comb begin
+        if (fetch_compressed)
+            fetch_instruction = expanded_instruction;
+        else if (fetch_attr.use_rb)
+            fetch_instruction = {fetch_word[15:0], fetch_attr.rb_half};
+        else
+            fetch_instruction = fetch_word;
+    end
+
     ////////////////////////////////////////////////////
     //End of Implementation
     ////////////////////////////////////////////////////
@@ -68,6 +68,9 @@ module gc_unit(
         input logic instruction_retired,
         //unit_writeback_interface.unit gc_wb,
 
+        //Hardware performance monitor
+        input logic [HPM_NEVENTS-1:0] hpm_events,
+
         //External
         input logic interrupt,
         input logic timer_interrupt,
@@ -329,6 +332,7 @@ module gc_unit(
         .immu(immu),
         .dmmu(dmmu),
         .retire_inc(retire_inc),
+        .hpm_events(hpm_events),
         .interrupt(interrupt),
         .timer_interrupt(timer_interrupt),
         .wb_csr(wb_csr),
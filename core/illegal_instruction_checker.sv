@@ -97,6 +97,33 @@ module  illegal_instruction_checker
 	//Custom
 	localparam [31:0] CUSTOM0 = 32'b????????_????????_????????_?0001011;
 
+    //Zbb
+    localparam [31:0] ANDN = 32'b0100000??????????111?????0110011;
+    localparam [31:0] ORN = 32'b0100000??????????110?????0110011;
+    localparam [31:0] XNOR = 32'b0100000??????????100?????0110011;
+    localparam [31:0] CLZ = 32'b011000000000?????001?????0010011;
+    localparam [31:0] CTZ = 32'b011000000001?????001?????0010011;
+    localparam [31:0] CPOP = 32'b011000000010?????001?????0010011;
+    localparam [31:0] MAX = 32'b0000101??????????110?????0110011;
+    localparam [31:0] MAXU = 32'b0000101??????????111?????0110011;
+    localparam [31:0] MIN = 32'b0000101??????????100?????0110011;
+    localparam [31:0] MINU = 32'b0000101??????????101?????0110011;
+    localparam [31:0] SEXT_B = 32'b011000000100?????001?????0010011;
+    localparam [31:0] SEXT_H = 32'b011000000101?????001?????0010011;
+    localparam [31:0] ZEXT_H = 32'b000010000000?????100?????0110011;
+    localparam [31:0] ROL = 32'b0110000??????????001?????0110011;
+    localparam [31:0] ROR = 32'b0110000??????????101?????0110011;
+    localparam [31:0] RORI = 32'b0110000??????????101?????0010011;
+    localparam [31:0] ORC_B = 32'b001010000111?????101?????0010011;
+    localparam [31:0] REV8 = 32'b011010011000?????101?????0010011;
+
+    //CRC32C and Toeplitz hash (CUSTOM1)
+    localparam [31:0] CRC32C_B = 32'b0000000??????????000?????0101011;
+    localparam [31:0] CRC32C_H = 32'b0000001??????????000?????0101011;
+    localparam [31:0] CRC32C_W = 32'b0000010??????????000?????0101011;
+    localparam [31:0] TOEPLITZ_HI = 32'b0000100??????????000?????0101011;
+    localparam [31:0] TOEPLITZ_LO = 32'b0000101??????????000?????0101011;
+
     //AMO
     localparam [31:0] AMO_ADD = 32'b00000????????????010?????0101111;
     localparam [31:0] AMO_XOR = 32'b00100????????????010?????0101111;
@@ -124,6 +151,8 @@ module  illegal_instruction_checker
     logic machine_legal;
     logic supervisor_legal;
 	logic custom_legal;
+    logic zbb_legal;
+    logic hash_legal;
     ////////////////////////////////////////////////////
     //Implementation
 
@@ -164,6 +193,15 @@ module  illegal_instruction_checker
 		CUSTOM0
 	};
 
+    assign zbb_legal = instruction inside {
+        ANDN, ORN, XNOR, CLZ, CTZ, CPOP, MAX, MAXU, MIN, MINU,
+        SEXT_B, SEXT_H, ZEXT_H, ROL, ROR, RORI, ORC_B, REV8
+    };
+
+    assign hash_legal = instruction inside {
+        CRC32C_B, CRC32C_H, CRC32C_W, TOEPLITZ_HI, TOEPLITZ_LO
+    };
+
     assign illegal_instruction = ~(
         base_legal |
 		lrsc_legal |
@@ -172,7 +210,9 @@ module  illegal_instruction_checker
         (USE_AMO & amo_legal) |
         (ENABLE_M_MODE & machine_legal) |
         (ENABLE_S_MODE & supervisor_legal) |
-		(USE_SP & custom_legal)
+		(USE_SP & custom_legal) |
+        (USE_ZBB & zbb_legal) |
+        (USE_HASH & hash_legal)
     );
 
 endmodule
@@ -45,6 +45,7 @@ module instruction_metadata_and_id_management
         output id_t fetch_id,
         input logic fetch_complete,
         input logic [31:0] fetch_instruction,
+        input logic fetch_compressed,
         input logic fetch_address_valid,
 
         //Decode ID
@@ -87,6 +88,7 @@ module instruction_metadata_and_id_management
     //////////////////////////////////////////
     logic [31:0] pc_table [MAX_IDS];
     logic [31:0] instruction_table [MAX_IDS];
+    logic compressed_table [MAX_IDS];
     logic valid_fetch_addr_table [MAX_IDS];
 
     logic [4:0] rd_addr_table [MAX_IDS];
@@ -141,6 +143,12 @@ module instruction_metadata_and_id_management
             instruction_table[fetch_id] <= fetch_instruction;
     end
 
+    //compressed instruction table
+    always_ff @ (posedge clk) begin
+        if (fetch_complete)
+            compressed_table[fetch_id] <= fetch_compressed;
+    end
+
     //rd table
     always_ff @ (posedge clk) begin
         if (fetch_complete)
@@ -358,6 +366,7 @@ module instruction_metadata_and_id_management
     assign decode.valid = fetched_count[LOG2_MAX_IDS];
     assign decode.pc = pc_table[decode_id];
     assign decode.instruction = instruction_table[decode_id];
+    assign decode.compressed = compressed_table[decode_id];
     assign decode.addr_valid = valid_fetch_addr_table[decode_id];
 
     //Branch Predictor
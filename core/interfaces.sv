@@ -42,13 +42,14 @@ interface branch_predictor_interface;
     logic is_return;
     logic is_call;
     logic is_branch;
+    logic is_compressed;
 
     modport branch_predictor (
         input if_pc, if_id, new_mem_request, next_pc,
-        output branch_flush_pc, predicted_pc, use_prediction, is_return, is_call, is_branch
+        output branch_flush_pc, predicted_pc, use_prediction, is_return, is_call, is_branch, is_compressed
     );
     modport fetch (
-        input branch_flush_pc, predicted_pc, use_prediction, is_return, is_call, is_branch,
+        input branch_flush_pc, predicted_pc, use_prediction, is_return, is_call, is_branch, is_compressed,
         output if_pc, if_id, new_mem_request, next_pc
      );
 
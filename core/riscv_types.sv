@@ -56,7 +56,8 @@ package riscv_types;
         AMO = 7'b0101111,
         SYSTEM = 7'b1110011,
         //end of RV32I
-		CUSTOM0 = 7'b0001011
+		CUSTOM0 = 7'b0001011,
+		CUSTOM1 = 7'b0101011
     } opcodes_t;
 
     typedef enum logic [4:0] {
@@ -74,7 +75,8 @@ package riscv_types;
         SYSTEM_T = 5'b11100,
         //end of RV32I
         CUSTOM_T = 5'b11110,
-        CUSTOM0_T = 5'b00010
+        CUSTOM0_T = 5'b00010,
+        CUSTOM1_T = 5'b01010
     } opcodes_trimmed_t;
 
     typedef enum logic [2:0] {
@@ -144,8 +146,12 @@ package riscv_types;
         //Machine Counters
         MCYCLE = 12'hB00,
         MINSTRET = 12'hB02,
+        MHPMCOUNTER3 = 12'hB03,
         MCYCLEH = 12'hB80,
         MINSTRETH = 12'hB82,
+        MHPMCOUNTER3H = 12'hB83,
+        //Machine counter setup
+        MHPMEVENT3 = 12'h323,
 
         //Supervisor regs
         //Supervisor Trap Setup
@@ -174,9 +180,11 @@ package riscv_types;
         CYCLE = 12'hC00,
         TIME = 12'hC01,
         INSTRET = 12'hC02,
+        HPMCOUNTER3 = 12'hC03,
         CYCLEH = 12'hC80,
         TIMEH = 12'hC81,
         INSTRETH = 12'hC82,
+        HPMCOUNTER3H = 12'hC83,
 
         //Debug regs
         DCSR = 12'h7B0,
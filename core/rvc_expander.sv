@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//Expands an RV32C instruction into the equivalent 32-bit instruction.
+//Reserved encodings and the floating-point loads and stores are expanded
+//into an all-zero word, which the illegal instruction checker rejects.
+module rvc_expander (
+        input logic [15:0] instruction,
+        output logic [31:0] expanded
+        );
+
+    localparam logic [6:0] OPC_LOAD = 7'b0000011;
+    localparam logic [6:0] OPC_STORE = 7'b0100011;
+    localparam logic [6:0] OPC_ARITH_IMM = 7'b0010011;
+    localparam logic [6:0] OPC_ARITH = 7'b0110011;
+    localparam logic [6:0] OPC_LUI = 7'b0110111;
+    localparam logic [6:0] OPC_BRANCH = 7'b1100011;
+    localparam logic [6:0] OPC_JAL = 7'b1101111;
+    localparam logic [6:0] OPC_JALR = 7'b1100111;
+    localparam logic [6:0] OPC_SYSTEM = 7'b1110011;
+
+    localparam logic [4:0] X0 = 5'd0;
+    localparam logic [4:0] RA = 5'd1;
+    localparam logic [4:0] SP = 5'd2;
+
+    logic [4:0] rd;
+    logic [4:0] rs2;
+    //Registers x8-x15 of the three-bit register fields
+    logic [4:0] rd_p;
+    logic [4:0] rs1_p;
+    logic [4:0] rs2_p;
+
+    logic [11:0] imm6;
+    logic [11:0] addi4spn_imm;
+    logic [11:0] lw_imm;
+    logic [11:0] lwsp_imm;
+    logic [11:0] swsp_imm;
+    logic [11:0] addi16sp_imm;
+    logic [19:0] lui_imm;
+    logic [20:0] j_imm;
+    logic [12:0] b_imm;
+
+    ////////////////////////////////////////////////////
+    //Implementation
+    assign rd = instruction[11:7];
+    assign rs2 = instruction[6:2];
+    assign rd_p = {2'b01, instruction[4:2]};
+    assign rs1_p = {2'b01, instruction[9:7]};
+    assign rs2_p = {2'b01, instruction[4:2]};
+
+    assign imm6 = 12'(signed'({instruction[12], instruction[6:2]}));
+    assign addi4spn_imm = {2'b0, instruction[10:7], instruction[12:11], instruction[5], instruction[6], 2'b0};
+    assign lw_imm = {5'b0, instruction[5], instruction[12:10], instruction[6], 2'b0};
+    assign lwsp_imm = {4'b0, instruction[3:2], instruction[12], instruction[6:4], 2'b0};
+    assign swsp_imm = {4'b0, instruction[8:7], instruction[12:9], 2'b0};
+    assign addi16sp_imm = 12'(signed'({instruction[12], instruction[4:3], instruction[5], instruction[2], instruction[6], 4'b0}));
+    assign lui_imm = 20'(signed'({instruction[12], instruction[6:2]}));
+    assign j_imm = 21'(signed'({instruction[12], instruction[8], instruction[10:9], instruction[6], instruction[7], instruction[2], instruction[11], instruction[5:3], 1'b0}));
+    assign b_imm = 13'(signed'({instruction[12], instruction[6:5], instruction[2], instruction[11:10], instruction[4:3], 1'b0}));
+
+    always_comb begin
+        expanded = '0;
+        case ({instruction[1:0], instruction[15:13]})
+            //Quadrant 0
+            5'b00_000 : //C.ADDI4SPN
+                if (addi4spn_imm != 0)
+                    expanded = {addi4spn_imm, SP, 3'b000, rd_p, OPC_ARITH_IMM};
+            5'b00_010 : //C.LW
+                expanded = {lw_imm, rs1_p, 3'b010, rd_p, OPC_LOAD};
+            5'b00_110 : //C.SW
+                expanded = {lw_imm[11:5], rs2_p, rs1_p, 3'b010, lw_imm[4:0], OPC_STORE};
+            //Quadrant 1
+            5'b01_000 : //C.ADDI, C.NOP
+                expanded = {imm6, rd, 3'b000, rd, OPC_ARITH_IMM};
+            5'b01_001 : //C.JAL
+                expanded = {j_imm[20], j_imm[10:1], j_imm[11], j_imm[19:12], RA, OPC_JAL};
+            5'b01_010 : //C.LI
+                expanded = {imm6, X0, 3'b000, rd, OPC_ARITH_IMM};
+            5'b01_011 : //C.ADDI16SP, C.LUI
+                if (rd == SP) begin
+                    if (addi16sp_imm != 0)
+                        expanded = {addi16sp_imm, SP, 3'b000, SP, OPC_ARITH_IMM};
+                end
+                else if (lui_imm != 0)
+                    expanded = {lui_imm, rd, OPC_LUI};
+            5'b01_100 : begin
+                case (instruction[11:10])
+                    2'b00 : //C.SRLI
+                        if (~instruction[12])
+                            expanded = {7'b0000000, rs2, rs1_p, 3'b101, rs1_p, OPC_ARITH_IMM};
+                    2'b01 : //C.SRAI
+                        if (~instruction[12])
+                            expanded = {7'b0100000, rs2, rs1_p, 3'b101, rs1_p, OPC_ARITH_IMM};
+                    2'b10 : //C.ANDI
+                        expanded = {imm6, rs1_p, 3'b111, rs1_p, OPC_ARITH_IMM};
+                    2'b11 :
+                        if (~instruction[12]) begin
+                            case (instruction[6:5])
+                                2'b00 : expanded = {7'b0100000, rs2_p, rs1_p, 3'b000, rs1_p, OPC_ARITH};//C.SUB
+                                2'b01 : expanded = {7'b0000000, rs2_p, rs1_p, 3'b100, rs1_p, OPC_ARITH};//C.XOR
+                                2'b10 : expanded = {7'b0000000, rs2_p, rs1_p, 3'b110, rs1_p, OPC_ARITH};//C.OR
+                                2'b11 : expanded = {7'b0000000, rs2_p, rs1_p, 3'b111, rs1_p, OPC_ARITH};//C.AND
+                            endcase
+                        end
+                endcase
+            end
+            5'b01_101 : //C.J
+                expanded = {j_imm[20], j_imm[10:1], j_imm[11], j_imm[19:12], X0, OPC_JAL};
+            5'b01_110 : //C.BEQZ
+                expanded = {b_imm[12], b_imm[10:5], X0, rs1_p, 3'b000, b_imm[4:1], b_imm[11], OPC_BRANCH};
+            5'b01_111 : //C.BNEZ
+                expanded = {b_imm[12], b_imm[10:5], X0, rs1_p, 3'b001, b_imm[4:1], b_imm[11], OPC_BRANCH};
+            //Quadrant 2
+            5'b10_000 : //C.SLLI
+                if (~instruction[12])
+                    expanded = {7'b0000000, rs2, rd, 3'b001, rd, OPC_ARITH_IMM};
+            5'b10_010 : //C.LWSP
+                if (rd != X0)
+                    expanded = {lwsp_imm, SP, 3'b010, rd, OPC_LOAD};
+            5'b10_100 : begin
+                if (~instruction[12]) begin
+                    if (rs2 != X0) //C.MV
+                        expanded = {7'b0000000, rs2, X0, 3'b000, rd, OPC_ARITH};
+                    else if (rd != X0) //C.JR
+                        expanded = {12'b0, rd, 3'b000, X0, OPC_JALR};
+                end
+                else begin
+                    if (rs2 != X0) //C.ADD
+                        expanded = {7'b0000000, rs2, rd, 3'b000, rd, OPC_ARITH};
+                    else if (rd != X0) //C.JALR
+                        expanded = {12'b0, rd, 3'b000, RA, OPC_JALR};
+                    else //C.EBREAK
+                        expanded = {12'b000000000001, X0, 3'b000, X0, OPC_SYSTEM};
+                end
+            end
+            5'b10_110 : //C.SWSP
+                expanded = {swsp_imm[11:5], rs2, SP, 3'b010, swsp_imm[4:0], OPC_STORE};
+            default : expanded = '0;
+        endcase
+    end
+
+endmodule
@@ -72,10 +72,12 @@ module taiga #(
 
 	gem_rx_interface.slave gem_rx,
 	gem_tx_interface.master gem_tx,
+	input tsu_time_t tsu_time,
 
 	mmr_readwrite_interface.master mmr_rw,
 	mmr_read_interface.master mmr_r,
-	mmr_intr_interface.master mmr_i
+	mmr_intr_interface.master mmr_i,
+	mmr_stats_interface.master mmr_s
 );
 
     l1_arbiter_request_interface l1_request[L1_CONNECTIONS]();
@@ -129,6 +131,7 @@ module taiga #(
     id_t fetch_id;
     logic fetch_complete;
     logic [31:0] fetch_instruction;
+    logic fetch_compressed;
     logic fetch_address_valid;
         //Decode stage
     logic decode_advance;
@@ -233,6 +236,10 @@ module taiga #(
     unit_id_t tr_num_instructions_completing;
     id_t tr_num_instructions_in_flight;
     id_t tr_num_of_instructions_pending_writeback;
+
+    //Hardware performance monitor
+    logic [SP_NSUBUNITS-1:0] sp_subunits_busy;
+    logic [HPM_NEVENTS-1:0] hpm_events;
     ////////////////////////////////////////////////////
     //Implementation
 
@@ -257,6 +264,8 @@ module taiga #(
 			.sp_inputs(sp_inputs),
 			.acpram_port_i(acp_bram_port_b_i)
 		);
+	else
+		assign sp_subunits_busy = '0;
 	endgenerate
 
     ////////////////////////////////////////////////////
@@ -335,6 +344,49 @@ module taiga #(
     ////////////////////////////////////////////////////
     //Assertions
 
+    ////////////////////////////////////////////////////
+    //Hardware Performance Monitor Events
+    //The stall and instruction mix events come from the trace signals.
+    generate if (ENABLE_TRACE_INTERFACE) begin
+        logic sp_unit_stall;
+        assign sp_unit_stall = tr_unit_stall & (USE_SP != 0) & tr_unit_needed_issue_stage[SP_UNIT_WB_ID];
+
+        always_comb begin
+            hpm_events = '0;
+            hpm_events[HPM_EVENT_CYCLE] = 1;
+            hpm_events[HPM_EVENT_INSTRUCTION_ISSUED] = tr_instruction_issued_dec;
+            hpm_events[HPM_EVENT_OPERAND_STALL] = tr_operand_stall;
+            hpm_events[HPM_EVENT_UNIT_STALL] = tr_unit_stall;
+            hpm_events[HPM_EVENT_NO_ID_STALL] = tr_no_id_stall;
+            hpm_events[HPM_EVENT_NO_INSTRUCTION_STALL] = tr_no_instruction_stall;
+            hpm_events[HPM_EVENT_OTHER_STALL] = tr_other_stall;
+            hpm_events[HPM_EVENT_BRANCH_OPERAND_STALL] = tr_branch_operand_stall;
+            hpm_events[HPM_EVENT_ALU_OPERAND_STALL] = tr_alu_operand_stall;
+            hpm_events[HPM_EVENT_LS_OPERAND_STALL] = tr_ls_operand_stall;
+            hpm_events[HPM_EVENT_DIV_OPERAND_STALL] = tr_div_operand_stall;
+            hpm_events[HPM_EVENT_LS_UNIT_STALL] = tr_unit_stall & tr_unit_needed_issue_stage[LS_UNIT_WB_ID];
+            hpm_events[HPM_EVENT_LOAD] = tr_load_op;
+            hpm_events[HPM_EVENT_STORE] = tr_store_op;
+            hpm_events[HPM_EVENT_BRANCH_MISSPREDICT] = tr_branch_misspredict;
+            hpm_events[HPM_EVENT_RETURN_MISSPREDICT] = tr_return_misspredict;
+            hpm_events[HPM_EVENT_SP_RX_BUSY] = sp_subunits_busy[SP_SUBUNIT_RX];
+            hpm_events[HPM_EVENT_SP_TX_BUSY] = sp_subunits_busy[SP_SUBUNIT_TX];
+            hpm_events[HPM_EVENT_SP_COMMON_BUSY] = sp_subunits_busy[SP_SUBUNIT_COMMON];
+            hpm_events[HPM_EVENT_SP_ACP_BUSY] = sp_subunits_busy[SP_SUBUNIT_ACP];
+            hpm_events[HPM_EVENT_SP_RX_STALL] = sp_unit_stall & sp_subunits_busy[SP_SUBUNIT_RX];
+            hpm_events[HPM_EVENT_SP_TX_STALL] = sp_unit_stall & sp_subunits_busy[SP_SUBUNIT_TX];
+            hpm_events[HPM_EVENT_SP_COMMON_STALL] = sp_unit_stall & sp_subunits_busy[SP_SUBUNIT_COMMON];
+            hpm_events[HPM_EVENT_SP_ACP_STALL] = sp_unit_stall & sp_subunits_busy[SP_SUBUNIT_ACP];
+        end
+    end
+    else begin
+        always_comb begin
+            hpm_events = '0;
+            hpm_events[HPM_EVENT_CYCLE] = 1;
+        end
+    end
+    endgenerate
+
     ////////////////////////////////////////////////////
     //Trace Interface
     generate if (ENABLE_TRACE_INTERFACE) begin
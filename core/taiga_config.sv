@@ -40,9 +40,15 @@ package taiga_config;
     //CSR counter width (33-64 bits): 48-bits --> 32 days @ 100MHz
     localparam COUNTER_W = 33;
 
+    //Hardware performance counters mhpmcounter3 and up (1-29)
+    localparam NUM_HPM_COUNTERS = 4;
+
     ////////////////////////////////////////////////////
     //ISA Options
 
+    //Compressed instruction (C) extension
+    localparam USE_RVC = 1;
+
     //Multiply and Divide Inclusion
     localparam USE_MUL = 1;
     localparam USE_DIV = 1;
@@ -50,6 +56,12 @@ package taiga_config;
 	// SP Unit 
 	localparam USE_SP = 1;
 
+    //Zbb bit-manipulation extension (in the ALU)
+    localparam USE_ZBB = 1;
+
+    //CRC32C and Toeplitz hash instructions on the CUSTOM1 opcode (in the ALU)
+    localparam USE_HASH = 1;
+
     //Division algorithm selection
     typedef enum {
         RADIX_2,//Smallest
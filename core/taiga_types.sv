@@ -64,6 +64,26 @@ package taiga_types;
         ALU_RS2_RF =2'b11
     } alu_rs2_op_t;
 
+    //Zbb and hash operations whose result bypasses the adder and shifter
+    typedef enum logic [3:0] {
+        ALU_EXT_NONE,
+        ALU_EXT_CLZ,
+        ALU_EXT_CTZ,
+        ALU_EXT_CPOP,
+        ALU_EXT_SEXT_B,
+        ALU_EXT_SEXT_H,
+        ALU_EXT_ZEXT_H,
+        ALU_EXT_MIN,
+        ALU_EXT_MAX,
+        ALU_EXT_ORC_B,
+        ALU_EXT_REV8,
+        ALU_EXT_CRC32C_B,
+        ALU_EXT_CRC32C_H,
+        ALU_EXT_CRC32C_W,
+        ALU_EXT_TOEPLITZ_HI,
+        ALU_EXT_TOEPLITZ_LO
+    } alu_ext_op_t;
+
     typedef struct packed{
         logic valid;
         exception_code_t code;
@@ -80,7 +100,8 @@ package taiga_types;
     typedef struct packed{
         id_t id;
         logic [31:0] pc;
-        logic [31:0] instruction;
+        logic [31:0] instruction;//expanded if compressed
+        logic compressed;
         logic valid;
         logic addr_valid;
     } decode_packet_t;
@@ -101,6 +122,7 @@ package taiga_types;
         id_t id;
         logic stage_valid;
         logic addr_valid;
+        logic compressed;
     } issue_packet_t;
 
     typedef struct packed{
@@ -111,9 +133,12 @@ package taiga_types;
         logic subtract;
         logic arith;//contains sign padding bit for arithmetic shift right operation
         logic lshift;
+        logic rotate;
         alu_logic_op_t logic_op;
+        logic logic_invert;//andn, orn, xnor
         logic shifter_path;
         logic slt_path;
+        alu_ext_op_t ext_op;
     } alu_inputs_t;
 
     typedef struct packed {
@@ -127,6 +152,7 @@ package taiga_types;
         logic jalr;
         logic is_call;
         logic is_return;
+        logic compressed;
         logic [20:0] pc_offset;
     } branch_inputs_t;
 
@@ -138,6 +164,7 @@ package taiga_types;
         logic is_branch_ex;
         logic is_return_ex;
         logic is_call_ex;
+        logic is_compressed_ex;
     } branch_results_t;
 
     typedef struct packed{
@@ -274,6 +301,48 @@ package taiga_types;
         taiga_trace_events_t events;
     } trace_outputs_t;
 
+    //Hardware performance monitor events (the values of mhpmevent)
+    //An mhpmcounter counts the cycles in which its event is present.
+    typedef enum logic [4:0] {
+        HPM_EVENT_NONE,
+        HPM_EVENT_CYCLE,
+        HPM_EVENT_INSTRUCTION_ISSUED,
+        HPM_EVENT_OPERAND_STALL,
+        HPM_EVENT_UNIT_STALL,
+        HPM_EVENT_NO_ID_STALL,
+        HPM_EVENT_NO_INSTRUCTION_STALL,
+        HPM_EVENT_OTHER_STALL,
+        HPM_EVENT_BRANCH_OPERAND_STALL,
+        HPM_EVENT_ALU_OPERAND_STALL,
+        HPM_EVENT_LS_OPERAND_STALL,
+        HPM_EVENT_DIV_OPERAND_STALL,
+        HPM_EVENT_LS_UNIT_STALL,
+        HPM_EVENT_LOAD,
+        HPM_EVENT_STORE,
+        HPM_EVENT_BRANCH_MISSPREDICT,
+        HPM_EVENT_RETURN_MISSPREDICT,
+        //A command of the SP subunit is executing
+        HPM_EVENT_SP_RX_BUSY,
+        HPM_EVENT_SP_TX_BUSY,
+        HPM_EVENT_SP_COMMON_BUSY,
+        HPM_EVENT_SP_ACP_BUSY,
+        //An SP command waits in the issue stage for the busy subunit
+        HPM_EVENT_SP_RX_STALL,
+        HPM_EVENT_SP_TX_STALL,
+        HPM_EVENT_SP_COMMON_STALL,
+        HPM_EVENT_SP_ACP_STALL
+    } hpm_event_t;
+    localparam HPM_NEVENTS = HPM_EVENT_SP_ACP_STALL + 1;
+
+	//Indices of the SP subunits in the event signals of the SP unit
+	typedef enum int {
+		SP_SUBUNIT_RX,
+		SP_SUBUNIT_TX,
+		SP_SUBUNIT_COMMON,
+		SP_SUBUNIT_ACP
+	} sp_subunit_t;
+	localparam SP_NSUBUNITS = SP_SUBUNIT_ACP + 1;
+
 	typedef struct packed {
 		logic [6:0] fn3;
 		logic [6:0] fn7;
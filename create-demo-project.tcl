@@ -3,6 +3,10 @@ set part "xczu9eg-ffvb1156-2-e"
 set ip_repo_base_path "$::env(IP_REPO_BASE_PATH)"
 set proj_path "./${_xil_proj_name_}"
 
+# The GEMs to accelerate and the address map of their SP pairs
+source [file join [file dirname [info script]] prism-sp-ports.tcl]
+set npairs [llength $prism_sp_gems]
+
 start_gui
 
 create_project -part ${part} ${_xil_proj_name_} ${proj_path}
@@ -28,14 +32,20 @@ set_property -name "top" -value "design_1_wrapper" -objects [current_fileset]
 
 set zynq_ultra_ps_e_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:zynq_ultra_ps_e:3.5 zynq_ultra_ps_e_0 ]
 apply_bd_automation -rule xilinx.com:bd_rule:zynq_ultra_ps_e -config {apply_board_preset "1" }  [get_bd_cells zynq_ultra_ps_e_0]
-set prism_sp_openhw_gem3 [ create_bd_cell -type ip -vlnv drehmel.com:user:prism_sp_openhw:1.0 prism_sp_openhw_gem3 ]
-set_property -dict [ list \
-	CONFIG.C_M_AXI_DMA_DATA_WIDTH {128} \
-] $prism_sp_openhw_gem3
+
+# One SP pair per GEM, each with its own GEM FIFO interface and clocks.
+foreach g $prism_sp_gems {
+	set sp [ create_bd_cell -type ip -vlnv drehmel.com:user:prism_sp_openhw:1.0 prism_sp_openhw_gem${g} ]
+	set_property -dict [ list \
+		CONFIG.C_M_AXI_DMA_DATA_WIDTH {128} \
+		CONFIG.C_GEM_BASE_ADDR [prism_sp_gem_base $g] \
+	] $sp
+
+	create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 proc_sys_reset_gem${g}_tx
+	create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 proc_sys_reset_gem${g}_rx
+}
 
 set proc_sys_reset_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 proc_sys_reset_0 ]
-set proc_sys_reset_gem3_tx [ create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 proc_sys_reset_gem3_tx ]
-set proc_sys_reset_gem3_rx [ create_bd_cell -type ip -vlnv xilinx.com:ip:proc_sys_reset:5.0 proc_sys_reset_gem3_rx ]
 set axi_uartlite_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:axi_uartlite:2.0 axi_uartlite_0 ]
 
 set_property -dict [ list \
@@ -45,44 +55,70 @@ set_property -dict [ list \
 
 apply_bd_automation -rule xilinx.com:bd_rule:board -config { Board_Interface {uart2_pl ( UART ) } Manual_Source {Auto}} [get_bd_intf_pins axi_uartlite_0/UART]
 
-# We add a Smartconnect IP for the AXI-Lite interfaces of the SP.
+# We add a Smartconnect IP for the AXI-Lite interfaces and the BRAM windows of the SPs.
+# Each pair has two AXI-Lite interfaces and two BRAM windows.
 set smartconnect_sp_axil [ create_bd_cell -type ip -vlnv xilinx.com:ip:smartconnect:1.0 smartconnect_sp_axil ]
 set_property -dict [ list \
-	CONFIG.NUM_MI {2} \
+	CONFIG.NUM_MI [expr {4 * $npairs}] \
 	CONFIG.NUM_SI {1} \
 ] $smartconnect_sp_axil
 
-# We add a Smartconnect IP for the ACP interfaces of the SP.
+# We add a Smartconnect IP for the ACP interfaces of the SPs.
 set smartconnect_sp_acp [ create_bd_cell -type ip -vlnv xilinx.com:ip:smartconnect:1.0 smartconnect_sp_acp ]
 set_property -dict [ list \
 	CONFIG.NUM_MI {1} \
-	CONFIG.NUM_SI {2} \
+	CONFIG.NUM_SI [expr {2 * $npairs}] \
 ] $smartconnect_sp_acp
 
-# We add a Smartconnect IP for the I/O interfaces of the SP.
+# We add a Smartconnect IP for the I/O interfaces of the SPs.
 set smartconnect_sp_io [ create_bd_cell -type ip -vlnv xilinx.com:ip:smartconnect:1.0 smartconnect_sp_io ]
 set_property -dict [ list \
 	CONFIG.NUM_MI {2} \
-	CONFIG.NUM_SI {2} \
+	CONFIG.NUM_SI [expr {2 * $npairs}] \
 ] $smartconnect_sp_io
 
+# With more than one pair, the DMA interfaces share HPC0 through a Smartconnect IP.
+if {$npairs > 1} {
+	set smartconnect_sp_dma [ create_bd_cell -type ip -vlnv xilinx.com:ip:smartconnect:1.0 smartconnect_sp_dma ]
+	set_property -dict [ list \
+		CONFIG.NUM_MI {1} \
+		CONFIG.NUM_SI $npairs \
+	] $smartconnect_sp_dma
+}
+
+# Three IRQ lines per pair; pairs 0 and 1 go to pl_ps_irq0, pairs 2 and 3 to pl_ps_irq1.
 set xlconcat_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:xlconcat:2.1 xlconcat_0 ]
-set_property CONFIG.NUM_PORTS {3} $xlconcat_0
+set_property CONFIG.NUM_PORTS [expr {3 * min($npairs, 2)}] $xlconcat_0
+if {$npairs > 2} {
+	set xlconcat_1 [ create_bd_cell -type ip -vlnv xilinx.com:ip:xlconcat:2.1 xlconcat_1 ]
+	set_property CONFIG.NUM_PORTS [expr {3 * ($npairs - 2)}] $xlconcat_1
+}
 
 # We add a constant zero to keep pl_acpinact low.
 set xlconstant_0 [ create_bd_cell -type ip -vlnv xilinx.com:ip:xlconstant:1.1 xlconstant_0 ]
 set_property CONFIG.CONST_VAL {0} $xlconstant_0
 
+# The board preset has to route every GEM in the list to its PHY.
+# On the ZCU102, this is only the case for GEM3.
+set gem_protection ""
+set gem_config [ list ]
+foreach g {3 2 1 0} {
+	append gem_protection "|GEM${g}:NonSecure;[expr {$g == 3 || $g in $prism_sp_gems}]"
+}
+foreach g $prism_sp_gems {
+	lappend gem_config \
+		CONFIG.PSU__ENET${g}__FIFO__ENABLE {1} \
+		CONFIG.PSU__IRQ_P2F_ENT${g}__INT {1}
+}
+
 # S_AXI_GP0 is HPC0
 # S_AXI_GP2 is HP0
 # M_AXI_GP0 is HPM0
-set_property -dict [ list \
+set_property -dict [ concat [ list \
 	CONFIG.PSU__CRL_APB__PL0_REF_CTRL__FREQMHZ {300} \
-	CONFIG.PSU__ENET3__FIFO__ENABLE {1} \
 	CONFIG.PSU__EXPAND__LOWER_LPS_SLAVES {1} \
 	CONFIG.PSU__EXPAND__UPPER_LPS_SLAVES {1} \
-	CONFIG.PSU__IRQ_P2F_ENT3__INT {1} \
-	CONFIG.PSU__PROTECTION__MASTERS {USB1:NonSecure;0|USB0:NonSecure;1|S_AXI_LPD:NA;0|S_AXI_HPC1_FPD:NA;0|S_AXI_HPC0_FPD:NA;0|S_AXI_HP3_FPD:NA;0|S_AXI_HP2_FPD:NA;0|S_AXI_HP1_FPD:NA;0|S_AXI_HP0_FPD:NA;1|S_AXI_ACP:NA;0|S_AXI_ACE:NA;0|SD1:NonSecure;1|SD0:NonSecure;0|SATA1:NonSecure;1|SATA0:NonSecure;1|RPU1:Secure;1|RPU0:Secure;1|QSPI:NonSecure;1|PMU:NA;1|PCIe:NonSecure;1|NAND:NonSecure;0|LDMA:NonSecure;1|GPU:NonSecure;1|GEM3:NonSecure;1|GEM2:NonSecure;0|GEM1:NonSecure;0|GEM0:NonSecure;0|FDMA:NonSecure;1|DP:NonSecure;1|DAP:NA;1|Coresight:NA;1|CSU:NA;1|APU:NA;1} \
+	CONFIG.PSU__PROTECTION__MASTERS "USB1:NonSecure;0|USB0:NonSecure;1|S_AXI_LPD:NA;0|S_AXI_HPC1_FPD:NA;0|S_AXI_HPC0_FPD:NA;0|S_AXI_HP3_FPD:NA;0|S_AXI_HP2_FPD:NA;0|S_AXI_HP1_FPD:NA;0|S_AXI_HP0_FPD:NA;1|S_AXI_ACP:NA;0|S_AXI_ACE:NA;0|SD1:NonSecure;1|SD0:NonSecure;0|SATA1:NonSecure;1|SATA0:NonSecure;1|RPU1:Secure;1|RPU0:Secure;1|QSPI:NonSecure;1|PMU:NA;1|PCIe:NonSecure;1|NAND:NonSecure;0|LDMA:NonSecure;1|GPU:NonSecure;1${gem_protection}|FDMA:NonSecure;1|DP:NonSecure;1|DAP:NA;1|Coresight:NA;1|CSU:NA;1|APU:NA;1" \
 	CONFIG.PSU__SAXIGP0__DATA_WIDTH {128} \
 	CONFIG.PSU__SAXIGP2__DATA_WIDTH {128} \
 	CONFIG.PSU__MAXIGP0__DATA_WIDTH {128} \
@@ -91,65 +127,39 @@ set_property -dict [ list \
 	CONFIG.PSU__USE__S_AXI_GP2 {1} \
 	CONFIG.PSU__USE__M_AXI_GP0 {1} \
 	CONFIG.PSU__USE__M_AXI_GP1 {0} \
-  	CONFIG.PSU__USE__S_AXI_ACP {1} \
-] $zynq_ultra_ps_e_0
-
-# Connect the GEM external FIFO interface.
-connect_bd_intf_net [get_bd_intf_pins zynq_ultra_ps_e_0/FIFO_ENET3] [get_bd_intf_pins prism_sp_openhw_gem3/gem]
+	CONFIG.PSU__USE__S_AXI_ACP {1} \
+	CONFIG.PSU__USE__IRQ1 [expr {$npairs > 2}] \
+] $gem_config ] $zynq_ultra_ps_e_0
 
 # Connect the UARTLITE
 connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_io/M01_AXI] [get_bd_intf_pins axi_uartlite_0/S_AXI]
 
-# Connect the AXI-Lite Smartconnect
+# Connect the master sides of the Smartconnects.
 connect_bd_intf_net [get_bd_intf_pins zynq_ultra_ps_e_0/M_AXI_HPM0_FPD] [get_bd_intf_pins smartconnect_sp_axil/S00_AXI]
-connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/M00_AXI] [get_bd_intf_pins prism_sp_openhw_gem3/s_axil_0]
-connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/M01_AXI] [get_bd_intf_pins prism_sp_openhw_gem3/s_axil_1]
-
-# Connect the ACP Smartconnect
 connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_acp/M00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_ACP_FPD]
-connect_bd_intf_net [get_bd_intf_pins prism_sp_openhw_gem3/m_axi_acp_0] [get_bd_intf_pins smartconnect_sp_acp/S00_AXI]
-connect_bd_intf_net [get_bd_intf_pins prism_sp_openhw_gem3/m_axi_acp_1] [get_bd_intf_pins smartconnect_sp_acp/S01_AXI]
-
-# Connect the SP's DMA interface
-connect_bd_intf_net [get_bd_intf_pins prism_sp_openhw_gem3/m_axi_dma] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_HPC0_FPD]
-
-# Connect the I/O Smartconnect
 connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_io/M00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_HP0_FPD]
-connect_bd_intf_net [get_bd_intf_pins prism_sp_openhw_gem3/m_axi_io_0] [get_bd_intf_pins smartconnect_sp_io/S00_AXI]
-connect_bd_intf_net [get_bd_intf_pins prism_sp_openhw_gem3/m_axi_io_1] [get_bd_intf_pins smartconnect_sp_io/S01_AXI]
+if {$npairs > 1} {
+	connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_dma/M00_AXI] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_HPC0_FPD]
+	connect_bd_net [get_bd_pins proc_sys_reset_0/interconnect_aresetn] [get_bd_pins smartconnect_sp_dma/aresetn]
+	connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_clk0] [get_bd_pins smartconnect_sp_dma/aclk]
+}
 
-# Connect the IRQ lines of the SP
-connect_bd_net [get_bd_pins prism_sp_openhw_gem3/gem_irq] [get_bd_pins xlconcat_0/In0]
-connect_bd_net [get_bd_pins prism_sp_openhw_gem3/gem_irq_tx] [get_bd_pins xlconcat_0/In1]
-connect_bd_net [get_bd_pins prism_sp_openhw_gem3/gem_irq_rx] [get_bd_pins xlconcat_0/In2]
 connect_bd_net [get_bd_pins xlconcat_0/dout] [get_bd_pins zynq_ultra_ps_e_0/pl_ps_irq0]
+if {$npairs > 2} {
+	connect_bd_net [get_bd_pins xlconcat_1/dout] [get_bd_pins zynq_ultra_ps_e_0/pl_ps_irq1]
+}
 
 # Connect the constant to the pl_acpinact port.
 connect_bd_net [get_bd_pins xlconstant_0/dout] [get_bd_pins zynq_ultra_ps_e_0/pl_acpinact]
 
-# Connect the RX reset.
-connect_bd_net [get_bd_pins proc_sys_reset_gem3_rx/peripheral_aresetn] [get_bd_pins prism_sp_openhw_gem3/gem_rx_resetn]
-connect_bd_net [get_bd_pins proc_sys_reset_gem3_tx/peripheral_aresetn] [get_bd_pins prism_sp_openhw_gem3/gem_tx_resetn]
-
-connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/fmio_gem3_fifo_rx_clk_to_pl_bufg] \
-	[get_bd_pins prism_sp_openhw_gem3/gem_rx_clock] \
-	[get_bd_pins proc_sys_reset_gem3_rx/slowest_sync_clk]
-
-connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/fmio_gem3_fifo_tx_clk_to_pl_bufg] \
-	[get_bd_pins prism_sp_openhw_gem3/gem_tx_clock] \
-	[get_bd_pins proc_sys_reset_gem3_tx/slowest_sync_clk] \
-
 connect_bd_net [get_bd_pins proc_sys_reset_0/interconnect_aresetn] \
 	[get_bd_pins axi_uartlite_0/s_axi_aresetn] \
 	[get_bd_pins smartconnect_sp_acp/aresetn] \
 	[get_bd_pins smartconnect_sp_io/aresetn] \
 	[get_bd_pins smartconnect_sp_axil/aresetn]
 
-connect_bd_net [get_bd_pins proc_sys_reset_0/peripheral_aresetn] [get_bd_pins prism_sp_openhw_gem3/resetn]
-
 # Connect the PL clock.
 connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_clk0] \
-	[get_bd_pins prism_sp_openhw_gem3/clock] \
 	[get_bd_pins proc_sys_reset_0/slowest_sync_clk] \
 	[get_bd_pins axi_uartlite_0/s_axi_aclk] \
 	[get_bd_pins smartconnect_sp_axil/aclk] \
@@ -161,36 +171,92 @@ connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_clk0] \
 	[get_bd_pins zynq_ultra_ps_e_0/saxiacp_fpd_aclk]
 
 # Connect the PL reset.
-connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_resetn0] \
-	[get_bd_pins proc_sys_reset_0/ext_reset_in] \
-	[get_bd_pins proc_sys_reset_gem3_tx/ext_reset_in] \
-	[get_bd_pins proc_sys_reset_gem3_rx/ext_reset_in]
-
-# Make the raw DDR (low) region available to the ACP interfaces.
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_acp_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIACP/ACP_DDR_LOW] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_acp_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIACP/ACP_DDR_LOW] -force
-
-# Make the raw DDR (low) region available to the DMA interface.
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_dma [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP0/HPC0_DDR_LOW] -force
-
-# Make the necessary regions available to the SP I/O interface.
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART0] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART1] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_GEM3] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_CRL_APB] -force
-assign_bd_address -offset 0xA0010000 -range 0x00000400 -target_address_space /prism_sp_openhw_gem3/m_axi_io_0 [get_bd_addr_segs axi_uartlite_0/S_AXI/Reg] -force
-
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART0] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART1] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_GEM3] -force
-assign_bd_address -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_CRL_APB] -force
-assign_bd_address -offset 0xA0010000 -range 0x00000400 -target_address_space /prism_sp_openhw_gem3/m_axi_io_1 [get_bd_addr_segs axi_uartlite_0/S_AXI/Reg] -force
-
-# Make the memory-mapped registers of the Prism SP available to the PS->PL interface
-assign_bd_address -offset 0xA0006000 -range 0x00000400 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs prism_sp_openhw_gem3/s_axil_0/reg0] -force
-assign_bd_address -offset 0xA0007000 -range 0x00000400 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs prism_sp_openhw_gem3/s_axil_1/reg0] -force
+connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_resetn0] [get_bd_pins proc_sys_reset_0/ext_reset_in]
+
+set i 0
+foreach g $prism_sp_gems {
+	set sp prism_sp_openhw_gem${g}
+	# Smartconnect slave (Sxx) and master (Mxx) interface names of this pair
+	set si [list [format S%02d_AXI [expr {2 * $i}]] [format S%02d_AXI [expr {2 * $i + 1}]]]
+	set mi [lmap n {0 1 2 3} {format M%02d_AXI [expr {4 * $i + $n}]}]
+
+	# Connect the GEM external FIFO interface.
+	connect_bd_intf_net [get_bd_intf_pins zynq_ultra_ps_e_0/FIFO_ENET${g}] [get_bd_intf_pins ${sp}/gem]
+
+	# Connect the AXI-Lite Smartconnect
+	connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/[lindex $mi 0]] [get_bd_intf_pins ${sp}/s_axil_0]
+	connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/[lindex $mi 1]] [get_bd_intf_pins ${sp}/s_axil_1]
+	connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/[lindex $mi 2]] [get_bd_intf_pins ${sp}/s_axi_bram_0]
+	connect_bd_intf_net [get_bd_intf_pins smartconnect_sp_axil/[lindex $mi 3]] [get_bd_intf_pins ${sp}/s_axi_bram_1]
+
+	# Connect the ACP Smartconnect
+	connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_acp_0] [get_bd_intf_pins smartconnect_sp_acp/[lindex $si 0]]
+	connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_acp_1] [get_bd_intf_pins smartconnect_sp_acp/[lindex $si 1]]
+
+	# Connect the SP's DMA interface
+	if {$npairs > 1} {
+		connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_dma] [get_bd_intf_pins smartconnect_sp_dma/[format S%02d_AXI $i]]
+	} else {
+		connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_dma] [get_bd_intf_pins zynq_ultra_ps_e_0/S_AXI_HPC0_FPD]
+	}
+
+	# Connect the I/O Smartconnect
+	connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_io_0] [get_bd_intf_pins smartconnect_sp_io/[lindex $si 0]]
+	connect_bd_intf_net [get_bd_intf_pins ${sp}/m_axi_io_1] [get_bd_intf_pins smartconnect_sp_io/[lindex $si 1]]
+
+	# Connect the IRQ lines of the SP
+	set xlconcat [expr {$i < 2 ? "xlconcat_0" : "xlconcat_1"}]
+	set irq_in [expr {3 * ($i % 2)}]
+	connect_bd_net [get_bd_pins ${sp}/gem_irq] [get_bd_pins ${xlconcat}/In${irq_in}]
+	connect_bd_net [get_bd_pins ${sp}/gem_irq_tx] [get_bd_pins ${xlconcat}/In[expr {$irq_in + 1}]]
+	connect_bd_net [get_bd_pins ${sp}/gem_irq_rx] [get_bd_pins ${xlconcat}/In[expr {$irq_in + 2}]]
+
+	# Connect the RX and TX resets.
+	connect_bd_net [get_bd_pins proc_sys_reset_gem${g}_rx/peripheral_aresetn] [get_bd_pins ${sp}/gem_rx_resetn]
+	connect_bd_net [get_bd_pins proc_sys_reset_gem${g}_tx/peripheral_aresetn] [get_bd_pins ${sp}/gem_tx_resetn]
+
+	connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/fmio_gem${g}_fifo_rx_clk_to_pl_bufg] \
+		[get_bd_pins ${sp}/gem_rx_clock] \
+		[get_bd_pins proc_sys_reset_gem${g}_rx/slowest_sync_clk]
+
+	connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/fmio_gem${g}_fifo_tx_clk_to_pl_bufg] \
+		[get_bd_pins ${sp}/gem_tx_clock] \
+		[get_bd_pins proc_sys_reset_gem${g}_tx/slowest_sync_clk]
+
+	connect_bd_net [get_bd_pins proc_sys_reset_0/peripheral_aresetn] [get_bd_pins ${sp}/resetn]
+	connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_clk0] [get_bd_pins ${sp}/clock]
+	connect_bd_net [get_bd_pins zynq_ultra_ps_e_0/pl_resetn0] \
+		[get_bd_pins proc_sys_reset_gem${g}_tx/ext_reset_in] \
+		[get_bd_pins proc_sys_reset_gem${g}_rx/ext_reset_in]
+
+	# Make the raw DDR (low) region available to the ACP interfaces.
+	assign_bd_address -target_address_space /${sp}/m_axi_acp_0 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIACP/ACP_DDR_LOW] -force
+	assign_bd_address -target_address_space /${sp}/m_axi_acp_1 [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIACP/ACP_DDR_LOW] -force
+
+	# Make the raw DDR (low and high) regions available to the DMA interface.
+	assign_bd_address -target_address_space /${sp}/m_axi_dma [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP0/HPC0_DDR_LOW] -force
+	assign_bd_address -target_address_space /${sp}/m_axi_dma [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP0/HPC0_DDR_HIGH] -force
+
+	# Make the necessary regions available to the SP I/O interfaces.
+	foreach io {m_axi_io_0 m_axi_io_1} {
+		assign_bd_address -target_address_space /${sp}/${io} [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_DDR_LOW] -force
+		assign_bd_address -target_address_space /${sp}/${io} [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART0] -force
+		assign_bd_address -target_address_space /${sp}/${io} [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_UART1] -force
+		assign_bd_address -target_address_space /${sp}/${io} [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_GEM${g}] -force
+		assign_bd_address -target_address_space /${sp}/${io} [get_bd_addr_segs zynq_ultra_ps_e_0/SAXIGP2/HP0_CRL_APB] -force
+		assign_bd_address -offset 0xA0010000 -range 0x00000400 -target_address_space /${sp}/${io} [get_bd_addr_segs axi_uartlite_0/S_AXI/Reg] -force
+	}
+
+	# Make the memory-mapped registers of the Prism SP available to the PS->PL interface
+	assign_bd_address -offset [prism_sp_mmr_addr $i tx] -range 0x00000400 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs ${sp}/s_axil_0/reg0] -force
+	assign_bd_address -offset [prism_sp_mmr_addr $i rx] -range 0x00000400 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs ${sp}/s_axil_1/reg0] -force
+
+	# Make the BRAM windows (IBRAM followed by DBRAM) available for loading the firmware
+	assign_bd_address -offset [prism_sp_bram_addr $i tx] -range 0x00010000 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs ${sp}/s_axi_bram_0/reg0] -force
+	assign_bd_address -offset [prism_sp_bram_addr $i rx] -range 0x00010000 -target_address_space /zynq_ultra_ps_e_0/Data [get_bd_addr_segs ${sp}/s_axi_bram_1/reg0] -force
+
+	incr i
+}
 
 regenerate_bd_layout
 validate_bd_design
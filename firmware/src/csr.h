@@ -73,4 +73,77 @@ static inline uint64_t csr_read_instret()
 	return (uint64_t)x << 32 | y;
 }
 
+/*
+ * Hardware performance monitor
+ * (see hpm_event_t in core/taiga_types.sv)
+ */
+#define CSR_MHPMCOUNTER3			0xb03
+#define CSR_MHPMCOUNTER3H			0xb83
+#define CSR_MHPMEVENT3				0x323
+#define CSR_NHPMCOUNTERS			4
+
+enum {
+	HPM_EVENT_NONE,
+	HPM_EVENT_CYCLE,
+	HPM_EVENT_INSTRUCTION_ISSUED,
+	HPM_EVENT_OPERAND_STALL,
+	HPM_EVENT_UNIT_STALL,
+	HPM_EVENT_NO_ID_STALL,
+	HPM_EVENT_NO_INSTRUCTION_STALL,
+	HPM_EVENT_OTHER_STALL,
+	HPM_EVENT_BRANCH_OPERAND_STALL,
+	HPM_EVENT_ALU_OPERAND_STALL,
+	HPM_EVENT_LS_OPERAND_STALL,
+	HPM_EVENT_DIV_OPERAND_STALL,
+	HPM_EVENT_LS_UNIT_STALL,
+	HPM_EVENT_LOAD,
+	HPM_EVENT_STORE,
+	HPM_EVENT_BRANCH_MISSPREDICT,
+	HPM_EVENT_RETURN_MISSPREDICT,
+	HPM_EVENT_SP_RX_BUSY,
+	HPM_EVENT_SP_TX_BUSY,
+	HPM_EVENT_SP_COMMON_BUSY,
+	HPM_EVENT_SP_ACP_BUSY,
+	HPM_EVENT_SP_RX_STALL,
+	HPM_EVENT_SP_TX_STALL,
+	HPM_EVENT_SP_COMMON_STALL,
+	HPM_EVENT_SP_ACP_STALL
+};
+
+/*
+ * Selects the event counted by mhpmcounter(3+n) and resets the counter.
+ * 'n' must be a constant.
+ */
+#define csr_hpm_setup(n, event) \
+	asm volatile ( \
+		"csrw	%0, zero\n" \
+		"csrw	%1, zero\n" \
+		"csrw	%2, zero\n" \
+		"csrw	%0, %3\n" \
+		: \
+		: "i" (CSR_MHPMEVENT3 + (n)), "i" (CSR_MHPMCOUNTER3 + (n)), \
+		  "i" (CSR_MHPMCOUNTER3H + (n)), "r" (event) \
+		: \
+	)
+
+/*
+ * Reads mhpmcounter(3+n).
+ * 'n' must be a constant.
+ */
+#define csr_hpm_read(n) \
+	({ \
+		uint32_t _x, _y, _z; \
+		asm volatile ( \
+			"csr_hpm_read_again_%=:\n" \
+			"		csrr	%0, %3\n" \
+			"		csrr	%1, %4\n" \
+			"		csrr	%2, %3\n" \
+			"		bne		%0, %2, csr_hpm_read_again_%=\n" \
+			: "=r" (_x), "=r" (_y), "=r" (_z) \
+			: "i" (CSR_MHPMCOUNTER3H + (n)), "i" (CSR_MHPMCOUNTER3 + (n)) \
+			: \
+		); \
+		(uint64_t)_x << 32 | _y; \
+	})
+
 #endif
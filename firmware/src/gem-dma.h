@@ -20,6 +20,8 @@
 #define GEM_RX_DD0_VALID_BITN					0
 #define GEM_RX_DD0_WRAP_BITN					1
 #define GEM_RX_DD0_ADDR_BITN					2
+// Only with extended (time stamp) descriptors
+#define GEM_RX_DD0_TS_VALID_BITN				2
 
 #define GEM_RX_DD1_FRAME_LENGTH_BITN			0
 #define GEM_RX_DD1_OFFSET_BITN					12
@@ -40,16 +42,55 @@
 #define GEM_TX_DD0_ADDR_BITN					0
 #define GEM_TX_DD1_EOF_BITN						15
 #define GEM_TX_DD1_NOCRC_BITN					16
+// Large send offload, as in the first descriptor of a frame
+#define GEM_TX_DD1_LSO_BITN						17
+#define GEM_TX_DD1_LSO_WIDTH					2
+#define GEM_TX_DD1_LSO_TSO						2
+// The MSS, as in all but the first descriptor of an LSO frame
+#define GEM_TX_DD1_MSS_BITN						16
+#define GEM_TX_DD1_MSS_WIDTH					14
+// Only with extended (time stamp) descriptors
+#define GEM_TX_DD1_TS_VALID_BITN				23
+// The frame was aborted because its data did not arrive in time.
+#define GEM_TX_DD1_UNDERRUN_BITN				28
 #define GEM_TX_DD1_WRAP_BITN					30
 #define GEM_TX_DD1_VALID_BITN					31
 
 #define GEM3_BASE								0xff0e0000
 #define GEM_NETWORK_CONFIG_OFFSET				0x004
+#define GEM_DMA_CONFIG_OFFSET					0x010
 #define GEM_RECEIVE_Q_PTR_OFFSET				0x018
 #define GEM_TRANSMIT_Q_PTR_OFFSET				0x01c
+#define GEM_TX_PAUSE_QUANTUM_OFFSET				0x03c
 #define GEM_EXTERNAL_FIFO_INTERFACE_OFFSET		0x04c
+#define GEM_SPEC_ADD1_BOTTOM_OFFSET				0x088
+#define GEM_SPEC_ADD1_TOP_OFFSET				0x08c
 #define GEM_TRANSMIT_Q1_PTR_OFFSET				0x440
 #define GEM_RECEIVE_Q1_PTR_OFFSET				0x480
+#define GEM_DMA_RXBUF_SIZE_Q1_OFFSET			0x4a0
+// The upper 32 bits of the addresses of all TX or RX rings
+// (only with 64-bit descriptors)
+#define GEM_UPPER_TX_Q_BASE_OFFSET				0x4c8
+#define GEM_UPPER_RX_Q_BASE_OFFSET				0x4d4
+
+// The quantum the driver has set up for PAUSE frames
+#define GEM_TX_PAUSE_QUANTUM_MASK				0xffff
+
+// The link speed: 100 Mb/s if SPEED is set, 1 Gb/s if GIGABIT is set
+#define GEM_NETWORK_CONFIG_SPEED_BITN			0
+#define GEM_NETWORK_CONFIG_GIGABIT_BITN			10
+
+// The number of bytes the received data is offset from the start of
+// the first buffer of a frame (e.g. NET_IP_ALIGN)
+#define GEM_NETWORK_CONFIG_RX_BUF_OFFSET_BITN	14
+#define GEM_NETWORK_CONFIG_RX_BUF_OFFSET_WIDTH	2
+
+// The RX buffer size fields count in units of 64 bytes.
+#define GEM_DMA_CONFIG_RX_BUF_SIZE_BITN			16
+#define GEM_DMA_CONFIG_RX_BUF_SIZE_WIDTH		8
+#define GEM_DMA_RXBUF_SIZE_Q1_BITN				0
+#define GEM_DMA_RXBUF_SIZE_Q1_WIDTH				8
+#define GEM_DMA_RX_BUF_SIZE_UNIT				64
 
 static inline uint32_t
 gem_tx_dma_desc0_get_addr(gem_tx_dma_desc_word_type desc)
@@ -73,7 +114,8 @@ gem_rx_dma_desc0_get_addr(gem_rx_dma_desc_word_type desc)
 static inline int
 gem_rx_dma_desc1_get_length(gem_rx_dma_desc_word_type desc)
 {
-	return desc & 0x1fff;
+	// 13:0 is the frame length if jumbo frames are enabled
+	return desc & 0x3fff;
 }
 
 #endif // _GEM_DMA_H_
@@ -59,6 +59,15 @@
 
 #define GEM_NETWORK_CONFIG_DATA_BUS_WIDTH_BITN	21
 #define TX_META_DESC_NO_CRC_BITN		31
+#define TX_META_DESC_TSTAMP_BITN		30
+// The meta data is pushed before all of the frame's data is transferred.
+#define TX_META_DESC_CUT_THROUGH_BITN	29
+// The frame has a launch time in the TX launch FIFO.
+#define TX_META_DESC_LAUNCH_BITN		28
+// 27:24 is returned with the time stamp of the frame.
+#define TX_META_DESC_TS_TAG_BITN		24
+// 23:16 is the number of header bytes to take from the TX header FIFO
+#define TX_META_DESC_HDR_LEN_BITN		16
 
 typedef uint32_t gem_rx_meta_desc_type;
 typedef uint32_t gem_tx_meta_desc_type;
@@ -78,7 +87,8 @@ gem_write_reg(volatile void *base, int offset, uint32_t x)
 static inline int
 gem_rx_meta_desc_get_length(gem_rx_meta_desc_type desc)
 {
-	return desc & 0x1fff;
+	// 13:0 is the frame length (jumbo frames included)
+	return desc & 0x3fff;
 }
 
 static inline int
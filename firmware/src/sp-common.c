@@ -14,16 +14,115 @@
  * limitations under the License.
  */
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "sp.h"
+#include "sp-desc.h"
 
+/*
+ * The ACP RAM holds the two 64-byte prefetch areas of the queues,
+ * followed by a 16-byte scratch area for each queue.
+ */
 void
 sp_gem_queue_init(struct sp_gem_queue *queue, int i)
 {
 	queue->scratch_addr = (void *)(uintptr_t)(0x30000 + 2 * 64 + i * 16);
 }
 
+/*
+ * The upper address bits of the ring in dma_desc_base_h are only used
+ * with 64-bit descriptors.
+ */
+void
+sp_desc_queue_init(struct sp_desc_gem_queue *q, uint32_t dma_desc_base,
+	uint32_t dma_desc_base_h)
+{
+	uint32_t control = sp_load_reg(SP_REGN_CONTROL);
+
+	q->ts = (control & (1 << SP_CONTROL_EXT_DESC_TS_BITN)) != 0;
+	q->addr64 = (control & (1 << SP_CONTROL_64BIT_DESC_BITN)) != 0;
+
+	if (q->ts && q->addr64)
+		q->ndescwords = SP_DESC_64BIT_TS_NWORDS;
+	else if (q->addr64)
+		q->ndescwords = SP_DESC_64BIT_NWORDS;
+	else if (q->ts)
+		q->ndescwords = SP_DESC_TS_NWORDS;
+	else
+		q->ndescwords = SP_DESC_NWORDS;
+	q->ts_wordn = q->addr64 ? SP_DESC_64BIT_TS_WORDN : SP_DESC_TS_WORDN;
+
+	q->dma_desc_base = dma_desc_base;
+	if (q->addr64)
+		q->dma_desc_base |= (dma_addr_t)dma_desc_base_h << 32;
+	q->cur_dma_desc_addr = q->dma_desc_base;
+	q->prefetch_primed = 0;
+}
+
+/*
+ * Reads the 64-byte line of the current descriptor into the prefetch
+ * area of the queue. If the descriptor goes on in the next line, its
+ * rest is in the first 16 bytes of that line. They are read in place of
+ * the first 16 bytes of the prefetch area, which only hold descriptors
+ * before the current one (see sp_desc_prefetch_word()).
+ */
+void
+sp_desc_prefetch(struct sp_desc_gem_queue *q)
+{
+	dma_addr_t line_addr = q->cur_dma_desc_addr & ~(dma_addr_t)(64 - 1);
+	uint32_t end = ((uint32_t)q->cur_dma_desc_addr & (64 - 1)) + q->ndescwords * 4;
+
+	while (sp_acp_busy()) {
+	}
+	sp_acp_read_start_64((uint32_t)q->prefetch_addr, line_addr);
+	if (end > 64) {
+		while (sp_acp_busy()) {
+		}
+		sp_acp_read_start_16((uint32_t)q->prefetch_addr, line_addr + 64);
+	}
+	while (sp_acp_busy()) {
+	}
+	q->prefetch_primed = 1;
+}
+
+/*
+ * Writes the words of the descriptor at dma_desc_addr that are set in
+ * wmask (bit n for word n) through the ACP, with the scratch area of the
+ * queue as the buffer. A descriptor covers at most two 128-bit words.
+ * The second one is written first, so words 0 and 1, which hand the
+ * descriptor back, are written last.
+ * Returns without waiting for the last write.
+ */
+void
+sp_desc_write(struct sp_desc_gem_queue *q, dma_addr_t dma_desc_addr,
+	const uint32_t *words, int wmask)
+{
+	volatile uint32_t *scratch_addr = q->base.scratch_addr;
+	dma_addr_t line_addr = dma_desc_addr & ~(dma_addr_t)(16 - 1);
+	// The position of the descriptor in its 128-bit word
+	int first = (dma_desc_addr & (16 - 1)) / 4;
+	uint32_t lines_wmask = (uint32_t)wmask << first;
+
+	for (int i = 1; i >= 0; i--) {
+		uint32_t line_wmask = (lines_wmask >> (i * 4)) & 0xf;
+		uint16_t wstrb = 0;
+
+		if (line_wmask == 0)
+			continue;
+		while (sp_acp_busy()) {
+		}
+		for (int j = 0; j < 4; j++) {
+			if (line_wmask & (1 << j)) {
+				scratch_addr[j] = words[i * 4 + j - first];
+				wstrb |= 0xf << (j * 4);
+			}
+		}
+		sp_acp_set_remote_wstrb_0(wstrb);
+		sp_acp_write_start_16((uint32_t)scratch_addr, line_addr + i * 16);
+	}
+}
+
 void
 prism_hexdump(const void *na, int nbytes)
 {
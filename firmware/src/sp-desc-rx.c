@@ -13,8 +13,11 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 
+#include "csr.h"
 #include "sp.h"
 #include "sp-desc.h"
 #include "sp-desc-rx.h"
@@ -27,6 +30,32 @@ extern struct sp_config rx_config;
 
 struct sp_desc_gem_rx_queue rx_queues[NQUEUES];
 
+// Frames up to the copy-break threshold go to this queue.
+// The driver is expected to fill it with small buffers.
+#define RX_COPYBREAK_QUEUE	1
+// The size of the record header in the slots of the capture ring
+// (see rx_mirror())
+#define RX_MIRROR_HDR_SIZE	16
+
+// The registers of the GEM this SP is attached to
+static void *gem_base;
+static int rx_hdr_split_length;
+static bool rx_hdr_split_parse;
+static int rx_copybreak;
+static int rx_stash;
+static int rx_buf_offset;
+static int rx_lro_max_nsegs;
+static uint32_t rx_lro_timeout;
+static bool rx_vlan_strip;
+static bool rx_flow_ctrl_enabled;
+// Word 3 of the descriptors of the current frame (64-bit descriptors)
+static gem_rx_dma_desc_word_type rx_vlan_desc;
+static int rx_mirror_snaplen;
+static uint32_t rx_mirror_filter;
+static dma_addr_t rx_mirror_ring_base;
+static int rx_mirror_nslots;
+static int rx_mirror_slot_size;
+
 void prism_hexdump(const void *na, int nbytes);
 
 int
@@ -38,27 +67,196 @@ rx_queue_no(struct sp_desc_gem_rx_queue *rx_queue)
 void
 load_desc_rx_config(void)
 {
-	rx_queues[0].q.dma_desc_base =
-		(gem_rx_dma_desc_word_type *)sp_load_reg(SP_REGN_RX_DMA_DESC_BASE_0);
-	rx_queues[0].q.cur_dma_desc_addr = rx_queues[0].q.dma_desc_base;
+	gem_base = (void *)sp_load_reg(SP_REGN_GEM_BASE);
+	printf("GEM registers are at %p\n", gem_base);
 
-	rx_queues[1].q.dma_desc_base =
-		(gem_rx_dma_desc_word_type *)sp_load_reg(SP_REGN_RX_DMA_DESC_BASE_1);
-	rx_queues[1].q.cur_dma_desc_addr = rx_queues[1].q.dma_desc_base;
+	uint32_t dma_config = gem_read_reg(gem_base, GEM_DMA_CONFIG_OFFSET);
+	rx_queues[0].buf_size = GEM_DMA_RX_BUF_SIZE_UNIT *
+		((dma_config >> GEM_DMA_CONFIG_RX_BUF_SIZE_BITN) & ((1 << GEM_DMA_CONFIG_RX_BUF_SIZE_WIDTH) - 1));
+	uint32_t rxbuf_size_q1 = gem_read_reg(gem_base, GEM_DMA_RXBUF_SIZE_Q1_OFFSET);
+	rx_queues[1].buf_size = GEM_DMA_RX_BUF_SIZE_UNIT *
+		((rxbuf_size_q1 >> GEM_DMA_RXBUF_SIZE_Q1_BITN) & ((1 << GEM_DMA_RXBUF_SIZE_Q1_WIDTH) - 1));
 
+	// All RX rings share the upper address bits.
+	uint32_t dma_desc_base_h = gem_read_reg(gem_base, GEM_UPPER_RX_Q_BASE_OFFSET);
 	for (int i = 0; i < NQUEUES; i++) {
-		rx_queues[i].q.prefetch_primed = 0;
+		sp_desc_queue_init(&rx_queues[i].q,
+			sp_load_reg(SP_REGN_RX_DMA_DESC_BASE_0 + i), dma_desc_base_h);
 		rx_queues[i].q.prefetch_addr = (void *)(uintptr_t)(0x30000 + i * 64);
 		sp_gem_queue_init(&rx_queues[i].q.base, i);
 	}
 
-	printf("Descriptor base of RX queue 0 is at %p\n", rx_queues[0].q.dma_desc_base);
-	printf("Descriptor base of RX queue 1 is at %p\n", rx_queues[1].q.dma_desc_base);
+	for (int i = 0; i < NQUEUES; i++) {
+		printf("Descriptor base of RX queue %d is at 0x%02x%08x\n", i,
+			(uint32_t)(rx_queues[i].q.dma_desc_base >> 32),
+			(uint32_t)rx_queues[i].q.dma_desc_base);
+	}
+	printf("Buffer size of RX queue 0 is %d\n", rx_queues[0].buf_size);
+	printf("Buffer size of RX queue 1 is %d\n", rx_queues[1].buf_size);
+
+	// The DMA engine can write to unaligned addresses, so we can honor
+	// the buffer offset the driver configured in the GEM.
+	uint32_t network_config = gem_read_reg(gem_base, GEM_NETWORK_CONFIG_OFFSET);
+	rx_buf_offset = (network_config >> GEM_NETWORK_CONFIG_RX_BUF_OFFSET_BITN) &
+		((1 << GEM_NETWORK_CONFIG_RX_BUF_OFFSET_WIDTH) - 1);
+	printf("Buffer offset is %d\n", rx_buf_offset);
+
+	uint32_t hdr_split = sp_load_reg(SP_REGN_RX_HDR_SPLIT);
+	rx_hdr_split_length = hdr_split & SP_RX_HDR_SPLIT_LENGTH_MASK;
+	rx_hdr_split_parse = (hdr_split >> SP_RX_HDR_SPLIT_PARSE_BITN) & 1;
+	rx_copybreak = sp_load_reg(SP_REGN_RX_COPYBREAK) & SP_RX_COPYBREAK_LENGTH_MASK;
+	// With copy-break, the length of a frame selects its ring and not
+	// its VLAN priority, so it cannot be combined with the RX queue map.
+	if (rx_copybreak != 0 && sp_load_reg(SP_REGN_RX_QUEUE_MAP) != 0) {
+		printf("Copy-break is disabled because the RX queue map is in use.\n");
+		rx_copybreak = 0;
+		sp_store_reg(SP_REGN_STATUS, sp_load_reg(SP_REGN_STATUS) |
+			(uint32_t)1 << SP_STATUS_RX_COPYBREAK_OFF_BITN);
+	}
+
+	printf("Header split length is %d%s\n", rx_hdr_split_length,
+		rx_hdr_split_parse ? " (parsed)" : "");
+	printf("Copy-break threshold is %d\n", rx_copybreak);
+
+	// Stashing goes through the ACP port, which is 128 bits wide.
+	if (rx_config.data_fifo_width == 128)
+		rx_stash = sp_load_reg(SP_REGN_RX_STASH) & SP_RX_STASH_LENGTH_MASK;
+	printf("Stash threshold is %d\n", rx_stash);
+
+	uint32_t lro = sp_load_reg(SP_REGN_RX_LRO);
+	rx_lro_max_nsegs = lro & SP_RX_LRO_MAX_NSEGS_MASK;
+	rx_lro_timeout = (lro >> SP_RX_LRO_TIMEOUT_BITN) << 8;
+
+	rx_vlan_strip = (sp_load_reg(SP_REGN_VLAN) >> SP_VLAN_RX_STRIP_BITN) & 1;
+
+	// LRO needs the payload of each segment on a new RX data FIFO word.
+	// So does header/data split to split the parsed headers exactly.
+	bool align_payload = rx_lro_max_nsegs != 0 ||
+		(rx_hdr_split_length != 0 && rx_hdr_split_parse);
+	sp_rx_config((align_payload ? 1 << SP_RX_CONFIG_ALIGN_PAYLOAD_BITN : 0) |
+		(rx_vlan_strip ? 1 << SP_RX_CONFIG_STRIP_VLAN_BITN : 0));
+
+	printf("LRO is %s (%d segments, %lu cycles)\n",
+		rx_lro_max_nsegs != 0 ? "enabled" : "disabled",
+		rx_lro_max_nsegs, (unsigned long)rx_lro_timeout);
+	printf("VLAN stripping is %s\n", rx_vlan_strip ? "enabled" : "disabled");
+
+	uint32_t flow_ctrl_high = sp_load_reg(SP_REGN_RX_FLOW_CTRL) & SP_RX_FLOW_CTRL_HIGH_MASK;
+	rx_flow_ctrl_enabled = flow_ctrl_high != 0;
+
+	printf("Flow control is %s (high-water mark %lu)\n",
+		rx_flow_ctrl_enabled ? "enabled" : "disabled",
+		(unsigned long)sp_rx_flow_high());
+	if (sp_rx_flow_high() != flow_ctrl_high) {
+		printf("Warning: The high-water mark %lu leaves no room for a frame of maximum length.\n",
+			(unsigned long)flow_ctrl_high);
+	}
+	printf("RX queue map is 0x%08lx\n", (unsigned long)sp_load_reg(SP_REGN_RX_QUEUE_MAP));
+
+	rx_mirror_snaplen = sp_load_reg(SP_REGN_RX_MIRROR) & SP_RX_MIRROR_SNAPLEN_MASK;
+	rx_mirror_filter = sp_load_reg(SP_REGN_RX_MIRROR_FILTER);
+	rx_mirror_ring_base = sp_load_reg(SP_REGN_RX_MIRROR_RING_BASE) |
+		(dma_addr_t)(sp_load_reg(SP_REGN_RX_MIRROR_RING_BASE_H) & 0xff) << 32;
+	uint32_t mirror_ring_size = sp_load_reg(SP_REGN_RX_MIRROR_RING_SIZE);
+	rx_mirror_nslots = mirror_ring_size & SP_RX_MIRROR_RING_NSLOTS_MASK;
+	rx_mirror_slot_size = mirror_ring_size >> SP_RX_MIRROR_RING_SLOT_SIZE_BITN;
+	if (rx_mirror_snaplen > SP_RX_MIRROR_MAX_LENGTH)
+		rx_mirror_snaplen = SP_RX_MIRROR_MAX_LENGTH;
+	if (rx_mirror_snaplen > rx_mirror_slot_size - RX_MIRROR_HDR_SIZE)
+		rx_mirror_snaplen = rx_mirror_slot_size - RX_MIRROR_HDR_SIZE;
+	if (rx_mirror_snaplen < 0 || (rx_mirror_nslots & (rx_mirror_nslots - 1)) != 0)
+		rx_mirror_snaplen = 0;
+	if (rx_mirror_nslots == 0 || rx_mirror_ring_base == 0)
+		rx_mirror_snaplen = 0;
+	// The record headers are written with 16-byte ACP transfers, which
+	// ignore the low address bits.
+	if (rx_mirror_slot_size < RX_MIRROR_HDR_SIZE || rx_mirror_slot_size % 64 != 0 ||
+			rx_mirror_ring_base % 64 != 0)
+		rx_mirror_snaplen = 0;
+
+	printf("Mirroring is %s (%d bytes, filter 0x%04lx, %d slots of %d bytes at 0x%02lx%08lx)\n",
+		rx_mirror_snaplen != 0 ? "enabled" : "disabled", rx_mirror_snaplen,
+		(unsigned long)(rx_mirror_filter & 0xffff), rx_mirror_nslots,
+		rx_mirror_slot_size, (unsigned long)(rx_mirror_ring_base >> 32),
+		(unsigned long)(uint32_t)rx_mirror_ring_base);
+}
+
+/*
+ * VLAN stripping
+ *
+ * The hardware removes the VLAN tag of received frames and passes its
+ * TCI on in the RX meta FIFO. The priority and CFI go into the VLAN bits
+ * of descriptor word 1. With 64-bit descriptors, the whole TCI also goes
+ * into word 3 (see rx_vlan_desc).
+ */
+static gem_rx_meta_desc_type
+rx_vlan_meta_desc(gem_rx_meta_desc_type meta_desc)
+{
+	rx_vlan_desc = 0;
+	if (!rx_vlan_strip)
+		return meta_desc;
+
+	uint32_t vlan_info = sp_rx_meta_get(7);
+	if (!(vlan_info & (1 << SP_RX_VLAN_INFO_STRIPPED_BITN)))
+		return meta_desc;
+
+	uint32_t tci = vlan_info & SP_RX_VLAN_INFO_TCI_MASK;
+	rx_vlan_desc = 1 << SP_DESC_VLAN_VALID_BITN | tci;
+
+	meta_desc |= 1 << GEM_RX_DD1_VLAN_TAGGED_BITN;
+	// VLAN ID 0 only carries the priority.
+	if ((tci & 0xfff) == 0)
+		meta_desc |= 1 << GEM_RX_DD1_PRTY_TAGGED_BITN;
+	meta_desc |= ((tci >> 13) & 0x7) << GEM_RX_DD1_TCI_BITN;
+	meta_desc |= ((tci >> 12) & 0x1) << GEM_RX_DD1_CFI_BITN;
+	return meta_desc;
+}
+
+/*
+ * Returns the number of bytes to put into the first buffer of a frame
+ * with header/data split, or 0 if the frame should not be split.
+ * Frames whose payload the hardware has aligned are split in rx().
+ */
+static int
+rx_get_split_length(int data_length, uint32_t hdr_info)
+{
+	int split_length = rx_hdr_split_length;
+	int hdr_length = 0;
+
+	if (split_length == 0)
+		return 0;
+	if (rx_hdr_split_parse) {
+		// Only split frames whose headers we actually know about.
+		if (!(hdr_info & (1 << SP_RX_HDR_INFO_IPV4_BITN | 1 << SP_RX_HDR_INFO_IPV6_BITN)))
+			return 0;
+		hdr_length = sp_rx_hdr_info_get_hdr_len(hdr_info);
+		if (hdr_length < split_length)
+			split_length = hdr_length;
+	}
+	// The RX data FIFO can only be split on word boundaries.
+	// Rounding up would put payload bytes into the header buffer, so
+	// parsed headers that do not end on one are not split at all.
+	int fifo_width = rx_config.data_fifo_width / 8;
+	if (split_length & (fifo_width - 1)) {
+		if (split_length == hdr_length)
+			return 0;
+		split_length &= ~(fifo_width - 1);
+	}
+	if (split_length >= data_length)
+		return 0;
+	return split_length;
 }
 
 struct gem_rx_dma_desc {
 	gem_rx_dma_desc_word_type dma_desc_0;
 	gem_rx_dma_desc_word_type dma_desc_1;
+	// Only with 64-bit descriptors: the upper address bits
+	gem_rx_dma_desc_word_type dma_desc_2;
+	// Only with 64-bit descriptors: the VLAN tag of the frame
+	gem_rx_dma_desc_word_type dma_desc_vlan;
+	// Only with extended (time stamp) descriptors
+	gem_rx_dma_desc_word_type dma_desc_ts_1;
+	gem_rx_dma_desc_word_type dma_desc_ts_2;
 };
 
 #define PRISM_SP_DESC_RX_OPT
@@ -73,34 +271,26 @@ sp_desc_rx_get_desc(
 	// in between. You would trigger the prefetching again.
 
 	for (int i = 0; i < 2; i++) {
-		register gem_rx_dma_desc_word_type *prefetch_addr = rx_queue->q.prefetch_addr;
 		if (!rx_queue->q.prefetch_primed) {
-			while (sp_acp_busy()) {
-			}
-
 #ifdef DEBUG
-			printf("[rx%d,cur=%p] read(0x%08x, 0x%08x)\n",
+			printf("[rx%d,cur=0x%02x%08x] read(0x%08x)\n",
 				rx_queue_no(rx_queue),
-				rx_queue->q.cur_dma_desc_addr,
-				(uint32_t)prefetch_addr,
-				(uint32_t)rx_queue->q.cur_dma_desc_addr & ~(uint32_t)(64 - 1));
+				(uint32_t)(rx_queue->q.cur_dma_desc_addr >> 32),
+				(uint32_t)rx_queue->q.cur_dma_desc_addr,
+				(uint32_t)rx_queue->q.prefetch_addr);
 #endif
-
-			sp_acp_read_start_64((uint32_t)prefetch_addr, (uint32_t)rx_queue->q.cur_dma_desc_addr & ~(uint32_t)(64 - 1));
-
-			while (sp_acp_busy()) {
-			}
-
-			rx_queue->q.prefetch_primed = 1;
+			sp_desc_prefetch(&rx_queue->q);
+		}
+		desc->dma_desc_0 = sp_desc_prefetch_word(&rx_queue->q, 0);
+		desc->dma_desc_1 = sp_desc_prefetch_word(&rx_queue->q, 1);
+		if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+			desc->dma_desc_2 = sp_desc_prefetch_word(&rx_queue->q, SP_DESC_ADDRH_WORDN);
 		}
-		prefetch_addr = (gem_rx_dma_desc_word_type *)((uint32_t)prefetch_addr | ((uint32_t)rx_queue->q.cur_dma_desc_addr & (64 - 1)));
-		desc->dma_desc_0 = prefetch_addr[0];
-		desc->dma_desc_1 = prefetch_addr[1];
 #ifdef DEBUG
-		printf("[rx%d,cur=%p] prefetch_addr=0x%08x [0]=0x%08x [1]=0x%08x\n",
+		printf("[rx%d,cur=0x%02x%08x] [0]=0x%08x [1]=0x%08x\n",
 			rx_queue_no(rx_queue),
-			rx_queue->q.cur_dma_desc_addr,
-			(uint32_t)prefetch_addr,
+			(uint32_t)(rx_queue->q.cur_dma_desc_addr >> 32),
+			(uint32_t)rx_queue->q.cur_dma_desc_addr,
 			desc->dma_desc_0,
 			desc->dma_desc_1);
 #endif
@@ -113,65 +303,57 @@ sp_desc_rx_get_desc(
 	return 1;
 }
 
+/*
+ * Writes the descriptor back. The upper address bits of 64-bit
+ * descriptors are left alone.
+ * Returns without waiting for the write.
+ */
 static inline void
-sp_desc_rx_set_desc_(
+sp_desc_rx_set_desc(
 	struct sp_desc_gem_rx_queue *rx_queue,
-	gem_rx_dma_desc_word_type dma_desc_0,
-	gem_rx_dma_desc_word_type dma_desc_1
+	struct gem_rx_dma_desc *desc
 )
 {
-	register gem_rx_dma_desc_word_type *prefetch_addr = rx_queue->q.prefetch_addr;
-	prefetch_addr = (gem_rx_dma_desc_word_type *)((uint32_t)prefetch_addr | ((uint32_t)rx_queue->q.cur_dma_desc_addr & (64 - 1)));
-	prefetch_addr[0] = dma_desc_0;
-	prefetch_addr[1] = dma_desc_1;
+	uint32_t words[SP_DESC_64BIT_TS_NWORDS] = { desc->dma_desc_0, desc->dma_desc_1 };
+	int wmask = 0x3;
 
-	register uint32_t cur_dma_desc_addr = (uint32_t)rx_queue->q.cur_dma_desc_addr;
-
-	while (sp_acp_busy()) {
+	if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+		words[SP_DESC_VLAN_WORDN] = desc->dma_desc_vlan;
+		wmask |= 1 << SP_DESC_VLAN_WORDN;
 	}
-	// Set the write strobes.
-	// Words 0 and 1 are in the LSBs.
-	// Words 2 and 3 are in the MSBs.
-	if (cur_dma_desc_addr & (16 / 2)) {
-		sp_acp_set_remote_wstrb_0(0x0000ff00);
+	if (sp_desc_queue_has_ts(&rx_queue->q)) {
+		words[rx_queue->q.ts_wordn] = desc->dma_desc_ts_1;
+		words[rx_queue->q.ts_wordn + 1] = desc->dma_desc_ts_2;
+		wmask |= 0x3 << rx_queue->q.ts_wordn;
 	}
-	else {
-		sp_acp_set_remote_wstrb_0(0x000000ff);
-	}
-
-	// We need to transfer the whole 128-bit word, so align the address to
-	// an 16-byte boundary.
-	register uint32_t mask = ~(uint32_t)(16 - 1);
-	prefetch_addr = (void *)((uintptr_t)prefetch_addr & mask);
-	uint32_t cur_dma_desc_addr_aligned = cur_dma_desc_addr & mask;
 #ifdef DEBUG
-	printf("[rx%d] write(0x%08x, 0x%08x)\n",
+	printf("[rx%d] write(0x%02x%08x)\n",
 		rx_queue_no(rx_queue),
-		(uint32_t)prefetch_addr,
-		cur_dma_desc_addr_aligned);
+		(uint32_t)(rx_queue->q.cur_dma_desc_addr >> 32),
+		(uint32_t)rx_queue->q.cur_dma_desc_addr);
 #endif
-	sp_acp_write_start_16((uint32_t)prefetch_addr, cur_dma_desc_addr_aligned);
+	sp_desc_write(&rx_queue->q, rx_queue->q.cur_dma_desc_addr, words, wmask);
 }
 
-
 static inline void
 sp_desc_rx_next_desc(
 	struct sp_desc_gem_rx_queue *rx_queue,
 	struct gem_rx_dma_desc *desc
 )
 {
-	if (desc->dma_desc_0 & (1 << GEM_RX_DD0_WRAP_BITN)) {
-		rx_queue->q.cur_dma_desc_addr = rx_queue->q.dma_desc_base;
-		rx_queue->q.prefetch_primed = 0;
-	}
-	else {
-		rx_queue->q.cur_dma_desc_addr += 2;
-		if (((uint32_t)rx_queue->q.cur_dma_desc_addr & (64 - 1)) == 0x00) {
-			rx_queue->q.prefetch_primed = 0;
-		}
-	}
+	sp_desc_queue_next(&rx_queue->q, (desc->dma_desc_0 & (1 << GEM_RX_DD0_WRAP_BITN)) != 0);
 }
 #else
+/*
+ * Without the ACP, the descriptors are accessed directly, so the rings
+ * have to be below 4 GB.
+ */
+static inline gem_rx_dma_desc_word_type *
+sp_desc_rx_ptr(dma_addr_t dma_desc_addr)
+{
+	return (gem_rx_dma_desc_word_type *)(uintptr_t)dma_desc_addr;
+}
+
 static inline int
 sp_desc_rx_get_desc(
 	struct sp_desc_gem_rx_queue *rx_queue,
@@ -179,16 +361,15 @@ sp_desc_rx_get_desc(
 )
 {
 	// Get next descriptor from DRAM
-	gem_rx_dma_desc_word_type *dma_descp = rx_queue->q.cur_dma_desc_addr;
+	gem_rx_dma_desc_word_type *dma_descp = sp_desc_rx_ptr(rx_queue->q.cur_dma_desc_addr);
 	gem_rx_dma_desc_word_type dma_desc_0 = *(dma_descp + 0);
 	if (dma_desc_0 & (1 << GEM_RX_DD0_VALID_BITN)) {
 		//printf("RX: There are no free descriptors!\n");
 		return 1;
 	}
-	// XXX We currently only support 32-bit addresses.
-#ifdef GEM_64BIT_DESC
-	gem_rx_dma_desc_word_type dma_desc_2 = *(dma_descp + 2);
-#endif
+	if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+		desc->dma_desc_2 = *(dma_descp + SP_DESC_ADDRH_WORDN);
+	}
 	gem_rx_dma_desc_word_type dma_desc_1 = *(dma_descp + 1);
 
 	desc->dma_desc_0 = dma_desc_0;
@@ -198,17 +379,23 @@ sp_desc_rx_get_desc(
 }
 
 static inline void
-sp_desc_rx_set_desc_(
+sp_desc_rx_set_desc(
 	struct sp_desc_gem_rx_queue *rx_queue,
-	gem_rx_dma_desc_word_type dma_desc_0,
-	gem_rx_dma_desc_word_type dma_desc_1
+	struct gem_rx_dma_desc *desc
 )
 {
-	gem_rx_dma_desc_word_type *dma_descp = rx_queue->q.cur_dma_desc_addr;
+	gem_rx_dma_desc_word_type *dma_descp = sp_desc_rx_ptr(rx_queue->q.cur_dma_desc_addr);
 
 	// Set all the other parameters.
-	*(dma_descp + 1) = dma_desc_1;
-	*(dma_descp + 0) = dma_desc_0;
+	if (sp_desc_queue_has_ts(&rx_queue->q)) {
+		*(dma_descp + rx_queue->q.ts_wordn + 1) = desc->dma_desc_ts_2;
+		*(dma_descp + rx_queue->q.ts_wordn) = desc->dma_desc_ts_1;
+	}
+	if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+		*(dma_descp + SP_DESC_VLAN_WORDN) = desc->dma_desc_vlan;
+	}
+	*(dma_descp + 1) = desc->dma_desc_1;
+	*(dma_descp + 0) = desc->dma_desc_0;
 }
 
 static inline void
@@ -218,22 +405,589 @@ sp_desc_rx_next_desc(
 )
 {
 	// On to the next descriptor
-	if (desc->dma_desc_0 & (1 << GEM_RX_DD0_WRAP_BITN)) {
-		rx_queue->q.cur_dma_desc_addr = rx_queue->q.dma_desc_base;
+	sp_desc_queue_next(&rx_queue->q, (desc->dma_desc_0 & (1 << GEM_RX_DD0_WRAP_BITN)) != 0);
+}
+#endif
+
+/*
+ * Flow control
+ *
+ * While the RX data FIFO is above its high-water mark or while there
+ * is no free descriptor for a received frame, the link partner should
+ * pause. We only tell the TX SP of the pair by setting
+ * SP_STATUS_RX_PAUSE_BITN in our STATUS register. The TX SP builds the
+ * PAUSE (or PFC) frames and sends them between its own frames (see
+ * sp-desc-tx.c), so none of the GEM registers the driver owns are
+ * touched.
+ */
+struct rx_flow_ctrl {
+	bool paused;
+	// No free descriptor for the frame at the head of the RX meta FIFO
+	bool ring_dry;
+};
+
+static struct rx_flow_ctrl rx_flow_ctrl_state;
+
+static void
+rx_flow_ctrl(void)
+{
+	struct rx_flow_ctrl *fc = &rx_flow_ctrl_state;
+
+	if (!rx_flow_ctrl_enabled)
+		return;
+
+	bool pause = fc->ring_dry || sp_rx_flow_status();
+	if (pause == fc->paused)
+		return;
+
+	// Nobody else writes our STATUS register while we are running.
+	uint32_t status = sp_load_reg(SP_REGN_STATUS);
+	if (pause)
+		status |= (uint32_t)1 << SP_STATUS_RX_PAUSE_BITN;
+	else
+		status &= ~((uint32_t)1 << SP_STATUS_RX_PAUSE_BITN);
+	sp_store_reg(SP_REGN_STATUS, status);
+	fc->paused = pause;
+#ifdef DEBUG
+	printf("RX: %s (ring_dry=%d)\n", pause ? "pause" : "resume", fc->ring_dry);
+#endif
+}
+
+/*
+ * Waits for the driver to hand us a free descriptor.
+ */
+static void
+rx_wait_desc(
+	struct sp_desc_gem_rx_queue *rx_queue,
+	struct gem_rx_dma_desc *desc
+)
+{
+	while (sp_desc_rx_get_desc(rx_queue, desc)) {
+		rx_flow_ctrl_state.ring_dry = true;
+		rx_flow_ctrl();
 	}
-	else {
-		rx_queue->q.cur_dma_desc_addr += 2;
+	rx_flow_ctrl_state.ring_dry = false;
+}
+
+/*
+ * Large receive offload (LRO)
+ *
+ * In-order TCP segments of one flow are coalesced into one frame.
+ * The hardware starts the payload of IPv4 TCP frames on a new RX data
+ * FIFO word and tells us whether a segment continues the previous one.
+ *
+ * The first buffer receives the headers of the first segment and each
+ * following buffer receives the payload of one segment, so the frame
+ * is spread over multiple descriptors like a jumbo frame.
+ * The SOF descriptor is held back until the frame is flushed, so the
+ * driver does not look at the frame before we have patched the headers.
+ * Descriptors must be used in order, so only one frame can be open.
+ */
+// The frame length field of the RX descriptor is 14 bits wide.
+#define RX_LRO_MAX_LENGTH	0x3fff
+#define RX_LRO_TCP_FLAG_PSH	0x08
+// IP and TCP checksums have been checked (and are correct).
+#define RX_LRO_CHKSUM_ENC_TCP	2
+
+struct rx_lro {
+	bool open;
+	int q;
+	int nsegs;
+	// The length of the frame so far
+	int length;
+	int l3_off;
+	// The IPv4 total length of the first segment
+	uint32_t ip_len;
+	bool psh;
+	uint32_t tcp_ack;
+	uint32_t tcp_win;
+	// The cycle counter at the last segment
+	uint32_t cycle;
+	// The address of the headers (below 4 GB)
+	uint32_t hdr_addr;
+	dma_addr_t sof_dma_desc_addr;
+	struct gem_rx_dma_desc sof_desc;
+	dma_addr_t last_dma_desc_addr;
+	gem_rx_dma_desc_word_type last_dma_desc_1;
+	// All segments have the same VLAN tag (if any).
+	gem_rx_dma_desc_word_type vlan_desc;
+};
+
+static struct rx_lro rx_lro;
+
+static inline uint32_t
+get_be16(const volatile uint8_t *p)
+{
+	return (uint32_t)p[0] << 8 | p[1];
+}
+
+static inline void
+put_be16(volatile uint8_t *p, uint32_t x)
+{
+	p[0] = x >> 8;
+	p[1] = x;
+}
+
+static inline void
+put_be32(volatile uint8_t *p, uint32_t x)
+{
+	put_be16(p, x >> 16);
+	put_be16(p + 2, x);
+}
+
+static inline void
+rx_dma(dma_addr_t addr, int length)
+{
+	sp_rx_data_dma_start(addr, length);
+	while (sp_rx_data_dma_status()) {
+	}
+}
+
+/*
+ * LRO writes descriptors other than the current one and patches the
+ * headers of a frame when it is flushed. Both go through the ACP like
+ * all other descriptor writes. The prefetch area of the queue serves as
+ * scratch space for the headers, so the descriptors have to be
+ * prefetched again.
+ */
+
+/*
+ * Writes word 1 of a descriptor other than the current one or, if all
+ * is set, all of its words but the upper address bits.
+ */
+static void
+rx_lro_write_desc(
+	struct sp_desc_gem_rx_queue *rx_queue,
+	dma_addr_t dma_desc_addr,
+	struct gem_rx_dma_desc *desc,
+	bool all
+)
+{
+	uint32_t words[SP_DESC_64BIT_TS_NWORDS] = { desc->dma_desc_0, desc->dma_desc_1 };
+	int wmask = 0x3;
+
+	if (!all) {
+		sp_desc_write(&rx_queue->q, dma_desc_addr, words, 1 << 1);
+		while (sp_acp_busy()) {
+		}
+		return;
+	}
+	if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+		words[SP_DESC_VLAN_WORDN] = desc->dma_desc_vlan;
+		wmask |= 1 << SP_DESC_VLAN_WORDN;
+	}
+	if (sp_desc_queue_has_ts(&rx_queue->q)) {
+		words[rx_queue->q.ts_wordn] = desc->dma_desc_ts_1;
+		words[rx_queue->q.ts_wordn + 1] = desc->dma_desc_ts_2;
+		wmask |= 0x3 << rx_queue->q.ts_wordn;
+	}
+	sp_desc_write(&rx_queue->q, dma_desc_addr, words, wmask);
+	while (sp_acp_busy()) {
+	}
+}
+
+/*
+ * Updates the IPv4 and TCP headers of the frame for all its segments.
+ */
+static void
+rx_lro_patch_hdr(struct sp_desc_gem_rx_queue *rx_queue)
+{
+	uint32_t ip_addr = rx_lro.hdr_addr + rx_lro.l3_off;
+	// The patched bytes go from the IPv4 total length to the TCP window.
+	uint32_t line_addr = (ip_addr + 2) & ~(uint32_t)(16 - 1);
+	int nlines = (ip_addr + 20 + 15 - line_addr) / 16 + 1;
+	volatile uint8_t *scratch = rx_queue->q.prefetch_addr;
+	volatile uint8_t *ip = scratch + (ip_addr - line_addr);
+	volatile uint8_t *tcp = ip + 20;
+	uint32_t ip_len = rx_lro.length - rx_lro.l3_off;
+	// One write strobe per byte of the scratch area
+	uint64_t wstrb = 0;
+
+	for (int i = 0; i < nlines; i++) {
+		while (sp_acp_busy()) {
+		}
+		sp_acp_read_start_16((uint32_t)(scratch + i * 16), line_addr + i * 16);
+	}
+	while (sp_acp_busy()) {
 	}
+
+	if (rx_lro.nsegs > 1) {
+		// Incremental update of the IPv4 header checksum (RFC 1624)
+		uint32_t sum = ~get_be16(ip + 10) & 0xffff;
+		sum += ~rx_lro.ip_len & 0xffff;
+		sum += ip_len;
+		sum = (sum & 0xffff) + (sum >> 16);
+		sum = (sum & 0xffff) + (sum >> 16);
+		put_be16(ip + 2, ip_len);
+		put_be16(ip + 10, ~sum);
+		put_be32(tcp + 8, rx_lro.tcp_ack);
+		put_be16(tcp + 14, rx_lro.tcp_win);
+		wstrb |= (uint64_t)0x3 << (ip + 2 - scratch);
+		wstrb |= (uint64_t)0x3 << (ip + 10 - scratch);
+		wstrb |= (uint64_t)0xf << (tcp + 8 - scratch);
+		wstrb |= (uint64_t)0x3 << (tcp + 14 - scratch);
+		// The TCP checksum is not updated. The driver knows from the
+		// descriptor that it has been checked for each segment.
+	}
+	if (rx_lro.psh) {
+		tcp[13] |= RX_LRO_TCP_FLAG_PSH;
+		wstrb |= (uint64_t)0x1 << (tcp + 13 - scratch);
+	}
+
+	for (int i = 0; i < nlines; i++) {
+		uint16_t line_wstrb = wstrb >> (i * 16);
+		if (line_wstrb == 0)
+			continue;
+		while (sp_acp_busy()) {
+		}
+		sp_acp_set_remote_wstrb_0(line_wstrb);
+		sp_acp_write_start_16((uint32_t)(scratch + i * 16), line_addr + i * 16);
+	}
+	while (sp_acp_busy()) {
+	}
+	rx_queue->q.prefetch_primed = 0;
 }
+
+static void
+rx_lro_flush(void)
+{
+	if (!rx_lro.open)
+		return;
+
+	struct sp_desc_gem_rx_queue *rx_queue = &rx_queues[rx_lro.q];
+
+	rx_lro_patch_hdr(rx_queue);
+
+	// The EOF descriptor holds the frame length.
+	struct gem_rx_dma_desc last_desc = { 0 };
+	last_desc.dma_desc_1 = (rx_lro.last_dma_desc_1 & ~(uint32_t)0x3fff) |
+		1 << GEM_RX_DD1_EOF_BITN | rx_lro.length;
+	rx_lro_write_desc(rx_queue, rx_lro.last_dma_desc_addr, &last_desc, false);
+
+	// All other writes have completed, so the driver may now see the
+	// frame.
+	rx_lro_write_desc(rx_queue, rx_lro.sof_dma_desc_addr, &rx_lro.sof_desc, true);
+#ifdef DEBUG
+	printf("LRO: flush %d segments len=%d\n", rx_lro.nsegs, rx_lro.length);
 #endif
+	rx_lro.open = false;
 
-static inline void
-sp_desc_rx_set_desc(
+	gem_rx_done(rx_lro.q);
+}
+
+/*
+ * Puts the payload of one segment into the next buffer(s), starting with
+ * the (free) descriptor desc.
+ */
+static void
+rx_lro_add_payload(
 	struct sp_desc_gem_rx_queue *rx_queue,
-	struct gem_rx_dma_desc *desc
+	struct gem_rx_dma_desc *desc,
+	gem_rx_meta_desc_type meta_desc,
+	int payload_length,
+	gem_rx_dma_desc_word_type ts_1,
+	gem_rx_dma_desc_word_type ts_2
+)
+{
+	int offset = 0;
+
+	for (;;) {
+		int part_length = payload_length - offset;
+		if (rx_queue->buf_size != 0 && part_length > rx_queue->buf_size)
+			part_length = rx_queue->buf_size;
+
+		dma_addr_t data_addr = gem_rx_dma_desc0_get_addr(desc->dma_desc_0);
+		if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+			data_addr |= (dma_addr_t)desc->dma_desc_2 << 32;
+		}
+		rx_dma(data_addr, part_length);
+
+		// Descriptors other than SOF and EOF hold the buffer length.
+		desc->dma_desc_0 |= 1 << GEM_RX_DD0_VALID_BITN;
+		desc->dma_desc_1 = (meta_desc & ~((uint32_t)1 << GEM_RX_DD1_SOF_BITN |
+			(uint32_t)1 << GEM_RX_DD1_EOF_BITN | 0x3fff)) | part_length;
+		if (sp_desc_queue_has_ts(&rx_queue->q)) {
+			desc->dma_desc_0 |= 1 << GEM_RX_DD0_TS_VALID_BITN;
+			desc->dma_desc_ts_1 = ts_1;
+			desc->dma_desc_ts_2 = ts_2;
+		}
+		desc->dma_desc_vlan = rx_vlan_desc;
+		sp_desc_rx_set_desc(rx_queue, desc);
+		rx_lro.last_dma_desc_addr = rx_queue->q.cur_dma_desc_addr;
+		rx_lro.last_dma_desc_1 = desc->dma_desc_1;
+
+		sp_desc_rx_next_desc(rx_queue, desc);
+
+		offset += part_length;
+		if (offset == payload_length)
+			break;
+		rx_wait_desc(rx_queue, desc);
+	}
+}
+
+/*
+ * Returns 0 if the frame has been coalesced or started a new LRO frame,
+ * or 1 if it has to be received the normal way.
+ */
+static int
+rx_lro_rx(
+	int q,
+	struct gem_rx_dma_desc *desc,
+	gem_rx_meta_desc_type meta_desc,
+	uint32_t hdr_info,
+	gem_rx_dma_desc_word_type ts_1,
+	gem_rx_dma_desc_word_type ts_2
+)
+{
+	struct sp_desc_gem_rx_queue *rx_queue = &rx_queues[q];
+	uint32_t lro_info = sp_rx_meta_get(4);
+	int hdr_length = sp_rx_hdr_info_get_hdr_len(hdr_info);
+	int payload_length = lro_info >> SP_RX_LRO_INFO_PAYLOAD_LEN_BITN;
+
+	if (!(lro_info & (1 << SP_RX_LRO_INFO_OK_BITN)))
+		return 1;
+	if (gem_rx_meta_desc_get_chksum_enc(meta_desc) != RX_LRO_CHKSUM_ENC_TCP)
+		return 1;
+	// Frames with Ethernet padding leave more data in the RX data FIFO.
+	if (gem_rx_meta_desc_get_length(meta_desc) != hdr_length + payload_length)
+		return 1;
+
+	if (rx_lro.open && (rx_lro.q != q ||
+			!(lro_info & (1 << SP_RX_LRO_INFO_CONT_BITN)) ||
+			rx_lro.vlan_desc != rx_vlan_desc ||
+			rx_lro.length + payload_length > RX_LRO_MAX_LENGTH)) {
+		rx_lro_flush();
+	}
+
+	if (rx_lro.open) {
+		// The headers are the same as in the first segment.
+		sp_rx_data_skip(hdr_length);
+		while (sp_rx_data_dma_status()) {
+		}
+		rx_lro_add_payload(rx_queue, desc, meta_desc, payload_length, ts_1, ts_2);
+		rx_lro.length += payload_length;
+		rx_lro.nsegs++;
+	}
+	else {
+		dma_addr_t data_addr = gem_rx_dma_desc0_get_addr(desc->dma_desc_0);
+		if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+			data_addr |= (dma_addr_t)desc->dma_desc_2 << 32;
+		}
+		data_addr += rx_buf_offset;
+		// We patch the headers through the ACP (see rx_lro_flush()).
+		if ((data_addr >> 32) != 0)
+			return 1;
+
+		rx_dma(data_addr, hdr_length);
+
+		// The SOF descriptor holds the header length.
+		rx_lro.sof_dma_desc_addr = rx_queue->q.cur_dma_desc_addr;
+		rx_lro.sof_desc = *desc;
+		rx_lro.sof_desc.dma_desc_0 |= 1 << GEM_RX_DD0_VALID_BITN;
+		rx_lro.sof_desc.dma_desc_1 = (meta_desc &
+			~((uint32_t)1 << GEM_RX_DD1_EOF_BITN | 0x3fff)) | hdr_length;
+		if (sp_desc_queue_has_ts(&rx_queue->q)) {
+			rx_lro.sof_desc.dma_desc_0 |= 1 << GEM_RX_DD0_TS_VALID_BITN;
+			rx_lro.sof_desc.dma_desc_ts_1 = ts_1;
+			rx_lro.sof_desc.dma_desc_ts_2 = ts_2;
+		}
+		rx_lro.sof_desc.dma_desc_vlan = rx_vlan_desc;
+		sp_desc_rx_next_desc(rx_queue, desc);
+		rx_wait_desc(rx_queue, desc);
+		rx_lro_add_payload(rx_queue, desc, meta_desc, payload_length, ts_1, ts_2);
+
+		rx_lro.open = true;
+		rx_lro.q = q;
+		rx_lro.nsegs = 1;
+		rx_lro.vlan_desc = rx_vlan_desc;
+		rx_lro.length = hdr_length + payload_length;
+		rx_lro.l3_off = (hdr_info >> SP_RX_HDR_INFO_L3_OFF_BITN) & 0xff;
+		rx_lro.ip_len = rx_lro.length - rx_lro.l3_off;
+		rx_lro.psh = false;
+		rx_lro.hdr_addr = (uint32_t)data_addr;
+	}
+#ifdef DEBUG
+	printf("LRO: segment %d len=%d meta=0x%08x lro=0x%08x\n",
+		rx_lro.nsegs, payload_length, meta_desc, lro_info);
+#endif
+
+	rx_lro.tcp_ack = sp_rx_meta_get(5);
+	rx_lro.tcp_win = sp_rx_meta_get(6);
+	rx_lro.cycle = (uint32_t)csr_read_cycle();
+	if ((lro_info >> SP_RX_LRO_INFO_TCP_FLAGS_BITN) & RX_LRO_TCP_FLAG_PSH)
+		rx_lro.psh = true;
+
+	if (rx_lro.psh || rx_lro.nsegs >= rx_lro_max_nsegs)
+		rx_lro_flush();
+
+	return 0;
+}
+
+/*
+ * Mirroring
+ *
+ * The first bytes of the frames that match the filter are also written
+ * into a capture ring in host memory. The DMA engine keeps a copy of the
+ * first part of the frame and writes it a second time, so the frame is
+ * read from the RX data FIFO only once.
+ * The slots of the ring are overwritten in order. Each slot starts with
+ * a record header followed by the captured bytes:
+ *   word 0: the sequence number of the record (never 0)
+ *   word 1: 15:0 the length of the frame, 31:16 the captured length
+ *   words 2 and 3: the time stamp (as in words 2 and 3 of an extended
+ *                  descriptor), 0 without time stamps
+ * The header is written through the ACP, like the descriptors, and the
+ * captured bytes with SP_DMA_ATTR_STASH. Word 0 is cleared before the
+ * captured bytes are written, and the header with the new sequence
+ * number is written in one beat after their transfer has completed.
+ * So the host needs no register accesses: it polls word 0 for the next
+ * sequence number and drops a record if word 0 has changed after
+ * copying it. A gap in the sequence numbers means that records have been
+ * overwritten.
+ *
+ * Frames to be mirrored are not coalesced by LRO, which modifies
+ * the headers after they have been written.
+ */
+static inline bool
+rx_mirror_match(uint32_t hdr_info)
+{
+	uint32_t mask = rx_mirror_filter & SP_RX_MIRROR_FILTER_MASK_MASK;
+	uint32_t value = (rx_mirror_filter >> SP_RX_MIRROR_FILTER_VALUE_BITN) & 0xff;
+
+	return rx_mirror_snaplen != 0 && ((hdr_info >> 24) & mask) == value;
+}
+
+/*
+ * Writes the record of a frame whose first part of 'part_length' bytes
+ * has just been written with the mirror bit set.
+ * The prefetch area of rx_queue is used as scratch space for the header.
+ */
+static void
+rx_mirror(
+	struct sp_desc_gem_rx_queue *rx_queue,
+	int length,
+	int part_length,
+	gem_rx_dma_desc_word_type ts_1,
+	gem_rx_dma_desc_word_type ts_2
 )
 {
-	sp_desc_rx_set_desc_(rx_queue, desc->dma_desc_0, desc->dma_desc_1);
+	static int head;
+	static uint32_t seq;
+	int caplen = part_length < rx_mirror_snaplen ? part_length : rx_mirror_snaplen;
+	dma_addr_t slot_addr = rx_mirror_ring_base + (dma_addr_t)head * rx_mirror_slot_size;
+	volatile uint32_t *scratch_addr = rx_queue->q.prefetch_addr;
+
+	while (sp_acp_busy()) {
+	}
+	scratch_addr[0] = 0;
+	sp_acp_set_remote_wstrb_0(0x000f);
+	sp_acp_write_start_16((uint32_t)scratch_addr, slot_addr);
+	while (sp_acp_busy()) {
+	}
+
+	sp_rx_mirror_dma_start_attr(slot_addr + RX_MIRROR_HDR_SIZE, caplen, SP_DMA_ATTR_STASH);
+	while (sp_rx_data_dma_status()) {
+	}
+
+	if (++seq == 0)
+		seq = 1;
+	scratch_addr[0] = seq;
+	scratch_addr[1] = (uint32_t)caplen << 16 | length;
+	scratch_addr[2] = ts_1;
+	scratch_addr[3] = ts_2;
+	sp_acp_set_remote_wstrb_0(0xffff);
+	sp_acp_write_start_16((uint32_t)scratch_addr, slot_addr);
+	while (sp_acp_busy()) {
+	}
+	rx_queue->q.prefetch_primed = 0;
+
+	head = (head + 1) & (rx_mirror_nslots - 1);
+}
+
+/*
+ * Returns the ring of the frame at the head of the selected RX FIFO,
+ * which is queue q, or RX_COPYBREAK_QUEUE with copy-break, and gets its
+ * descriptor. Returns -1 if the ring has no free descriptor.
+ * The length of the frame is peeked at, so a dry ring only holds up
+ * the frames that go to it.
+ */
+static int
+rx_desc_ring(int q, struct gem_rx_dma_desc *desc)
+{
+	if (rx_copybreak != 0 &&
+			gem_rx_meta_desc_get_length(sp_rx_meta_peek()) <= rx_copybreak)
+		q = RX_COPYBREAK_QUEUE;
+	if (sp_desc_rx_get_desc(&rx_queues[q], desc))
+		return -1;
+	return q;
+}
+
+/*
+ * Per-queue RX FIFOs
+ *
+ * The hardware puts each frame into the RX FIFO of the queue its VLAN
+ * priority maps to. Frames of RX FIFO queue q go to GEM RX queue q.
+ * The queues are served round-robin. A queue whose ring has no free
+ * descriptor is skipped, so it cannot hold up the other queues.
+ *
+ * Selects the next queue and returns its number or -1 if no queue
+ * can be served.
+ */
+int
+rx_select_queue(void)
+{
+	static int last_q;
+	struct gem_rx_dma_desc desc;
+	uint32_t pending = sp_rx_queue_select(last_q);
+
+	if (pending == 0)
+		return -1;
+
+	for (int i = 1; i <= NQUEUES; i++) {
+		int q = (last_q + i) % NQUEUES;
+
+		if (!(pending & (1 << q)))
+			continue;
+		if (q != last_q) {
+			sp_rx_queue_select(q);
+			last_q = q;
+		}
+		if (rx_desc_ring(q, &desc) < 0)
+			continue;
+		return q;
+	}
+	rx_flow_ctrl_state.ring_dry = true;
+	return -1;
+}
+
+/*
+ * Called when there are no received frames.
+ * Flushes the open LRO frame after the timeout and releases the pause.
+ */
+void
+rx_poll(void)
+{
+	if (rx_lro.open && (uint32_t)csr_read_cycle() - rx_lro.cycle >= rx_lro_timeout)
+		rx_lro_flush();
+	rx_flow_ctrl();
+}
+
+/*
+ * Drops the frame of the meta information just popped if the hardware
+ * truncated it, together with the part of it in the RX data FIFO.
+ */
+static bool
+rx_drop_truncated(void)
+{
+	uint32_t vlan_info = sp_rx_meta_get(7);
+
+	if (!(vlan_info & ((uint32_t)1 << SP_RX_VLAN_INFO_TRUNCATED_BITN)))
+		return false;
+
+	sp_rx_data_skip((vlan_info >> SP_RX_VLAN_INFO_NBYTES_BITN) & SP_RX_VLAN_INFO_NBYTES_MASK);
+	while (sp_rx_data_dma_status()) {
+	}
+	return true;
 }
 
 /*
@@ -244,41 +998,157 @@ rx(int q)
 {
 	struct sp_desc_gem_rx_queue *rx_queue = &rx_queues[q];
 	struct gem_rx_dma_desc desc;
+	gem_rx_meta_desc_type meta_desc;
+	bool copybreak = false;
+
+	rx_flow_ctrl();
 
-	if (sp_desc_rx_get_desc(rx_queue, &desc))
+	// The meta information stays in the RX meta FIFO until the frame
+	// has a descriptor, so the other queues can go on meanwhile.
+	int ring = rx_desc_ring(q, &desc);
+	if (ring < 0) {
+		rx_flow_ctrl_state.ring_dry = true;
 		return 1;
+	}
+	rx_flow_ctrl_state.ring_dry = false;
 
 	// Get meta information from BRAM
-	gem_rx_meta_desc_type meta_desc = sp_rx_meta_pop_uint32();
+	meta_desc = sp_rx_meta_pop_uint32();
+	if (rx_drop_truncated())
+		return 0;
+	if (ring != q) {
+		q = ring;
+		rx_queue = &rx_queues[q];
+		copybreak = true;
+	}
+	meta_desc = rx_vlan_meta_desc(meta_desc);
+
+	gem_rx_dma_desc_word_type ts_1 = 0;
+	gem_rx_dma_desc_word_type ts_2 = 0;
+	if (sp_desc_queue_has_ts(&rx_queue->q)) {
+		// The time stamp of the frame was popped together with the
+		// meta information.
+		ts_1 = sp_rx_meta_get(1);
+		ts_2 = sp_rx_meta_get(2);
+	}
 
 	// Do nothing with the data just received
 	// ...
 	// Could skip, could modify.
 
-	// Get the destination of the buffer in DRAM
-	dma_addr_t data_addr = gem_rx_dma_desc0_get_addr(desc.dma_desc_0);
+	uint32_t hdr_info = sp_rx_meta_get(3);
+	bool mirror = rx_mirror_match(hdr_info);
+
+	if (rx_lro_max_nsegs != 0) {
+		if (!copybreak && !mirror && rx_lro_rx(q, &desc, meta_desc, hdr_info, ts_1, ts_2) == 0)
+			return 0;
+		// Keep the order of the frames.
+		rx_lro_flush();
+	}
+
 	// Get length from BRAM
 	int data_length = gem_rx_meta_desc_get_length(meta_desc);
+	int offset = 0;
+	int split_length;
+	if (hdr_info & (1 << SP_RX_HDR_INFO_ALIGNED_BITN)) {
+		// The payload starts on a new word in the RX data FIFO,
+		// so the headers have to go into a buffer of their own.
+		split_length = sp_rx_hdr_info_get_hdr_len(hdr_info);
+	}
+	else {
+		// Small frames are not split because they are copied anyway.
+		split_length = copybreak ? 0 : rx_get_split_length(data_length, hdr_info);
+	}
+
+	// Frames larger than the receive buffers (jumbo frames) are spread
+	// over multiple descriptors. Only the first one has the SOF bit set
+	// and only the last one has the EOF bit set.
+	// Each part has to start on a word boundary in the RX data FIFO.
+	// The buffer size is a multiple of 64 bytes, but the first buffer
+	// also holds the buffer offset, so it may not be used completely.
+	// With header/data split, the first buffer only receives the headers
+	// and the payload starts in the second buffer.
+	int fifo_width = rx_config.data_fifo_width / 8;
+	for (;;) {
+		bool sof = offset == 0;
+		int part_length = data_length - offset;
+		int buf_size = rx_queue->buf_size;
+		if (sof && buf_size != 0)
+			buf_size = (buf_size - rx_buf_offset) & ~(fifo_width - 1);
+		if (buf_size != 0 && part_length > buf_size)
+			part_length = buf_size;
+		if (sof && split_length != 0 && part_length > split_length)
+			part_length = split_length;
+		bool eof = offset + part_length == data_length;
+
+		// Get the destination of the buffer in DRAM
+		dma_addr_t data_addr = gem_rx_dma_desc0_get_addr(desc.dma_desc_0);
+		if (sp_desc_queue_has_addr64(&rx_queue->q)) {
+			data_addr |= (dma_addr_t)desc.dma_desc_2 << 32;
+		}
+		if (sof)
+			data_addr += rx_buf_offset;
 #ifdef DEBUG
-	printf(" RX: 0:0x%08x 1:0x%08x addr=0x%08x len=%d meta=0x%08x\n",
-		desc.dma_desc_0, desc.dma_desc_1, data_addr, data_length, meta_desc);
+		printf("%sRX: 0:0x%08x 1:0x%08x addr=0x%02x%08x len=%d meta=0x%08x\n",
+			sof ? " " : "+",
+			desc.dma_desc_0, desc.dma_desc_1,
+			(uint32_t)(data_addr >> 32), (uint32_t)data_addr,
+			part_length, meta_desc);
 #endif
 
-	sp_rx_data_dma_start(data_addr, data_length);
-	int niters;
-	for (niters = 0;; niters++) {
-		uint32_t status = sp_rx_data_dma_status();
-		if (status == 0) {
-			break;
+		// A short first part (a small frame or the headers with
+		// header/data split) is written into the L2 cache of the
+		// host, which reads it first.
+		uint32_t dma_attr = 0;
+		if (sof && part_length <= rx_stash)
+			dma_attr = SP_DMA_ATTR_STASH;
+		if (sof && mirror)
+			dma_attr |= (uint32_t)1 << SP_DMA_ATTR_MIRROR_BITN;
+		sp_rx_data_dma_start_attr(data_addr, part_length, dma_attr);
+		int niters;
+		for (niters = 0;; niters++) {
+			uint32_t status = sp_rx_data_dma_status();
+			if (status == 0) {
+				break;
+			}
 		}
-	}
+		if (sof && mirror)
+			rx_mirror(rx_queue, data_length, part_length, ts_1, ts_2);
 
-	// Update DRAM descriptor to be valid
-	desc.dma_desc_0 |= 1 << GEM_RX_DD0_VALID_BITN;
-	sp_desc_rx_set_desc_(rx_queue, desc.dma_desc_0, meta_desc);
+		// Update DRAM descriptor to be valid
+		desc.dma_desc_0 |= 1 << GEM_RX_DD0_VALID_BITN;
+		desc.dma_desc_1 = meta_desc;
+		if (!sof)
+			desc.dma_desc_1 &= ~((uint32_t)1 << GEM_RX_DD1_SOF_BITN);
+		if (!eof)
+			desc.dma_desc_1 &= ~((uint32_t)1 << GEM_RX_DD1_EOF_BITN);
+		// The driver cannot derive the length of the first buffer
+		// from the buffer size (header/data split, buffer offset),
+		// so pass it in the SOF descriptor.
+		// The EOF descriptor still holds the frame length.
+		if (sof && !eof)
+			desc.dma_desc_1 = (desc.dma_desc_1 & ~(uint32_t)0x3fff) | part_length;
+		if (sp_desc_queue_has_ts(&rx_queue->q)) {
+			desc.dma_desc_0 |= 1 << GEM_RX_DD0_TS_VALID_BITN;
+			desc.dma_desc_ts_1 = ts_1;
+			desc.dma_desc_ts_2 = ts_2;
+		}
+		desc.dma_desc_vlan = rx_vlan_desc;
+		sp_desc_rx_set_desc(rx_queue, &desc);
 
-	sp_desc_rx_next_desc(rx_queue, &desc);
+		sp_desc_rx_next_desc(rx_queue, &desc);
+
+		if (eof)
+			break;
+		offset += part_length;
+
+		// The rest of the frame is already in the RX data FIFO,
+		// so wait for the driver to hand us another buffer.
+		rx_wait_desc(rx_queue, &desc);
+	}
 
 	// Send the RX done interrupt
 	gem_rx_done(q);
+
+	return 0;
 }
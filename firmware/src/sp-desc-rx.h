@@ -19,6 +19,8 @@
 void load_rx_config(void);
 void load_desc_rx_config(void);
 int rx(int q);
+void rx_poll(void);
+int rx_select_queue(void);
 
 
 #endif
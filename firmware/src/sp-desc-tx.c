@@ -13,8 +13,11 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 
+#include "csr.h"
 #include "sp.h"
 #include "sp-desc.h"
 #include "sp-desc-tx.h"
@@ -27,6 +30,109 @@ extern struct sp_config tx_config;
 
 struct sp_desc_gem_tx_queue tx_queues[NQUEUES];
 
+/*
+ * With extended (time stamp) descriptors or cut-through, the first
+ * descriptor of a frame is validated only after the time stamp and the
+ * status of the frame have arrived. The hardware returns them in the
+ * order the frames were sent, so a ring in the same order suffices.
+ * Each frame is pushed with its index in the ring as its tag, which
+ * comes back with the time stamp. A time stamp for a later frame means
+ * that the ones before it were lost, and a time stamp whose frame is
+ * not pending anymore is a late one and is dropped.
+ * If the time stamp of the oldest frame has not arrived after the
+ * timeout (see tx_ts_timeout()), the frame is handed back without one.
+ */
+struct sp_desc_tx_ts_pending {
+	int q;
+	dma_addr_t dma_desc_addr;
+	gem_tx_dma_desc_word_type dma_desc_1;
+	// The cycle counter when the frame was sent
+	uint32_t cycle;
+};
+
+// Matches the depth of the TX time stamp FIFO and the number of tags.
+#define TX_TS_PENDING_SIZE		16
+// About 3.5 ms at 300 MHz, on top of the time a frame may be held
+#define TX_TS_TIMEOUT			(1 << 20)
+#define TX_CYCLES_PER_USEC		300
+// The longest pause a link partner can ask for, in units of 512 bit times
+#define TX_PAUSE_MAX_QUANTA		0xffff
+
+static struct sp_desc_tx_ts_pending tx_ts_pending[TX_TS_PENDING_SIZE];
+static unsigned int tx_ts_pending_head;
+static unsigned int tx_ts_pending_tail;
+
+// The cut-through threshold in bytes (0 disables cut-through)
+static uint32_t tx_ct_threshold;
+
+// The number of bytes sent by the last call of tx()
+static int tx_frame_nbytes;
+
+#if NQUEUES * SP_TX_SCHED_WEIGHT_WIDTH > 32
+#error "The TX scheduler weights do not fit into one register"
+#endif
+
+// Insert the VLAN tag of the SOF descriptor (64-bit descriptors only)
+static bool tx_vlan_insert;
+
+static int tx_sched_mode;
+static int tx_sched_weights[NQUEUES];
+static int tx_sched_deficits[NQUEUES];
+
+/*
+ * Traffic shaper
+ *
+ * Each queue has a token bucket of byte credits in units of 1/65536
+ * bytes. In every cycle, the rate of a queue is added to its credits, up
+ * to its burst size. A queue only starts a frame while its credits are
+ * not negative, and the length of the frame is taken from them. A rate
+ * of 0 disables the shaper of a queue.
+ *
+ * A frame is held back before anything of it is pushed into the TX
+ * FIFOs, which all queues share, so the other queues go on sending.
+ */
+#define TX_SHAPER_FRAC_BITS		16
+// Longer idle times do not overflow the credits computation.
+#define TX_SHAPER_MAX_CYCLES	((uint64_t)1 << 38)
+
+static uint32_t tx_shaper_rates[NQUEUES];
+static int64_t tx_shaper_max_credits[NQUEUES];
+static int64_t tx_shaper_credits[NQUEUES];
+static uint64_t tx_shaper_cycles[NQUEUES];
+
+/*
+ * Launch time
+ *
+ * A frame whose launch time has passed is sent at once, like a frame
+ * without one. A frame whose launch time is beyond the horizon is
+ * dropped, so a bogus or wrapped launch time cannot stall its queue.
+ * Any other frame is held back in its queue until its launch time is
+ * at most the lead ahead. Only then is it pushed, and the hardware
+ * holds it until its launch time. Since the frames of all queues wait
+ * behind it, the lead bounds how long that takes.
+ */
+enum {
+	TX_LAUNCH_NOW,
+	TX_LAUNCH_GATE,
+	TX_LAUNCH_HOLD,
+	TX_LAUNCH_DROP
+};
+
+#define TX_LAUNCH_NSEC_MASK		0x3fffffff
+#define TSU_NSEC_PER_SEC		1000000000
+
+// In nanoseconds
+static int64_t tx_launch_lead;
+static int64_t tx_launch_horizon;
+
+// A queue has held back a frame during the last tx_schedule().
+static bool tx_held;
+
+// The registers of the GEM this SP is attached to
+static void *gem_base;
+static uint32_t tx_flow_ctrl_prios;
+static uint32_t tx_flow_ctrl_refresh;
+
 void prism_hexdump(const void *na, int nbytes);
 
 int
@@ -38,29 +144,88 @@ tx_queue_no(struct sp_desc_gem_tx_queue *tx_queue)
 void
 load_desc_tx_config(void)
 {
-	tx_queues[0].q.dma_desc_base =
-		(gem_tx_dma_desc_word_type *)sp_load_reg(SP_REGN_TX_DMA_DESC_BASE_0);
-	tx_queues[0].q.cur_dma_desc_addr = tx_queues[0].q.dma_desc_base;
-
-	tx_queues[1].q.dma_desc_base =
-		(gem_tx_dma_desc_word_type *)sp_load_reg(SP_REGN_TX_DMA_DESC_BASE_1);
-	tx_queues[1].q.cur_dma_desc_addr = tx_queues[1].q.dma_desc_base;
+	gem_base = (void *)sp_load_reg(SP_REGN_GEM_BASE);
+	// All TX rings share the upper address bits.
+	uint32_t dma_desc_base_h = gem_read_reg(gem_base, GEM_UPPER_TX_Q_BASE_OFFSET);
 
 	for (int i = 0; i < NQUEUES; i++) {
-		tx_queues[i].q.prefetch_primed = 0;
+		sp_desc_queue_init(&tx_queues[i].q,
+			sp_load_reg(SP_REGN_TX_DMA_DESC_BASE_0 + i), dma_desc_base_h);
 		tx_queues[i].q.prefetch_addr = (void *)(uintptr_t)(0x30000 + i * 64);
-		tx_queues[i].saved_cur_dma_desc_addr = NULL;
+		tx_queues[i].saved_cur_dma_desc_addr = 0;
 		tx_queues[i].saved_dma_desc_1 = 0;
 		sp_gem_queue_init(&tx_queues[i].q.base, i);
 	}
 
-	printf("Descriptor base of TX queue 0 is at %p\n", tx_queues[0].q.dma_desc_base);
-	printf("Descriptor base of TX queue 1 is at %p\n", tx_queues[1].q.dma_desc_base);
+	tx_ts_pending_head = 0;
+	tx_ts_pending_tail = 0;
+
+	tx_ct_threshold = sp_load_reg(SP_REGN_TX_CUT_THROUGH) & SP_TX_CUT_THROUGH_THRESHOLD_MASK;
+	sp_tx_config(tx_ct_threshold);
+
+	tx_vlan_insert = (sp_load_reg(SP_REGN_VLAN) >> SP_VLAN_TX_INSERT_BITN) & 1;
+
+	tx_sched_mode = sp_load_reg(SP_REGN_TX_SCHED) & SP_TX_SCHED_MODE_MASK;
+	uint32_t weights = sp_load_reg(SP_REGN_TX_SCHED_WEIGHTS);
+	for (int i = 0; i < NQUEUES; i++) {
+		int weight = (weights >> (i * SP_TX_SCHED_WEIGHT_WIDTH)) &
+			((1 << SP_TX_SCHED_WEIGHT_WIDTH) - 1);
+		tx_sched_weights[i] = weight != 0 ? weight : 1;
+		tx_sched_deficits[i] = 0;
+	}
+
+	for (int i = 0; i < NQUEUES; i++) {
+		tx_shaper_rates[i] = sp_load_reg(SP_REGN_TX_SHAPER_RATE_0 + 2 * i) &
+			SP_TX_SHAPER_RATE_MASK;
+		tx_shaper_max_credits[i] = (int64_t)(sp_load_reg(SP_REGN_TX_SHAPER_BURST_0 + 2 * i) &
+			SP_TX_SHAPER_BURST_MASK) << TX_SHAPER_FRAC_BITS;
+		tx_shaper_credits[i] = 0;
+		tx_shaper_cycles[i] = csr_read_cycle();
+	}
+
+	uint32_t launch = sp_load_reg(SP_REGN_TX_LAUNCH);
+	uint32_t horizon = launch >> SP_TX_LAUNCH_HORIZON_BITN;
+	if (horizon == 0)
+		horizon = SP_TX_LAUNCH_HORIZON_DEFAULT;
+	tx_launch_lead = (int64_t)(launch & SP_TX_LAUNCH_LEAD_MASK) * 1000;
+	tx_launch_horizon = (int64_t)horizon * 1000000;
+
+	uint32_t flow_ctrl_pause = sp_load_reg(SP_REGN_RX_FLOW_CTRL_PAUSE);
+	tx_flow_ctrl_prios = flow_ctrl_pause & SP_RX_FLOW_CTRL_PAUSE_PRIOS_MASK;
+	tx_flow_ctrl_refresh = (flow_ctrl_pause >> SP_RX_FLOW_CTRL_PAUSE_REFRESH_BITN) << 8;
+
+	for (int i = 0; i < NQUEUES; i++) {
+		printf("Descriptor base of TX queue %d is at 0x%02x%08x\n", i,
+			(uint32_t)(tx_queues[i].q.dma_desc_base >> 32),
+			(uint32_t)tx_queues[i].q.dma_desc_base);
+	}
+	printf("Cut-through threshold is %lu\n", (unsigned long)tx_ct_threshold);
+	printf("VLAN insertion is %s\n", tx_vlan_insert ? "enabled" : "disabled");
+	printf("TX scheduling mode is %d, weights:", tx_sched_mode);
+	for (int i = 0; i < NQUEUES; i++)
+		printf(" %d", tx_sched_weights[i]);
+	printf("\n");
+	printf("TX shaper rates:");
+	for (int i = 0; i < NQUEUES; i++)
+		printf(" %lu", (unsigned long)tx_shaper_rates[i]);
+	printf("\n");
+	printf("Launch time lead is %lu us, horizon is %lu ms\n",
+		(unsigned long)(launch & SP_TX_LAUNCH_LEAD_MASK), (unsigned long)horizon);
+	printf("Flow control sends %s frames (%lu cycles)\n",
+		tx_flow_ctrl_prios != 0 ? "PFC" : "PAUSE",
+		(unsigned long)tx_flow_ctrl_refresh);
 }
 
 struct gem_tx_dma_desc {
 	gem_tx_dma_desc_word_type dma_desc_0;
 	gem_tx_dma_desc_word_type dma_desc_1;
+	// Only with 64-bit descriptors: the upper address bits
+	gem_tx_dma_desc_word_type dma_desc_2;
+	// Only with 64-bit descriptors: the VLAN tag to insert
+	gem_tx_dma_desc_word_type dma_desc_vlan;
+	// Only with extended (time stamp) descriptors: the launch time
+	gem_tx_dma_desc_word_type dma_desc_ts_1;
+	gem_tx_dma_desc_word_type dma_desc_ts_2;
 };
 
 #define PRISM_SP_DESC_TX_OPT
@@ -73,34 +238,32 @@ sp_desc_tx_get_desc(
 {
 
 	for (int i = 0; i < 2; i++) {
-		register gem_tx_dma_desc_word_type *prefetch_addr = tx_queue->q.prefetch_addr;
 		if (!tx_queue->q.prefetch_primed) {
-			while (sp_acp_busy()) {
-			}
-
 #ifdef DEBUG
-			printf("[tx%d,cur=%p] get_desc(): read(0x%x, 0x%x)\n",
+			printf("[tx%d,cur=0x%02x%08x] get_desc(): read(0x%x)\n",
 				tx_queue_no(tx_queue),
-				tx_queue->q.cur_dma_desc_addr,
-				(uint32_t)prefetch_addr,
-				(uint32_t)tx_queue->q.cur_dma_desc_addr & ~(uint32_t)(64 - 1)
+				(uint32_t)(tx_queue->q.cur_dma_desc_addr >> 32),
+				(uint32_t)tx_queue->q.cur_dma_desc_addr,
+				(uint32_t)tx_queue->q.prefetch_addr
 			);
 #endif
-			sp_acp_read_start_64((uint32_t)prefetch_addr, (uint32_t)tx_queue->q.cur_dma_desc_addr & ~(uint32_t)(64 - 1));
-
-			while (sp_acp_busy()) {
-			}
-
-			tx_queue->q.prefetch_primed = 1;
+			sp_desc_prefetch(&tx_queue->q);
+		}
+		desc->dma_desc_0 = sp_desc_prefetch_word(&tx_queue->q, 0);
+		desc->dma_desc_1 = sp_desc_prefetch_word(&tx_queue->q, 1);
+		if (sp_desc_queue_has_addr64(&tx_queue->q)) {
+			desc->dma_desc_2 = sp_desc_prefetch_word(&tx_queue->q, SP_DESC_ADDRH_WORDN);
+			desc->dma_desc_vlan = sp_desc_prefetch_word(&tx_queue->q, SP_DESC_VLAN_WORDN);
+		}
+		if (sp_desc_queue_has_ts(&tx_queue->q)) {
+			desc->dma_desc_ts_1 = sp_desc_prefetch_word(&tx_queue->q, tx_queue->q.ts_wordn);
+			desc->dma_desc_ts_2 = sp_desc_prefetch_word(&tx_queue->q, tx_queue->q.ts_wordn + 1);
 		}
-		prefetch_addr = (gem_tx_dma_desc_word_type *)((uint32_t)prefetch_addr | ((uint32_t)tx_queue->q.cur_dma_desc_addr & (64 - 1)));
-		desc->dma_desc_0 = prefetch_addr[0];
-		desc->dma_desc_1 = prefetch_addr[1];
 #ifdef DEBUG
-		printf("[tx%d,cur=%p] get_desc(): prefetch_addr=0x%08x [0]=0x%08x [1]=0x%08x\n",
+		printf("[tx%d,cur=0x%02x%08x] get_desc(): [0]=0x%08x [1]=0x%08x\n",
 			tx_queue_no(tx_queue),
-			tx_queue->q.cur_dma_desc_addr,
-			(uint32_t)prefetch_addr,
+			(uint32_t)(tx_queue->q.cur_dma_desc_addr >> 32),
+			(uint32_t)tx_queue->q.cur_dma_desc_addr,
 			desc->dma_desc_0,
 			desc->dma_desc_1
 		);
@@ -110,17 +273,15 @@ sp_desc_tx_get_desc(
 			return 0;
 		}
 #ifdef DEBUG
-		printf("[tx%d,cur=%p] get_desc(): no desc., repriming.\n",
-			tx_queue_no(tx_queue),
-			tx_queue->q.cur_dma_desc_addr
+		printf("[tx%d] get_desc(): no desc., repriming.\n",
+			tx_queue_no(tx_queue)
 		);
 #endif
 		tx_queue->q.prefetch_primed = 0;
 	}
 #ifdef DEBUG
-	printf("[tx%d,cur=%p] get_desc(): still no desc, giving up.\n",
-		tx_queue_no(tx_queue),
-		tx_queue->q.cur_dma_desc_addr
+	printf("[tx%d] get_desc(): still no desc, giving up.\n",
+		tx_queue_no(tx_queue)
 	);
 #endif
 
@@ -142,30 +303,48 @@ sp_desc_tx_validate_saved_desc(
 	struct sp_desc_gem_tx_queue *tx_queue
 )
 {
-	register uint32_t saved_cur_dma_desc_addr = (uint32_t)tx_queue->saved_cur_dma_desc_addr;
-	register gem_tx_dma_desc_word_type *scratch_addr = tx_queue->q.base.scratch_addr;
-	gem_tx_dma_desc_word_type dma_desc_1 = tx_queue->saved_dma_desc_1;
-	dma_desc_1 |= (uint32_t)1 << GEM_TX_DD1_VALID_BITN;
+	uint32_t words[2] = { 0, tx_queue->saved_dma_desc_1 | (uint32_t)1 << GEM_TX_DD1_VALID_BITN };
 
-	while (sp_acp_busy()) {
-	}
-	if (saved_cur_dma_desc_addr & (16 / 2)) {
-		sp_acp_set_remote_wstrb_0(0x0000f000);
-		scratch_addr[3] = dma_desc_1;
-	}
-	else {
-		sp_acp_set_remote_wstrb_0(0x000000f0);
-		scratch_addr[1] = dma_desc_1;
+#ifdef DEBUG
+	printf("[tx%d] write(0x%02x%08x)\n",
+		tx_queue_no(tx_queue),
+		(uint32_t)(tx_queue->saved_cur_dma_desc_addr >> 32),
+		(uint32_t)tx_queue->saved_cur_dma_desc_addr);
+#endif
+	sp_desc_write(&tx_queue->q, tx_queue->saved_cur_dma_desc_addr, words, 1 << 1);
+	while (sp_acp_busy()) { }
+}
+
+/*
+ * The bits in status (TS_VALID, UNDERRUN) are set in word 1 of the
+ * descriptor. The time stamp is only written with extended descriptors.
+ */
+static inline void
+sp_desc_tx_validate_pending_desc(
+	struct sp_desc_gem_tx_queue *tx_queue,
+	struct sp_desc_tx_ts_pending *pending,
+	uint32_t status,
+	uint32_t ts_1,
+	uint32_t ts_2
+)
+{
+	uint32_t words[SP_DESC_64BIT_TS_NWORDS] = { 0 };
+	int wmask = 1 << 1;
+
+	words[1] = pending->dma_desc_1 | (uint32_t)1 << GEM_TX_DD1_VALID_BITN | status;
+	if (sp_desc_queue_has_ts(&tx_queue->q)) {
+		words[tx_queue->q.ts_wordn] = ts_1;
+		words[tx_queue->q.ts_wordn + 1] = ts_2;
+		wmask |= 0x3 << tx_queue->q.ts_wordn;
 	}
-	// Align to 16 bits.
-	saved_cur_dma_desc_addr &= ~(uint32_t)(16-1);
 #ifdef DEBUG
-	printf("[tx%d] write(0x%08x, 0x%08x)\n",
+	printf("[tx%d] write(0x%02x%08x) ts=0x%08x:0x%08x\n",
 		tx_queue_no(tx_queue),
-		(uint32_t)scratch_addr,
-		saved_cur_dma_desc_addr);
+		(uint32_t)(pending->dma_desc_addr >> 32),
+		(uint32_t)pending->dma_desc_addr,
+		ts_2, ts_1);
 #endif
-	sp_acp_write_start_16((uint32_t)scratch_addr, saved_cur_dma_desc_addr);
+	sp_desc_write(&tx_queue->q, pending->dma_desc_addr, words, wmask);
 	while (sp_acp_busy()) { }
 }
 
@@ -175,30 +354,39 @@ sp_desc_tx_next_desc(
 	struct gem_tx_dma_desc *desc
 )
 {
-	if (desc->dma_desc_1 & (1 << GEM_TX_DD1_WRAP_BITN)) {
-		tx_queue->q.cur_dma_desc_addr = tx_queue->q.dma_desc_base;
-		tx_queue->q.prefetch_primed = 0;
-	}
-	else {
-		tx_queue->q.cur_dma_desc_addr += 2;
-		if (((uint32_t)tx_queue->q.cur_dma_desc_addr & (64-1)) == 0x00) {
-			tx_queue->q.prefetch_primed = 0;
-		}
-	}
+	sp_desc_queue_next(&tx_queue->q, (desc->dma_desc_1 & (1 << GEM_TX_DD1_WRAP_BITN)) != 0);
 }
 #else
+/*
+ * Without the ACP, the descriptors are accessed directly, so the rings
+ * have to be below 4 GB.
+ */
+static inline gem_tx_dma_desc_word_type *
+sp_desc_tx_ptr(dma_addr_t dma_desc_addr)
+{
+	return (gem_tx_dma_desc_word_type *)(uintptr_t)dma_desc_addr;
+}
+
 static inline int
 sp_desc_tx_get_desc(
 	struct sp_desc_gem_tx_queue *tx_queue,
 	struct gem_tx_dma_desc *desc
 )
 {
-	gem_tx_dma_desc_word_type *dma_descp = tx_queue->q.cur_dma_desc_addr;
+	gem_tx_dma_desc_word_type *dma_descp = sp_desc_tx_ptr(tx_queue->q.cur_dma_desc_addr);
 	gem_tx_dma_desc_word_type dma_desc_1 = *(dma_descp + 1);
 	if (dma_desc_1 & (1 << GEM_TX_DD1_VALID_BITN)) {
 		return 1;
 	}
 	gem_tx_dma_desc_word_type dma_desc_0 = *(dma_descp + 0);
+	if (sp_desc_queue_has_addr64(&tx_queue->q)) {
+		desc->dma_desc_2 = *(dma_descp + SP_DESC_ADDRH_WORDN);
+		desc->dma_desc_vlan = *(dma_descp + SP_DESC_VLAN_WORDN);
+	}
+	if (sp_desc_queue_has_ts(&tx_queue->q)) {
+		desc->dma_desc_ts_1 = *(dma_descp + tx_queue->q.ts_wordn);
+		desc->dma_desc_ts_2 = *(dma_descp + tx_queue->q.ts_wordn + 1);
+	}
 
 	desc->dma_desc_0 = dma_desc_0;
 	desc->dma_desc_1 = dma_desc_1;
@@ -223,7 +411,28 @@ sp_desc_tx_validate_saved_desc(
 	// Mark the first descriptor of this packet as usable by the driver
 	// Note that only the first descriptor is set to valid.
 	tx_queue->saved_dma_desc_1 |= (uint32_t)1 << GEM_TX_DD1_VALID_BITN;
-	tx_queue->saved_cur_dma_desc_addr[1] = tx_queue->saved_dma_desc_1;
+	sp_desc_tx_ptr(tx_queue->saved_cur_dma_desc_addr)[1] = tx_queue->saved_dma_desc_1;
+}
+
+static inline void
+sp_desc_tx_validate_pending_desc(
+	struct sp_desc_gem_tx_queue *tx_queue,
+	struct sp_desc_tx_ts_pending *pending,
+	uint32_t status,
+	uint32_t ts_1,
+	uint32_t ts_2
+)
+{
+	gem_tx_dma_desc_word_type *dma_descp = sp_desc_tx_ptr(pending->dma_desc_addr);
+	gem_tx_dma_desc_word_type dma_desc_1 = pending->dma_desc_1;
+	dma_desc_1 |= (uint32_t)1 << GEM_TX_DD1_VALID_BITN;
+	dma_desc_1 |= status;
+
+	if (sp_desc_queue_has_ts(&tx_queue->q)) {
+		dma_descp[tx_queue->q.ts_wordn] = ts_1;
+		dma_descp[tx_queue->q.ts_wordn + 1] = ts_2;
+	}
+	dma_descp[1] = dma_desc_1;
 }
 
 static inline void
@@ -233,14 +442,590 @@ sp_desc_tx_next_desc(
 )
 {
 	// On to the next descriptor in any case.
-	if (desc->dma_desc_1 & (1 << GEM_TX_DD1_WRAP_BITN)) {
-		tx_queue->q.cur_dma_desc_addr = tx_queue->q.dma_desc_base;
+	sp_desc_queue_next(&tx_queue->q, (desc->dma_desc_1 & (1 << GEM_TX_DD1_WRAP_BITN)) != 0);
+}
+#endif
+
+/*
+ * Returns the meta bits with the tag for the next pending frame.
+ * Waits until the ring has room, so the tag is not in use.
+ */
+static uint32_t
+tx_ts_tag(void)
+{
+	while (tx_ts_pending_head - tx_ts_pending_tail == TX_TS_PENDING_SIZE) {
+		tx_ts_drain();
+	}
+	return (tx_ts_pending_head % TX_TS_PENDING_SIZE) << TX_META_DESC_TS_TAG_BITN;
+}
+
+/*
+ * Called when the last descriptor of a frame has been processed.
+ * Validates the first descriptor of the frame or, with time stamps or
+ * cut-through, defers that until the time stamp has arrived.
+ * Returns the bits to add to the meta information of the frame.
+ */
+static uint32_t
+tx_frame_done(struct sp_desc_gem_tx_queue *tx_queue, int q, bool cut_through)
+{
+	if (sp_desc_queue_has_ts(&tx_queue->q) || cut_through) {
+		// Defer the validation until the time stamp arrives.
+		uint32_t tag = tx_ts_tag();
+		struct sp_desc_tx_ts_pending *pending =
+			&tx_ts_pending[tx_ts_pending_head % TX_TS_PENDING_SIZE];
+		pending->q = q;
+		pending->dma_desc_addr = tx_queue->saved_cur_dma_desc_addr;
+		pending->dma_desc_1 = tx_queue->saved_dma_desc_1;
+		pending->cycle = (uint32_t)csr_read_cycle();
+		tx_ts_pending_head++;
+
+		return (uint32_t)sp_desc_queue_has_ts(&tx_queue->q) << TX_META_DESC_TSTAMP_BITN | tag;
+	}
+
+	sp_desc_tx_validate_saved_desc(tx_queue);
+	return 0;
+}
+
+/*
+ * Returns the length of the frame that starts with the current
+ * descriptor. If the frame has more than one descriptor, this walks
+ * ahead to the last one and goes back to the current one afterwards.
+ */
+static int
+tx_frame_length(struct sp_desc_gem_tx_queue *tx_queue, const struct gem_tx_dma_desc *first)
+{
+	struct gem_tx_dma_desc desc = *first;
+	int length = gem_tx_dma_desc1_get_length(desc.dma_desc_1);
+
+	if (desc.dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN))
+		return length;
+
+	dma_addr_t cur_dma_desc_addr = tx_queue->q.cur_dma_desc_addr;
+	do {
+		sp_desc_tx_next_desc(tx_queue, &desc);
+		// The driver hands over all descriptors of a frame at once.
+		while (sp_desc_tx_get_desc(tx_queue, &desc)) {
+		}
+		length += gem_tx_dma_desc1_get_length(desc.dma_desc_1);
+	} while (!(desc.dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN)));
+
+	tx_queue->q.cur_dma_desc_addr = cur_dma_desc_addr;
+	// The prefetched descriptors may belong to the ones further ahead.
+	tx_queue->q.prefetch_primed = 0;
+
+	return length;
+}
+
+/*
+ * TCP segmentation offload (TSO)
+ *
+ * The first descriptor of a TSO frame holds the headers (Ethernet,
+ * IPv4 or IPv6 and TCP) and has GEM_TX_DD1_LSO_TSO set.
+ * The following descriptors hold the payload and carry the MSS.
+ *
+ * For each segment, a copy of the headers is patched and pushed into
+ * the TX header FIFO. The hardware sends it before the payload and sums
+ * up the payload for the TCP checksum while it is transferred into the
+ * TX data FIFO.
+ *
+ * The MSS-sized segments span payload buffers.
+ * The header buffer is read through the ACP and may be above 4 GB.
+ */
+#define TX_TSO_MAX_HDR_LEN		128
+
+#define ETHERTYPE_VLAN			0x8100
+#define ETHERTYPE_QINQ			0x88a8
+#define ETHERTYPE_IPV4			0x0800
+#define ETHERTYPE_IPV6			0x86dd
+#define TCP_PROTO				6
+#define TCP_FLAG_FIN			0x01
+#define TCP_FLAG_PSH			0x08
+#define TCP_FLAG_CWR			0x80
+
+struct tx_tso_hdr {
+	union {
+		uint8_t b[TX_TSO_MAX_HDR_LEN];
+		uint32_t w[TX_TSO_MAX_HDR_LEN / 4];
+	};
+	int len;
+	int l3_off;
+	int l4_off;
+	bool ipv6;
+};
+
+static struct tx_tso_hdr tx_tso_hdr;
+
+static inline uint32_t
+get_be16(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 8 | p[1];
+}
+
+static inline uint32_t
+get_be32(const uint8_t *p)
+{
+	return get_be16(p) << 16 | get_be16(p + 2);
+}
+
+static inline void
+put_be16(uint8_t *p, uint32_t x)
+{
+	p[0] = x >> 8;
+	p[1] = x;
+}
+
+static inline void
+put_be32(uint8_t *p, uint32_t x)
+{
+	put_be16(p, x >> 16);
+	put_be16(p + 2, x);
+}
+
+static uint32_t
+csum_add(uint32_t sum, const uint8_t *p, int len)
+{
+	for (int i = 0; i + 1 < len; i += 2)
+		sum += get_be16(p + i);
+	if (len & 1)
+		sum += (uint32_t)p[len - 1] << 8;
+	return sum;
+}
+
+static uint32_t
+csum_fold(uint32_t sum)
+{
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+static int
+tx_tso_parse_hdr(struct tx_tso_hdr *hdr)
+{
+	const uint8_t *b = hdr->b;
+	int off = 12;
+	uint32_t ethertype = get_be16(b + off);
+	uint8_t proto;
+
+	while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) &&
+		off + 4 + 2 <= hdr->len) {
+		off += 4;
+		ethertype = get_be16(b + off);
+	}
+	hdr->l3_off = off + 2;
+
+	if (ethertype == ETHERTYPE_IPV4) {
+		if (hdr->l3_off + 20 > hdr->len)
+			return 1;
+		hdr->ipv6 = false;
+		hdr->l4_off = hdr->l3_off + (b[hdr->l3_off] & 0xf) * 4;
+		proto = b[hdr->l3_off + 9];
+	}
+	else if (ethertype == ETHERTYPE_IPV6) {
+		if (hdr->l3_off + 40 > hdr->len)
+			return 1;
+		hdr->ipv6 = true;
+		hdr->l4_off = hdr->l3_off + 40;
+		proto = b[hdr->l3_off + 6];
+	}
+	else {
+		return 1;
+	}
+	if (proto != TCP_PROTO)
+		return 1;
+	// The headers must end exactly with the TCP header.
+	if (hdr->l4_off + 20 > hdr->len ||
+		hdr->l4_off + (b[hdr->l4_off + 12] >> 4) * 4 != hdr->len)
+		return 1;
+
+	return 0;
+}
+
+/*
+ * Copies the tmpl->len bytes of headers at hdr_addr into tmpl.
+ * They are read through the ACP 16 bytes at a time into the prefetch
+ * area of the queue, so the buffer may be anywhere in the 40-bit space.
+ */
+static void
+tx_tso_read_hdr(struct sp_desc_gem_tx_queue *tx_queue, struct tx_tso_hdr *tmpl,
+	dma_addr_t hdr_addr)
+{
+	const volatile uint8_t *scratch = tx_queue->q.prefetch_addr;
+	dma_addr_t line_addr = hdr_addr & ~(dma_addr_t)(16 - 1);
+
+	for (int i = 0; i < tmpl->len; line_addr += 16) {
+		while (sp_acp_busy()) {
+		}
+		sp_acp_read_start_16((uint32_t)(uintptr_t)scratch, line_addr);
+		while (sp_acp_busy()) {
+		}
+		for (int off = hdr_addr + i - line_addr; off < 16 && i < tmpl->len; off++)
+			tmpl->b[i++] = scratch[off];
+	}
+	// The prefetched descriptors have been overwritten.
+	tx_queue->q.prefetch_primed = 0;
+}
+
+/*
+ * Hands a part of the payload of a segment to the TX DMA.
+ * With 'more', the next part follows in the same segment.
+ */
+static inline void
+tx_tso_dma_start(dma_addr_t data_addr, int data_length, bool more)
+{
+	// The DMA engine only takes one transfer at a time.
+	while (sp_tx_data_dma_status()) {
+	}
+	sp_tx_data_dma_start(data_addr, (uint32_t)more << 31 | data_length);
+}
+
+/*
+ * Sends one segment: payload_offset bytes of payload have been sent
+ * before this one and the data_length bytes of its payload have been
+ * handed to the TX DMA.
+ */
+static void
+tx_tso_segment(struct tx_tso_hdr *hdr, const struct tx_tso_hdr *tmpl,
+	uint32_t payload_offset, int segn, bool last,
+	int data_length, uint32_t meta_bits)
+{
+	uint8_t *b = hdr->b;
+	int l3 = hdr->l3_off;
+	int l4 = hdr->l4_off;
+	int tcp_length = hdr->len - l4 + data_length;
+
+	// The hardware sums up the payload while it is transferred.
+	// Getting the sum starts over with the next segment.
+	while (sp_tx_data_dma_status()) {
+	}
+	uint32_t sum = sp_tx_csum_get();
+
+	// IP
+	if (hdr->ipv6) {
+		put_be16(b + l3 + 4, tcp_length);
+		sum = csum_add(sum, b + l3 + 8, 32);
 	}
 	else {
-		tx_queue->q.cur_dma_desc_addr += 2;
+		put_be16(b + l3 + 2, hdr->len - l3 + data_length);
+		put_be16(b + l3 + 4, get_be16(tmpl->b + l3 + 4) + segn);
+		put_be16(b + l3 + 10, 0);
+		put_be16(b + l3 + 10, ~csum_fold(csum_add(0, b + l3, l4 - l3)));
+		sum = csum_add(sum, b + l3 + 12, 8);
+	}
+
+	// TCP
+	uint8_t flags = tmpl->b[l4 + 13];
+	if (!last)
+		flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+	if (segn != 0)
+		flags &= ~TCP_FLAG_CWR;
+	put_be32(b + l4 + 4, get_be32(tmpl->b + l4 + 4) + payload_offset);
+	b[l4 + 13] = flags;
+	put_be16(b + l4 + 16, 0);
+	// The rest of the pseudo header
+	sum += TCP_PROTO + tcp_length;
+	sum = csum_add(sum, b + l4, hdr->len - l4);
+	put_be16(b + l4 + 16, ~csum_fold(sum));
+
+	for (int i = 0; i < (hdr->len + 3) / 4; i++) {
+		while (sp_tx_hdr_push(hdr->w[i])) {
+		}
 	}
+
+	uint32_t meta_desc = (uint32_t)hdr->len << TX_META_DESC_HDR_LEN_BITN |
+		(hdr->len + data_length) | meta_bits;
+	tx_frame_nbytes += hdr->len + data_length;
+#ifdef DEBUG
+	printf("TSO: seg=%d off=%u len=%d meta=0x%08x\n",
+		segn, payload_offset, data_length, meta_desc);
+#endif
+	sp_tx_meta_push_uint32(meta_desc);
 }
+
+/*
+ * Processes a TSO frame whose first descriptor (with the headers) is
+ * in desc. Returns the number of descriptors.
+ *
+ * Segments are MSS-sized across payload buffers: the parts of a segment
+ * from different buffers are chained into one transfer with the "more"
+ * bit of the TX DMA. A segment is only sent once the next payload byte
+ * or the end of the frame has been seen, so the last one is known.
+ */
+static int
+tx_tso(int q, struct gem_tx_dma_desc *desc)
+{
+	struct sp_desc_gem_tx_queue *tx_queue = &tx_queues[q];
+	struct tx_tso_hdr *tmpl = &tx_tso_hdr;
+	struct tx_tso_hdr hdr;
+	int ndescs = 1;
+	int nsegs = 0;
+	uint32_t payload_offset = 0;
+	bool error = false;
+	// The MSS is taken from the first payload descriptor.
+	int mss = 0;
+	// The part of the current segment not yet handed to the TX DMA
+	dma_addr_t part_addr = 0;
+	int part_length = 0;
+	int seg_length = 0;
+
+	dma_addr_t hdr_addr = gem_tx_dma_desc0_get_addr(desc->dma_desc_0);
+	if (sp_desc_queue_has_addr64(&tx_queue->q)) {
+		hdr_addr |= (dma_addr_t)desc->dma_desc_2 << 32;
+	}
+	tmpl->len = gem_tx_dma_desc1_get_length(desc->dma_desc_1);
+	bool eof = (desc->dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN)) != 0;
+
+	if (eof || tmpl->len > TX_TSO_MAX_HDR_LEN) {
+		error = true;
+	}
+	else {
+		tx_tso_read_hdr(tx_queue, tmpl, hdr_addr);
+		error = tx_tso_parse_hdr(tmpl) != 0;
+		// Start over with the sum.
+		sp_tx_csum_get();
+	}
+	sp_desc_tx_next_desc(tx_queue, desc);
+
+	while (!eof) {
+		// The driver hands over all descriptors of a frame at once.
+		while (sp_desc_tx_get_desc(tx_queue, desc)) {
+		}
+		ndescs++;
+
+		eof = (desc->dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN)) != 0;
+		dma_addr_t data_addr = gem_tx_dma_desc0_get_addr(desc->dma_desc_0);
+		if (sp_desc_queue_has_addr64(&tx_queue->q)) {
+			data_addr |= (dma_addr_t)desc->dma_desc_2 << 32;
+		}
+		int data_length = gem_tx_dma_desc1_get_length(desc->dma_desc_1);
+		if (mss == 0) {
+			mss = (desc->dma_desc_1 >> GEM_TX_DD1_MSS_BITN) & ((1 << GEM_TX_DD1_MSS_WIDTH) - 1);
+			if (mss == 0)
+				error = true;
+		}
+		sp_desc_tx_next_desc(tx_queue, desc);
+
+		for (int offset = 0; !error && offset < data_length;) {
+			if (seg_length == mss) {
+				// More payload follows the full segment.
+				tx_tso_dma_start(part_addr, part_length, false);
+				hdr = *tmpl;
+				tx_tso_segment(&hdr, tmpl, payload_offset, nsegs, false,
+					seg_length, 0);
+				payload_offset += seg_length;
+				nsegs++;
+				part_length = 0;
+				seg_length = 0;
+			}
+			if (part_length != 0) {
+				// The segment goes on in this buffer.
+				tx_tso_dma_start(part_addr, part_length, true);
+			}
+
+			part_addr = data_addr + offset;
+			part_length = data_length - offset;
+			if (part_length > mss - seg_length)
+				part_length = mss - seg_length;
+			seg_length += part_length;
+			offset += part_length;
+		}
+	}
+
+	if (seg_length == 0) {
+		printf("TX: Dropping malformed TSO frame.\n");
+		sp_desc_tx_validate_saved_desc(tx_queue);
+		return ndescs;
+	}
+
+	tx_tso_dma_start(part_addr, part_length, false);
+	hdr = *tmpl;
+	tx_tso_segment(&hdr, tmpl, payload_offset, nsegs, true,
+		seg_length, tx_frame_done(tx_queue, q, false));
+
+	return ndescs;
+}
+
+/*
+ * Returns true if the shaper lets queue q start a frame.
+ */
+static bool
+tx_shaper_ok(int q)
+{
+	if (tx_shaper_rates[q] == 0)
+		return true;
+
+	uint64_t cycle = csr_read_cycle();
+	uint64_t ncycles = cycle - tx_shaper_cycles[q];
+	if (ncycles > TX_SHAPER_MAX_CYCLES)
+		ncycles = TX_SHAPER_MAX_CYCLES;
+	int64_t credits = tx_shaper_credits[q] + (int64_t)tx_shaper_rates[q] * (int64_t)ncycles;
+	if (credits > tx_shaper_max_credits[q])
+		credits = tx_shaper_max_credits[q];
+
+	tx_shaper_credits[q] = credits;
+	tx_shaper_cycles[q] = cycle;
+	return credits >= 0;
+}
+
+/*
+ * Returns what to do with a frame that has the launch time ts_1/ts_2
+ * (TX_LAUNCH_*).
+ */
+static int
+tx_launch_check(uint32_t ts_1, uint32_t ts_2)
+{
+	uint32_t now_1 = sp_tx_tsu_get(0);
+	uint32_t now_2 = sp_tx_tsu_get(1);
+
+	// The seconds are 34 bits wide.
+	int64_t sec = (int64_t)((uint64_t)ts_2 << 2 | ts_1 >> 30) -
+		(int64_t)((uint64_t)now_2 << 2 | now_1 >> 30);
+	// The horizon is less than 65536 seconds. This also keeps the
+	// nanoseconds below from overflowing.
+	if (sec > 65536)
+		return TX_LAUNCH_DROP;
+	if (sec < -1)
+		return TX_LAUNCH_NOW;
+
+	int64_t nsec = sec * TSU_NSEC_PER_SEC +
+		(int64_t)(ts_1 & TX_LAUNCH_NSEC_MASK) - (int64_t)(now_1 & TX_LAUNCH_NSEC_MASK);
+	if (nsec <= 0)
+		return TX_LAUNCH_NOW;
+	if (nsec > tx_launch_horizon)
+		return TX_LAUNCH_DROP;
+	if (nsec > tx_launch_lead)
+		return TX_LAUNCH_HOLD;
+	return TX_LAUNCH_GATE;
+}
+
+/*
+ * Hands the frame that starts with desc back to the driver without
+ * sending it.
+ */
+static void
+tx_drop(struct sp_desc_gem_tx_queue *tx_queue, int q, struct gem_tx_dma_desc *desc)
+{
+	sp_desc_tx_save_desc(tx_queue, desc);
+	tx_queue->saved_dma_desc_1 &= ~((uint32_t)1 << GEM_TX_DD1_TS_VALID_BITN);
+
+	while (!(desc->dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN))) {
+		sp_desc_tx_next_desc(tx_queue, desc);
+		// The driver hands over all descriptors of a frame at once.
+		while (sp_desc_tx_get_desc(tx_queue, desc)) {
+		}
+	}
+	sp_desc_tx_next_desc(tx_queue, desc);
+
+	sp_desc_tx_validate_saved_desc(tx_queue);
+	gem_tx_done(q);
+}
+
+/*
+ * Flow control
+ *
+ * The RX SP of the pair sets SP_STATUS_RX_PAUSE_BITN in its STATUS
+ * register (our PEER_STATUS register) while the link partner should
+ * pause. Meanwhile, we send PAUSE frames with the quantum the driver has
+ * set up in the GEM, or PFC frames for the configured priorities.
+ * The pause is renewed at the configured interval, which should be
+ * shorter than the quantum. Once the RX SP clears the bit, a frame with
+ * a zero quantum releases the link partner right away.
+ *
+ * The frames are built here and put into the TX control frame slot,
+ * which the hardware sends at the next frame boundary, ahead of queued
+ * and launch-gated frames. This leaves the GEM's network control
+ * register to the driver.
+ */
+#define ETHERTYPE_MAC_CONTROL	0x8808
+#define MAC_CONTROL_PAUSE		0x0001
+#define MAC_CONTROL_PFC			0x0101
+// Without the FCS, which the GEM appends
+#define TX_PAUSE_FRAME_LEN		60
+#define TX_PFC_NPRIOS			8
+
+struct tx_flow_ctrl {
+	bool paused;
+	// The cycle counter at the last PAUSE frame
+	uint32_t cycle;
+	union {
+		uint8_t b[TX_PAUSE_FRAME_LEN];
+		uint32_t w[TX_PAUSE_FRAME_LEN / 4];
+	} frame;
+};
+
+static struct tx_flow_ctrl tx_flow_ctrl_state;
+
+static void
+tx_flow_ctrl_send(bool zero)
+{
+	uint8_t *b = tx_flow_ctrl_state.frame.b;
+	uint32_t quantum = zero ? 0 :
+		gem_read_reg(gem_base, GEM_TX_PAUSE_QUANTUM_OFFSET) & GEM_TX_PAUSE_QUANTUM_MASK;
+	uint32_t sa_bottom = gem_read_reg(gem_base, GEM_SPEC_ADD1_BOTTOM_OFFSET);
+	uint32_t sa_top = gem_read_reg(gem_base, GEM_SPEC_ADD1_TOP_OFFSET);
+
+	for (int i = 0; i < TX_PAUSE_FRAME_LEN; i++)
+		b[i] = 0;
+	// 01:80:c2:00:00:01
+	put_be32(b, 0x0180c200);
+	put_be16(b + 4, 0x0001);
+	// The GEM keeps the first byte of the address in bits 7:0.
+	for (int i = 0; i < 4; i++)
+		b[6 + i] = sa_bottom >> (8 * i);
+	b[10] = sa_top;
+	b[11] = sa_top >> 8;
+	put_be16(b + 12, ETHERTYPE_MAC_CONTROL);
+	if (tx_flow_ctrl_prios == 0) {
+		put_be16(b + 14, MAC_CONTROL_PAUSE);
+		put_be16(b + 16, quantum);
+	}
+	else {
+		put_be16(b + 14, MAC_CONTROL_PFC);
+		put_be16(b + 16, tx_flow_ctrl_prios);
+		for (int i = 0; i < TX_PFC_NPRIOS; i++) {
+			if (tx_flow_ctrl_prios & (1 << i))
+				put_be16(b + 18 + 2 * i, quantum);
+		}
+	}
+
+	// The last frame may still be in the slot.
+	for (int i = 0; i < TX_PAUSE_FRAME_LEN / 4; i++) {
+		uint32_t length = i == TX_PAUSE_FRAME_LEN / 4 - 1 ? TX_PAUSE_FRAME_LEN : 0;
+		while (sp_tx_ctrl_push(tx_flow_ctrl_state.frame.w[i], length)) {
+		}
+	}
+}
+
+/*
+ * Sends a PAUSE (or PFC) frame if the RX SP has asked for a pause, if
+ * it is time to renew it or if the RX SP has released it.
+ */
+void
+tx_flow_ctrl(void)
+{
+	struct tx_flow_ctrl *fc = &tx_flow_ctrl_state;
+	bool pause = (sp_load_reg(SP_REGN_PEER_STATUS) >> SP_STATUS_RX_PAUSE_BITN) & 1;
+	uint32_t cycle = (uint32_t)csr_read_cycle();
+
+	if (pause) {
+		if (!fc->paused || (tx_flow_ctrl_refresh != 0 &&
+				cycle - fc->cycle >= tx_flow_ctrl_refresh)) {
+			tx_flow_ctrl_send(false);
+			fc->paused = true;
+			fc->cycle = cycle;
+#ifdef DEBUG
+			printf("TX: pause\n");
+#endif
+		}
+	}
+	else if (fc->paused) {
+		tx_flow_ctrl_send(true);
+		fc->paused = false;
+#ifdef DEBUG
+		printf("TX: resume\n");
 #endif
+	}
+}
 
 /*
  * Called when triggered by MMIO.
@@ -254,6 +1039,14 @@ tx(int q)
 	int packet_length = 0;
 	int ntxdescs = 0;
 	bool no_crc;
+	bool cut_through = false;
+	uint32_t meta_bits;
+	uint32_t vlan_bits = 0;
+	int launch = TX_LAUNCH_NOW;
+
+	tx_frame_nbytes = 0;
+	// A pause must not wait for a long burst of our own frames.
+	tx_flow_ctrl();
 
 	for (;;) {
 		struct gem_tx_dma_desc desc;
@@ -262,38 +1055,102 @@ tx(int q)
 		if (sp_desc_tx_get_desc(tx_queue, &desc))
 			return 0;
 
+		// With extended descriptors, the host requests a launch time
+		// by setting TS_VALID in the first descriptor of a frame.
+		// The time stamp words hold the launch time then.
+		if (ntxdescs == 0 && sp_desc_queue_has_ts(&tx_queue->q) &&
+			(desc.dma_desc_1 & (1 << GEM_TX_DD1_TS_VALID_BITN)) != 0) {
+			launch = tx_launch_check(desc.dma_desc_ts_1, desc.dma_desc_ts_2);
+			if (launch == TX_LAUNCH_HOLD) {
+				tx_held = true;
+				return 0;
+			}
+			if (launch == TX_LAUNCH_DROP) {
+				printf("TX: Dropped the frame in queue %d, its launch time is too far ahead.\n", q);
+				tx_drop(tx_queue, q, &desc);
+				return 1;
+			}
+		}
+
+		// The frame stays in the queue until the shaper lets it go.
+		if (ntxdescs == 0 && !tx_shaper_ok(q)) {
+			tx_held = true;
+			return 0;
+		}
+
 		ntxdescs++;
 
 		// If this is the first descriptor of this packet.
 		if (packet_length == 0) {
 			sp_desc_tx_save_desc(tx_queue, &desc);
+			// TS_VALID is only set again with the time stamp.
+			tx_queue->saved_dma_desc_1 &= ~((uint32_t)1 << GEM_TX_DD1_TS_VALID_BITN);
+
+			if (((desc.dma_desc_1 >> GEM_TX_DD1_LSO_BITN) &
+				((1 << GEM_TX_DD1_LSO_WIDTH) - 1)) == GEM_TX_DD1_LSO_TSO) {
+				ntxdescs += tx_tso(q, &desc) - 1;
+				break;
+			}
 			no_crc = (desc.dma_desc_1 & (1 << GEM_TX_DD1_NOCRC_BITN)) != 0;
+			meta_bits = (uint32_t)no_crc << TX_META_DESC_NO_CRC_BITN;
+
+			// A launch time that has passed is ignored.
+			if (launch == TX_LAUNCH_GATE) {
+				while (sp_tx_launch_push(desc.dma_desc_ts_1, desc.dma_desc_ts_2)) {
+				}
+				meta_bits |= (uint32_t)1 << TX_META_DESC_LAUNCH_BITN;
+			}
+
+			// With 64-bit descriptors, the host requests a VLAN tag
+			// in the otherwise reserved word of the first descriptor.
+			if (tx_vlan_insert && sp_desc_queue_has_addr64(&tx_queue->q) &&
+				(desc.dma_desc_vlan & (1 << SP_DESC_VLAN_VALID_BITN)) != 0) {
+				vlan_bits = (uint32_t)1 << SP_TX_META_VLAN_INSERT_BITN |
+					(desc.dma_desc_vlan & SP_DESC_VLAN_TCI_MASK);
+			}
+
+			// With cut-through, the GEM may start sending the frame
+			// while the rest of it is still being transferred.
+			if (tx_ct_threshold != 0) {
+				// tx_frame_done() takes the same tag later.
+				uint32_t meta_desc = meta_bits | tx_ts_tag() |
+					(uint32_t)1 << TX_META_DESC_CUT_THROUGH_BITN |
+					tx_frame_length(tx_queue, &desc);
+				if (sp_desc_queue_has_ts(&tx_queue->q)) {
+					meta_desc |= (uint32_t)1 << TX_META_DESC_TSTAMP_BITN;
+				}
+				sp_tx_meta_push_vlan(meta_desc, vlan_bits);
+				cut_through = true;
+			}
 		}
 
 		// Get the DRAM address and length of the payload buffer
 		dma_addr_t data_addr = gem_tx_dma_desc0_get_addr(desc.dma_desc_0);
+		if (sp_desc_queue_has_addr64(&tx_queue->q)) {
+			data_addr |= (dma_addr_t)desc.dma_desc_2 << 32;
+		}
 		int data_length = gem_tx_dma_desc1_get_length(desc.dma_desc_1);
 
 #ifdef DEBUG
-		printf("%sTX: 0:0x%08x 1:0x%08x addr=0x%08x len=%d\n",
+		printf("%sTX: 0:0x%08x 1:0x%08x addr=0x%02x%08x len=%d\n",
 			packet_length == 0 ? " " : "+",
-			desc.dma_desc_0, desc.dma_desc_1, data_addr, data_length);
+			desc.dma_desc_0, desc.dma_desc_1,
+			(uint32_t)(data_addr >> 32), (uint32_t)data_addr,
+			data_length);
 #endif
 
 		bool eof = (desc.dma_desc_1 & (1 << GEM_TX_DD1_EOF_BITN)) != 0;
-		uint32_t count;
-		for (;;) {
-			count = sp_tx_data_count();
-			if (tx_config.data_fifo_size - count >= data_length)
-				break;
-		}
 
+		// The DMA engine waits for room in the TX data FIFO by itself,
+		// but it only takes one transfer at a time.
+		while (sp_tx_data_dma_status()) {
+		}
 		sp_tx_data_dma_start(data_addr, (uint32_t)!eof << 31 | data_length);
-		int niters;
-		for (niters = 0;; niters++) {
-			uint32_t status = sp_tx_data_dma_status();
-			if (status == 0) {
-				break;
+		if (eof) {
+			// The frame must be complete in the TX data FIFO
+			// before its meta data is pushed or its descriptors
+			// are handed back.
+			while (sp_tx_data_dma_status()) {
 			}
 		}
 
@@ -302,14 +1159,27 @@ tx(int q)
 		sp_desc_tx_next_desc(tx_queue, &desc);
 
 		if (eof) {
-			sp_desc_tx_validate_saved_desc(tx_queue);
+			if (cut_through) {
+				// The meta data has been pushed already.
+				tx_frame_done(tx_queue, q, true);
+				break;
+			}
+
+			uint32_t meta_desc = meta_bits | packet_length;
+
+			meta_desc |= tx_frame_done(tx_queue, q, false);
 
 			// Store the descriptor in the BRAM
-			sp_tx_meta_push_uint32((uint32_t)no_crc << TX_META_DESC_NO_CRC_BITN | packet_length);
+			sp_tx_meta_push_vlan(meta_desc, vlan_bits);
 			break;
 		}
 	}
-	if (ntxdescs > 0) {
+	tx_frame_nbytes += packet_length;
+	if (tx_shaper_rates[q] != 0)
+		tx_shaper_credits[q] -= (int64_t)tx_frame_nbytes << TX_SHAPER_FRAC_BITS;
+
+	// With time stamps or cut-through, tx_ts_drain() sends the interrupt.
+	if (ntxdescs > 0 && !sp_desc_queue_has_ts(&tx_queue->q) && !cut_through) {
 		// Send TX done interrupt
 		gem_tx_done(q);
 	}
@@ -319,3 +1189,162 @@ tx(int q)
 	// >=1: Possibly more descriptors
 	return ntxdescs;
 }
+
+/*
+ * Sends the frames of all TX queues until they are empty.
+ *
+ * Strict priority: A frame is always taken from the highest-numbered
+ * queue that has one, like the GEM does.
+ * Weighted round-robin (WRR): Each queue sends up to its weight in frames
+ * per round.
+ * Deficit round-robin (DRR): Each queue gets its weight times 64 bytes
+ * per round and sends as long as it has some left. Since the length of a
+ * frame is only known after it has been sent, the last frame of a round
+ * may overdraw the deficit, which is then carried into the next round.
+ * The deficit of a queue that runs empty is reset.
+ * A queue whose frame is held back by the shaper counts as empty.
+ * Returns true if that happened, so tx_schedule() has to be called again.
+ */
+bool
+tx_schedule(void)
+{
+	tx_held = false;
+
+	if (tx_sched_mode == SP_TX_SCHED_MODE_STRICT) {
+		for (;;) {
+			int q;
+			for (q = NQUEUES - 1; q >= 0; q--) {
+				if (tx(q))
+					break;
+			}
+			if (q < 0)
+				return tx_held;
+		}
+	}
+
+	bool drr = tx_sched_mode == SP_TX_SCHED_MODE_DRR;
+	bool busy[NQUEUES];
+	int nbusy = NQUEUES;
+
+	for (int q = 0; q < NQUEUES; q++)
+		busy[q] = true;
+
+	while (nbusy > 0) {
+		for (int q = 0; q < NQUEUES; q++) {
+			if (!busy[q])
+				continue;
+			if (drr)
+				tx_sched_deficits[q] += tx_sched_weights[q] * 64;
+
+			for (int n = 0; drr ? tx_sched_deficits[q] > 0 : n < tx_sched_weights[q]; n++) {
+				if (!tx(q)) {
+					busy[q] = false;
+					nbusy--;
+					tx_sched_deficits[q] = 0;
+					break;
+				}
+				tx_sched_deficits[q] -= tx_frame_nbytes;
+			}
+		}
+	}
+	return tx_held;
+}
+
+/*
+ * Returns the number of cycles after which the time stamp of a frame
+ * is considered lost. The GEM may hold a frame for a whole pause of the
+ * link partner, and all frames wait behind one with a launch time.
+ */
+static uint32_t
+tx_ts_timeout(void)
+{
+	uint32_t config = gem_read_reg(gem_base, GEM_NETWORK_CONFIG_OFFSET);
+	// In nanoseconds
+	uint64_t bit_time = (config & (1 << GEM_NETWORK_CONFIG_GIGABIT_BITN)) ? 1 :
+		(config & (1 << GEM_NETWORK_CONFIG_SPEED_BITN)) ? 10 : 100;
+	uint64_t nsec = (uint64_t)tx_launch_lead + TX_PAUSE_MAX_QUANTA * 512 * bit_time;
+
+	return TX_TS_TIMEOUT + (uint32_t)(nsec * TX_CYCLES_PER_USEC / 1000);
+}
+
+/*
+ * Validates the oldest pending frame with the status and time stamp
+ * given and sends the TX done interrupt.
+ */
+static void
+tx_ts_validate_oldest(uint32_t status, uint32_t ts_1, uint32_t ts_2)
+{
+	struct sp_desc_tx_ts_pending *pending =
+		&tx_ts_pending[tx_ts_pending_tail % TX_TS_PENDING_SIZE];
+
+	sp_desc_tx_validate_pending_desc(&tx_queues[pending->q], pending, status, ts_1, ts_2);
+	tx_ts_pending_tail++;
+
+	// Send TX done interrupt
+	gem_tx_done(pending->q);
+}
+
+/*
+ * Writes the time stamps and the status of all frames sent so far back
+ * into their descriptors and validates them. Cut-through frames which
+ * the GEM aborted get the UNDERRUN bit.
+ * The time stamp FIFO entries are matched to the frames by their tag.
+ * The oldest frame is validated without a time stamp once a later
+ * frame's time stamp has arrived or once it has waited for longer than
+ * tx_ts_timeout(), so a lost time stamp cannot stall the transmission
+ * for good.
+ * Only used with extended (time stamp) descriptors or cut-through.
+ */
+int
+tx_ts_drain(void)
+{
+	int n = 0;
+
+	while (tx_ts_pending_head != tx_ts_pending_tail) {
+		struct sp_desc_tx_ts_pending *pending =
+			&tx_ts_pending[tx_ts_pending_tail % TX_TS_PENDING_SIZE];
+
+		if (!sp_tx_ts_empty()) {
+			uint32_t ts_1 = sp_tx_ts_pop_uint32();
+			uint32_t ts_2 = sp_tx_ts_get(1);
+			uint32_t ts_status = sp_tx_ts_get(SP_TX_TS_STATUS_WORDN);
+			unsigned int tag = (ts_status >> SP_TX_TS_STATUS_TAG_BITN) & SP_TX_TS_STATUS_TAG_MASK;
+			unsigned int ahead = (tag - tx_ts_pending_tail) % TX_TS_PENDING_SIZE;
+
+			if (ahead >= tx_ts_pending_head - tx_ts_pending_tail) {
+				printf("TX: Dropping a late time stamp.\n");
+				continue;
+			}
+			for (; ahead > 0; ahead--) {
+				printf("TX: No time stamp for the frame in queue %d.\n",
+					tx_ts_pending[tx_ts_pending_tail % TX_TS_PENDING_SIZE].q);
+				tx_ts_validate_oldest(0, 0, 0);
+				n++;
+			}
+			pending = &tx_ts_pending[tx_ts_pending_tail % TX_TS_PENDING_SIZE];
+
+			uint32_t status = 0;
+			if (ts_status & (1 << SP_TX_TS_STATUS_UNDERFLOW_BITN)) {
+#ifdef DEBUG
+				printf("TX: Underflow of the frame in queue %d.\n", pending->q);
+#endif
+				status |= (uint32_t)1 << GEM_TX_DD1_UNDERRUN_BITN;
+			}
+			else if (sp_desc_queue_has_ts(&tx_queues[pending->q].q)) {
+				status |= (uint32_t)1 << GEM_TX_DD1_TS_VALID_BITN;
+			}
+			tx_ts_validate_oldest(status, ts_1, ts_2);
+		}
+		else {
+			uint32_t waited = (uint32_t)csr_read_cycle() - pending->cycle;
+			// Only look at the GEM once the shortest timeout is up.
+			if (waited < TX_TS_TIMEOUT || waited < tx_ts_timeout())
+				break;
+			printf("TX: No time stamp for the frame in queue %d.\n", pending->q);
+			tx_ts_validate_oldest(0, 0, 0);
+		}
+		n++;
+	}
+
+	return n;
+}
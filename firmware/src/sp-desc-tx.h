@@ -19,5 +19,8 @@
 void load_tx_config(void);
 void load_desc_tx_config(void);
 int tx(int q);
+bool tx_schedule(void);
+int tx_ts_drain(void);
+void tx_flow_ctrl(void);
 
 #endif
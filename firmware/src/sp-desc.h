@@ -19,17 +19,53 @@
 typedef uint32_t gem_rx_dma_desc_word_type;
 typedef uint32_t gem_tx_dma_desc_word_type;
 
+// Words per descriptor.
+// Extended (time stamp) descriptors add the two time stamp words.
+// 64-bit descriptors add the upper address word and a reserved word.
+// With both, the time stamp words come after the reserved word, so the
+// descriptors are 24 bytes and some of them straddle two 64-byte lines.
+#define SP_DESC_NWORDS			2
+#define SP_DESC_TS_NWORDS		4
+#define SP_DESC_64BIT_NWORDS	4
+#define SP_DESC_64BIT_TS_NWORDS	6
+
+// The word holding the upper 32 bits of the buffer address
+// in 64-bit descriptors.
+#define SP_DESC_ADDRH_WORDN		2
+// The first time stamp word in extended descriptors
+#define SP_DESC_TS_WORDN		2
+#define SP_DESC_64BIT_TS_WORDN	4
+// The reserved word of 64-bit descriptors carries the VLAN tag
+// (the TCI and a valid bit) of a frame for VLAN offloading.
+#define SP_DESC_VLAN_WORDN		3
+#define SP_DESC_VLAN_TCI_MASK	0xffff
+#define SP_DESC_VLAN_VALID_BITN	16
+
 struct sp_desc_gem_queue {
 	struct sp_gem_queue base;
 
-	gem_rx_dma_desc_word_type *dma_desc_base;
-	gem_rx_dma_desc_word_type *cur_dma_desc_addr;
+	dma_addr_t dma_desc_base;
+	dma_addr_t cur_dma_desc_addr;
+	// The 64-byte line of the current descriptor. If the descriptor
+	// straddles two lines, the first 16 bytes of the next line are in
+	// place of the first 16 bytes of its line.
 	void *prefetch_addr;
 	int prefetch_primed;
+	// The number of words per descriptor.
+	int ndescwords;
+	// The first time stamp word (only with extended descriptors)
+	int ts_wordn;
+	// Extended (time stamp) descriptors
+	bool ts;
+	// 64-bit descriptors
+	bool addr64;
 };
 
 struct sp_desc_gem_rx_queue {
 	struct sp_desc_gem_queue q;
+	// The size of the receive buffers in bytes as configured in the GEM.
+	// Frames larger than this are spread over multiple descriptors.
+	int buf_size;
 };
 
 struct sp_desc_gem_tx_queue {
@@ -37,10 +73,60 @@ struct sp_desc_gem_tx_queue {
 	// Keeps the address of the last start-of-frame descriptor.
 	// We need this to set the valid bit of this (and only this)
 	// descriptor when we're done with the packet.
-	gem_rx_dma_desc_word_type *saved_cur_dma_desc_addr;
+	dma_addr_t saved_cur_dma_desc_addr;
 	gem_rx_dma_desc_word_type saved_dma_desc_1;
 };
 
+static inline bool
+sp_desc_queue_has_ts(struct sp_desc_gem_queue *q)
+{
+	return q->ts;
+}
+
+static inline bool
+sp_desc_queue_has_addr64(struct sp_desc_gem_queue *q)
+{
+	return q->addr64;
+}
+
+/*
+ * Returns word i of the current descriptor from the prefetched line.
+ */
+static inline uint32_t
+sp_desc_prefetch_word(struct sp_desc_gem_queue *q, int i)
+{
+	const volatile uint32_t *line = q->prefetch_addr;
+	int first = ((uint32_t)q->cur_dma_desc_addr & (64 - 1)) / 4;
+
+	return line[(first + i) % 16];
+}
+
+/*
+ * Moves on to the next descriptor in the ring, or back to the first one
+ * after the descriptor with the WRAP bit. A new line has to be
+ * prefetched once the next descriptor starts in it.
+ */
+static inline void
+sp_desc_queue_next(struct sp_desc_gem_queue *q, bool wrap)
+{
+	if (wrap) {
+		q->cur_dma_desc_addr = q->dma_desc_base;
+		q->prefetch_primed = 0;
+	}
+	else {
+		q->cur_dma_desc_addr += q->ndescwords * sizeof(uint32_t);
+		if (((uint32_t)q->cur_dma_desc_addr & (64 - 1)) < q->ndescwords * sizeof(uint32_t)) {
+			q->prefetch_primed = 0;
+		}
+	}
+}
+
+void sp_desc_queue_init(struct sp_desc_gem_queue *q, uint32_t dma_desc_base,
+	uint32_t dma_desc_base_h);
+void sp_desc_prefetch(struct sp_desc_gem_queue *q);
+void sp_desc_write(struct sp_desc_gem_queue *q, dma_addr_t dma_desc_addr,
+	const uint32_t *words, int wmask);
+
 void dump_tx_descs(int q);
 
 extern struct sp_desc_gem_rx_queue rx_queues[NQUEUES];
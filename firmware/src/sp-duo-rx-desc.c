@@ -63,10 +63,12 @@ main()
 	sp_acp_set_local_wstrb_3(0x0000ffff);
 
 	for (;;) {
-		uint32_t x = sp_rx_meta_empty();
-		if (!x) {
-			// Put all the received packets into the first queue.
-			rx(0);
+		int q = rx_select_queue();
+		if (q >= 0) {
+			rx(q);
+		}
+		else {
+			rx_poll();
 		}
 	}
 	printf("Done.\n");
@@ -62,13 +62,24 @@ main()
 	sp_acp_set_local_wstrb_2(0x0000ffff);
 	sp_acp_set_local_wstrb_3(0x0000ffff);
 
+	bool held = false;
 	for (;;) {
-		uint32_t x = sp_load_reg(SP_REGN_CONTROL);
-		if (x & (1 << SP_CONTROL_START_TX_BITN)) {
-			sp_store_reg(SP_REGN_CONTROL, x ^ (1 << SP_CONTROL_START_TX_BITN));
-			while (tx(0)) { }
-			while (tx(1)) { }
+		// The packet generator owns the TX FIFOs while it is enabled.
+		// A doorbell rung meanwhile is left set, so the frames are sent
+		// once the generator has been disabled.
+		bool gen = sp_load_reg(SP_REGN_BENCH) & (1 << SP_BENCH_GEN_ENABLE_BITN);
+		if (!gen) {
+			uint32_t x = sp_load_reg(SP_REGN_CONTROL);
+			bool start = x & (1 << SP_CONTROL_START_TX_BITN);
+			if (start)
+				sp_store_reg(SP_REGN_CONTROL, x ^ (1 << SP_CONTROL_START_TX_BITN));
+			// Frames held back by the shaper are tried again without a doorbell.
+			if (start || held)
+				held = tx_schedule();
 		}
+		// PAUSE frames do not go through the TX FIFOs.
+		tx_flow_ctrl();
+		tx_ts_drain();
 	}
 	printf("Done.\n");
 
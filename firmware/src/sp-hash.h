@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SP_HASH_H_
+#define _SP_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The CRC32C and Toeplitz hash instructions of the ALU.
+ * They are found in the funct7 field of CUSTOM_1 instructions.
+ * Unlike the SP unit instructions, they have no side effects
+ * and complete in a single cycle.
+ */
+#define SP_FUNCT7_CRC32C_B				"0x0"
+#define SP_FUNCT7_CRC32C_H				"0x1"
+#define SP_FUNCT7_CRC32C_W				"0x2"
+#define SP_FUNCT7_TOEPLITZ_HI			"0x4"
+#define SP_FUNCT7_TOEPLITZ_LO			"0x5"
+
+#define EMIT_HASH_INSN(funct7, rd, rs1, rs2) \
+	__asm__( \
+		".insn r CUSTOM_1, 0, " funct7 ", %[_rd], %[_rs1], %[_rs2]\n" \
+	: [_rd] "=r" (rd) \
+	: [_rs1] "r" (rs1), [_rs2] "r" (rs2) \
+	)
+
+/*
+ * Update the (reflected) CRC32C 'crc' with the low 1, 2 or 4 bytes
+ * of 'data', least significant byte first. This is the byte order of
+ * a little-endian load from the packet buffer.
+ */
+static inline uint32_t
+sp_crc32c_b(uint32_t crc, uint32_t data)
+{
+	uint32_t rd;
+	EMIT_HASH_INSN(SP_FUNCT7_CRC32C_B, rd, crc, data);
+	return rd;
+}
+
+static inline uint32_t
+sp_crc32c_h(uint32_t crc, uint32_t data)
+{
+	uint32_t rd;
+	EMIT_HASH_INSN(SP_FUNCT7_CRC32C_H, rd, crc, data);
+	return rd;
+}
+
+static inline uint32_t
+sp_crc32c_w(uint32_t crc, uint32_t data)
+{
+	uint32_t rd;
+	EMIT_HASH_INSN(SP_FUNCT7_CRC32C_W, rd, crc, data);
+	return rd;
+}
+
+/*
+ * The CRC32C (as used by iSCSI and SCTP) of 'len' bytes at 'buf'.
+ */
+static inline uint32_t
+sp_crc32c(const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	uint32_t crc = UINT32_MAX;
+
+	for (; len > 0 && ((uintptr_t)p & 3) != 0; p++, len--)
+		crc = sp_crc32c_b(crc, *p);
+	for (; len >= 4; p += 4, len -= 4)
+		crc = sp_crc32c_w(crc, *(const uint32_t *)p);
+	for (; len > 0; p++, len--)
+		crc = sp_crc32c_b(crc, *p);
+
+	return ~crc;
+}
+
+/*
+ * The Toeplitz hash of 32 input bits takes a 64-bit window of the key.
+ * 'key_hi' and 'key_lo' are its two halves and 'data' holds the input
+ * bits in network byte order (the first bit in bit 31).
+ */
+static inline uint32_t
+sp_toeplitz_w(uint32_t key_hi, uint32_t key_lo, uint32_t data)
+{
+	uint32_t hi, lo;
+	EMIT_HASH_INSN(SP_FUNCT7_TOEPLITZ_HI, hi, key_hi, data);
+	EMIT_HASH_INSN(SP_FUNCT7_TOEPLITZ_LO, lo, key_lo, data);
+	return hi ^ lo;
+}
+
+/*
+ * The Toeplitz (RSS) hash of the 'nwords' words at 'data'.
+ * 'key' holds the key as 32-bit big-endian words and must have
+ * at least nwords + 1 of them (e.g. 10 for the usual 40-byte key).
+ * The words at 'data' are in host byte order, e.g. an IPv4 address
+ * loaded from a packet and converted with __builtin_bswap32()
+ * (a single rev8 with Zbb).
+ */
+static inline uint32_t
+sp_toeplitz(const uint32_t *key, const uint32_t *data, int nwords)
+{
+	uint32_t hash = 0;
+
+	for (int i = 0; i < nwords; i++)
+		hash ^= sp_toeplitz_w(key[i], key[i + 1], data[i]);
+
+	return hash;
+}
+
+#endif
@@ -34,17 +34,32 @@
 #define SP_FUNCT7_RX_META_NELEMS		"0x0"
 #define SP_FUNCT7_RX_META_POP			"0x1"
 #define SP_FUNCT7_RX_META_EMPTY			"0x2"
+#define SP_FUNCT7_RX_META_GET			"0x3"
 #define SP_FUNCT7_RX_DATA_SKIP			"0x4"
 #define SP_FUNCT7_RX_DATA_DMA_START		"0x5"
 #define SP_FUNCT7_RX_DATA_DMA_STATUS	"0x6"
+#define SP_FUNCT7_RX_CONFIG				"0x7"
+#define SP_FUNCT7_RX_FLOW_STATUS		"0x20"
+#define SP_FUNCT7_RX_QUEUE_SELECT		"0x21"
+#define SP_FUNCT7_RX_MIRROR_DMA_START	"0x22"
+#define SP_FUNCT7_RX_META_PEEK			"0x23"
 
 #define SP_FUNCT7_TX_META_NFREE			"0x8"
 #define SP_FUNCT7_TX_META_PUSH			"0x9"
 #define SP_FUNCT7_TX_META_FULL			"0xa"
+#define SP_FUNCT7_TX_TS_EMPTY			"0xb"
 #define SP_FUNCT7_TX_DATA_COUNT			"0xc"
 #define SP_FUNCT7_TX_DATA_SKIP			"0xd"
 #define SP_FUNCT7_TX_DATA_DMA_START		"0xe"
 #define SP_FUNCT7_TX_DATA_DMA_STATUS	"0xf"
+#define SP_FUNCT7_TX_TS_POP				"0x28"
+#define SP_FUNCT7_TX_TS_GET				"0x29"
+#define SP_FUNCT7_TX_HDR_PUSH			"0x2a"
+#define SP_FUNCT7_TX_CSUM_GET			"0x2b"
+#define SP_FUNCT7_TX_CONFIG				"0x2c"
+#define SP_FUNCT7_TX_LAUNCH_PUSH		"0x2d"
+#define SP_FUNCT7_TX_TSU_GET			"0x2e"
+#define SP_FUNCT7_TX_CTRL_PUSH			"0x2f"
 
 #define SP_FUNCT7_LOAD_REG				"0x10"
 #define SP_FUNCT7_STORE_REG				"0x11"
@@ -61,6 +76,7 @@
 #define SP_MMR_R_BITN					8
 
 #define SP_REGN_CONTROL					0
+#define SP_REGN_STATUS					1
 
 enum {
 	SP_MMR_R_REGN_IO_AXI_AXCACHE,
@@ -73,7 +89,33 @@ enum {
 	SP_MMR_R_REGN_RX_DATA_FIFO_SIZE,
 	SP_MMR_R_REGN_RX_DATA_FIFO_WIDTH,
 	SP_MMR_R_REGN_TX_DATA_FIFO_SIZE,
-	SP_MMR_R_REGN_TX_DATA_FIFO_WIDTH
+	SP_MMR_R_REGN_TX_DATA_FIFO_WIDTH,
+	SP_MMR_R_REGN_RX_HDR_SPLIT,
+	SP_MMR_R_REGN_RX_COPYBREAK,
+	SP_MMR_R_REGN_RX_LRO,
+	SP_MMR_R_REGN_TX_CUT_THROUGH,
+	SP_MMR_R_REGN_TX_SCHED,
+	SP_MMR_R_REGN_TX_SCHED_WEIGHTS,
+	SP_MMR_R_REGN_TX_SHAPER_RATE_0,
+	SP_MMR_R_REGN_TX_SHAPER_BURST_0,
+	SP_MMR_R_REGN_TX_SHAPER_RATE_1,
+	SP_MMR_R_REGN_TX_SHAPER_BURST_1,
+	SP_MMR_R_REGN_VLAN,
+	SP_MMR_R_REGN_RX_FLOW_CTRL,
+	SP_MMR_R_REGN_RX_FLOW_CTRL_PAUSE,
+	SP_MMR_R_REGN_RX_QUEUE_MAP,
+	SP_MMR_R_REGN_RX_STASH,
+	SP_MMR_R_REGN_BENCH,
+	SP_MMR_R_REGN_GEN_LENGTH,
+	SP_MMR_R_REGN_GEN_PERIOD,
+	SP_MMR_R_REGN_RX_MIRROR,
+	SP_MMR_R_REGN_RX_MIRROR_FILTER,
+	SP_MMR_R_REGN_RX_MIRROR_RING_BASE,
+	SP_MMR_R_REGN_RX_MIRROR_RING_BASE_H,
+	SP_MMR_R_REGN_RX_MIRROR_RING_SIZE,
+	SP_MMR_R_REGN_TX_LAUNCH,
+	SP_MMR_R_REGN_GEM_BASE,
+	SP_MMR_R_REGN_PEER_STATUS
 };
 #define SP_REGN_IO_AXI_AXCACHE			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_IO_AXI_AXCACHE)
 #define SP_REGN_DMA_AXI_AXCACHE			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_DMA_AXI_AXCACHE)
@@ -85,10 +127,133 @@ enum {
 #define SP_REGN_RX_DATA_FIFO_WIDTH		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_DATA_FIFO_WIDTH)
 #define SP_REGN_TX_DATA_FIFO_SIZE		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_DATA_FIFO_SIZE)
 #define SP_REGN_TX_DATA_FIFO_WIDTH		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_DATA_FIFO_WIDTH)
+#define SP_REGN_RX_HDR_SPLIT			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_HDR_SPLIT)
+#define SP_REGN_RX_COPYBREAK			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_COPYBREAK)
+#define SP_REGN_RX_LRO					(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_LRO)
+#define SP_REGN_TX_CUT_THROUGH			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_CUT_THROUGH)
+#define SP_REGN_TX_SCHED				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_SCHED)
+#define SP_REGN_TX_SCHED_WEIGHTS		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_SCHED_WEIGHTS)
+#define SP_REGN_TX_SHAPER_RATE_0		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_SHAPER_RATE_0)
+#define SP_REGN_TX_SHAPER_BURST_0		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_SHAPER_BURST_0)
+#define SP_REGN_VLAN					(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_VLAN)
+#define SP_REGN_RX_FLOW_CTRL			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_FLOW_CTRL)
+#define SP_REGN_RX_FLOW_CTRL_PAUSE		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_FLOW_CTRL_PAUSE)
+#define SP_REGN_RX_QUEUE_MAP			(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_QUEUE_MAP)
+#define SP_REGN_RX_STASH				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_STASH)
+#define SP_REGN_BENCH					(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_BENCH)
+#define SP_REGN_GEN_LENGTH				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_GEN_LENGTH)
+#define SP_REGN_GEN_PERIOD				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_GEN_PERIOD)
+#define SP_REGN_RX_MIRROR				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_MIRROR)
+#define SP_REGN_RX_MIRROR_FILTER		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_MIRROR_FILTER)
+#define SP_REGN_RX_MIRROR_RING_BASE		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_MIRROR_RING_BASE)
+#define SP_REGN_RX_MIRROR_RING_BASE_H	(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_MIRROR_RING_BASE_H)
+#define SP_REGN_RX_MIRROR_RING_SIZE		(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_RX_MIRROR_RING_SIZE)
+#define SP_REGN_TX_LAUNCH				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_TX_LAUNCH)
+#define SP_REGN_GEM_BASE				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_GEM_BASE)
+// The STATUS register of the other SP of the pair
+#define SP_REGN_PEER_STATUS				(1 << SP_MMR_R_BITN | SP_MMR_R_REGN_PEER_STATUS)
+
+// 15:0 is the maximum header length (0 disables header/data split).
+// If the PARSE bit is set, frames are split after the headers found
+// by the header parser instead.
+#define SP_RX_HDR_SPLIT_LENGTH_MASK		0xffff
+#define SP_RX_HDR_SPLIT_PARSE_BITN		31
+// 15:0 is the copy-break threshold (0 disables copy-break).
+// Copy-break is disabled if the RX queue map is not 0
+// (see SP_STATUS_RX_COPYBREAK_OFF_BITN).
+#define SP_RX_COPYBREAK_LENGTH_MASK		0xffff
+// 7:0 is the maximum number of TCP segments coalesced into one frame
+// (0 disables LRO). 31:8 is the flush timeout in units of 256 cycles.
+#define SP_RX_LRO_MAX_NSEGS_MASK		0xff
+#define SP_RX_LRO_TIMEOUT_BITN			8
+// 13:0 is the number of bytes of a frame that must be in the TX data FIFO
+// before the GEM starts sending it (0 disables cut-through).
+#define SP_TX_CUT_THROUGH_THRESHOLD_MASK	0x3fff
+// 1:0 is the TX scheduling mode.
+#define SP_TX_SCHED_MODE_MASK			0x3
+#define SP_TX_SCHED_MODE_WRR			0
+#define SP_TX_SCHED_MODE_STRICT			1
+#define SP_TX_SCHED_MODE_DRR			2
+// 8 bits per queue, queue 0 in 7:0: the number of frames per round (WRR)
+// or the quantum in units of 64 bytes (DRR). 0 is taken as 1.
+#define SP_TX_SCHED_WEIGHT_WIDTH		8
+// There is a rate and a burst size register for each queue, in this
+// order. 23:0 is the rate in units of 1/65536 bytes per cycle (0 disables
+// the shaper of the queue) and the burst size in bytes.
+#define SP_TX_SHAPER_RATE_MASK			0xffffff
+#define SP_TX_SHAPER_BURST_MASK			0xffffff
+// 15:0 is the lead in microseconds: a frame is handed to the hardware
+// this long before its launch time at most (0 sends it when it is due).
+// 31:16 is the horizon in milliseconds: frames with a launch time
+// further ahead are dropped (0 selects SP_TX_LAUNCH_HORIZON_DEFAULT).
+#define SP_TX_LAUNCH_LEAD_MASK			0xffff
+#define SP_TX_LAUNCH_HORIZON_BITN		16
+#define SP_TX_LAUNCH_HORIZON_DEFAULT	1000
+// Strip the VLAN tag (TPID 0x8100) of received frames.
+#define SP_VLAN_RX_STRIP_BITN			0
+// Insert the VLAN tag of the SOF descriptor into transmitted frames.
+#define SP_VLAN_TX_INSERT_BITN			1
+// 15:0 is the high-water mark and 31:16 the low-water mark of the
+// RX data FIFO in units of 64 bytes (a high-water mark of 0 disables
+// flow control). The hardware limits the high-water mark so that a
+// frame of maximum length still fits (see sp_rx_flow_high()).
+#define SP_RX_FLOW_CTRL_HIGH_MASK		0xffff
+#define SP_RX_FLOW_CTRL_LOW_BITN		16
+// Read by the TX SP, which sends the PAUSE and PFC frames:
+// 7:0 are the priorities to pause with PFC frames (0 sends 802.3x PAUSE
+// frames instead). 31:8 is the interval at which the pause is renewed
+// in units of 256 cycles (0 does not renew it).
+#define SP_RX_FLOW_CTRL_PAUSE_PRIOS_MASK	0xff
+#define SP_RX_FLOW_CTRL_PAUSE_REFRESH_BITN	8
+// 4 bits per VLAN priority, priority 0 in 3:0: the RX queue of tagged
+// frames. Untagged frames go to queue 0.
+#define SP_RX_QUEUE_MAP_WIDTH			4
+// 15:0 is the length up to which frame data is written through the ACP
+// into the L2 cache (0 disables stashing). It is only done if the RX
+// data FIFO width matches the ACP width of 128 bits.
+#define SP_RX_STASH_LENGTH_MASK			0xffff
+// Feed the frames of the TX SP into the RX SP instead of the GEM.
+#define SP_BENCH_LOOPBACK_BITN			0
+// The packet generator owns the TX FIFOs, so nothing must be transmitted.
+#define SP_BENCH_GEN_ENABLE_BITN		1
+// 13:0 is the minimum and 29:16 the maximum length of generated frames.
+#define SP_GEN_LENGTH_MIN_MASK			0x3fff
+#define SP_GEN_LENGTH_MAX_BITN			16
+// 15:0 is the number of bytes at the start of a frame that are written
+// into the capture ring (0 disables mirroring). It is limited to
+// SP_RX_MIRROR_MAX_LENGTH.
+#define SP_RX_MIRROR_SNAPLEN_MASK		0xffff
+// 7:0 is a mask and 15:8 a value for bits 31:24 of the header information
+// word (see SP_RX_HDR_INFO_*). Frames are mirrored if the masked bits are
+// equal to the value, so a mask of 0 mirrors every frame.
+#define SP_RX_MIRROR_FILTER_MASK_MASK	0xff
+#define SP_RX_MIRROR_FILTER_VALUE_BITN	8
+// 15:0 is the number of slots of the capture ring (a power of 2) and
+// 31:16 the size of each slot in bytes (a multiple of 64).
+// The ring (RX_MIRROR_RING_BASE with bits 39:32 in RX_MIRROR_RING_BASE_H)
+// must be 64-byte aligned.
+#define SP_RX_MIRROR_RING_NSLOTS_MASK	0xffff
+#define SP_RX_MIRROR_RING_SLOT_SIZE_BITN	16
 
 #define SP_CONTROL_ENABLE_RX_BITN		0
 #define SP_CONTROL_ENABLE_TX_BITN		1
 #define SP_CONTROL_START_TX_BITN		3
+// Use extended (time stamp) descriptors with four words each.
+#define SP_CONTROL_EXT_DESC_TS_BITN		4
+// Use 64-bit descriptors with four words each, or six words each
+// together with extended descriptors.
+#define SP_CONTROL_64BIT_DESC_BITN		5
+
+// The descriptor layout selected in the CONTROL register is not
+// supported. The firmware stops until the SP is reset.
+// All layouts are supported now, so this is never set.
+#define SP_STATUS_DESC_UNSUPPORTED_BITN	0
+// Set by the RX SP while the link partner should pause. The TX SP sees
+// it in its PEER_STATUS register and sends the PAUSE or PFC frames.
+#define SP_STATUS_RX_PAUSE_BITN			1
+// Set by the RX SP if copy-break is configured but disabled because
+// the RX queue map is in use.
+#define SP_STATUS_RX_COPYBREAK_OFF_BITN	2
 
 struct sp_gem_queue {
 	void *scratch_addr;
@@ -164,7 +329,8 @@ struct sp_gem_queue {
 	: [_rs1] "r" (rs1), [_rs2] "r" (rs2) \
 	)
 
-typedef uint32_t dma_addr_t;
+// The DMA engines take 40-bit addresses.
+typedef uint64_t dma_addr_t;
 
 struct sp_config {
 	int data_fifo_size;
@@ -206,20 +372,137 @@ sp_rx_meta_empty(void)
 	return (bool)x;
 }
 
+/*
+ * This function returns the status word of the element at the head of
+ * the RX meta FIFO without popping it.
+ * The RX meta FIFO must not be empty.
+ */
+static inline uint32_t
+sp_rx_meta_peek(void)
+{
+	uint32_t x;
+
+	EMIT_INSN_100("0", SP_FUNCT7_RX_META_PEEK, x);
+	return x;
+}
+
+/*
+ * This function returns word i of the RX meta FIFO element
+ * popped last.
+ * Word 0 is the status word, words 1 and 2 are the time stamp.
+ * Word 3 is the header information (see SP_RX_HDR_INFO_*).
+ * Word 4 is the LRO information (see SP_RX_LRO_INFO_*), words 5 and 6
+ * are the TCP acknowledgment number and window.
+ * Word 7 is the VLAN information (see SP_RX_VLAN_INFO_*).
+ */
+static inline uint32_t
+sp_rx_meta_get(int i)
+{
+	uint32_t x;
+
+	EMIT_INSN_110("0", SP_FUNCT7_RX_META_GET, x, i);
+	return x;
+}
+
+#define SP_RX_HDR_INFO_L3_OFF_BITN		0
+#define SP_RX_HDR_INFO_L4_OFF_BITN		8
+#define SP_RX_HDR_INFO_HDR_LEN_BITN		16
+#define SP_RX_HDR_INFO_VLAN_BITN		24
+#define SP_RX_HDR_INFO_IPV4_BITN		25
+#define SP_RX_HDR_INFO_IPV6_BITN		26
+#define SP_RX_HDR_INFO_TCP_BITN			27
+#define SP_RX_HDR_INFO_UDP_BITN			28
+#define SP_RX_HDR_INFO_IPV4_FRAG_BITN	29
+#define SP_RX_HDR_INFO_ALIGNED_BITN		30
+
+#define SP_RX_LRO_INFO_OK_BITN			0
+#define SP_RX_LRO_INFO_CONT_BITN		1
+#define SP_RX_LRO_INFO_TCP_FLAGS_BITN	8
+#define SP_RX_LRO_INFO_PAYLOAD_LEN_BITN	16
+
+// With a stripped VLAN tag, the offsets and the header length of the
+// header information refer to the frame without the tag.
+#define SP_RX_VLAN_INFO_TCI_MASK		0xffff
+#define SP_RX_VLAN_INFO_STRIPPED_BITN	16
+// The same word of the meta information reports a frame that did not
+// fit into the RX data FIFO and the number of its bytes that did.
+#define SP_RX_VLAN_INFO_NBYTES_BITN		17
+#define SP_RX_VLAN_INFO_NBYTES_MASK		0x3fff
+#define SP_RX_VLAN_INFO_TRUNCATED_BITN	31
+
+static inline int
+sp_rx_hdr_info_get_hdr_len(uint32_t hdr_info)
+{
+	return (hdr_info >> SP_RX_HDR_INFO_HDR_LEN_BITN) & 0xff;
+}
+
+/*
+ * This function drops length bytes (rounded up to whole FIFO words)
+ * from the RX data FIFO.
+ * sp_rx_data_dma_status() reports busy until it is done.
+ */
 static inline void
 sp_rx_data_skip(uint32_t length)
 {
 	EMIT_INSN_010("0", SP_FUNCT7_RX_DATA_SKIP, length);
 }
 
+/*
+ * The AXI attributes of a DMA transfer (see sp_rx_data_dma_start_attr()
+ * and sp_tx_data_dma_start_attr()).
+ * An AXCACHE of 0 selects the default in SP_REGN_DMA_AXI_AXCACHE.
+ */
+#define SP_DMA_ATTR_AXCACHE_BITN		24
+#define SP_DMA_ATTR_AXUSER_BITN			28
+// RX only: write through the ACP port instead of the DMA port.
+#define SP_DMA_ATTR_ACP_BITN			30
+// RX only: also copy the first SP_RX_MIRROR_MAX_LENGTH bytes into the
+// mirror buffer (see sp_rx_mirror_dma_start_attr()).
+#define SP_DMA_ATTR_MIRROR_BITN			31
+#define SP_DMA_ATTR(axcache, axuser) \
+	((uint32_t)(axcache) << SP_DMA_ATTR_AXCACHE_BITN | (uint32_t)(axuser) << SP_DMA_ATTR_AXUSER_BITN)
+// Write-back, read/write-allocate and inner shareable through the ACP,
+// so the data is allocated in the L2 cache of the host.
+#define SP_DMA_ATTR_STASH \
+	(SP_DMA_ATTR(0xf, 0x2) | (uint32_t)1 << SP_DMA_ATTR_ACP_BITN)
+
 /*
  * This function starts the RX DMA transfer
- * (from RX data FIFO to AXI memory).
+ * (from RX data FIFO to AXI memory) with the attributes 'attr'.
+ * The address bits 39:32 are passed in bits 23:16 of the length.
  */
 static inline void
-sp_rx_data_dma_start(uint32_t addr, uint32_t length)
+sp_rx_data_dma_start_attr(dma_addr_t addr, uint32_t length, uint32_t attr)
+{
+	uint32_t addr_l = (uint32_t)addr;
+	uint32_t length_addr_h = attr | ((uint32_t)(addr >> 32) & 0xff) << 16 | length;
+
+	EMIT_INSN_011("0", SP_FUNCT7_RX_DATA_DMA_START, addr_l, length_addr_h);
+}
+
+static inline void
+sp_rx_data_dma_start(dma_addr_t addr, uint32_t length)
 {
-	EMIT_INSN_011("0", SP_FUNCT7_RX_DATA_DMA_START, addr, length);
+	sp_rx_data_dma_start_attr(addr, length, 0);
+}
+
+/*
+ * This function writes the first 'length' bytes of the last RX DMA
+ * transfer started with SP_DMA_ATTR_MIRROR_BITN set to a second
+ * destination, e.g. a capture ring.
+ * 'length' must not exceed the length of that transfer and is limited
+ * to SP_RX_MIRROR_MAX_LENGTH.
+ * sp_rx_data_dma_status() reports busy until it is done.
+ */
+#define SP_RX_MIRROR_MAX_LENGTH			256
+
+static inline void
+sp_rx_mirror_dma_start_attr(dma_addr_t addr, uint32_t length, uint32_t attr)
+{
+	uint32_t addr_l = (uint32_t)addr;
+	uint32_t length_addr_h = attr | ((uint32_t)(addr >> 32) & 0xff) << 16 | length;
+
+	EMIT_INSN_011("0", SP_FUNCT7_RX_MIRROR_DMA_START, addr_l, length_addr_h);
 }
 
 static inline uint32_t
@@ -231,6 +514,56 @@ sp_rx_data_dma_status(void)
 	return x;
 }
 
+#define SP_RX_CONFIG_ALIGN_PAYLOAD_BITN	0
+#define SP_RX_CONFIG_STRIP_VLAN_BITN	1
+
+static inline void
+sp_rx_config(uint32_t x)
+{
+	EMIT_INSN_010("0", SP_FUNCT7_RX_CONFIG, x);
+}
+
+/*
+ * This function returns true while the RX data FIFO is above its
+ * high-water mark (until it drops to the low-water mark).
+ */
+static inline bool
+sp_rx_flow_status(void)
+{
+	uint32_t x;
+
+	EMIT_INSN_100("0", SP_FUNCT7_RX_FLOW_STATUS, x);
+	return (bool)(x & 1);
+}
+
+/*
+ * This function returns the high-water mark of the RX data FIFO in
+ * effect, which may be lower than the one in the RX_FLOW_CTRL register.
+ */
+static inline uint32_t
+sp_rx_flow_high(void)
+{
+	uint32_t x;
+
+	EMIT_INSN_100("0", SP_FUNCT7_RX_FLOW_STATUS, x);
+	return x >> 16;
+}
+
+/*
+ * This function selects the RX queue that the RX meta and data functions
+ * operate on. It returns a bit mask of the queues that hold received
+ * frames (as of before the call).
+ * Don't call while sp_rx_data_dma_status() reports busy.
+ */
+static inline uint32_t
+sp_rx_queue_select(int q)
+{
+	uint32_t x;
+
+	EMIT_INSN_110("0", SP_FUNCT7_RX_QUEUE_SELECT, x, q);
+	return x;
+}
+
 /*
  * Note that the hardware does not support this function currently.
  * Use sp_tx_meta_full() instead.
@@ -250,6 +583,20 @@ sp_tx_meta_push_uint32(uint32_t x)
 	EMIT_INSN_010("0", SP_FUNCT7_TX_META_PUSH, x);
 }
 
+#define SP_TX_META_VLAN_TCI_MASK		0xffff
+#define SP_TX_META_VLAN_INSERT_BITN		16
+
+/*
+ * Like sp_tx_meta_push_uint32(), but a VLAN tag with the TCI in
+ * vlan[15:0] is inserted into the frame if SP_TX_META_VLAN_INSERT_BITN
+ * is set in vlan.
+ */
+static inline void
+sp_tx_meta_push_vlan(uint32_t x, uint32_t vlan)
+{
+	EMIT_INSN_011("0", SP_FUNCT7_TX_META_PUSH, x, vlan);
+}
+
 static inline bool
 sp_tx_meta_full(void)
 {
@@ -275,12 +622,23 @@ sp_tx_data_skip(uint32_t length)
 
 /*
  * This function starts the TX DMA transfer
- * (from AXI memory to TX data FIFO).
+ * (from AXI memory to TX data FIFO) with the attributes 'attr'.
+ * The address bits 39:32 are passed in bits 23:16 of the length.
+ * The TX DMA always reads through the DMA port.
  */
 static inline void
-sp_tx_data_dma_start(uint32_t addr, uint32_t length)
+sp_tx_data_dma_start_attr(dma_addr_t addr, uint32_t length, uint32_t attr)
+{
+	uint32_t addr_l = (uint32_t)addr;
+	uint32_t length_addr_h = attr | ((uint32_t)(addr >> 32) & 0xff) << 16 | length;
+
+	EMIT_INSN_011("0", SP_FUNCT7_TX_DATA_DMA_START, addr_l, length_addr_h);
+}
+
+static inline void
+sp_tx_data_dma_start(dma_addr_t addr, uint32_t length)
 {
-	EMIT_INSN_011("0", SP_FUNCT7_TX_DATA_DMA_START, addr, length);
+	sp_tx_data_dma_start_attr(addr, length, 0);
 }
 
 static inline uint32_t
@@ -291,6 +649,124 @@ sp_tx_data_dma_status(void)
 	return x;
 }
 
+static inline bool
+sp_tx_ts_empty(void)
+{
+	uint32_t x;
+	EMIT_INSN_100("0", SP_FUNCT7_TX_TS_EMPTY, x);
+	return (bool)x;
+}
+
+/*
+ * This function pops an element from the TX time stamp FIFO
+ * and returns its first word.
+ */
+static inline uint32_t
+sp_tx_ts_pop_uint32(void)
+{
+	uint32_t x;
+	EMIT_INSN_100("0", SP_FUNCT7_TX_TS_POP, x);
+	return x;
+}
+
+// Word 2 of a TX time stamp FIFO element holds the status of the frame.
+#define SP_TX_TS_STATUS_WORDN			2
+// The GEM aborted the frame because its data did not arrive in time
+// (cut-through).
+#define SP_TX_TS_STATUS_UNDERFLOW_BITN	0
+// The tag the frame was pushed with (TX_META_DESC_TS_TAG_BITN)
+#define SP_TX_TS_STATUS_TAG_BITN		1
+#define SP_TX_TS_STATUS_TAG_MASK		0xf
+
+/*
+ * This function returns word i of the TX time stamp FIFO element
+ * popped last.
+ */
+
+static inline uint32_t
+sp_tx_ts_get(int i)
+{
+	uint32_t x;
+	EMIT_INSN_110("0", SP_FUNCT7_TX_TS_GET, x, i);
+	return x;
+}
+
+/*
+ * This function pushes a word into the TX header FIFO.
+ * It returns true if the FIFO was full and the word was not pushed.
+ */
+static inline bool
+sp_tx_hdr_push(uint32_t x)
+{
+	uint32_t full;
+	EMIT_INSN_110("0", SP_FUNCT7_TX_HDR_PUSH, full, x);
+	return (bool)full;
+}
+
+/*
+ * This function returns the folded 16-bit one's complement sum of all
+ * the data transferred into the TX data FIFO since the last call.
+ */
+static inline uint32_t
+sp_tx_csum_get(void)
+{
+	uint32_t x;
+	EMIT_INSN_100("0", SP_FUNCT7_TX_CSUM_GET, x);
+	return x;
+}
+
+// 13:0 is the cut-through threshold in bytes.
+#define SP_TX_CONFIG_CT_THRESHOLD_MASK	0x3fff
+
+static inline void
+sp_tx_config(uint32_t x)
+{
+	EMIT_INSN_010("0", SP_FUNCT7_TX_CONFIG, x);
+}
+
+/*
+ * This function pushes the launch time of the next frame into the
+ * TX launch FIFO, in the layout of the TX time stamps.
+ * It returns true if the FIFO was full and nothing was pushed.
+ */
+static inline bool
+sp_tx_launch_push(uint32_t ts_1, uint32_t ts_2)
+{
+	uint32_t full;
+	EMIT_INSN_111("0", SP_FUNCT7_TX_LAUNCH_PUSH, full, ts_1, ts_2);
+	return (bool)full;
+}
+
+/*
+ * This function returns word i of the TSU time, in the layout of the
+ * TX time stamps. Reading word 0 latches word 1.
+ */
+static inline uint32_t
+sp_tx_tsu_get(int i)
+{
+	uint32_t x;
+	EMIT_INSN_110("0", SP_FUNCT7_TX_TSU_GET, x, i);
+	return x;
+}
+
+// The size of the TX control frame slot
+#define SP_TX_CTRL_MAX_LENGTH			64
+
+/*
+ * This function writes the next word of a control frame (e.g. PAUSE)
+ * into the TX control frame slot. A non-zero 'length' marks the last
+ * word; the frame of 'length' bytes is then sent at the next frame
+ * boundary, ahead of the frames in the TX meta FIFO.
+ * It returns true if the slot still held a frame and nothing was written.
+ */
+static inline bool
+sp_tx_ctrl_push(uint32_t x, uint32_t length)
+{
+	uint32_t busy;
+	EMIT_INSN_111("0", SP_FUNCT7_TX_CTRL_PUSH, busy, x, length);
+	return (bool)busy;
+}
+
 static inline uint32_t
 sp_load_reg(int i)
 {
@@ -313,17 +789,22 @@ sp_intr(int q, uint32_t x)
 
 /*
  * AXI ACP functions
+ * The address bits 39:32 of 'ext_addr' are passed in bits 31:24 of
+ * 'int_addr'.
  */
+#define SP_ACP_INT_ADDR(int_addr, ext_addr) \
+	((int_addr) | ((uint32_t)((ext_addr) >> 32) & 0xff) << 24)
+
 static inline void
-sp_acp_read_start_16(uint32_t int_addr, uint32_t ext_addr)
+sp_acp_read_start_16(uint32_t int_addr, dma_addr_t ext_addr)
 {
-	EMIT_INSN_011("0", SP_FUNCT7_ACP_READ_START, int_addr, ext_addr);
+	EMIT_INSN_011("0", SP_FUNCT7_ACP_READ_START, SP_ACP_INT_ADDR(int_addr, ext_addr), (uint32_t)ext_addr);
 }
 
 static inline void
-sp_acp_read_start_64(uint32_t int_addr, uint32_t ext_addr)
+sp_acp_read_start_64(uint32_t int_addr, dma_addr_t ext_addr)
 {
-	EMIT_INSN_011("1", SP_FUNCT7_ACP_READ_START, int_addr, ext_addr);
+	EMIT_INSN_011("1", SP_FUNCT7_ACP_READ_START, SP_ACP_INT_ADDR(int_addr, ext_addr), (uint32_t)ext_addr);
 }
 
 static inline uint32_t
@@ -335,15 +816,15 @@ sp_acp_read_status(void)
 }
 
 static inline void
-sp_acp_write_start_16(uint32_t int_addr, uint32_t ext_addr)
+sp_acp_write_start_16(uint32_t int_addr, dma_addr_t ext_addr)
 {
-	EMIT_INSN_011("0", SP_FUNCT7_ACP_WRITE_START, int_addr, ext_addr);
+	EMIT_INSN_011("0", SP_FUNCT7_ACP_WRITE_START, SP_ACP_INT_ADDR(int_addr, ext_addr), (uint32_t)ext_addr);
 }
 
 static inline void
-sp_acp_write_start_64(uint32_t int_addr, uint32_t ext_addr)
+sp_acp_write_start_64(uint32_t int_addr, dma_addr_t ext_addr)
 {
-	EMIT_INSN_011("1", SP_FUNCT7_ACP_WRITE_START, int_addr, ext_addr);
+	EMIT_INSN_011("1", SP_FUNCT7_ACP_WRITE_START, SP_ACP_INT_ADDR(int_addr, ext_addr), (uint32_t)ext_addr);
 }
 
 static inline uint32_t
@@ -19,10 +19,12 @@ module axi_lite_mmr #(
 	parameter int REG_WIDTH = 32,
 	parameter int IBRAM_SIZE,
 	parameter int DBRAM_SIZE,
+	parameter int PROF_SIZE = 0,
 	parameter int RX_DATA_FIFO_SIZE = 0,
 	parameter int RX_DATA_FIFO_WIDTH = 0,
 	parameter int TX_DATA_FIFO_SIZE = 0,
-	parameter int TX_DATA_FIFO_WIDTH = 0
+	parameter int TX_DATA_FIFO_WIDTH = 0,
+	parameter logic [31:0] GEM_BASE = 32'hff0e0000
 ) (
 	input wire logic clock,
 	input wire logic reset_n,
@@ -36,12 +38,19 @@ module axi_lite_mmr #(
 	mmr_readwrite_interface.slave mmr_rw,
 	mmr_read_interface.slave mmr_r,
 	mmr_intr_interface.slave mmr_i,
+	mmr_prof_interface.slave prof,
+	mmr_stats_interface.slave mmr_s,
 
 	output wire logic cpu_reset,
 
 	output var logic [3:0] io_axi_axcache,
 	output var logic [3:0] dma_axi_axcache,
 
+	output tsu_time_t tsu_time,
+
+	// The STATUS register of the other SP of the pair
+	input wire logic [31:0] peer_status,
+
 	local_memory_interface.master instruction_bram_mmr,
 	local_memory_interface.master data_bram_mmr
 );
@@ -81,6 +90,27 @@ assign data_bram_mmr.data_in = bram_data;
 
 assign mmr_r.data[MMR_R_REGN_IO_AXI_AXCACHE] = io_axi_axcache;
 assign mmr_r.data[MMR_R_REGN_DMA_AXI_AXCACHE] = dma_axi_axcache;
+assign mmr_r.data[MMR_R_REGN_PEER_STATUS] = peer_status;
+
+/*
+ * Time stamp unit
+ *
+ * The TSU time advances by 'tsu_incr' every clock cycle.
+ * 'tsu_incr' is a fixed-point value with 8 bits of nanoseconds and
+ * 24 bits of sub-nanoseconds, just like the GEM's TSU increment.
+ * The host sets the time by writing SEC_H and SEC_L first and NSEC last.
+ * Reading NSEC latches the seconds so SEC_L and SEC_H can be read
+ * consistently afterwards.
+ */
+var logic [31:0] tsu_incr;
+var logic [23:0] tsu_sub_nsec;
+var logic [TSU_SEC_WIDTH-1:0] tsu_sec_pending;
+var logic [TSU_SEC_WIDTH-1:0] tsu_sec_shadow;
+var logic [TSU_NSEC_WIDTH+24:0] tsu_nsec_next_comb;
+
+always_comb begin
+	tsu_nsec_next_comb = { 1'b0, tsu_time.nsec, tsu_sub_nsec } + { {(TSU_NSEC_WIDTH-8+1){1'b0}}, tsu_incr };
+end
 
 task mmr_write(
 	input var logic [AXI_AWADDR_WIDTH-1:0] awaddr,
@@ -121,6 +151,21 @@ task mmr_write(
 		mmr_r.data[MMR_R_REGN_RESERVED0] <= wdata;
 	end
 
+	REGOFF_TSU_INCR: begin
+		tsu_incr <= wdata;
+	end
+	REGOFF_TSU_NSEC: begin
+		tsu_time.sec <= tsu_sec_pending;
+		tsu_time.nsec <= wdata[TSU_NSEC_WIDTH-1:0];
+		tsu_sub_nsec <= '0;
+	end
+	REGOFF_TSU_SEC_L: begin
+		tsu_sec_pending[31:0] <= wdata;
+	end
+	REGOFF_TSU_SEC_H: begin
+		tsu_sec_pending[TSU_SEC_WIDTH-1:32] <= wdata[TSU_SEC_WIDTH-32-1:0];
+	end
+
 	REGOFF_RX_DMA_DESC_BASE + SIZEOF_REG*0: begin
 		mmr_r.data[MMR_R_REGN_RX_DMA_DESC_BASE_0] <= wdata;
 	end
@@ -133,6 +178,89 @@ task mmr_write(
 	REGOFF_TX_DMA_DESC_BASE + SIZEOF_REG*1: begin
 		mmr_r.data[MMR_R_REGN_TX_DMA_DESC_BASE_1] <= wdata;
 	end
+	REGOFF_RX_HDR_SPLIT: begin
+		mmr_r.data[MMR_R_REGN_RX_HDR_SPLIT] <= wdata;
+	end
+	REGOFF_RX_COPYBREAK: begin
+		mmr_r.data[MMR_R_REGN_RX_COPYBREAK] <= wdata;
+	end
+	REGOFF_RX_LRO: begin
+		mmr_r.data[MMR_R_REGN_RX_LRO] <= wdata;
+	end
+	REGOFF_TX_CUT_THROUGH: begin
+		mmr_r.data[MMR_R_REGN_TX_CUT_THROUGH] <= wdata;
+	end
+	REGOFF_TX_SCHED: begin
+		mmr_r.data[MMR_R_REGN_TX_SCHED] <= wdata;
+	end
+	REGOFF_TX_SCHED_WEIGHTS: begin
+		mmr_r.data[MMR_R_REGN_TX_SCHED_WEIGHTS] <= wdata;
+	end
+	REGOFF_VLAN: begin
+		mmr_r.data[MMR_R_REGN_VLAN] <= wdata;
+	end
+	REGOFF_RX_FLOW_CTRL: begin
+		mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL] <= wdata;
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*0: begin
+		mmr_r.data[MMR_R_REGN_TX_SHAPER_RATE_0] <= wdata;
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*1: begin
+		mmr_r.data[MMR_R_REGN_TX_SHAPER_BURST_0] <= wdata;
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*2: begin
+		mmr_r.data[MMR_R_REGN_TX_SHAPER_RATE_1] <= wdata;
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*3: begin
+		mmr_r.data[MMR_R_REGN_TX_SHAPER_BURST_1] <= wdata;
+	end
+	REGOFF_RX_FLOW_CTRL_PAUSE: begin
+		mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL_PAUSE] <= wdata;
+	end
+	REGOFF_RX_QUEUE_MAP: begin
+		mmr_r.data[MMR_R_REGN_RX_QUEUE_MAP] <= wdata;
+	end
+	REGOFF_RX_STASH: begin
+		mmr_r.data[MMR_R_REGN_RX_STASH] <= wdata;
+	end
+	REGOFF_BENCH: begin
+		mmr_r.data[MMR_R_REGN_BENCH] <= wdata;
+	end
+	REGOFF_GEN_LENGTH: begin
+		mmr_r.data[MMR_R_REGN_GEN_LENGTH] <= wdata;
+	end
+	REGOFF_GEN_PERIOD: begin
+		mmr_r.data[MMR_R_REGN_GEN_PERIOD] <= wdata;
+	end
+	REGOFF_RX_MIRROR: begin
+		mmr_r.data[MMR_R_REGN_RX_MIRROR] <= wdata;
+	end
+	REGOFF_RX_MIRROR_FILTER: begin
+		mmr_r.data[MMR_R_REGN_RX_MIRROR_FILTER] <= wdata;
+	end
+	REGOFF_RX_MIRROR_RING_BASE: begin
+		mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_BASE] <= wdata;
+	end
+	REGOFF_RX_MIRROR_RING_BASE_H: begin
+		mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_BASE_H] <= wdata;
+	end
+	REGOFF_RX_MIRROR_RING_SIZE: begin
+		mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_SIZE] <= wdata;
+	end
+	REGOFF_TX_LAUNCH: begin
+		mmr_r.data[MMR_R_REGN_TX_LAUNCH] <= wdata;
+	end
+	REGOFF_PROF_CONTROL: begin
+		prof.enable <= wdata[PROF_CONTROL_ENABLE_BITN];
+		prof.clear <= wdata[PROF_CONTROL_CLEAR_BITN];
+		prof.pc_shift <= wdata[PROF_CONTROL_PC_SHIFT_BITN +: PROF_CONTROL_PC_SHIFT_WIDTH];
+	end
+	REGOFF_PROF_PERIOD: begin
+		prof.period <= wdata;
+	end
+	REGOFF_PROF_ADDR: begin
+		// See the histogram address below
+	end
 	REGOFF_IER_BASE + SIZEOF_REG*0: begin
 		mmr_i.imr[0] <= mmr_i.imr[0] | wdata;
 	end
@@ -174,16 +302,23 @@ always_ff @(posedge clock) begin
 			mmr_rw.data[i] <= '0;
 
 		for (int i = 0; i < mmr_r.NREGS; i++) begin
-			if (i != MMR_R_REGN_IO_AXI_AXCACHE && i != MMR_R_REGN_DMA_AXI_AXCACHE) begin
+			if (i != MMR_R_REGN_IO_AXI_AXCACHE && i != MMR_R_REGN_DMA_AXI_AXCACHE &&
+				i != MMR_R_REGN_PEER_STATUS)
+			begin
 				mmr_r.data[i] <= '0;
 			end
 		end
 		io_axi_axcache <= 4'b0000;
 		dma_axi_axcache <= 4'b0000;
+		tsu_incr <= '0;
+		tsu_sub_nsec <= '0;
+		tsu_sec_pending <= '0;
+		tsu_time <= '0;
 		mmr_r.data[MMR_R_REGN_RX_DATA_FIFO_SIZE] <= RX_DATA_FIFO_SIZE;
 		mmr_r.data[MMR_R_REGN_RX_DATA_FIFO_WIDTH] <= RX_DATA_FIFO_WIDTH;
 		mmr_r.data[MMR_R_REGN_TX_DATA_FIFO_SIZE] <= TX_DATA_FIFO_SIZE;
 		mmr_r.data[MMR_R_REGN_TX_DATA_FIFO_WIDTH] <= TX_DATA_FIFO_WIDTH;
+		mmr_r.data[MMR_R_REGN_GEM_BASE] <= GEM_BASE;
 
 		for (int i = 0; i < mmr_i.N; i++) begin
 			mmr_i.isr[i] <= '0;
@@ -192,11 +327,33 @@ always_ff @(posedge clock) begin
 
 		instruction_bram_mmr.en <= 1'b0;
 		data_bram_mmr.en <= 1'b0;
+
+		prof.enable <= 1'b0;
+		prof.clear <= 1'b0;
+		prof.pc_shift <= '0;
+		prof.period <= '0;
 	end
 	else begin
 		// Unpulse
 		instruction_bram_mmr.en <= 1'b0;
 		data_bram_mmr.en <= 1'b0;
+		prof.clear <= 1'b0;
+		// Writes to REGOFF_BRAM_DATA advance the address, so a block
+		// of words only needs its start address to be written.
+		if (instruction_bram_mmr.en | data_bram_mmr.en) begin
+			bram_addr <= bram_addr + 1;
+		end
+
+		// Advance the TSU time.
+		// A write to REGOFF_TSU_NSEC below takes precedence.
+		tsu_sub_nsec <= tsu_nsec_next_comb[23:0];
+		if (tsu_nsec_next_comb[24 +: TSU_NSEC_WIDTH+1] >= TSU_NSEC_PER_SEC) begin
+			tsu_time.nsec <= TSU_NSEC_WIDTH'(tsu_nsec_next_comb[24 +: TSU_NSEC_WIDTH+1] - TSU_NSEC_PER_SEC);
+			tsu_time.sec <= tsu_time.sec + 1;
+		end
+		else begin
+			tsu_time.nsec <= tsu_nsec_next_comb[24 +: TSU_NSEC_WIDTH];
+		end
 
 		if (mmr_rw.store) begin
 			mmr_rw.data[mmr_rw.store_idx] <= mmr_rw.store_data;
@@ -240,6 +397,26 @@ always_ff @(posedge clock) begin
 	end
 end
 
+/*
+ * Histogram address of the profiler
+ *
+ * It is written by both channels: reads of REGOFF_PROF_DATA advance it.
+ * The next read is at least two cycles away, which leaves the BRAM
+ * enough time to output the next counter.
+ */
+always_ff @(posedge clock) begin
+	if (!reset_n) begin
+		prof.addr <= '0;
+	end
+	else if (got_aw_hshake && got_w_hshake &&
+		axi_awaddr[MMR_RANGE_WIDTH-1:0] == REGOFF_PROF_ADDR) begin
+		prof.addr <= 30'(axi_wdata[31:2]);
+	end
+	else if (ar_hshake && axi_ar.araddr[MMR_RANGE_WIDTH-1:0] == REGOFF_PROF_DATA) begin
+		prof.addr <= prof.addr + 1;
+	end
+end
+
 //
 //
 // AXI READ CHANNEL
@@ -253,6 +430,9 @@ always_comb begin
 		axi_rdata_next[31] = cpu_reset_ff;
 		axi_rdata_next[30:0] = mmr_rw.data[MMR_RW_REGN_CONTROL];
 	end
+	REGOFF_STATUS: begin
+		axi_rdata_next = mmr_rw.data[MMR_RW_REGN_STATUS];
+	end
 
 	REGOFF_IO_AXI_AXCACHE: begin
 		axi_rdata_next = { 28'h0000000, io_axi_axcache };
@@ -266,6 +446,19 @@ always_comb begin
 		axi_rdata_next = mmr_r.data[MMR_R_REGN_RESERVED0];
 	end
 
+	REGOFF_TSU_INCR: begin
+		axi_rdata_next = tsu_incr;
+	end
+	REGOFF_TSU_NSEC: begin
+		axi_rdata_next = 32'(tsu_time.nsec);
+	end
+	REGOFF_TSU_SEC_L: begin
+		axi_rdata_next = tsu_sec_shadow[31:0];
+	end
+	REGOFF_TSU_SEC_H: begin
+		axi_rdata_next = 32'(tsu_sec_shadow[TSU_SEC_WIDTH-1:32]);
+	end
+
 	REGOFF_RX_DMA_DESC_BASE + SIZEOF_REG*0: begin
 		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_DMA_DESC_BASE_0];
 	end
@@ -278,6 +471,117 @@ always_comb begin
 	REGOFF_TX_DMA_DESC_BASE + SIZEOF_REG*1: begin
 		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_DMA_DESC_BASE_1];
 	end
+	REGOFF_RX_HDR_SPLIT: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_HDR_SPLIT];
+	end
+	REGOFF_RX_COPYBREAK: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_COPYBREAK];
+	end
+	REGOFF_RX_LRO: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_LRO];
+	end
+	REGOFF_TX_CUT_THROUGH: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_CUT_THROUGH];
+	end
+	REGOFF_TX_SCHED: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SCHED];
+	end
+	REGOFF_TX_SCHED_WEIGHTS: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SCHED_WEIGHTS];
+	end
+	REGOFF_VLAN: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_VLAN];
+	end
+	REGOFF_RX_FLOW_CTRL: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL];
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*0: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SHAPER_RATE_0];
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*1: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SHAPER_BURST_0];
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*2: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SHAPER_RATE_1];
+	end
+	REGOFF_TX_SHAPER_BASE + SIZEOF_REG*3: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_SHAPER_BURST_1];
+	end
+	REGOFF_RX_FLOW_CTRL_PAUSE: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL_PAUSE];
+	end
+	REGOFF_RX_QUEUE_MAP: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_QUEUE_MAP];
+	end
+	REGOFF_RX_STASH: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_STASH];
+	end
+	REGOFF_BENCH: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_BENCH];
+	end
+	REGOFF_GEN_LENGTH: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_GEN_LENGTH];
+	end
+	REGOFF_GEN_PERIOD: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_GEN_PERIOD];
+	end
+	REGOFF_RX_MIRROR: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_MIRROR];
+	end
+	REGOFF_RX_MIRROR_FILTER: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_MIRROR_FILTER];
+	end
+	REGOFF_RX_MIRROR_RING_BASE: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_BASE];
+	end
+	REGOFF_RX_MIRROR_RING_BASE_H: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_BASE_H];
+	end
+	REGOFF_RX_MIRROR_RING_SIZE: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_RX_MIRROR_RING_SIZE];
+	end
+	REGOFF_TX_LAUNCH: begin
+		axi_rdata_next = mmr_r.data[MMR_R_REGN_TX_LAUNCH];
+	end
+	REGOFF_GEN_NFRAMES: begin
+		axi_rdata_next = mmr_s.gen_nframes;
+	end
+	REGOFF_TX_NFRAMES: begin
+		axi_rdata_next = mmr_s.tx_nframes;
+	end
+	REGOFF_TX_NBYTES: begin
+		axi_rdata_next = mmr_s.tx_nbytes;
+	end
+	REGOFF_RX_NFRAMES: begin
+		axi_rdata_next = mmr_s.rx_nframes;
+	end
+	REGOFF_RX_NBYTES: begin
+		axi_rdata_next = mmr_s.rx_nbytes;
+	end
+	REGOFF_RX_NDROPS: begin
+		axi_rdata_next = mmr_s.rx_ndrops;
+	end
+	REGOFF_PROF_CONTROL: begin
+		axi_rdata_next = '0;
+		axi_rdata_next[PROF_CONTROL_ENABLE_BITN] = prof.enable;
+		axi_rdata_next[PROF_CONTROL_CLEAR_BITN] = prof.clearing;
+		axi_rdata_next[PROF_CONTROL_PC_SHIFT_BITN +: PROF_CONTROL_PC_SHIFT_WIDTH] = prof.pc_shift;
+	end
+	REGOFF_PROF_PERIOD: begin
+		axi_rdata_next = prof.period;
+	end
+	REGOFF_PROF_NSAMPLES: begin
+		axi_rdata_next = prof.nsamples;
+	end
+	REGOFF_PROF_SIZE: begin
+		axi_rdata_next = PROF_SIZE;
+	end
+	REGOFF_PROF_ADDR: begin
+		axi_rdata_next = { prof.addr, 2'b00 };
+	end
+	REGOFF_PROF_DATA: begin
+		axi_rdata_next = prof.data;
+	end
 	REGOFF_IMR_BASE + SIZEOF_REG*0: begin
 		axi_rdata_next = mmr_i.imr[0];
 	end
@@ -324,6 +628,9 @@ always_ff @(posedge clock) begin
 
 		if (ar_hshake) begin
 			$display("AR_HSHAKE for address %h", axi_ar.araddr);
+			if (axi_ar.araddr[MMR_RANGE_WIDTH-1:0] == REGOFF_TSU_NSEC) begin
+				tsu_sec_shadow <= tsu_time.sec;
+			end
 			axi_ar.arready <= 1'b0;
 			axi_r.rvalid <= 1'b1;
 			axi_r.rdata <= axi_rdata_next;
@@ -18,8 +18,24 @@ package mmr_config;
 // XXX Doesn't really belong here.
 localparam int NGEMQUEUES = 2;
 
+/*
+ * Time stamp unit (TSU) time.
+ * The layout follows the GEM's own TSU: 48 bits of seconds and
+ * 30 bits of nanoseconds.
+ */
+localparam int TSU_SEC_WIDTH = 48;
+localparam int TSU_NSEC_WIDTH = 30;
+localparam int TSU_NSEC_PER_SEC = 1000000000;
+
+typedef struct packed {
+	logic [TSU_SEC_WIDTH-1:0] sec;
+	logic [TSU_NSEC_WIDTH-1:0] nsec;
+} tsu_time_t;
+
 typedef enum int {
-	MMR_RW_REGN_CONTROL
+	MMR_RW_REGN_CONTROL,
+	// Written by the firmware, read-only for the host
+	MMR_RW_REGN_STATUS
 } mmr_rw_n;
 
 typedef enum int {
@@ -33,7 +49,37 @@ typedef enum int {
 	MMR_R_REGN_RX_DATA_FIFO_SIZE,
 	MMR_R_REGN_RX_DATA_FIFO_WIDTH,
 	MMR_R_REGN_TX_DATA_FIFO_SIZE,
-	MMR_R_REGN_TX_DATA_FIFO_WIDTH
+	MMR_R_REGN_TX_DATA_FIFO_WIDTH,
+	MMR_R_REGN_RX_HDR_SPLIT,
+	MMR_R_REGN_RX_COPYBREAK,
+	MMR_R_REGN_RX_LRO,
+	MMR_R_REGN_TX_CUT_THROUGH,
+	MMR_R_REGN_TX_SCHED,
+	MMR_R_REGN_TX_SCHED_WEIGHTS,
+	// Rate and burst size registers of the TX shaper for each queue
+	MMR_R_REGN_TX_SHAPER_RATE_0,
+	MMR_R_REGN_TX_SHAPER_BURST_0,
+	MMR_R_REGN_TX_SHAPER_RATE_1,
+	MMR_R_REGN_TX_SHAPER_BURST_1,
+	MMR_R_REGN_VLAN,
+	MMR_R_REGN_RX_FLOW_CTRL,
+	MMR_R_REGN_RX_FLOW_CTRL_PAUSE,
+	MMR_R_REGN_RX_QUEUE_MAP,
+	MMR_R_REGN_RX_STASH,
+	MMR_R_REGN_BENCH,
+	MMR_R_REGN_GEN_LENGTH,
+	MMR_R_REGN_GEN_PERIOD,
+	MMR_R_REGN_RX_MIRROR,
+	MMR_R_REGN_RX_MIRROR_FILTER,
+	MMR_R_REGN_RX_MIRROR_RING_BASE,
+	// Bits 39:32 of the capture ring address
+	MMR_R_REGN_RX_MIRROR_RING_BASE_H,
+	MMR_R_REGN_RX_MIRROR_RING_SIZE,
+	MMR_R_REGN_TX_LAUNCH,
+	// Base address of the GEM register block the SP pair is attached to
+	MMR_R_REGN_GEM_BASE,
+	// The STATUS register of the other SP of the pair
+	MMR_R_REGN_PEER_STATUS
 } mmr_r_n;
 
 localparam int SIZEOF_REG = 4;
@@ -46,15 +92,81 @@ localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_BRAM_DATA			= 10'h014;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_IO_AXI_AXCACHE	= 10'h020;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_DMA_AXI_AXCACHE	= 10'h024;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RESERVED0			= 10'h028;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TSU_INCR			= 10'h030;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TSU_NSEC			= 10'h034;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TSU_SEC_L			= 10'h038;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TSU_SEC_H			= 10'h03c;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_DMA_DESC_BASE	= 10'h040;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_DMA_DESC_BASE	= 10'h080;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_HDR_SPLIT		= 10'h0c0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_COPYBREAK		= 10'h0c4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_LRO			= 10'h0c8;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_CUT_THROUGH	= 10'h0cc;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_SCHED			= 10'h0d0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_SCHED_WEIGHTS	= 10'h0d4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_VLAN				= 10'h0d8;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_FLOW_CTRL		= 10'h0dc;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_SHAPER_BASE	= 10'h0e0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_FLOW_CTRL_PAUSE	= 10'h0f0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_QUEUE_MAP		= 10'h0f4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_STASH			= 10'h0f8;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_IER_BASE			= 10'h100;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_IDR_BASE			= 10'h120;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_IMR_BASE			= 10'h140;
 localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_ISR_BASE			= 10'h160;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_CONTROL		= 10'h180;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_PERIOD		= 10'h184;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_NSAMPLES		= 10'h188;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_SIZE			= 10'h18c;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_ADDR			= 10'h190;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_PROF_DATA			= 10'h194;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_BENCH				= 10'h1a0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_GEN_LENGTH		= 10'h1a4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_GEN_PERIOD		= 10'h1a8;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_GEN_NFRAMES		= 10'h1ac;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_NFRAMES		= 10'h1b0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_NBYTES			= 10'h1b4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_NFRAMES		= 10'h1b8;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_NBYTES			= 10'h1bc;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_NDROPS			= 10'h1c0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_MIRROR			= 10'h1c4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_MIRROR_FILTER	= 10'h1c8;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_MIRROR_RING_BASE	= 10'h1cc;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_MIRROR_RING_SIZE	= 10'h1d0;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_TX_LAUNCH			= 10'h1d4;
+localparam logic [MMR_RANGE_WIDTH-1:0] REGOFF_RX_MIRROR_RING_BASE_H	= 10'h1d8;
+
+/*
+ * Bits of the REGOFF_PROF_CONTROL register.
+ * Writing CLEAR starts clearing the histogram and the sample count.
+ * CLEAR reads as 1 until clearing has finished.
+ */
+localparam int PROF_CONTROL_ENABLE_BITN = 0;
+localparam int PROF_CONTROL_CLEAR_BITN = 1;
+localparam int PROF_CONTROL_PC_SHIFT_BITN = 8;
+localparam int PROF_CONTROL_PC_SHIFT_WIDTH = 4;
+
+/*
+ * Bits of the REGOFF_BENCH register.
+ * LOOPBACK feeds the frames of the TX unit into the RX unit instead
+ * of the GEM. GEN_ENABLE makes the packet generator fill the TX FIFOs.
+ * Both are only meant to be changed while no frames are in flight.
+ * The loopback bits of the RX and the TX SP are ORed.
+ */
+localparam int BENCH_LOOPBACK_BITN = 0;
+localparam int BENCH_GEN_ENABLE_BITN = 1;
+
+/*
+ * The packet generator picks frame lengths between GEN_LENGTH_MIN
+ * and GEN_LENGTH_MAX (inclusive) and starts a frame at most every
+ * REGOFF_GEN_PERIOD cycles.
+ */
+localparam int GEN_LENGTH_MIN_BITN = 0;
+localparam int GEN_LENGTH_MAX_BITN = 16;
+localparam int GEN_LENGTH_WIDTH = 14;
 
-localparam int MMR_RW_NREGS = 1;
-localparam int MMR_R_NREGS = 11;
+localparam int MMR_RW_NREGS = 2;
+localparam int MMR_R_NREGS = 37;
 localparam int MMR_R_BITN = 8;
 
 endpackage
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Connects the PC-sampling profiler to the MMR.
+ */
+interface mmr_prof_interface;
+
+logic enable;
+// Pulses for one cycle to start clearing the histogram
+logic clear;
+logic clearing;
+logic [3:0] pc_shift;
+logic [31:0] period;
+logic [31:0] nsamples;
+
+// Histogram read port (index of a 32-bit counter)
+logic [29:0] addr;
+logic [31:0] data;
+
+modport master(
+	input enable,
+	input clear,
+	output clearing,
+	input pc_shift,
+	input period,
+	output nsamples,
+	input addr,
+	output data
+);
+modport slave(
+	output enable,
+	output clear,
+	input clearing,
+	output pc_shift,
+	output period,
+	input nsamples,
+	output addr,
+	input data
+);
+
+endinterface
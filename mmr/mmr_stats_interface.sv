@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Connects the frame counters of the SP units to the MMR.
+ * All counters are free-running and wrap around, so the host
+ * computes rates from the difference of two samples.
+ */
+interface mmr_stats_interface;
+
+// Frames written into the TX FIFOs by the packet generator
+logic [31:0] gen_nframes;
+// Frames and bytes handed to the GEM (or the loopback)
+logic [31:0] tx_nframes;
+logic [31:0] tx_nbytes;
+// Frames stored in the RX FIFOs and bytes received from the GEM
+// (or the loopback)
+logic [31:0] rx_nframes;
+logic [31:0] rx_nbytes;
+// Frames that were received with an error or did not fit
+logic [31:0] rx_ndrops;
+
+modport master(
+	output gen_nframes,
+	output tx_nframes,
+	output tx_nbytes,
+	output rx_nframes,
+	output rx_nbytes,
+	output rx_ndrops
+);
+modport slave(
+	input gen_nframes,
+	input tx_nframes,
+	input tx_nbytes,
+	input rx_nframes,
+	input rx_nbytes,
+	input rx_ndrops
+);
+
+endinterface
@@ -2,7 +2,7 @@ set ip_name "prism_sp_openhw"
 set ip_repo_path "$::env(IP_REPO_BASE_PATH)/${ip_name}"
 set ip_src_path [file dirname [info script]]
 set fpga_part "xczu9eg-ffvb1156-2-e"
-set core_revision 15
+set core_revision 17
 
 file delete -force -- ${ip_repo_path}
 create_project -force -part ${fpga_part} temporary_project /tmp/temporary_project
@@ -84,6 +84,62 @@ ipx::infer_bus_interface { \
 	s_axil_1_rresp } \
 	xilinx.com:interface:aximm_rtl:1.0 [ipx::current_core]
 
+ipx::infer_bus_interface { \
+	s_axi_bram_0_awvalid \
+	s_axi_bram_0_awready \
+	s_axi_bram_0_awaddr \
+	s_axi_bram_0_awlen \
+	s_axi_bram_0_awsize \
+	s_axi_bram_0_awburst \
+	s_axi_bram_0_wvalid \
+	s_axi_bram_0_wready \
+	s_axi_bram_0_wdata \
+	s_axi_bram_0_wstrb \
+	s_axi_bram_0_wlast \
+	s_axi_bram_0_bvalid \
+	s_axi_bram_0_bready \
+	s_axi_bram_0_bresp \
+	s_axi_bram_0_arvalid \
+	s_axi_bram_0_arready \
+	s_axi_bram_0_araddr \
+	s_axi_bram_0_arlen \
+	s_axi_bram_0_arsize \
+	s_axi_bram_0_arburst \
+	s_axi_bram_0_rvalid \
+	s_axi_bram_0_rready \
+	s_axi_bram_0_rdata \
+	s_axi_bram_0_rresp \
+	s_axi_bram_0_rlast } \
+	xilinx.com:interface:aximm_rtl:1.0 [ipx::current_core]
+
+ipx::infer_bus_interface { \
+	s_axi_bram_1_awvalid \
+	s_axi_bram_1_awready \
+	s_axi_bram_1_awaddr \
+	s_axi_bram_1_awlen \
+	s_axi_bram_1_awsize \
+	s_axi_bram_1_awburst \
+	s_axi_bram_1_wvalid \
+	s_axi_bram_1_wready \
+	s_axi_bram_1_wdata \
+	s_axi_bram_1_wstrb \
+	s_axi_bram_1_wlast \
+	s_axi_bram_1_bvalid \
+	s_axi_bram_1_bready \
+	s_axi_bram_1_bresp \
+	s_axi_bram_1_arvalid \
+	s_axi_bram_1_arready \
+	s_axi_bram_1_araddr \
+	s_axi_bram_1_arlen \
+	s_axi_bram_1_arsize \
+	s_axi_bram_1_arburst \
+	s_axi_bram_1_rvalid \
+	s_axi_bram_1_rready \
+	s_axi_bram_1_rdata \
+	s_axi_bram_1_rresp \
+	s_axi_bram_1_rlast } \
+	xilinx.com:interface:aximm_rtl:1.0 [ipx::current_core]
+
 ipx::infer_bus_interface { \
 	m_axi_io_0_awvalid \
 	m_axi_io_0_awready \
@@ -265,6 +321,7 @@ ipx::infer_bus_interface { \
 	m_axi_dma_awprot \
 	m_axi_dma_awqos \
 	m_axi_dma_awregion \
+	m_axi_dma_awuser \
 	m_axi_dma_wvalid \
 	m_axi_dma_wready \
 	m_axi_dma_wdata \
@@ -286,6 +343,7 @@ ipx::infer_bus_interface { \
 	m_axi_dma_arprot \
 	m_axi_dma_arqos \
 	m_axi_dma_arregion \
+	m_axi_dma_aruser \
 	m_axi_dma_rvalid \
 	m_axi_dma_rready \
 	m_axi_dma_rid \
@@ -347,9 +405,11 @@ set_property physical_name gem_tx_r_sop [ipx::get_port_maps TX_R_SOP -of_objects
 ipx::add_port_map TX_R_FIXED_LAT [ipx::get_bus_interfaces gem -of_objects [ipx::current_core]]
 set_property physical_name gem_tx_r_fixed_lat [ipx::get_port_maps TX_R_FIXED_LAT -of_objects [ipx::get_bus_interfaces gem -of_objects [ipx::current_core]]]
 
-set_property value "s_axil_0:s_axil_1:m_axi_io_0:m_axi_io_1:m_axi_dma:m_axi_acp_0:m_axi_acp_1" [ipx::get_bus_parameters ASSOCIATED_BUSIF -of_objects [ipx::get_bus_interfaces clock -of_objects [ipx::current_core]]]
+set_property value "s_axil_0:s_axil_1:s_axi_bram_0:s_axi_bram_1:m_axi_io_0:m_axi_io_1:m_axi_dma:m_axi_acp_0:m_axi_acp_1" [ipx::get_bus_parameters ASSOCIATED_BUSIF -of_objects [ipx::get_bus_interfaces clock -of_objects [ipx::current_core]]]
 ipx::associate_bus_interfaces -busif s_axil_0 -clock clock [ipx::current_core]
 ipx::associate_bus_interfaces -busif s_axil_1 -clock clock [ipx::current_core]
+ipx::associate_bus_interfaces -busif s_axi_bram_0 -clock clock [ipx::current_core]
+ipx::associate_bus_interfaces -busif s_axi_bram_1 -clock clock [ipx::current_core]
 ipx::associate_bus_interfaces -busif m_axi_io_0 -clock clock [ipx::current_core]
 ipx::associate_bus_interfaces -busif m_axi_io_1 -clock clock [ipx::current_core]
 ipx::associate_bus_interfaces -busif m_axi_dma -clock clock [ipx::current_core]
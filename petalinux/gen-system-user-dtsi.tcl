@@ -0,0 +1,45 @@
+# Generates system-user.dtsi for the SP pairs of the block design
+# created by create-demo-project.tcl.
+#
+# Usage: PRISM_SP_GEMS="0 1 2 3" tclsh gen-system-user-dtsi.tcl > system-user.dtsi
+#
+# Every pair runs the same two firmware images (the SPs read the base
+# address of their GEM from a register), so only the device tree
+# depends on the list of GEMs.
+source [file join [file dirname [info script]] .. prism-sp-ports.tcl]
+
+puts {/include/ "system-conf.dtsi"}
+puts "/ {"
+puts "\tchosen {"
+puts "\t\tbootargs = \"console=ttyPS0,115200n8 earlycon clk_ignore_unused cpuidle.off=1\";"
+puts "\t};"
+
+set i 0
+foreach g $prism_sp_gems {
+	set n 1
+	puts ""
+	foreach dir {tx rx} {
+		set mmr [prism_sp_mmr_addr $i $dir]
+		set bram [prism_sp_bram_addr $i $dir]
+		puts "\tprism_sp_duo_${dir}_${g}: prism_sp_duo_${dir}_${i}@[string tolower [string range $mmr 2 end]] {"
+		puts "\t\tcompatible = \"xlnx,prism-sp-duo-${dir}-1.0\";"
+		puts "\t\treg = <0x0 [string tolower $mmr] 0x0 0x1000>, <0x0 [string tolower $bram] 0x0 0x10000>;"
+		puts "\t\treg-names = \"mmr\", \"bram\";"
+		puts "\t\tinterrupt-parent = <&gic>;"
+		puts "\t\tinterrupts = <0 [prism_sp_irq $i $n] 4>;"
+		puts "\t\tio_axi_axcache = \"0000\";"
+		puts "\t\tdma_axi_axcache = \"1111\";"
+		puts "\t};"
+		incr n
+	}
+	incr i
+}
+puts "};"
+
+foreach g $prism_sp_gems {
+	puts ""
+	puts "&gem${g} {"
+	puts "\tprism-sp-tx = <&prism_sp_duo_tx_${g}>;"
+	puts "\tprism-sp-rx = <&prism_sp_duo_rx_${g}>;"
+	puts "};"
+}
@@ -0,0 +1,51 @@
+# The GEMs that get an SP pair (one prism_sp_openhw instance) each, and
+# the address map of the pairs.
+# This file is sourced by create-demo-project.tcl and by
+# petalinux/gen-system-user-dtsi.tcl, so the block design and the device
+# tree always agree.
+#
+# The list can be overridden with the environment variable PRISM_SP_GEMS
+# (e.g., PRISM_SP_GEMS="0 1 2 3").
+# The position of a GEM in the list is the index of its SP pair.
+if {[info exists ::env(PRISM_SP_GEMS)]} {
+	set prism_sp_gems $::env(PRISM_SP_GEMS)
+} else {
+	set prism_sp_gems {3}
+}
+
+if {[llength $prism_sp_gems] < 1 || [llength $prism_sp_gems] > 4 ||
+		[llength [lsort -unique $prism_sp_gems]] != [llength $prism_sp_gems]} {
+	error "PRISM_SP_GEMS must list one to four different GEMs"
+}
+foreach g $prism_sp_gems {
+	if {$g ni {0 1 2 3}} {
+		error "GEM${g} does not exist"
+	}
+}
+
+# Base address of the registers of GEM g
+proc prism_sp_gem_base {g} {
+	format 0x%08X [expr {0xff0b0000 + $g * 0x10000}]
+}
+
+# Memory-mapped registers of the TX or RX SP of pair i
+proc prism_sp_mmr_addr {i dir} {
+	format 0x%08X [expr {0xa0006000 + $i * 0x2000 + ($dir eq "rx" ? 0x1000 : 0)}]
+}
+
+# BRAM window (IBRAM followed by DBRAM) of the TX or RX SP of pair i
+proc prism_sp_bram_addr {i dir} {
+	format 0x%08X [expr {0xa0100000 + $i * 0x20000 + ($dir eq "rx" ? 0x10000 : 0)}]
+}
+
+# Shared peripheral interrupt (as numbered in the device tree) of the IRQ
+# line n of pair i, where n is 0 for gem_irq, 1 for gem_irq_tx and 2 for
+# gem_irq_rx.
+# Pairs 0 and 1 use pl_ps_irq0 (SPI 89-96), pairs 2 and 3 use pl_ps_irq1
+# (SPI 104-111).
+proc prism_sp_irq {i n} {
+	if {$i < 2} {
+		return [expr {89 + 3 * $i + $n}]
+	}
+	return [expr {104 + 3 * ($i - 2) + $n}]
+}
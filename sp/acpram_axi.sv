@@ -42,7 +42,6 @@ module acpram_axi
 // AXI write channels
 // ------- ------- ------- ------- ------- ------- ------- -------
 // ------- ------- ------- ------- ------- ------- ------- -------
-assign axi_aw.awaddr[39:32] = '0;
 assign axi_aw.awlen[7:2] = '0;
 assign axi_aw.awid = '0;
 // The ACP port only allows a size of 128 bits (16 byte).
@@ -184,7 +183,6 @@ wire logic r_hshake_last = r_hshake && axi_r.rlast;
 // Set up the AXI Read Channel interface
 //
 // Read Address
-assign axi_ar.araddr[39:32] = '0;
 assign axi_ar.arlen[7:2] = '0;
 assign axi_ar.arid = '0;
 assign axi_ar.arsize = 3'h4;
@@ -331,7 +329,6 @@ always_ff @(posedge clock) begin
 			$display("acpram_axi_i.write pulse: .acpram_addr=%x .axi_addr=%x .len=%d",
 				acpram_axi_i.acpram_addr, acpram_axi_i.axi_addr, acpram_axi_i.len);
 
-			axi_aw.awaddr[31:0] <= acpram_axi_i.axi_addr;
 			// This sets AWLEN
 			// to 0 (1 transfer)  for acpram_axi_i.len==0 and
 			// to 3 (4 transfers) for acpram_axi_i.len==1
@@ -362,7 +359,6 @@ always_ff @(posedge clock) begin
 			$display("acpram_axi_i.read pulse: .acpram_addr=%x .axi_addr=%x .len=%d",
 				acpram_axi_i.acpram_addr, acpram_axi_i.axi_addr, acpram_axi_i.len);
 
-			axi_ar.araddr[31:0] <= acpram_axi_i.axi_addr;
 			// This sets ARLEN
 			// to 0 (1 transfer)  for acpram_axi_i.len==0 and
 			// to 3 (4 transfers) for acpram_axi_i.len==1
@@ -16,7 +16,8 @@
 // AXI[r] -> FIFO
 module axi_to_fifo #
 (
-	parameter integer AXI_ADDR_WIDTH = 32
+	parameter integer AXI_ADDR_WIDTH = 32,
+	parameter integer FIFO_NFREE_WIDTH = 16
 )
 (
 	input wire logic clock,
@@ -26,6 +27,9 @@ module axi_to_fifo #
 	memory_read_interface.slave mem_r,
 	// Interface to write to a FIFO
 	fifo_write_interface.master fifo_w,
+	// The number of free words in the FIFO.
+	// A burst is only issued if the FIFO has room for all of its beats.
+	input wire logic [FIFO_NFREE_WIDTH-1:0] fifo_w_nfree,
 
 	// Actual AXI memory interface for reading
 	axi_read_address_channel.master axi_ar,
@@ -33,9 +37,13 @@ module axi_to_fifo #
 );
 
 localparam int AXI_DATA_WIDTH = axi_r.AXI_RDATA_WIDTH;
-localparam int MAX_NBYTES_PER_BURST = 256 * (AXI_DATA_WIDTH / 8);
+// Bursts have at most 256 beats and do not cross a 4 KB boundary.
+localparam int MAX_BURST_BEATS = 256;
+localparam int PAGE_BEATS = 4096 / (AXI_DATA_WIDTH / 8);
 localparam int LEN_WIDTH = 16;
 localparam int ALIGN_WIDTH = $clog2(AXI_DATA_WIDTH / 8);
+// Wide enough for the beats of a transfer with an unaligned address
+localparam int BEATS_WIDTH = LEN_WIDTH - ALIGN_WIDTH + 2;
 
 //
 // Set up the FIFO Write interface
@@ -56,13 +64,9 @@ assign axi_ar.arsize = ARSIZE[2:0];
 // INCR burst type
 assign axi_ar.arburst = 2'b01;
 assign axi_ar.arlock = 1'b0;
-// This is now set by the user of the module.
-// Was:
-// Not Allocated, Modifiable, not Bufferable.
-// assign axi_ar.arcache = 4'b0010;
+// ARCACHE and ARUSER are taken from each transfer (see below).
 assign axi_ar.arprot = 3'h0;
 assign axi_ar.arqos = 4'h0;
-assign axi_ar.aruser = '1;
 
 // ------- ------- ------- ------- ------- ------- ------- -------
 //
@@ -74,6 +78,24 @@ assign axi_ar.aruser = '1;
 // On the next clock posedge where both RVALID(S) and RREADY(M)
 // are asserted, the data in RDATA is transferred.
 //
+var logic [7:0] axi_ar_arlen_comb;
+// The beats of the next burst: the beats left in the transfer, up to
+// the next 4 KB boundary and at most MAX_BURST_BEATS.
+var logic [BEATS_WIDTH-1:0] burst_beats_comb;
+// The next burst ends the transfer.
+wire logic last_burst_comb = burst_beats_comb == beats_left;
+wire logic [BEATS_WIDTH-1:0] page_beats_left =
+	BEATS_WIDTH'(PAGE_BEATS) - BEATS_WIDTH'(src_addr[11:ALIGN_WIDTH]);
+
+always_comb begin
+	burst_beats_comb = beats_left;
+	if (burst_beats_comb > page_beats_left)
+		burst_beats_comb = page_beats_left;
+	if (burst_beats_comb > BEATS_WIDTH'(MAX_BURST_BEATS))
+		burst_beats_comb = BEATS_WIDTH'(MAX_BURST_BEATS);
+	axi_ar_arlen_comb = 8'(burst_beats_comb - 1);
+end
+
 always_ff @(posedge clock) begin
 	if (!reset_n) begin
 		axi_ar.arvalid <= 1'b0;
@@ -82,39 +104,7 @@ always_ff @(posedge clock) begin
 		if (read_burst_start) begin
 			axi_ar.arvalid <= 1'b1;
 			axi_ar.araddr <= src_addr;
-
-			// Example for a 32-bit data width:
-			//
-			// 16       8       0
-			//  |-------|-------|
-			//   YYYYYYXXXXXXXXAA
-			//      YYY is the number of full bursts
-			// XXXXXXXX is the number of beats
-			//       AA is the number of extra bytes
-			//
-			// So this "if" condition below is just whether a Y bit is
-			// set.
-			if (full_bursts_left != '0) begin
-				axi_ar.arlen <= 255;
-			end
-			else begin
-				// If it isn't, round up if necessary (effectively adding
-				// 1 to XXXXXXXX and then subtracting 1).
-				// Otherwise, just subtract 1. There is no need to
-				// use bytes_left[ALIGN +:9] in this case, because
-				// that would only be necessary if there are bits set
-				// in bytes_left above bit (8+ALIGN-1) which cannot
-				// happen because these are the YYY bits so we would not
-				// end up here in the first place.
-				if (extra_bytes != '0)
-					axi_ar.arlen <= beats_left;
-				else
-					axi_ar.arlen <= beats_left - 1;
-			end
-			// Prepare these values here.
-			rlast_lt_full <= last_write_bytes[ALIGN_WIDTH] == 1'b0;
-			rlast_gt_full <= last_write_bytes[ALIGN_WIDTH] == 1'b1 &&
-				|last_write_bytes[ALIGN_WIDTH-1:0] != 1'b0;
+			axi_ar.arlen <= axi_ar_arlen_comb;
 		end
 		else if (ar_hshake) begin
 			axi_ar.arvalid <= 1'b0;
@@ -163,144 +153,45 @@ always_ff @(posedge clock) begin
 	end
 end
 
-var logic [$bits(axi_r.rdata)-1:0] reordered_axi_rdata_comb;
-var logic [$bits(axi_r.rdata)-1:0] last_axi_rdata_comb;
-var logic [$bits(axi_r.rdata)-1:0] last_axi_rdata_ff;
+// ------- ------- ------- ------- ------- ------- ------- -------
+//
+// Realignment
+//
+// ------- ------- ------- ------- ------- ------- ------- -------
+// The source address does not need to be aligned. Whole beats are read
+// starting at the aligned address, and the bytes before the source
+// address (in the first beat) and after its end (in the last beat) are
+// dropped.
+// The remaining bytes of each beat are appended to the bytes left over
+// from the previous beat. With 'cont', the bytes left over at the end of
+// a transfer are kept and the next transfer is appended to them.
+localparam int NBYTES = AXI_DATA_WIDTH / 8;
+
+// The number of bytes left over in carry_ff
 var logic [ALIGN_WIDTH-1:0] current_offset;
+var logic [$bits(axi_r.rdata)-1:0] carry_ff;
+var logic first_beat;
+var logic [ALIGN_WIDTH-1:0] src_offset;
+// The number of bytes of the last beat that belong to the transfer
+var logic [ALIGN_WIDTH:0] src_end_bytes;
+
+wire logic xfer_last = axi_r.rlast && last_burst_comb;
+wire logic [ALIGN_WIDTH-1:0] beat_lo = first_beat ? src_offset : '0;
+wire logic [ALIGN_WIDTH:0] beat_hi = xfer_last ? src_end_bytes : (ALIGN_WIDTH+1)'(NBYTES);
+wire logic [ALIGN_WIDTH+1:0] beat_total = (ALIGN_WIDTH+2)'(current_offset) + (ALIGN_WIDTH+2)'(beat_hi - beat_lo);
+// Byte i of the beat goes to byte (i - beat_lo + current_offset) mod NBYTES.
+wire logic [ALIGN_WIDTH-1:0] beat_rot = current_offset - beat_lo;
+
+var logic [$bits(axi_r.rdata)-1:0] rotated_axi_rdata_comb;
+var logic [$bits(axi_r.rdata)-1:0] merged_axi_rdata_comb;
 
-if (AXI_DATA_WIDTH == 32) begin
-always_comb begin
-	case (current_offset)
-	2'b00: begin
-		reordered_axi_rdata_comb = axi_r.rdata;
-		last_axi_rdata_comb = '0;
-	end
-	2'b01: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:3*8], last_axi_rdata_ff[0 +:1*8] };
-		last_axi_rdata_comb = { {3*8{1'b0}}, axi_r.rdata[3*8 +:1*8] };
-	end
-	2'b10: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:2*8], last_axi_rdata_ff[0 +:2*8] };
-		last_axi_rdata_comb = { {2*8{1'b0}}, axi_r.rdata[2*8 +:2*8] };
-	end
-	2'b11: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:1*8], last_axi_rdata_ff[0 +:3*8] };
-		last_axi_rdata_comb = { {1*8{1'b0}}, axi_r.rdata[1*8 +:3*8] };
-	end
-	endcase
-end
-end
-else if (AXI_DATA_WIDTH == 64) begin
-always_comb begin
-	case (current_offset)
-	3'b000: begin
-		reordered_axi_rdata_comb = axi_r.rdata;
-		last_axi_rdata_comb = '0;
-	end
-	3'b001: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:7*8], last_axi_rdata_ff[0 +:1*8] };
-		last_axi_rdata_comb = { {7*8{1'b0}}, axi_r.rdata[7*8 +:1*8] };
-	end
-	3'b010: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:6*8], last_axi_rdata_ff[0 +:2*8] };
-		last_axi_rdata_comb = { {6*8{1'b0}}, axi_r.rdata[6*8 +:2*8] };
-	end
-	3'b011: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:5*8], last_axi_rdata_ff[0 +:3*8] };
-		last_axi_rdata_comb = { {5*8{1'b0}}, axi_r.rdata[5*8 +:3*8] };
-	end
-	3'b100: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:4*8], last_axi_rdata_ff[0 +:4*8] };
-		last_axi_rdata_comb = { {4*8{1'b0}}, axi_r.rdata[4*8 +:4*8] };
-	end
-	3'b101: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:3*8], last_axi_rdata_ff[0 +:5*8] };
-		last_axi_rdata_comb = { {3*8{1'b0}}, axi_r.rdata[3*8 +:5*8] };
-	end
-	3'b110: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:2*8], last_axi_rdata_ff[0 +:6*8] };
-		last_axi_rdata_comb = { {2*8{1'b0}}, axi_r.rdata[2*8 +:6*8] };
-	end
-	3'b111: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:1*8], last_axi_rdata_ff[0 +:7*8] };
-		last_axi_rdata_comb = { {1*8{1'b0}}, axi_r.rdata[1*8 +:7*8] };
-	end
-	endcase
-end
-end
-else if (AXI_DATA_WIDTH == 128) begin
 always_comb begin
-	case (current_offset)
-	4'b0000: begin
-		reordered_axi_rdata_comb = axi_r.rdata;
-		last_axi_rdata_comb = '0;
-	end
-	4'b0001: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:15*8], last_axi_rdata_ff[0 +:1*8] };
-		last_axi_rdata_comb = { {15*8{1'b0}}, axi_r.rdata[15*8 +:1*8] };
+	rotated_axi_rdata_comb = AXI_DATA_WIDTH'({ axi_r.rdata, axi_r.rdata } >> (AXI_DATA_WIDTH - { beat_rot, 3'b000 }));
+	for (int i = 0; i < NBYTES; i++) begin
+		merged_axi_rdata_comb[i*8 +: 8] = i < current_offset ? carry_ff[i*8 +: 8] : rotated_axi_rdata_comb[i*8 +: 8];
 	end
-	4'b0010: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:14*8], last_axi_rdata_ff[0 +:2*8] };
-		last_axi_rdata_comb = { {14*8{1'b0}}, axi_r.rdata[14*8 +:2*8] };
-	end
-	4'b0011: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:13*8], last_axi_rdata_ff[0 +:3*8] };
-		last_axi_rdata_comb = { {13*8{1'b0}}, axi_r.rdata[13*8 +:3*8] };
-	end
-	4'b0100: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:12*8], last_axi_rdata_ff[0 +:4*8] };
-		last_axi_rdata_comb = { {12*8{1'b0}}, axi_r.rdata[12*8 +:4*8] };
-	end
-	4'b0101: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:11*8], last_axi_rdata_ff[0 +:5*8] };
-		last_axi_rdata_comb = { {11*8{1'b0}}, axi_r.rdata[11*8 +:5*8] };
-	end
-	4'b0110: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:10*8], last_axi_rdata_ff[0 +:6*8] };
-		last_axi_rdata_comb = { {10*8{1'b0}}, axi_r.rdata[10*8 +:6*8] };
-	end
-	4'b0111: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:9*8], last_axi_rdata_ff[0 +:7*8] };
-		last_axi_rdata_comb = { {9*8{1'b0}}, axi_r.rdata[9*8 +:7*8] };
-	end
-	4'b1000: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:8*8], last_axi_rdata_ff[0 +:8*8] };
-		last_axi_rdata_comb = { {8*8{1'b0}}, axi_r.rdata[8*8 +:8*8] };
-	end
-	4'b1001: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:7*8], last_axi_rdata_ff[0 +:9*8] };
-		last_axi_rdata_comb = { {7*8{1'b0}}, axi_r.rdata[7*8 +:9*8] };
-	end
-	4'b1010: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:6*8], last_axi_rdata_ff[0 +:10*8] };
-		last_axi_rdata_comb = { {6*8{1'b0}}, axi_r.rdata[6*8 +:10*8] };
-	end
-	4'b1011: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:5*8], last_axi_rdata_ff[0 +:11*8] };
-		last_axi_rdata_comb = { {5*8{1'b0}}, axi_r.rdata[5*8 +:11*8] };
-	end
-	4'b1100: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:4*8], last_axi_rdata_ff[0 +:12*8] };
-		last_axi_rdata_comb = { {4*8{1'b0}}, axi_r.rdata[4*8 +:12*8] };
-	end
-	4'b1101: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:3*8], last_axi_rdata_ff[0 +:13*8] };
-		last_axi_rdata_comb = { {3*8{1'b0}}, axi_r.rdata[3*8 +:13*8] };
-	end
-	4'b1110: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:2*8], last_axi_rdata_ff[0 +:14*8] };
-		last_axi_rdata_comb = { {2*8{1'b0}}, axi_r.rdata[2*8 +:14*8] };
-	end
-	4'b1111: begin
-		reordered_axi_rdata_comb = { axi_r.rdata[0 +:1*8], last_axi_rdata_ff[0 +:15*8] };
-		last_axi_rdata_comb = { {1*8{1'b0}}, axi_r.rdata[1*8 +:15*8] };
-	end
-	endcase
-end
 end
 
-var logic rlast_lt_full;
-var logic rlast_gt_full;
 // We keep this around to be able to detect the cycle just after the
 // last read beat.
 var logic extra_write;
@@ -308,45 +199,52 @@ always_ff @(posedge clock) begin
 	if (!reset_n) begin
 		fifo_w.wr_en <= 1'b0;
 		extra_write <= 1'b0;
+		current_offset <= '0;
 	end
 	else begin
 		// Unpulse
 		fifo_w.wr_en <= 1'b0;
 		extra_write <= 1'b0;
 
+		if (mem_r.busy == 1'b0 && mem_r.start) begin
+			first_beat <= 1'b1;
+		end
 		if (r_hshake) begin
-			/* 
-			 * There are three cases to handle here.
-			 * 1) a less-than-full data word to write
-			 *   o) If 'cont' is set, don't write non-full data words to the FIFO.
-			 *   x) If 'cont' is not set, write the non-full data word to the FIFO.
-			 * 2) a full data word to write
-			 *   o) Whether or not cont is set, write the full data word to the FIFO.
-			 * 3) more than a full data word to write
-			 *   o) Whether or not cont is set, write the full data word to the FIFO
-			 *		and store the extra bytes.
-			 *   x) If 'cont' is not set, set 'extra_write' to write the remaining bytes
-			 *		in the next cycle.
+			first_beat <= 1'b0;
+
+			/*
+			 * There are two cases to handle here.
+			 * 1) a full data word (or more) is available
+			 *   o) Write the full data word to the FIFO and keep the extra bytes.
+			 *   x) If this is the last beat and 'cont' is not set, write the
+			 *      extra bytes in the next cycle ('extra_write').
+			 * 2) a less-than-full data word is available
+			 *   o) Keep the bytes.
+			 *   x) If this is the last beat and 'cont' is not set, write the
+			 *      non-full data word to the FIFO.
 			 */
-			if (axi_r.rlast & rlast_lt_full & cont) begin
-				last_axi_rdata_ff <= reordered_axi_rdata_comb;
+			if (beat_total >= NBYTES) begin
+				fifo_w.wr_en <= 1'b1;
+				fifo_w.wr_data <= merged_axi_rdata_comb;
+				carry_ff <= rotated_axi_rdata_comb;
+				current_offset <= ALIGN_WIDTH'(beat_total - NBYTES);
+				extra_write <= xfer_last & ~cont & beat_total != NBYTES;
 			end
 			else begin
-				fifo_w.wr_en <= 1'b1;
-				fifo_w.wr_data <= reordered_axi_rdata_comb;
-				last_axi_rdata_ff <= last_axi_rdata_comb;
+				carry_ff <= merged_axi_rdata_comb;
+				current_offset <= ALIGN_WIDTH'(beat_total);
+				if (xfer_last & ~cont) begin
+					fifo_w.wr_en <= 1'b1;
+					fifo_w.wr_data <= merged_axi_rdata_comb;
+				end
+			end
+			if (xfer_last & ~cont) begin
+				current_offset <= '0;
 			end
-			// If
-			// - this is the last transfer,
-			// - more than a full word is available,
-			// - this is the last transaction, and
-			// - cont is not set,
-			// do an extra write cycle.
-			extra_write <= axi_r.rlast & rlast_gt_full & (bursts_left == 1) & ~cont;
 		end
 		if (extra_write) begin
 			fifo_w.wr_en <= 1'b1;
-			fifo_w.wr_data <= last_axi_rdata_ff;
+			fifo_w.wr_data <= carry_ff;
 		end
 	end
 end
@@ -358,27 +256,46 @@ end
 // ------- ------- ------- ------- ------- ------- ------- -------
 // Reading initiation pulse
 var logic read_burst_start;
-var logic [(LEN_WIDTH-8-ALIGN_WIDTH)-1:0] full_bursts_left;
-var logic [LEN_WIDTH-8-ALIGN_WIDTH:0] bursts_left;
-var logic [7:0] beats_left;
-var logic [ALIGN_WIDTH-1:0] extra_bytes;
+// A burst is waiting for room in the FIFO.
+var logic read_burst_pending;
+// The bursts cover the bytes from the aligned source address on,
+// so there may be one more beat than for an aligned source address.
+localparam int SPAN_WIDTH = LEN_WIDTH + 1;
+// The beats left in the transfer, including a partial last beat
+var logic [BEATS_WIDTH-1:0] beats_left;
 var logic [AXI_ADDR_WIDTH-1:0] src_addr;
 var logic cont;
 
-var logic [ALIGN_WIDTH:0] last_write_bytes;
+wire logic [SPAN_WIDTH-1:0] mem_r_span = SPAN_WIDTH'(mem_r.len) + SPAN_WIDTH'(mem_r.addr[ALIGN_WIDTH-1:0]);
+
+// Flow control
+//
+// The bursts of a transfer are issued one after the other, so all data
+// of the previous burst has been written when the next one is about to
+// be issued. Besides the beats, one word is reserved for an extra write
+// and a few words cover the latency of the FIFO's write data count.
+localparam int FIFO_NFREE_MARGIN = 4;
+
+wire logic read_burst_credit_ok =
+	fifo_w_nfree >= FIFO_NFREE_WIDTH'(axi_ar_arlen_comb) + 1 + FIFO_NFREE_MARGIN;
 
 always_ff @(posedge clock) begin
 	if (!reset_n) begin
 		read_burst_start <= 1'b0;
+		read_burst_pending <= 1'b0;
 		mem_r.done <= 1'b0;
 		mem_r.busy <= 1'b0;
-		current_offset <= '0;
 	end
 	else begin
 		// Unpulse
 		read_burst_start <= 1'b0;
 		mem_r.done <= 1'b0;
 
+		if (read_burst_pending && read_burst_credit_ok) begin
+			read_burst_pending <= 1'b0;
+			read_burst_start <= 1'b1;
+		end
+
 		if (mem_r.busy == 1'b0 && mem_r.start) begin
 			$display("mem_r.start pulse: .addr=%x .len=%d",
 				mem_r.addr, mem_r.len);
@@ -388,47 +305,34 @@ always_ff @(posedge clock) begin
 				mem_r.error <= 1'b1;
 			end
 			else begin
-				src_addr <= mem_r.addr;
-				full_bursts_left <= mem_r.len[LEN_WIDTH-1:8+ALIGN_WIDTH];
-
-				if (mem_r.len[8+ALIGN_WIDTH-1:0] != '0) begin
-					bursts_left <= mem_r.len[LEN_WIDTH-1:8+ALIGN_WIDTH] + 1;
-				end
-				else begin
-					bursts_left <= mem_r.len[LEN_WIDTH-1:8+ALIGN_WIDTH];
-				end
-
-				beats_left <= mem_r.len[8+ALIGN_WIDTH-1:ALIGN_WIDTH];
-				extra_bytes <= mem_r.len[ALIGN_WIDTH-1:0];
-				if (mem_r.len[ALIGN_WIDTH-1:0] == '0) begin
-					last_write_bytes[ALIGN_WIDTH] <= 1'b1;
-					last_write_bytes[ALIGN_WIDTH-1:0] <= current_offset;
-				end
+				src_addr <= { mem_r.addr[AXI_ADDR_WIDTH-1:ALIGN_WIDTH], {ALIGN_WIDTH{1'b0}} };
+				src_offset <= mem_r.addr[ALIGN_WIDTH-1:0];
+				// Round up to whole beats.
+				beats_left <= BEATS_WIDTH'((mem_r_span + SPAN_WIDTH'(NBYTES - 1)) >> ALIGN_WIDTH);
+				if (mem_r_span[ALIGN_WIDTH-1:0] == '0)
+					src_end_bytes <= (ALIGN_WIDTH+1)'(NBYTES);
 				else
-					last_write_bytes <= current_offset + mem_r.len[ALIGN_WIDTH-1:0];
+					src_end_bytes <= (ALIGN_WIDTH+1)'(mem_r_span[ALIGN_WIDTH-1:0]);
 				cont <= mem_r.cont;
+				axi_ar.arcache <= mem_r.cache;
+				axi_ar.aruser <= $bits(axi_ar.aruser)'(mem_r.user);
 				mem_r.busy <= 1'b1;
-				read_burst_start <= 1'b1;
+				read_burst_pending <= 1'b1;
 			end
 		end
 
 		if (mem_r.busy == 1'b1 && read_burst_done) begin
 			$display("read_burst_done pulse");
 
-			if (bursts_left != 1) begin
-				src_addr <= src_addr + MAX_NBYTES_PER_BURST[AXI_ADDR_WIDTH-1:0];
-				full_bursts_left <= full_bursts_left - 1;
-				bursts_left <= bursts_left - 1;
-				read_burst_start <= 1'b1;
+			if (!last_burst_comb) begin
+				src_addr <= src_addr + (AXI_ADDR_WIDTH'(burst_beats_comb) << ALIGN_WIDTH);
+				beats_left <= beats_left - burst_beats_comb;
+				read_burst_pending <= 1'b1;
 			end
 			else begin
 				mem_r.error <= 1'b0;
 				mem_r.done <= 1'b1;
 				mem_r.busy <= 1'b0;
-				if (cont)
-					current_offset <= last_write_bytes[ALIGN_WIDTH-1:0];
-				else
-					current_offset <= '0;
 			end
 		end
 	end
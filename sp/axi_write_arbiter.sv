@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Merges the write channels of two AXI masters into one.
+ *
+ * A master is granted all three channels from its AWVALID until the
+ * write response of the burst has been accepted. So a master must not
+ * start its next burst before the response of the previous one, which
+ * holds for acpram_axi and fifo_to_axi.
+ * The masters take turns if both are waiting.
+ */
+module axi_write_arbiter(
+	input wire logic clock,
+	input wire logic reset_n,
+
+	axi_write_address_channel.slave s_axi_0_aw,
+	axi_write_channel.slave s_axi_0_w,
+	axi_write_response_channel.slave s_axi_0_b,
+
+	axi_write_address_channel.slave s_axi_1_aw,
+	axi_write_channel.slave s_axi_1_w,
+	axi_write_response_channel.slave s_axi_1_b,
+
+	axi_write_address_channel.master m_axi_aw,
+	axi_write_channel.master m_axi_w,
+	axi_write_response_channel.master m_axi_b
+);
+
+// One-hot, zero if no master is granted the channels.
+var logic [1:0] grant;
+// The master that was granted the channels last
+var logic last;
+
+wire logic b_hshake = m_axi_b.bvalid && m_axi_b.bready;
+
+always_ff @(posedge clock) begin
+	if (!reset_n) begin
+		grant <= '0;
+		last <= 1'b1;
+	end
+	else begin
+		if (grant == '0) begin
+			if (s_axi_0_aw.awvalid && (!s_axi_1_aw.awvalid || last)) begin
+				grant <= 2'b01;
+				last <= 1'b0;
+			end
+			else if (s_axi_1_aw.awvalid) begin
+				grant <= 2'b10;
+				last <= 1'b1;
+			end
+		end
+		else if (b_hshake) begin
+			grant <= '0;
+		end
+	end
+end
+
+assign m_axi_aw.awid = grant[1] ? s_axi_1_aw.awid : s_axi_0_aw.awid;
+assign m_axi_aw.awaddr = grant[1] ? s_axi_1_aw.awaddr : s_axi_0_aw.awaddr;
+assign m_axi_aw.awlen = grant[1] ? s_axi_1_aw.awlen : s_axi_0_aw.awlen;
+assign m_axi_aw.awsize = grant[1] ? s_axi_1_aw.awsize : s_axi_0_aw.awsize;
+assign m_axi_aw.awburst = grant[1] ? s_axi_1_aw.awburst : s_axi_0_aw.awburst;
+assign m_axi_aw.awlock = grant[1] ? s_axi_1_aw.awlock : s_axi_0_aw.awlock;
+assign m_axi_aw.awcache = grant[1] ? s_axi_1_aw.awcache : s_axi_0_aw.awcache;
+assign m_axi_aw.awprot = grant[1] ? s_axi_1_aw.awprot : s_axi_0_aw.awprot;
+assign m_axi_aw.awqos = grant[1] ? s_axi_1_aw.awqos : s_axi_0_aw.awqos;
+assign m_axi_aw.awregion = grant[1] ? s_axi_1_aw.awregion : s_axi_0_aw.awregion;
+assign m_axi_aw.awuser = grant[1] ? s_axi_1_aw.awuser : s_axi_0_aw.awuser;
+assign m_axi_aw.awvalid = grant[0] && s_axi_0_aw.awvalid || grant[1] && s_axi_1_aw.awvalid;
+assign s_axi_0_aw.awready = grant[0] && m_axi_aw.awready;
+assign s_axi_1_aw.awready = grant[1] && m_axi_aw.awready;
+
+assign m_axi_w.wdata = grant[1] ? s_axi_1_w.wdata : s_axi_0_w.wdata;
+assign m_axi_w.wstrb = grant[1] ? s_axi_1_w.wstrb : s_axi_0_w.wstrb;
+assign m_axi_w.wlast = grant[1] ? s_axi_1_w.wlast : s_axi_0_w.wlast;
+assign m_axi_w.wuser = grant[1] ? s_axi_1_w.wuser : s_axi_0_w.wuser;
+assign m_axi_w.wvalid = grant[0] && s_axi_0_w.wvalid || grant[1] && s_axi_1_w.wvalid;
+assign s_axi_0_w.wready = grant[0] && m_axi_w.wready;
+assign s_axi_1_w.wready = grant[1] && m_axi_w.wready;
+
+assign s_axi_0_b.bid = m_axi_b.bid;
+assign s_axi_0_b.bresp = m_axi_b.bresp;
+assign s_axi_0_b.buser = m_axi_b.buser;
+assign s_axi_0_b.bvalid = grant[0] && m_axi_b.bvalid;
+assign s_axi_1_b.bid = m_axi_b.bid;
+assign s_axi_1_b.bresp = m_axi_b.bresp;
+assign s_axi_1_b.buser = m_axi_b.buser;
+assign s_axi_1_b.bvalid = grant[1] && m_axi_b.bvalid;
+assign m_axi_b.bready = grant[0] && s_axi_0_b.bready || grant[1] && s_axi_1_b.bready;
+
+endmodule
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AXI4 window onto the instruction and data BRAMs
+ *
+ * The host can load the firmware with burst writes instead of poking
+ * each word through REGOFF_BRAM_ADDR and REGOFF_BRAM_DATA.
+ * The IBRAM starts at offset 0, the DBRAM at offset IBRAM_SIZE.
+ *
+ * Bursts are taken as INCR bursts of 32-bit beats.
+ * Writes are accepted at one beat per cycle. Reads take three cycles
+ * per beat; they are only meant for verifying the firmware.
+ */
+module bram_axi
+#(
+	parameter int IBRAM_SIZE,
+	parameter int DBRAM_SIZE
+)
+(
+	input wire logic clock,
+	input wire logic resetn,
+
+	// AXI
+	axi_write_address_channel.slave axi_aw,
+	axi_write_channel.slave axi_w,
+	axi_write_response_channel.slave axi_b,
+	axi_read_address_channel.slave axi_ar,
+	axi_read_channel.slave axi_r,
+
+	local_memory_interface.master instruction_bram_axi,
+	local_memory_interface.master data_bram_axi
+);
+
+localparam int BRAM_SIZE = IBRAM_SIZE + DBRAM_SIZE;
+localparam int BRAM_ADDR_WIDTH = $clog2(BRAM_SIZE) - 2;
+localparam int IBRAM_SEL_BITN = $clog2(IBRAM_SIZE) - 2;
+
+// Little helpers
+wire logic aw_hshake = axi_aw.awvalid && axi_aw.awready;
+wire logic w_hshake = axi_w.wvalid && axi_w.wready;
+wire logic b_hshake = axi_b.bvalid && axi_b.bready;
+wire logic ar_hshake = axi_ar.arvalid && axi_ar.arready;
+wire logic r_hshake = axi_r.rvalid && axi_r.rready;
+
+typedef enum {
+	STATE_IDLE,
+	STATE_WRITE,
+	STATE_WRITE_RESP,
+	STATE_READ,
+	STATE_READ_WAIT,
+	STATE_READ_DATA
+} state_t;
+
+state_t state;
+
+// The word address of the next beat
+var logic [BRAM_ADDR_WIDTH-1:0] addr;
+// The word address of the BRAM access
+var logic [BRAM_ADDR_WIDTH-1:0] bram_addr;
+var logic [7:0] nbeats_left;
+var logic read_dbram;
+
+assign instruction_bram_axi.addr = 30'(bram_addr);
+assign data_bram_axi.addr = 30'(bram_addr);
+
+assign axi_b.bresp = 2'b00;
+assign axi_r.rresp = 2'b00;
+assign axi_r.rlast = nbeats_left == '0;
+assign axi_r.rdata = read_dbram ? data_bram_axi.data_out : instruction_bram_axi.data_out;
+
+// Writes have priority over reads.
+assign axi_aw.awready = state == STATE_IDLE;
+assign axi_ar.arready = state == STATE_IDLE && !axi_aw.awvalid;
+assign axi_w.wready = state == STATE_WRITE;
+
+always_ff @(posedge clock) begin
+	if (!resetn) begin
+		state <= STATE_IDLE;
+		axi_b.bvalid <= 1'b0;
+		axi_r.rvalid <= 1'b0;
+		instruction_bram_axi.en <= 1'b0;
+		data_bram_axi.en <= 1'b0;
+	end
+	else begin
+		// Unpulse
+		instruction_bram_axi.en <= 1'b0;
+		data_bram_axi.en <= 1'b0;
+
+		case (state)
+		STATE_IDLE: begin
+			if (aw_hshake) begin
+				addr <= axi_aw.awaddr[2 +: BRAM_ADDR_WIDTH];
+				axi_b.bid <= axi_aw.awid;
+				state <= STATE_WRITE;
+			end
+			else if (ar_hshake) begin
+				addr <= axi_ar.araddr[2 +: BRAM_ADDR_WIDTH];
+				nbeats_left <= axi_ar.arlen;
+				axi_r.rid <= axi_ar.arid;
+				state <= STATE_READ;
+			end
+		end
+		STATE_WRITE: begin
+			if (w_hshake) begin
+				bram_addr <= addr;
+				addr <= addr + 1;
+				if (~addr[IBRAM_SEL_BITN]) begin
+					instruction_bram_axi.en <= 1'b1;
+				end
+				else begin
+					data_bram_axi.en <= 1'b1;
+				end
+				instruction_bram_axi.be <= axi_w.wstrb;
+				data_bram_axi.be <= axi_w.wstrb;
+				instruction_bram_axi.data_in <= axi_w.wdata;
+				data_bram_axi.data_in <= axi_w.wdata;
+				if (axi_w.wlast) begin
+					axi_b.bvalid <= 1'b1;
+					state <= STATE_WRITE_RESP;
+				end
+			end
+		end
+		STATE_WRITE_RESP: begin
+			if (b_hshake) begin
+				axi_b.bvalid <= 1'b0;
+				state <= STATE_IDLE;
+			end
+		end
+		STATE_READ: begin
+			bram_addr <= addr;
+			addr <= addr + 1;
+			instruction_bram_axi.en <= 1'b1;
+			data_bram_axi.en <= 1'b1;
+			instruction_bram_axi.be <= '0;
+			data_bram_axi.be <= '0;
+			read_dbram <= addr[IBRAM_SEL_BITN];
+			state <= STATE_READ_WAIT;
+		end
+		STATE_READ_WAIT: begin
+			// The BRAMs have a read latency of one cycle.
+			axi_r.rvalid <= 1'b1;
+			state <= STATE_READ_DATA;
+		end
+		STATE_READ_DATA: begin
+			if (r_hshake) begin
+				axi_r.rvalid <= 1'b0;
+				nbeats_left <= nbeats_left - 1;
+				state <= axi_r.rlast ? STATE_IDLE : STATE_READ;
+			end
+		end
+		endcase
+	end
+end
+
+endmodule
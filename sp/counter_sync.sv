@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A free-running event counter in one clock domain (e.g. the GEM RX or
+ * TX clock domain) that is read in another one (the PL clock domain).
+ *
+ * The counter increments by at most one per 'src_clk' cycle, so its Gray
+ * code changes in a single bit at a time and can be synchronized
+ * bit by bit. The value read lags behind by a few cycles.
+ */
+module counter_sync #(
+	parameter int WIDTH = 32
+)
+(
+	input wire logic src_clk,
+	input wire logic src_resetn,
+	input wire logic inc,
+
+	input wire logic dst_clk,
+	output var logic [WIDTH-1:0] count
+);
+
+/*
+ * --------  --------  --------  --------
+ * Source Clock Domain
+ * --------  --------  --------  --------
+ */
+var logic [WIDTH-1:0] count_src = '0;
+var logic [WIDTH-1:0] gray_src = '0;
+
+always_ff @(posedge src_clk) begin
+	if (!src_resetn) begin
+		count_src <= '0;
+		gray_src <= '0;
+	end
+	else begin
+		if (inc) begin
+			count_src <= count_src + 1;
+		end
+		gray_src <= count_src ^ (count_src >> 1);
+	end
+end
+
+/*
+ * --------  --------  --------  --------
+ * Destination Clock Domain
+ * --------  --------  --------  --------
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0][WIDTH-1:0] gray_sync = '0;
+var logic [WIDTH-1:0] count_comb;
+
+always_comb begin
+	count_comb[WIDTH-1] = gray_sync[1][WIDTH-1];
+	for (int i = WIDTH-2; i >= 0; i--) begin
+		count_comb[i] = count_comb[i+1] ^ gray_sync[1][i];
+	end
+end
+
+always_ff @(posedge dst_clk) begin
+	gray_sync <= { gray_sync[0], gray_src };
+	count <= count_comb;
+end
+
+endmodule
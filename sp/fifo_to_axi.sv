@@ -36,9 +36,16 @@ module fifo_to_axi
 );
 
 localparam int AXI_DATA_WIDTH = axi_w.AXI_WDATA_WIDTH;
-localparam int MAX_NBYTES_PER_BURST = 256 * (AXI_DATA_WIDTH / 8);
 localparam int LEN_WIDTH = 16;
 localparam int ALIGN_WIDTH = $clog2(AXI_DATA_WIDTH / 8);
+// Wide enough for the beats of a transfer with an unaligned address
+localparam int BEATS_WIDTH = LEN_WIDTH - ALIGN_WIDTH + 2;
+// Bursts have at most 256 beats, except for transfers to an ACP port
+// (see below), and do not cross a 4 KB boundary.
+localparam int MAX_BURST_BEATS = 256;
+localparam int PAGE_BEATS = 4096 / (AXI_DATA_WIDTH / 8);
+// The beats per 64-byte cache line
+localparam int ACP_LINE_BEATS = AXI_DATA_WIDTH <= 512 ? 512 / AXI_DATA_WIDTH : 1;
 
 assign axi_aw.awid = '0;
 // Size should be AXI_DATA_WIDTH, in 2^AWSIZE bytes, otherwise narrow bursts are
@@ -48,13 +55,9 @@ assign axi_aw.awsize = AWSIZE[2:0];
 // INCR burst type
 assign axi_aw.awburst = 2'b01;
 assign axi_aw.awlock = 0;
-// Not used anymore.
-// Was: 
-// Not Allocated, Modifiable, not Bufferable.
-// assign axi_aw.awcache = 4'b0010;
+// AWCACHE and AWUSER are taken from each transfer (see below).
 assign axi_aw.awprot = 3'h0;
 assign axi_aw.awqos = 4'h0;
-assign axi_aw.awuser = 1;
 assign axi_w.wuser = 0;
 
 // ------- ------- ------- ------- ------- ------- ------- -------
@@ -70,20 +73,81 @@ wire logic w_hshake_last = w_hshake && axi_w.wlast;
 wire logic w_hshake_not_last = w_hshake && !axi_w.wlast;
 wire logic b_hshake = axi_b.bvalid && axi_b.bready;
 
-assign fifo_r.rd_en = write_burst_start || w_hshake_not_last;
+// The FIFO is read on each beat until all words of the transfer are read.
+// With an unaligned destination address, there may be one more beat
+// than there are FIFO words.
+wire logic w_beat = write_burst_start || w_hshake_not_last;
+assign fifo_r.rd_en = w_beat && src_words_left != '0;
+
+// ------- ------- ------- ------- ------- ------- ------- -------
+//
+// Realignment
+//
+// ------- ------- ------- ------- ------- ------- ------- -------
+// The destination address does not need to be aligned. The bursts start
+// at the aligned address and the data is shifted up by 'dest_offset'
+// bytes. The lower bytes of a beat are taken from the upper bytes of the
+// previous FIFO word.
+// The bytes before the destination address (in the first beat) and after
+// its end (in the last beat) are masked out with WSTRB.
+localparam int NBYTES = AXI_DATA_WIDTH / 8;
+
+var logic [AXI_DATA_WIDTH-1:0] carry_ff;
+var logic [ALIGN_WIDTH-1:0] dest_offset;
+var logic first_beat;
+var logic [LEN_WIDTH-ALIGN_WIDTH:0] src_words_left;
+
+wire logic [AXI_DATA_WIDTH-1:0] realigned_rd_data =
+	AXI_DATA_WIDTH'({ fifo_r.rd_data, carry_ff } >> (AXI_DATA_WIDTH - { dest_offset, 3'b000 }));
+// Only the first beat of the whole transfer starts at the destination address.
+wire logic [NBYTES-1:0] first_beat_wstrb = first_beat ? ({NBYTES{1'b1}} << dest_offset) : '1;
+
+always_ff @(posedge clock) begin
+	if (!reset_n) begin
+		first_beat <= 1'b0;
+	end
+	else begin
+		if (mem_w.busy == 1'b0 && mem_w.start) begin
+			first_beat <= 1'b1;
+			// Round up to whole FIFO words.
+			src_words_left <= (LEN_WIDTH-ALIGN_WIDTH+1)'((17'(mem_w.len) + NBYTES - 1) >> ALIGN_WIDTH);
+		end
+		if (w_beat) begin
+			first_beat <= 1'b0;
+		end
+		if (fifo_r.rd_en) begin
+			carry_ff <= fifo_r.rd_data;
+			src_words_left <= src_words_left - 1;
+		end
+	end
+end
 
 var logic [7:0] axi_aw_awlen_comb;
+// The beats of the next burst
+var logic [BEATS_WIDTH-1:0] burst_beats_comb;
+// The next burst ends the transfer.
+wire logic last_burst_comb = burst_beats_comb == beats_left;
+wire logic [BEATS_WIDTH-1:0] page_beats_left =
+	BEATS_WIDTH'(PAGE_BEATS) - BEATS_WIDTH'(dest_addr[11:ALIGN_WIDTH]);
+
 always_comb begin
-	if (full_bursts_left != '0) begin
-		axi_aw_awlen_comb = 255;
+	burst_beats_comb = beats_left;
+	if (burst_beats_comb > page_beats_left)
+		burst_beats_comb = page_beats_left;
+	if (!acp) begin
+		if (burst_beats_comb > BEATS_WIDTH'(MAX_BURST_BEATS))
+			burst_beats_comb = BEATS_WIDTH'(MAX_BURST_BEATS);
+	end
+	// A full line needs all bytes enabled, so the last beat of the
+	// transfer must not be partial.
+	else if (acp_lines && (beats_left > BEATS_WIDTH'(ACP_LINE_BEATS) ||
+			(beats_left == BEATS_WIDTH'(ACP_LINE_BEATS) && extra_bytes == '0))) begin
+		burst_beats_comb = BEATS_WIDTH'(ACP_LINE_BEATS);
 	end
 	else begin
-		// See the comment in axi_to_fifo.sv for an explanation.
-		if (extra_bytes != '0)
-			axi_aw_awlen_comb = beats_left;
-		else
-			axi_aw_awlen_comb = beats_left - 1;
+		burst_beats_comb = BEATS_WIDTH'(1);
 	end
+	axi_aw_awlen_comb = 8'(burst_beats_comb - 1);
 end
 
 always_ff @(posedge clock) begin
@@ -166,22 +230,26 @@ always_ff @(posedge clock) begin
 	else begin
 		if (write_burst_start) begin
 			axi_w.wvalid <= 1'b1;
-			axi_w.wdata <= fifo_r.rd_data;
+			axi_w.wdata <= realigned_rd_data;
 			if (axi_aw_awlen_comb == '0) begin
 				axi_w.wlast <= 1'b1;
-				axi_w.wstrb <= axi_w_wstrb_comb;
+				// Single-beat bursts are not always the last one (see acp).
+				if (last_burst_comb)
+					axi_w.wstrb <= axi_w_wstrb_comb & first_beat_wstrb;
+				else
+					axi_w.wstrb <= first_beat_wstrb;
 			end
 			else begin
 				axi_w.wlast <= 1'b0;
-				axi_w.wstrb <= '1;
+				axi_w.wstrb <= first_beat_wstrb;
 			end
 		end
 		else if (w_hshake_not_last) begin
 			axi_w.wvalid <= 1'b1;
-			axi_w.wdata <= fifo_r.rd_data;
+			axi_w.wdata <= realigned_rd_data;
 			if (w_hshake_count_comb == axi_aw.awlen) begin
 				axi_w.wlast <= 1'b1;
-				if (full_bursts_left == '0)
+				if (last_burst_comb)
 					axi_w.wstrb <= axi_w_wstrb_comb;
 				else
 					axi_w.wstrb <= '1;
@@ -268,10 +336,22 @@ end
 // ------- ------- ------- ------- ------- ------- ------- -------
 // Writing initiation pulse
 var logic write_burst_start;
-var logic [(LEN_WIDTH-8-ALIGN_WIDTH)-1:0] full_bursts_left;
-var logic [7:0] beats_left;
+// The bursts cover the bytes from the aligned destination address on,
+// so there may be one more beat than for an aligned destination address.
+localparam int SPAN_WIDTH = LEN_WIDTH + 1;
+// The beats left in the transfer, including a partial last beat
+var logic [BEATS_WIDTH-1:0] beats_left;
 var logic [ALIGN_WIDTH-1:0] extra_bytes;
 var logic [AXI_ADDR_WIDTH-1:0] dest_addr;
+// An ACP port only takes whole cache lines (with all bytes enabled)
+// and single beats. So a transfer to an ACP port that starts on a
+// cache line is written in full-line bursts first (acp_lines) and
+// the rest in single beats. Other transfers use single beats only.
+var logic acp;
+var logic acp_lines;
+
+wire logic [SPAN_WIDTH-1:0] mem_w_span = SPAN_WIDTH'(mem_w.len) + SPAN_WIDTH'(mem_w.addr[ALIGN_WIDTH-1:0]);
+wire logic acp_line_aligned = mem_w.addr[5:0] == '0 && mem_w_span >= SPAN_WIDTH'(64);
 
 always_ff @(posedge clock) begin
 	if (!reset_n) begin
@@ -293,10 +373,15 @@ always_ff @(posedge clock) begin
 				mem_w.done <= 1'b1;
 			end
 			else begin
-				dest_addr <= mem_w.addr;
-				full_bursts_left <= mem_w.len[LEN_WIDTH-1:8+ALIGN_WIDTH];
-				beats_left <= mem_w.len[8+ALIGN_WIDTH-1:ALIGN_WIDTH];
-				extra_bytes <= mem_w.len[ALIGN_WIDTH-1:0];
+				dest_addr <= { mem_w.addr[AXI_ADDR_WIDTH-1:ALIGN_WIDTH], {ALIGN_WIDTH{1'b0}} };
+				dest_offset <= mem_w.addr[ALIGN_WIDTH-1:0];
+				acp <= mem_w.acp;
+				acp_lines <= acp_line_aligned;
+				// Round up to whole beats.
+				beats_left <= BEATS_WIDTH'((mem_w_span + SPAN_WIDTH'(NBYTES - 1)) >> ALIGN_WIDTH);
+				extra_bytes <= mem_w_span[ALIGN_WIDTH-1:0];
+				axi_aw.awcache <= mem_w.cache;
+				axi_aw.awuser <= $bits(axi_aw.awuser)'(mem_w.user);
 				mem_w.busy <= 1'b1;
 				write_burst_start <= 1'b1;
 			end
@@ -305,11 +390,9 @@ always_ff @(posedge clock) begin
 		if (mem_w.busy == 1'b1 && write_burst_done) begin
 			$display("write_burst_done pulse");
 
-			if (full_bursts_left > 1 ||
-				(full_bursts_left == 1 && |{beats_left,extra_bytes}))
-			begin
-				dest_addr <= dest_addr + MAX_NBYTES_PER_BURST[AXI_ADDR_WIDTH-1:0];
-				full_bursts_left <= full_bursts_left - 1;
+			if (!last_burst_comb) begin
+				dest_addr <= dest_addr + (AXI_ADDR_WIDTH'(burst_beats_comb) << ALIGN_WIDTH);
+				beats_left <= beats_left - burst_beats_comb;
 				write_burst_start <= 1'b1;
 			end
 			else begin
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TX-to-RX loopback
+ *
+ * While 'loopback' is set, this module plays the part of the GEM for
+ * both the TX and the RX SP: it reads the frames of the TX SP byte by
+ * byte (like the GEM's TX FIFO interface does) and writes them into the
+ * RX SP (like the GEM's RX FIFO interface does). The bytes cross from
+ * the GEM TX into the GEM RX clock domain through a small FIFO.
+ *
+ * On the RX side, frames are separated by the number of cycles the
+ * preamble and the inter-frame gap take on the wire, so with both GEM
+ * clocks running at the line rate, the loopback runs at the line rate
+ * as well. The TX side stops reading when the FIFO fills up.
+ * A frame that underflows on the TX side is passed on with rx_w_err set.
+ *
+ * 'loopback' must only change while no frames are in flight.
+ */
+module gem_loopback
+(
+	// Asynchronous to both GEM clocks
+	input wire logic loopback,
+
+	// GEM TX clock domain
+	input wire logic tx_clock,
+	input wire logic tx_resetn,
+	output wire logic tx_loopback,
+	input wire logic tx_r_data_rdy,
+	output wire logic tx_r_rd,
+	input wire logic tx_r_valid,
+	input wire logic [7:0] tx_r_data,
+	input wire logic tx_r_sop,
+	input wire logic tx_r_eop,
+	input wire logic tx_r_underflow,
+
+	// GEM RX clock domain
+	input wire logic rx_clock,
+	input wire logic rx_resetn,
+	output wire logic rx_loopback,
+	output var logic rx_w_wr,
+	output var logic [7:0] rx_w_data,
+	output var logic rx_w_sop,
+	output var logic rx_w_eop,
+	output var logic rx_w_err
+);
+
+// { underflow, eop, sop, data }
+localparam int LOOPBACK_FIFO_WIDTH = 1 + 1 + 1 + 8;
+localparam int LOOPBACK_FIFO_DEPTH = 512;
+// Preamble, SFD and inter-frame gap in bytes
+localparam int IFG_NCYCLES = 8 + 12;
+
+/*
+ * --------  --------  --------  --------
+ * GEM TX Clock Domain
+ * --------  --------  --------  --------
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0] tx_loopback_sync;
+var logic tx_in_frame;
+wire logic loopback_fifo_prog_full;
+
+assign tx_loopback = tx_loopback_sync[1];
+// The answer to a read comes a cycle later, so one more read than
+// necessary is issued at the end of a frame. The TX SP ignores it.
+assign tx_r_rd = tx_loopback & (tx_r_data_rdy | tx_in_frame) & ~loopback_fifo_prog_full;
+
+always_ff @(posedge tx_clock) begin
+	tx_loopback_sync <= { tx_loopback_sync[0], loopback };
+
+	if (!tx_resetn) begin
+		tx_in_frame <= 1'b0;
+	end
+	else begin
+		if (tx_r_rd & tx_r_data_rdy) begin
+			tx_in_frame <= 1'b1;
+		end
+		if (tx_r_valid & (tx_r_eop | tx_r_underflow)) begin
+			tx_in_frame <= 1'b0;
+		end
+	end
+end
+
+/*
+ * --------  --------  --------  --------
+ * GEM RX Clock Domain
+ * --------  --------  --------  --------
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0] rx_loopback_sync;
+var logic [$clog2(IFG_NCYCLES+1)-1:0] rx_ifg_countdown;
+wire logic [LOOPBACK_FIFO_WIDTH-1:0] loopback_fifo_dout;
+wire logic loopback_fifo_empty;
+wire logic loopback_fifo_rd_en = rx_loopback & ~loopback_fifo_empty & rx_ifg_countdown == '0;
+
+assign rx_loopback = rx_loopback_sync[1];
+
+always_ff @(posedge rx_clock) begin
+	rx_loopback_sync <= { rx_loopback_sync[0], loopback };
+
+	if (!rx_resetn) begin
+		rx_ifg_countdown <= '0;
+		rx_w_wr <= 1'b0;
+		rx_w_sop <= 1'b0;
+		rx_w_eop <= 1'b0;
+		rx_w_err <= 1'b0;
+	end
+	else begin
+		// Unpulse
+		rx_w_wr <= 1'b0;
+		rx_w_sop <= 1'b0;
+		rx_w_eop <= 1'b0;
+		rx_w_err <= 1'b0;
+
+		if (rx_ifg_countdown != '0) begin
+			rx_ifg_countdown <= rx_ifg_countdown - 1;
+		end
+
+		if (loopback_fifo_rd_en) begin
+			rx_w_wr <= 1'b1;
+			rx_w_data <= loopback_fifo_dout[7:0];
+			rx_w_sop <= loopback_fifo_dout[8];
+			rx_w_eop <= loopback_fifo_dout[9] | loopback_fifo_dout[10];
+			rx_w_err <= loopback_fifo_dout[10];
+			if (loopback_fifo_dout[9] | loopback_fifo_dout[10]) begin
+				rx_ifg_countdown <= IFG_NCYCLES;
+			end
+		end
+	end
+end
+
+/*
+ * --------  --------  --------  --------
+ * Clock Domain Crossing
+ * --------  --------  --------  --------
+ */
+`ifdef VERILATOR
+`else
+xpm_fifo_async #(
+	.CDC_SYNC_STAGES(2),
+	.DOUT_RESET_VALUE("0"),
+	.ECC_MODE("no_ecc"),
+	.FIFO_MEMORY_TYPE("auto"),
+	.FIFO_READ_LATENCY(0),
+	.FIFO_WRITE_DEPTH(LOOPBACK_FIFO_DEPTH),
+	.FULL_RESET_VALUE(0),
+	.PROG_EMPTY_THRESH(10),
+	// Leaves room for the answers to reads in flight
+	.PROG_FULL_THRESH(LOOPBACK_FIFO_DEPTH - 16),
+	// GEM RX clock domain
+	.RD_DATA_COUNT_WIDTH(1),
+	.READ_DATA_WIDTH(LOOPBACK_FIFO_WIDTH),
+	.READ_MODE("fwft"),
+	.RELATED_CLOCKS(0),
+	.SIM_ASSERT_CHK(0),
+	.USE_ADV_FEATURES("0707"),
+	.WAKEUP_TIME(0),
+	.WRITE_DATA_WIDTH(LOOPBACK_FIFO_WIDTH),
+	// GEM TX clock domain
+	.WR_DATA_COUNT_WIDTH(1)
+) loopback_fifo (
+	// reset is synchronized to wr_clk!
+	.rst(~tx_resetn),
+
+	.wr_clk(tx_clock),
+	.wr_en(tx_loopback & tx_r_valid),
+	.din({ tx_r_underflow, tx_r_eop, tx_r_sop, tx_r_data }),
+	.prog_full(loopback_fifo_prog_full),
+
+	.rd_clk(rx_clock),
+	.rd_en(loopback_fifo_rd_en),
+	.dout(loopback_fifo_dout),
+	.empty(loopback_fifo_empty)
+);
+`endif
+
+endmodule
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Parses the L2 to L4 headers of a received frame as it passes through
+ * the GEM RX FIFO interface.
+ *
+ * Up to two VLAN tags, IPv4 (with options) and IPv6 (without extension
+ * headers), TCP and UDP are recognized. 'out' is valid from the cycle
+ * after the last header byte on and is kept until the next SOP:
+ *
+ *   7:0   offset of the L3 header
+ *   15:8  offset of the L4 header
+ *   23:16 length of all recognized headers
+ *   24    VLAN tagged
+ *   25    IPv4
+ *   26    IPv6
+ *   27    TCP
+ *   28    UDP
+ *   29    IPv4 fragment (no L4 header is recognized)
+ *   30    The payload starts on a new RX data FIFO word
+ *
+ * Offsets and lengths may point beyond the end of truncated frames.
+ *
+ * If 'align_payload' is set, 'hdr_end' pulses together with 'wr' for the
+ * last header byte of IPv4 TCP frames with a payload so that the writer
+ * can start the payload on a new RX data FIFO word.
+ *
+ * For large receive offload (LRO), consecutive in-order TCP segments of
+ * the same flow are detected. 'lro' is valid at 'eop':
+ *
+ *   0     The frame may be coalesced: IPv4 (no options, not fragmented),
+ *         TCP with ACK and at most PSH set, a payload, payload aligned
+ *   1     The frame continues the last frame that could be coalesced
+ *         (same addresses, ports and header length, next sequence number)
+ *   15:8  TCP flags
+ *   31:16 TCP payload length
+ *
+ * The tracker state is only updated for frames with 'eop_ok' set.
+ */
+module gem_rx_hdr_parser
+(
+	input wire logic clk,
+	input wire logic resetn,
+	input wire logic sop,
+	input wire logic wr,
+	input wire logic [7:0] data,
+	input wire logic eop,
+	input wire logic eop_ok,
+	input wire logic align_payload,
+	output wire logic [31:0] out,
+	output wire logic hdr_end,
+	output wire logic [31:0] lro,
+	output wire logic [31:0] tcp_ack,
+	output wire logic [31:0] tcp_win
+);
+
+localparam logic [15:0] ETHERTYPE_VLAN = 16'h8100;
+localparam logic [15:0] ETHERTYPE_QINQ = 16'h88a8;
+localparam logic [15:0] ETHERTYPE_IPV4 = 16'h0800;
+localparam logic [15:0] ETHERTYPE_IPV6 = 16'h86dd;
+localparam logic [7:0] IPPROTO_TCP = 8'd6;
+localparam logic [7:0] IPPROTO_UDP = 8'd17;
+localparam logic [7:0] TCP_FLAG_PSH = 8'h08;
+localparam logic [7:0] TCP_FLAG_ACK = 8'h10;
+
+// The index of the current byte within the frame.
+// It saturates because we are only interested in the first bytes.
+var logic [7:0] idx_ff;
+wire logic [7:0] idx = sop ? '0 : idx_ff;
+
+var logic [7:0] ethertype_hi;
+var logic [7:0] l3_off;
+var logic [7:0] l4_off;
+var logic [7:0] hdr_len;
+var logic [7:0] proto;
+var logic [1:0] nvlans;
+var logic ipv4;
+var logic ipv6;
+var logic tcp;
+var logic udp;
+var logic ipv4_frag;
+var logic payload_aligned;
+
+// Fields for LRO
+var logic [15:0] ip_len;
+var logic [63:0] ip_addrs;
+var logic [31:0] tcp_ports;
+var logic [31:0] tcp_seq;
+var logic [31:0] tcp_ack_ff;
+var logic [7:0] tcp_flags;
+var logic [15:0] tcp_win_ff;
+
+// Offsets relative to the L3 and L4 headers.
+// l4_off is not final before the first byte of the L3 header, so
+// the shift registers below may capture garbage first. They are
+// overwritten completely by the correct bytes later on.
+wire logic [7:0] l3_idx = idx - l3_off;
+wire logic [7:0] l4_idx = idx - l4_off;
+
+wire logic [15:0] payload_len = 16'(l3_off) + ip_len - 16'(hdr_len);
+
+assign hdr_end = align_payload & wr & ipv4 & ~ipv4_frag & tcp &
+	payload_len != '0 & idx == hdr_len - 1;
+
+always_ff @(posedge clk) begin
+	if (!resetn) begin
+		idx_ff <= '0;
+	end
+	else begin
+		if (sop) begin
+			idx_ff <= '0;
+			l3_off <= 8'd14;
+			l4_off <= 8'd14;
+			hdr_len <= 8'd14;
+			nvlans <= '0;
+			ipv4 <= 1'b0;
+			ipv6 <= 1'b0;
+			tcp <= 1'b0;
+			udp <= 1'b0;
+			ipv4_frag <= 1'b0;
+			payload_aligned <= 1'b0;
+		end
+		if (hdr_end) begin
+			payload_aligned <= 1'b1;
+		end
+		if (wr) begin
+			if (idx != 8'hff) begin
+				idx_ff <= idx + 1;
+			end
+
+			// L2
+			if (idx == l3_off - 2) begin
+				ethertype_hi <= data;
+			end
+			if (idx == l3_off - 1) begin
+				case ({ ethertype_hi, data })
+				ETHERTYPE_VLAN, ETHERTYPE_QINQ: begin
+					if (nvlans != 2'd2) begin
+						nvlans <= nvlans + 1;
+						l3_off <= l3_off + 4;
+						l4_off <= l3_off + 4;
+						hdr_len <= l3_off + 4;
+					end
+				end
+				ETHERTYPE_IPV4: begin
+					ipv4 <= 1'b1;
+				end
+				ETHERTYPE_IPV6: begin
+					ipv6 <= 1'b1;
+					l4_off <= l3_off + 40;
+					hdr_len <= l3_off + 40;
+				end
+				default: begin end
+				endcase
+			end
+
+			// L3
+			if (ipv4) begin
+				if (idx == l3_off) begin
+					l4_off <= l3_off + { data[3:0], 2'b00 };
+					hdr_len <= l3_off + { data[3:0], 2'b00 };
+				end
+				// More fragments flag and fragment offset
+				if (idx == l3_off + 6 && |data[5:0]) begin
+					ipv4_frag <= 1'b1;
+				end
+				if (idx == l3_off + 7 && |data) begin
+					ipv4_frag <= 1'b1;
+				end
+				if (idx == l3_off + 9) begin
+					proto <= data;
+				end
+				if (l3_idx == 8'd2 || l3_idx == 8'd3) begin
+					ip_len <= { ip_len[7:0], data };
+				end
+				if (l3_idx >= 8'd12 && l3_idx < 8'd20) begin
+					ip_addrs <= { ip_addrs[55:0], data };
+				end
+			end
+			if (ipv6) begin
+				if (idx == l3_off + 6) begin
+					proto <= data;
+				end
+			end
+
+			// L4
+			if ((ipv4 & ~ipv4_frag) | ipv6) begin
+				if (idx == l4_off) begin
+					if (proto == IPPROTO_UDP) begin
+						udp <= 1'b1;
+						hdr_len <= l4_off + 8;
+					end
+				end
+				if (idx == l4_off + 12) begin
+					if (proto == IPPROTO_TCP) begin
+						tcp <= 1'b1;
+						hdr_len <= l4_off + { data[7:4], 2'b00 };
+					end
+				end
+				if (l4_idx < 8'd4) begin
+					tcp_ports <= { tcp_ports[23:0], data };
+				end
+				if (l4_idx >= 8'd4 && l4_idx < 8'd8) begin
+					tcp_seq <= { tcp_seq[23:0], data };
+				end
+				if (l4_idx >= 8'd8 && l4_idx < 8'd12) begin
+					tcp_ack_ff <= { tcp_ack_ff[23:0], data };
+				end
+				if (l4_idx == 8'd13) begin
+					tcp_flags <= data;
+				end
+				if (l4_idx == 8'd14 || l4_idx == 8'd15) begin
+					tcp_win_ff <= { tcp_win_ff[7:0], data };
+				end
+			end
+		end
+	end
+end
+
+/*
+ * LRO tracker
+ */
+var logic lro_prev_valid;
+var logic [63:0] lro_prev_ip_addrs;
+var logic [31:0] lro_prev_tcp_ports;
+var logic [31:0] lro_prev_next_seq;
+var logic [7:0] lro_prev_hdr_len;
+
+wire logic lro_ok = ipv4 & ~ipv4_frag & tcp & l4_off == l3_off + 20 &
+	payload_len != '0 & payload_aligned &
+	(tcp_flags & ~(TCP_FLAG_ACK | TCP_FLAG_PSH)) == '0 & (tcp_flags & TCP_FLAG_ACK) != '0;
+wire logic lro_cont = lro_ok & lro_prev_valid &
+	ip_addrs == lro_prev_ip_addrs & tcp_ports == lro_prev_tcp_ports &
+	tcp_seq == lro_prev_next_seq & hdr_len == lro_prev_hdr_len;
+
+always_ff @(posedge clk) begin
+	if (!resetn) begin
+		lro_prev_valid <= 1'b0;
+	end
+	else begin
+		if (eop & eop_ok & lro_ok) begin
+			lro_prev_valid <= 1'b1;
+			lro_prev_ip_addrs <= ip_addrs;
+			lro_prev_tcp_ports <= tcp_ports;
+			lro_prev_next_seq <= tcp_seq + 32'(payload_len);
+			lro_prev_hdr_len <= hdr_len;
+		end
+	end
+end
+
+assign lro = { payload_len, tcp_flags, 6'b000000, lro_cont, lro_ok };
+assign tcp_ack = tcp_ack_ff;
+assign tcp_win = 32'(tcp_win_ff);
+
+assign out = {
+	// 31
+	1'b0,
+	// 30
+	payload_aligned,
+	// 29
+	ipv4_frag,
+	// 28
+	udp,
+	// 27
+	tcp,
+	// 26
+	ipv6,
+	// 25
+	ipv4,
+	// 24
+	nvlans != '0,
+	// 23:16
+	hdr_len,
+	// 15:8
+	l4_off,
+	// 7:0
+	l3_off
+};
+
+endmodule
@@ -15,7 +15,7 @@
  */
 module gem_rx_w_status_encoder(
 	input wire logic [44:0] rx_w_status,
-	input wire logic [12:0] frame_length,
+	input wire logic [13:0] frame_length,
 	output wire logic [31:0] out
 );
 
@@ -152,9 +152,10 @@ assign out = {
 	1'b1,
 	// 14 start of frame
 	1'b1,
-	// 13 fcs status
-	1'b0,
-	// 12:0 frame length
+	// 13:0 frame length
+	//       Bit 13 is the FCS status unless jumbo frames are enabled.
+	//       We never pass the FCS on, so it is always zero for
+	//       frames that are not jumbo frames anyway.
 	frame_length
 };
 
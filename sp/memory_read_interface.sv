@@ -21,6 +21,9 @@ interface memory_read_interface #(
 
 logic [ADDR_WIDTH-1:0] addr;
 logic [LEN_WIDTH-1:0] len;
+// AXI cache and user attributes of the transfer
+logic [3:0] cache;
+logic [1:0] user;
 
 // Asserted to request a new memory transfer.
 logic start;
@@ -38,6 +41,8 @@ logic error;
 modport master (
 	output addr,
 	output len,
+	output cache,
+	output user,
 	output start,
 	output cont,
 	input busy,
@@ -47,6 +52,8 @@ modport master (
 modport slave (
 	input addr,
 	input len,
+	input cache,
+	input user,
 	input start,
 	input cont,
 	output busy,
@@ -21,6 +21,12 @@ interface memory_write_interface #(
 
 logic [ADDR_WIDTH-1:0] addr;
 logic [LEN_WIDTH-1:0] len;
+// AXI cache and user attributes of the transfer
+logic [3:0] cache;
+logic [1:0] user;
+// The transfer goes to an ACP port, which only takes
+// 64-byte (cache line) and 16-byte transactions.
+logic acp;
 
 // Start AXI write.
 logic start;
@@ -35,6 +41,9 @@ logic error;
 modport master (
 	output addr,
 	output len,
+	output cache,
+	output user,
+	output acp,
 	output start,
 	input busy,
 	input done,
@@ -43,6 +52,9 @@ modport master (
 modport slave (
 	input addr,
 	input len,
+	input cache,
+	input user,
+	input acp,
 	input start,
 	output busy,
 	output done,
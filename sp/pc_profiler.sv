@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+import taiga_types::*;
+
+/*
+ * PC-sampling profiler
+ *
+ * Every 'period' clock cycles (at least 2), the PC of the instruction
+ * in the issue stage and the reason why it did or did not issue are
+ * taken from the Taiga trace interface. The sample increments one of
+ * the saturating 32-bit counters of the histogram BRAM:
+ *
+ *   index = { reason, (pc[IBRAM_ADDR_WIDTH+1:2] >> pc_shift) }
+ *
+ * where the PC part has PROF_ADDR_WIDTH-2 bits. Samples whose PC part
+ * does not fit are only counted in 'nsamples'; the host increases
+ * 'pc_shift' to cover a larger IBRAM at a coarser granularity.
+ *
+ * A stall of the SP unit (e.g. a full FIFO or a busy DMA engine) shows
+ * up as a unit stall at the PC of the custom instruction waiting for it.
+ *
+ * The host reads the histogram through port B. It should disable the
+ * profiler first because a read colliding with a counter update returns
+ * undefined data.
+ */
+module pc_profiler #(
+	parameter int IBRAM_SIZE,
+	parameter int PROF_SIZE
+)
+(
+	input wire logic clock,
+	input wire logic resetn,
+
+	input trace_outputs_t tr,
+
+	mmr_prof_interface.master prof
+);
+
+typedef enum logic [1:0] {
+	PROF_REASON_ISSUED,
+	PROF_REASON_OPERAND_STALL,
+	PROF_REASON_UNIT_STALL,
+	// No instruction (fetch bubbles and flushes) and everything else
+	PROF_REASON_OTHER
+} prof_reason_t;
+
+localparam int PROF_ADDR_WIDTH = $clog2(PROF_SIZE / 4);
+localparam int PC_BIN_WIDTH = PROF_ADDR_WIDTH - $bits(prof_reason_t);
+localparam int PC_INDEX_WIDTH = $clog2(IBRAM_SIZE / 4);
+
+var logic [31:0] countdown;
+var logic clearing;
+var logic [PROF_ADDR_WIDTH-1:0] clear_addr;
+// Second (write) cycle of a read-modify-write of a counter
+var logic rmw;
+var logic [PROF_ADDR_WIDTH-1:0] rmw_addr;
+
+var prof_reason_t reason;
+wire logic [PC_INDEX_WIDTH-1:0] pc_index = tr.instruction_pc_dec[2 +: PC_INDEX_WIDTH] >> prof.pc_shift;
+wire logic pc_in_range = (pc_index >> PC_BIN_WIDTH) == '0;
+wire logic [PROF_ADDR_WIDTH-1:0] sample_addr = { reason, pc_index[PC_BIN_WIDTH-1:0] };
+wire logic sample = prof.enable && !clearing && countdown == 0;
+
+var logic bram_en;
+var logic bram_we;
+var logic [PROF_ADDR_WIDTH-1:0] bram_addr;
+var logic [31:0] bram_din;
+wire logic [31:0] bram_dout;
+
+assign prof.clearing = clearing;
+
+always_comb begin
+	if (tr.events.instruction_issued_dec)
+		reason = PROF_REASON_ISSUED;
+	else if (tr.events.operand_stall)
+		reason = PROF_REASON_OPERAND_STALL;
+	else if (tr.events.unit_stall)
+		reason = PROF_REASON_UNIT_STALL;
+	else
+		reason = PROF_REASON_OTHER;
+end
+
+always_comb begin
+	bram_en = 1'b0;
+	bram_we = 1'b0;
+	bram_addr = rmw_addr;
+	bram_din = '0;
+
+	if (clearing) begin
+		bram_en = 1'b1;
+		bram_we = 1'b1;
+		bram_addr = clear_addr;
+	end
+	else if (rmw) begin
+		bram_en = 1'b1;
+		bram_we = 1'b1;
+		bram_din = bram_dout == '1 ? bram_dout : bram_dout + 1;
+	end
+	else if (sample && pc_in_range) begin
+		bram_en = 1'b1;
+		bram_addr = sample_addr;
+	end
+end
+
+always_ff @(posedge clock) begin
+	if (!resetn) begin
+		countdown <= '0;
+		clearing <= 1'b0;
+		clear_addr <= '0;
+		rmw <= 1'b0;
+		prof.nsamples <= '0;
+	end
+	else begin
+		rmw <= 1'b0;
+
+		if (!prof.enable || countdown == 0)
+			countdown <= prof.period < 2 ? 1 : prof.period - 1;
+		else
+			countdown <= countdown - 1;
+
+		if (prof.clear) begin
+			clearing <= 1'b1;
+			clear_addr <= '0;
+			prof.nsamples <= '0;
+		end
+		else if (clearing) begin
+			clear_addr <= clear_addr + 1;
+			if (clear_addr == '1)
+				clearing <= 1'b0;
+		end
+		else if (sample) begin
+			prof.nsamples <= prof.nsamples + 1;
+			if (pc_in_range) begin
+				rmw <= 1'b1;
+				rmw_addr <= sample_addr;
+			end
+		end
+	end
+end
+
+xpm_memory_tdpram #(
+	.ADDR_WIDTH_A(PROF_ADDR_WIDTH),
+	.ADDR_WIDTH_B(PROF_ADDR_WIDTH),
+	.AUTO_SLEEP_TIME(0),
+	.BYTE_WRITE_WIDTH_A(32),
+	.BYTE_WRITE_WIDTH_B(32),
+	.CASCADE_HEIGHT(0),
+	.CLOCKING_MODE("common_clock"),
+	.ECC_MODE("no_ecc"),
+	.MEMORY_INIT_FILE("none"),
+	.MEMORY_INIT_PARAM("0"),
+	.MEMORY_OPTIMIZATION("true"),
+	.MEMORY_PRIMITIVE("block"),
+	.MEMORY_SIZE(PROF_SIZE*8),
+	.MESSAGE_CONTROL(0),
+	.READ_DATA_WIDTH_A(32),
+	.READ_DATA_WIDTH_B(32),
+	.READ_LATENCY_A(1),
+	.READ_LATENCY_B(1),
+	.READ_RESET_VALUE_A("0"),
+	.READ_RESET_VALUE_B("0"),
+	.RST_MODE_A("SYNC"),
+	.RST_MODE_B("SYNC"),
+	.SIM_ASSERT_CHK(0),
+	.USE_EMBEDDED_CONSTRAINT(0),
+	.USE_MEM_INIT(0),
+	.WAKEUP_TIME("disable_sleep"),
+	.WRITE_DATA_WIDTH_A(32),
+	.WRITE_DATA_WIDTH_B(32),
+	.WRITE_MODE_A("no_change"),
+	.WRITE_MODE_B("no_change")
+)
+xpm_memory_tdpram_prof (
+	.clka(clock),
+	.rsta(~resetn),
+	.rstb(~resetn),
+	.douta(bram_dout),
+	.doutb(prof.data),
+	.addra(bram_addr),
+	.addrb(prof.addr[PROF_ADDR_WIDTH-1:0]),
+	.dina(bram_din),
+	.dinb('0),
+	.ena(bram_en),
+	.enb(1'b1),
+	.wea(bram_we),
+	.web(1'b0)
+);
+
+endmodule
@@ -20,10 +20,12 @@ import sp_unit_config::*;
 module prism_sp_duo_tx_top #(
 	parameter int IBRAM_SIZE = 2**15,
 	parameter int DBRAM_SIZE = 2**15,
-	parameter int ACPBRAM_SIZE = 2*64*8,
+	parameter int ACPBRAM_SIZE = 4*64*8,
 
 	parameter int TX_DATA_FIFO_SIZE,
-	parameter int TX_DATA_FIFO_WIDTH
+	parameter int TX_DATA_FIFO_WIDTH,
+
+	parameter logic [31:0] GEM_BASE = 32'hff0e0000
 )
 (
 	input wire clock,
@@ -38,6 +40,12 @@ module prism_sp_duo_tx_top #(
 	axi_lite_read_address_channel.slave s_axil_ar,
 	axi_lite_read_channel.slave s_axil_r,
 
+	axi_write_address_channel.slave s_axi_bram_aw,
+	axi_write_channel.slave s_axi_bram_w,
+	axi_write_response_channel.slave s_axi_bram_b,
+	axi_read_address_channel.slave s_axi_bram_ar,
+	axi_read_channel.slave s_axi_bram_r,
+
 	axi_interface.master m_axi_io,
 
 	axi_write_address_channel.master m_axi_acp_aw,
@@ -49,7 +57,11 @@ module prism_sp_duo_tx_top #(
 	axi_read_address_channel.master m_axi_dma_ar,
 	axi_read_channel.master m_axi_dma_r,
 
-	gem_tx_interface.master gem_tx
+	gem_tx_interface.master gem_tx,
+	output wire loopback,
+	// The STATUS registers of this SP and of the other SP of the pair
+	output wire logic [31:0] status,
+	input wire logic [31:0] peer_status
 );
 
 wire logic queue_0_txdone;
@@ -63,8 +75,6 @@ assign gem_irq_tx = queue_0_txdone | queue_1_txdone;
 
 gem_rx_interface dummy_gem_rx();
 
-wire logic [3:0] dma_axi_axcache;
-assign m_axi_dma_ar.arcache = dma_axi_axcache;
 axi_write_address_channel dummy_m_axi_dma_aw();
 axi_write_channel dummy_m_axi_dma_w();
 axi_write_response_channel dummy_m_axi_dma_b();
@@ -75,6 +85,7 @@ prism_sp_duo_xx_top #(
 	.ACPBRAM_SIZE(ACPBRAM_SIZE),
 	.TX_DATA_FIFO_SIZE(TX_DATA_FIFO_SIZE),
 	.TX_DATA_FIFO_WIDTH(TX_DATA_FIFO_WIDTH),
+	.GEM_BASE(GEM_BASE),
 	.USE_SP_UNIT_TX(1)
 ) prism_sp_duo_xx_top_tx(
 	.clock(clock),
@@ -86,6 +97,12 @@ prism_sp_duo_xx_top #(
 	.s_axil_ar,
 	.s_axil_r,
 
+	.s_axi_bram_aw,
+	.s_axi_bram_w,
+	.s_axi_bram_b,
+	.s_axi_bram_ar,
+	.s_axi_bram_r,
+
 	.m_axi_io,
 
 	.m_axi_acp_aw,
@@ -94,7 +111,6 @@ prism_sp_duo_xx_top #(
 	.m_axi_acp_ar,
 	.m_axi_acp_r,
 
-	.dma_axi_axcache,
 	.m_axi_dma_aw(dummy_m_axi_dma_aw),
 	.m_axi_dma_w(dummy_m_axi_dma_w),
 	.m_axi_dma_b(dummy_m_axi_dma_b),
@@ -103,6 +119,9 @@ prism_sp_duo_xx_top #(
 
 	.gem_rx(dummy_gem_rx),
 	.gem_tx(gem_tx),
+	.loopback,
+	.status,
+	.peer_status,
 	.queue_0_txdone,
 	.queue_1_txdone
 );
@@ -20,19 +20,24 @@ import l2_config_and_types::*;
 module prism_sp_duo_wrapper #(
 	parameter int IBRAM_SIZE = 2**15,
 	parameter int DBRAM_SIZE = 2**15,
-	parameter int ACPBRAM_SIZE = 2*64*8,
+	parameter int ACPBRAM_SIZE = 4*64*8,
 
 	parameter int RX_DATA_FIFO_SIZE = 2**16,
 	parameter int TX_DATA_FIFO_SIZE = 2**16,
 
+	// Base address of the registers of the GEM this SP pair is attached to.
+	// One instance of the wrapper is placed per accelerated GEM.
+	parameter logic [31:0] C_GEM_BASE_ADDR = 32'hff0e0000,
+
 	parameter int C_M_AXI_IO_ADDR_WIDTH = 32,
 	parameter int C_M_AXI_IO_DATA_WIDTH = 32,
 	parameter int C_M_AXI_ACP_ADDR_WIDTH = 40,
 	parameter int C_M_AXI_ACP_DATA_WIDTH = 128,
-	parameter int C_M_AXI_DMA_ADDR_WIDTH = 32,
+	parameter int C_M_AXI_DMA_ADDR_WIDTH = 40,
 	parameter int C_M_AXI_DMA_DATA_WIDTH = 32,
 	parameter int C_S_AXIL_ADDR_WIDTH = 32,
-	parameter int C_S_AXIL_DATA_WIDTH = 32
+	parameter int C_S_AXIL_DATA_WIDTH = 32,
+	parameter int C_S_AXI_BRAM_ADDR_WIDTH = 32
 )
 (
 	input wire clock,
@@ -96,6 +101,72 @@ module prism_sp_duo_wrapper #(
 	output wire [C_S_AXIL_DATA_WIDTH-1:0] s_axil_1_rdata,
 	output wire [1:0] s_axil_1_rresp,
 
+	/*
+	 * AXI slave interface (BRAM window)
+	 */
+	input wire s_axi_bram_0_awvalid,
+	output wire s_axi_bram_0_awready,
+	input wire [C_S_AXI_BRAM_ADDR_WIDTH-1:0] s_axi_bram_0_awaddr,
+	input wire [7:0] s_axi_bram_0_awlen,
+	input wire [2:0] s_axi_bram_0_awsize,
+	input wire [1:0] s_axi_bram_0_awburst,
+
+	input wire s_axi_bram_0_wvalid,
+	output wire s_axi_bram_0_wready,
+	input wire [31:0] s_axi_bram_0_wdata,
+	input wire [3:0] s_axi_bram_0_wstrb,
+	input wire s_axi_bram_0_wlast,
+
+	output wire s_axi_bram_0_bvalid,
+	input wire s_axi_bram_0_bready,
+	output wire [1:0] s_axi_bram_0_bresp,
+
+	input wire s_axi_bram_0_arvalid,
+	output wire s_axi_bram_0_arready,
+	input wire [C_S_AXI_BRAM_ADDR_WIDTH-1:0] s_axi_bram_0_araddr,
+	input wire [7:0] s_axi_bram_0_arlen,
+	input wire [2:0] s_axi_bram_0_arsize,
+	input wire [1:0] s_axi_bram_0_arburst,
+
+	output wire s_axi_bram_0_rvalid,
+	input wire s_axi_bram_0_rready,
+	output wire [31:0] s_axi_bram_0_rdata,
+	output wire [1:0] s_axi_bram_0_rresp,
+	output wire s_axi_bram_0_rlast,
+
+	/*
+	 * AXI slave interface (BRAM window)
+	 */
+	input wire s_axi_bram_1_awvalid,
+	output wire s_axi_bram_1_awready,
+	input wire [C_S_AXI_BRAM_ADDR_WIDTH-1:0] s_axi_bram_1_awaddr,
+	input wire [7:0] s_axi_bram_1_awlen,
+	input wire [2:0] s_axi_bram_1_awsize,
+	input wire [1:0] s_axi_bram_1_awburst,
+
+	input wire s_axi_bram_1_wvalid,
+	output wire s_axi_bram_1_wready,
+	input wire [31:0] s_axi_bram_1_wdata,
+	input wire [3:0] s_axi_bram_1_wstrb,
+	input wire s_axi_bram_1_wlast,
+
+	output wire s_axi_bram_1_bvalid,
+	input wire s_axi_bram_1_bready,
+	output wire [1:0] s_axi_bram_1_bresp,
+
+	input wire s_axi_bram_1_arvalid,
+	output wire s_axi_bram_1_arready,
+	input wire [C_S_AXI_BRAM_ADDR_WIDTH-1:0] s_axi_bram_1_araddr,
+	input wire [7:0] s_axi_bram_1_arlen,
+	input wire [2:0] s_axi_bram_1_arsize,
+	input wire [1:0] s_axi_bram_1_arburst,
+
+	output wire s_axi_bram_1_rvalid,
+	input wire s_axi_bram_1_rready,
+	output wire [31:0] s_axi_bram_1_rdata,
+	output wire [1:0] s_axi_bram_1_rresp,
+	output wire s_axi_bram_1_rlast,
+
 	/*
 	 * IO access
 	 */
@@ -288,6 +359,7 @@ module prism_sp_duo_wrapper #(
 	output wire [2:0] m_axi_dma_arsize,
 	output wire [1:0] m_axi_dma_arburst,
 	output wire [3:0] m_axi_dma_arcache,
+	output wire m_axi_dma_aruser,
 	output wire [5:0] m_axi_dma_arid,
 	output wire m_axi_dma_rready,
 	input wire m_axi_dma_rvalid,
@@ -302,6 +374,7 @@ module prism_sp_duo_wrapper #(
 	output wire [2:0] m_axi_dma_awsize,
 	output wire [1:0] m_axi_dma_awburst,
 	output wire [3:0] m_axi_dma_awcache,
+	output wire m_axi_dma_awuser,
 	output wire [5:0] m_axi_dma_awid,
 	input wire m_axi_dma_wready,
 	output wire m_axi_dma_wvalid,
@@ -402,6 +475,72 @@ assign s_axil_1_r.rready = s_axil_1_rready;
 assign s_axil_1_rdata = s_axil_1_r.rdata;
 assign s_axil_1_rresp = s_axil_1_r.rresp;
 
+axi_write_address_channel #(.AXI_AWADDR_WIDTH(C_S_AXI_BRAM_ADDR_WIDTH)) s_axi_bram_0_aw();
+assign s_axi_bram_0_aw.awvalid = s_axi_bram_0_awvalid;
+assign s_axi_bram_0_awready = s_axi_bram_0_aw.awready;
+assign s_axi_bram_0_aw.awaddr = s_axi_bram_0_awaddr;
+assign s_axi_bram_0_aw.awlen = s_axi_bram_0_awlen;
+assign s_axi_bram_0_aw.awsize = s_axi_bram_0_awsize;
+assign s_axi_bram_0_aw.awburst = s_axi_bram_0_awburst;
+assign s_axi_bram_0_aw.awid = '0;
+axi_write_channel #(.AXI_WDATA_WIDTH(32)) s_axi_bram_0_w();
+assign s_axi_bram_0_w.wvalid = s_axi_bram_0_wvalid;
+assign s_axi_bram_0_wready = s_axi_bram_0_w.wready;
+assign s_axi_bram_0_w.wdata = s_axi_bram_0_wdata;
+assign s_axi_bram_0_w.wstrb = s_axi_bram_0_wstrb;
+assign s_axi_bram_0_w.wlast = s_axi_bram_0_wlast;
+axi_write_response_channel s_axi_bram_0_b();
+assign s_axi_bram_0_bvalid = s_axi_bram_0_b.bvalid;
+assign s_axi_bram_0_b.bready = s_axi_bram_0_bready;
+assign s_axi_bram_0_bresp = s_axi_bram_0_b.bresp;
+axi_read_address_channel #(.AXI_ARADDR_WIDTH(C_S_AXI_BRAM_ADDR_WIDTH)) s_axi_bram_0_ar();
+assign s_axi_bram_0_ar.arvalid = s_axi_bram_0_arvalid;
+assign s_axi_bram_0_arready = s_axi_bram_0_ar.arready;
+assign s_axi_bram_0_ar.araddr = s_axi_bram_0_araddr;
+assign s_axi_bram_0_ar.arlen = s_axi_bram_0_arlen;
+assign s_axi_bram_0_ar.arsize = s_axi_bram_0_arsize;
+assign s_axi_bram_0_ar.arburst = s_axi_bram_0_arburst;
+assign s_axi_bram_0_ar.arid = '0;
+axi_read_channel #(.AXI_RDATA_WIDTH(32)) s_axi_bram_0_r();
+assign s_axi_bram_0_rvalid = s_axi_bram_0_r.rvalid;
+assign s_axi_bram_0_r.rready = s_axi_bram_0_rready;
+assign s_axi_bram_0_rdata = s_axi_bram_0_r.rdata;
+assign s_axi_bram_0_rresp = s_axi_bram_0_r.rresp;
+assign s_axi_bram_0_rlast = s_axi_bram_0_r.rlast;
+
+axi_write_address_channel #(.AXI_AWADDR_WIDTH(C_S_AXI_BRAM_ADDR_WIDTH)) s_axi_bram_1_aw();
+assign s_axi_bram_1_aw.awvalid = s_axi_bram_1_awvalid;
+assign s_axi_bram_1_awready = s_axi_bram_1_aw.awready;
+assign s_axi_bram_1_aw.awaddr = s_axi_bram_1_awaddr;
+assign s_axi_bram_1_aw.awlen = s_axi_bram_1_awlen;
+assign s_axi_bram_1_aw.awsize = s_axi_bram_1_awsize;
+assign s_axi_bram_1_aw.awburst = s_axi_bram_1_awburst;
+assign s_axi_bram_1_aw.awid = '0;
+axi_write_channel #(.AXI_WDATA_WIDTH(32)) s_axi_bram_1_w();
+assign s_axi_bram_1_w.wvalid = s_axi_bram_1_wvalid;
+assign s_axi_bram_1_wready = s_axi_bram_1_w.wready;
+assign s_axi_bram_1_w.wdata = s_axi_bram_1_wdata;
+assign s_axi_bram_1_w.wstrb = s_axi_bram_1_wstrb;
+assign s_axi_bram_1_w.wlast = s_axi_bram_1_wlast;
+axi_write_response_channel s_axi_bram_1_b();
+assign s_axi_bram_1_bvalid = s_axi_bram_1_b.bvalid;
+assign s_axi_bram_1_b.bready = s_axi_bram_1_bready;
+assign s_axi_bram_1_bresp = s_axi_bram_1_b.bresp;
+axi_read_address_channel #(.AXI_ARADDR_WIDTH(C_S_AXI_BRAM_ADDR_WIDTH)) s_axi_bram_1_ar();
+assign s_axi_bram_1_ar.arvalid = s_axi_bram_1_arvalid;
+assign s_axi_bram_1_arready = s_axi_bram_1_ar.arready;
+assign s_axi_bram_1_ar.araddr = s_axi_bram_1_araddr;
+assign s_axi_bram_1_ar.arlen = s_axi_bram_1_arlen;
+assign s_axi_bram_1_ar.arsize = s_axi_bram_1_arsize;
+assign s_axi_bram_1_ar.arburst = s_axi_bram_1_arburst;
+assign s_axi_bram_1_ar.arid = '0;
+axi_read_channel #(.AXI_RDATA_WIDTH(32)) s_axi_bram_1_r();
+assign s_axi_bram_1_rvalid = s_axi_bram_1_r.rvalid;
+assign s_axi_bram_1_r.rready = s_axi_bram_1_rready;
+assign s_axi_bram_1_rdata = s_axi_bram_1_r.rdata;
+assign s_axi_bram_1_rresp = s_axi_bram_1_r.rresp;
+assign s_axi_bram_1_rlast = s_axi_bram_1_r.rlast;
+
 /*
  * AXI IO
  */
@@ -615,13 +754,19 @@ assign m_axi_acp_1_bready = m_axi_acp_1_b.bready;
 /*
  * AXI DMA
  */
-axi_write_address_channel m_axi_dma_aw();
+axi_write_address_channel #(
+	.AXI_AWADDR_WIDTH(C_M_AXI_DMA_ADDR_WIDTH),
+	.AXI_AWUSER_WIDTH(1)
+) m_axi_dma_aw();
 axi_write_channel #(
 	.AXI_WDATA_WIDTH(C_M_AXI_DMA_DATA_WIDTH)
 ) m_axi_dma_w();
 axi_write_response_channel m_axi_dma_b();
 
-axi_read_address_channel m_axi_dma_ar();
+axi_read_address_channel #(
+	.AXI_ARADDR_WIDTH(C_M_AXI_DMA_ADDR_WIDTH),
+	.AXI_ARUSER_WIDTH(1)
+) m_axi_dma_ar();
 axi_read_channel #(
 	.AXI_RDATA_WIDTH(C_M_AXI_DMA_DATA_WIDTH)
 ) m_axi_dma_r();
@@ -634,6 +779,7 @@ assign m_axi_dma_arlen = m_axi_dma_ar.arlen;
 assign m_axi_dma_arsize = m_axi_dma_ar.arsize;
 assign m_axi_dma_arburst = m_axi_dma_ar.arburst;
 assign m_axi_dma_arcache = m_axi_dma_ar.arcache;
+assign m_axi_dma_aruser = m_axi_dma_ar.aruser;
 assign m_axi_dma_ar.arready = m_axi_dma_arready;
 // R
 // assign m_axi_dma_rid = m_axi.rid;
@@ -649,6 +795,7 @@ assign m_axi_dma_awlen = m_axi_dma_aw.awlen;
 assign m_axi_dma_awsize = m_axi_dma_aw.awsize;
 assign m_axi_dma_awburst = m_axi_dma_aw.awburst;
 assign m_axi_dma_awcache = m_axi_dma_aw.awcache;
+assign m_axi_dma_awuser = m_axi_dma_aw.awuser;
 assign m_axi_dma_aw.awready = m_axi_dma_awready;
 // W
 assign m_axi_dma_wvalid = m_axi_dma_w.wvalid;
@@ -665,11 +812,26 @@ assign m_axi_dma_bready = m_axi_dma_b.bready;
 /*
  * GEM
  */
+wire logic loopback_tx_core;
+wire logic loopback_rx_core;
+wire logic tx_loopback;
+wire logic rx_loopback;
+wire logic loopback_tx_r_rd;
+wire logic loopback_rx_w_wr;
+wire logic [7:0] loopback_rx_w_data;
+wire logic loopback_rx_w_sop;
+wire logic loopback_rx_w_eop;
+wire logic loopback_rx_w_err;
+// The STATUS register of each SP is visible to the other one
+// (see MMR_R_REGN_PEER_STATUS).
+wire logic [31:0] status_tx_core;
+wire logic [31:0] status_rx_core;
+
 gem_tx_interface gem_tx();
 assign gem_tx.tx_clock = gem_tx_clock;
 assign gem_tx.tx_resetn = gem_tx_resetn;
-assign gem_tx_r_data_rdy = gem_tx.tx_r_data_rdy;
-assign gem_tx.tx_r_rd = gem_tx_r_rd;
+assign gem_tx_r_data_rdy = gem_tx.tx_r_data_rdy & ~tx_loopback;
+assign gem_tx.tx_r_rd = tx_loopback ? loopback_tx_r_rd : gem_tx_r_rd;
 assign gem_tx_r_valid = gem_tx.tx_r_valid;
 assign gem_tx_r_data = gem_tx.tx_r_data;
 assign gem_tx_r_sop = gem_tx.tx_r_sop;
@@ -686,14 +848,43 @@ assign gem_dma_tx_status_tog = gem_tx.dma_tx_status_tog;
 gem_rx_interface gem_rx();
 assign gem_rx.rx_clock = gem_rx_clock;
 assign gem_rx.rx_resetn = gem_rx_resetn;
-assign gem_rx.rx_w_wr = gem_rx_w_wr;
-assign gem_rx.rx_w_data = gem_rx_w_data;
-assign gem_rx.rx_w_sop = gem_rx_w_sop;
-assign gem_rx.rx_w_eop = gem_rx_w_eop;
-assign gem_rx.rx_w_status = gem_rx_w_status;
-assign gem_rx.rx_w_err = gem_rx_w_err;
-assign gem_rx_w_overflow = gem_rx.rx_w_overflow;
-assign gem_rx.rx_w_flush = gem_rx_w_flush;
+assign gem_rx.rx_w_wr = rx_loopback ? loopback_rx_w_wr : gem_rx_w_wr;
+assign gem_rx.rx_w_data = rx_loopback ? { 24'h000000, loopback_rx_w_data } : gem_rx_w_data;
+assign gem_rx.rx_w_sop = rx_loopback ? loopback_rx_w_sop : gem_rx_w_sop;
+assign gem_rx.rx_w_eop = rx_loopback ? loopback_rx_w_eop : gem_rx_w_eop;
+assign gem_rx.rx_w_status = rx_loopback ? '0 : gem_rx_w_status;
+assign gem_rx.rx_w_err = rx_loopback ? loopback_rx_w_err : gem_rx_w_err;
+assign gem_rx_w_overflow = gem_rx.rx_w_overflow & ~rx_loopback;
+assign gem_rx.rx_w_flush = rx_loopback ? 1'b0 : gem_rx_w_flush;
+
+/*
+ * TX-to-RX loopback (see the BENCH register)
+ *
+ * The GEM is cut off from both SPs while it is enabled.
+ */
+gem_loopback gem_loopback_0(
+	.loopback(loopback_tx_core | loopback_rx_core),
+
+	.tx_clock(gem_tx_clock),
+	.tx_resetn(gem_tx_resetn),
+	.tx_loopback,
+	.tx_r_data_rdy(gem_tx.tx_r_data_rdy),
+	.tx_r_rd(loopback_tx_r_rd),
+	.tx_r_valid(gem_tx.tx_r_valid),
+	.tx_r_data(gem_tx.tx_r_data),
+	.tx_r_sop(gem_tx.tx_r_sop),
+	.tx_r_eop(gem_tx.tx_r_eop),
+	.tx_r_underflow(gem_tx.tx_r_underflow),
+
+	.rx_clock(gem_rx_clock),
+	.rx_resetn(gem_rx_resetn),
+	.rx_loopback,
+	.rx_w_wr(loopback_rx_w_wr),
+	.rx_w_data(loopback_rx_w_data),
+	.rx_w_sop(loopback_rx_w_sop),
+	.rx_w_eop(loopback_rx_w_eop),
+	.rx_w_err(loopback_rx_w_err)
+);
 
 wire logic gem_irq_tx_core;
 wire logic gem_irq_rx_core;
@@ -704,7 +895,8 @@ prism_sp_duo_tx_top #(
 	.DBRAM_SIZE(DBRAM_SIZE),
 	.ACPBRAM_SIZE(ACPBRAM_SIZE),
 	.TX_DATA_FIFO_SIZE(TX_DATA_FIFO_SIZE),
-	.TX_DATA_FIFO_WIDTH(C_M_AXI_DMA_DATA_WIDTH)
+	.TX_DATA_FIFO_WIDTH(C_M_AXI_DMA_DATA_WIDTH),
+	.GEM_BASE(C_GEM_BASE_ADDR)
 ) prism_sp_duo_tx_top_0 (
 	.clock(clock),
 	.resetn(resetn),
@@ -718,6 +910,12 @@ prism_sp_duo_tx_top #(
 	.s_axil_ar(s_axil_0_ar),
 	.s_axil_r(s_axil_0_r),
 
+	.s_axi_bram_aw(s_axi_bram_0_aw),
+	.s_axi_bram_w(s_axi_bram_0_w),
+	.s_axi_bram_b(s_axi_bram_0_b),
+	.s_axi_bram_ar(s_axi_bram_0_ar),
+	.s_axi_bram_r(s_axi_bram_0_r),
+
 	.m_axi_io(m_axi_io_0),
 
 	.m_axi_acp_aw(m_axi_acp_0_aw),
@@ -729,7 +927,10 @@ prism_sp_duo_tx_top #(
 	.m_axi_dma_ar,
 	.m_axi_dma_r,
 
-	.gem_tx(gem_tx)
+	.gem_tx(gem_tx),
+	.loopback(loopback_tx_core),
+	.status(status_tx_core),
+	.peer_status(status_rx_core)
 );
 
 prism_sp_duo_rx_top #(
@@ -737,7 +938,8 @@ prism_sp_duo_rx_top #(
 	.DBRAM_SIZE(DBRAM_SIZE),
 	.ACPBRAM_SIZE(ACPBRAM_SIZE),
 	.RX_DATA_FIFO_SIZE(RX_DATA_FIFO_SIZE),
-	.RX_DATA_FIFO_WIDTH(C_M_AXI_DMA_DATA_WIDTH)
+	.RX_DATA_FIFO_WIDTH(C_M_AXI_DMA_DATA_WIDTH),
+	.GEM_BASE(C_GEM_BASE_ADDR)
 ) prism_sp_duo_rx_top_0 (
 	.clock(clock),
 	.resetn(resetn),
@@ -751,6 +953,12 @@ prism_sp_duo_rx_top #(
 	.s_axil_ar(s_axil_1_ar),
 	.s_axil_r(s_axil_1_r),
 
+	.s_axi_bram_aw(s_axi_bram_1_aw),
+	.s_axi_bram_w(s_axi_bram_1_w),
+	.s_axi_bram_b(s_axi_bram_1_b),
+	.s_axi_bram_ar(s_axi_bram_1_ar),
+	.s_axi_bram_r(s_axi_bram_1_r),
+
 	.m_axi_io(m_axi_io_1),
 
 	.m_axi_acp_aw(m_axi_acp_1_aw),
@@ -763,7 +971,10 @@ prism_sp_duo_rx_top #(
 	.m_axi_dma_w,
 	.m_axi_dma_b,
 
-	.gem_rx(gem_rx)
+	.gem_rx(gem_rx),
+	.loopback(loopback_rx_core),
+	.status(status_rx_core),
+	.peer_status(status_tx_core)
 );
 
 endmodule
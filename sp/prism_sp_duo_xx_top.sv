@@ -22,11 +22,14 @@ module prism_sp_duo_xx_top #(
 	parameter int IBRAM_SIZE,
 	parameter int DBRAM_SIZE,
 	parameter int ACPBRAM_SIZE,
+	// Size of the histogram BRAM of the PC-sampling profiler
+	parameter int PROF_SIZE = 2**16,
 
 	parameter int TX_DATA_FIFO_SIZE = 0,
 	parameter int TX_DATA_FIFO_WIDTH = 0,
 	parameter int RX_DATA_FIFO_SIZE = 0,
 	parameter int RX_DATA_FIFO_WIDTH = 0,
+	parameter logic [31:0] GEM_BASE = 32'hff0e0000,
 
 	parameter int USE_SP_UNIT_TX = 0,
 	parameter int USE_SP_UNIT_RX = 0
@@ -44,6 +47,12 @@ module prism_sp_duo_xx_top #(
 	axi_lite_read_address_channel.slave s_axil_ar,
 	axi_lite_read_channel.slave s_axil_r,
 
+	axi_write_address_channel.slave s_axi_bram_aw,
+	axi_write_channel.slave s_axi_bram_w,
+	axi_write_response_channel.slave s_axi_bram_b,
+	axi_read_address_channel.slave s_axi_bram_ar,
+	axi_read_channel.slave s_axi_bram_r,
+
 	axi_interface.master m_axi_io,
 
 	axi_write_address_channel.master m_axi_acp_aw,
@@ -52,7 +61,6 @@ module prism_sp_duo_xx_top #(
 	axi_read_address_channel.master m_axi_acp_ar,
 	axi_read_channel.master m_axi_acp_r,
 
-	output wire logic [3:0] dma_axi_axcache,
 	axi_write_address_channel.master m_axi_dma_aw,
 	axi_write_channel.master m_axi_dma_w,
 	axi_write_response_channel.master m_axi_dma_b,
@@ -61,6 +69,11 @@ module prism_sp_duo_xx_top #(
 
 	gem_tx_interface.master gem_tx,
 	gem_rx_interface.slave gem_rx,
+	// The loopback bit of the BENCH register
+	output wire logic loopback,
+	// The STATUS registers of this SP and of the other SP of the pair
+	output wire logic [31:0] status,
+	input wire logic [31:0] peer_status,
 	output wire logic queue_0_rxdone,
 	output wire logic queue_1_rxdone,
 	output wire logic queue_0_txdone,
@@ -74,11 +87,27 @@ localparam int IBRAM_DATA_WIDTH = 32;
 localparam int IBRAM_ADDR_WIDTH = $clog2(IBRAM_SIZE / (IBRAM_DATA_WIDTH/8));
 local_memory_interface instruction_bram();
 local_memory_interface instruction_bram_mmr();
+local_memory_interface instruction_bram_axi();
 
 localparam int DBRAM_DATA_WIDTH = 32;
 localparam int DBRAM_ADDR_WIDTH = $clog2(DBRAM_SIZE / (DBRAM_DATA_WIDTH/8));
 local_memory_interface data_bram();
 local_memory_interface data_bram_mmr();
+local_memory_interface data_bram_axi();
+
+// Port B of the IBRAM and the DBRAM is shared by the MMR (word by word)
+// and the AXI window (bursts). The host uses one of them at a time.
+assign instruction_bram_mmr.data_out = instruction_bram_axi.data_out;
+wire logic ibram_b_en = instruction_bram_mmr.en | instruction_bram_axi.en;
+wire logic [29:0] ibram_b_addr = instruction_bram_axi.en ? instruction_bram_axi.addr : instruction_bram_mmr.addr;
+wire logic [31:0] ibram_b_data_in = instruction_bram_axi.en ? instruction_bram_axi.data_in : instruction_bram_mmr.data_in;
+wire logic [3:0] ibram_b_be = instruction_bram_axi.en ? instruction_bram_axi.be : instruction_bram_mmr.be;
+
+assign data_bram_mmr.data_out = data_bram_axi.data_out;
+wire logic dbram_b_en = data_bram_mmr.en | data_bram_axi.en;
+wire logic [29:0] dbram_b_addr = data_bram_axi.en ? data_bram_axi.addr : data_bram_mmr.addr;
+wire logic [31:0] dbram_b_data_in = data_bram_axi.en ? data_bram_axi.data_in : data_bram_mmr.data_in;
+wire logic [3:0] dbram_b_be = data_bram_axi.en ? data_bram_axi.be : data_bram_mmr.be;
 
 // Port A is connected to the processor core
 localparam int ACPBRAM_A_DATA_WIDTH = 32;
@@ -100,6 +129,10 @@ wire logic interrupt;
 wire logic cpu_reset;
 
 wire logic [3:0] io_axi_axcache;
+// The DMA subunits set the AXCACHE of each transfer and
+// read the default from the register through mmr_r.
+wire logic [3:0] dma_axi_axcache;
+tsu_time_t tsu_time;
 
 assign m_axi_io.awcache = io_axi_axcache;
 assign m_axi_io.arcache = io_axi_axcache;
@@ -107,19 +140,27 @@ assign m_axi_io.arcache = io_axi_axcache;
 mmr_readwrite_interface #(.NREGS(MMR_RW_NREGS)) mmr_rw();
 mmr_read_interface #(.NREGS(MMR_R_NREGS)) mmr_r();
 mmr_intr_interface #(.N(NGEMQUEUES),.WIDTH(32)) mmr_i();
+mmr_prof_interface prof();
+mmr_stats_interface mmr_s();
+
+trace_outputs_t tr;
 
 assign queue_0_rxdone = mmr_i.isr[0][GEM_RXDONE_BITN];
 assign queue_1_rxdone = mmr_i.isr[1][GEM_RXDONE_BITN];
 assign queue_0_txdone = mmr_i.isr[0][GEM_TXDONE_BITN];
 assign queue_1_txdone = mmr_i.isr[1][GEM_TXDONE_BITN];
+assign loopback = mmr_r.data[MMR_R_REGN_BENCH][BENCH_LOOPBACK_BITN];
+assign status = mmr_rw.data[MMR_RW_REGN_STATUS];
 
 axi_lite_mmr #(
 	.IBRAM_SIZE(IBRAM_SIZE),
 	.DBRAM_SIZE(DBRAM_SIZE),
+	.PROF_SIZE(PROF_SIZE),
 	.TX_DATA_FIFO_SIZE(TX_DATA_FIFO_SIZE),
 	.TX_DATA_FIFO_WIDTH(TX_DATA_FIFO_WIDTH),
 	.RX_DATA_FIFO_SIZE(RX_DATA_FIFO_SIZE),
-	.RX_DATA_FIFO_WIDTH(RX_DATA_FIFO_WIDTH)
+	.RX_DATA_FIFO_WIDTH(RX_DATA_FIFO_WIDTH),
+	.GEM_BASE(GEM_BASE)
 )
 axi_lite_mmr_inst(
 	.clock(clock),
@@ -134,15 +175,39 @@ axi_lite_mmr_inst(
 	.mmr_rw(mmr_rw),
 	.mmr_r(mmr_r),
 	.mmr_i(mmr_i),
+	.prof(prof),
+	.mmr_s(mmr_s),
 
 	.cpu_reset(cpu_reset),
 	.io_axi_axcache,
 	.dma_axi_axcache,
 
+	.tsu_time,
+
+	.peer_status,
+
 	.instruction_bram_mmr(instruction_bram_mmr),
 	.data_bram_mmr(data_bram_mmr)
 );
 
+bram_axi #(
+	.IBRAM_SIZE(IBRAM_SIZE),
+	.DBRAM_SIZE(DBRAM_SIZE)
+)
+bram_axi_inst(
+	.clock(clock),
+	.resetn(resetn),
+
+	.axi_aw(s_axi_bram_aw),
+	.axi_w(s_axi_bram_w),
+	.axi_b(s_axi_bram_b),
+	.axi_ar(s_axi_bram_ar),
+	.axi_r(s_axi_bram_r),
+
+	.instruction_bram_axi(instruction_bram_axi),
+	.data_bram_axi(data_bram_axi)
+);
+
 //fifo_write_interface #(.DATA_WIDTH(RX_META_FIFO_WIDTH)) rx_data_fifo_write_mon();
 //fifo_read_interface #(.DATA_WIDTH(RX_META_FIFO_WIDTH)) rx_data_fifo_read_mon();
 
@@ -162,6 +227,8 @@ taiga #(
 	.acp_bram_a,
 	.acp_bram_port_b_i(acp_bram_b),
 
+	.tr,
+
 	.l2(l2),
 	.timer_interrupt,
 	.interrupt,
@@ -186,10 +253,23 @@ taiga #(
 
 	.gem_rx,
 	.gem_tx,
+	.tsu_time,
 
 	.mmr_rw,
 	.mmr_r,
-	.mmr_i
+	.mmr_i,
+	.mmr_s
+);
+
+pc_profiler #(
+	.IBRAM_SIZE(IBRAM_SIZE),
+	.PROF_SIZE(PROF_SIZE)
+)
+pc_profiler_inst(
+	.clock(clock),
+	.resetn(resetn),
+	.tr,
+	.prof(prof)
 );
 
 xpm_memory_tdpram #(
@@ -229,15 +309,15 @@ xpm_memory_tdpram_ibram (
 	.rsta(~resetn),
 	.rstb(~resetn),
 	.douta(instruction_bram.data_out),
-	.doutb(instruction_bram_mmr.data_out),
+	.doutb(instruction_bram_axi.data_out),
 	.addra(instruction_bram.addr[IBRAM_ADDR_WIDTH-1:0]),
-	.addrb(instruction_bram_mmr.addr[IBRAM_ADDR_WIDTH-1:0]),
+	.addrb(ibram_b_addr[IBRAM_ADDR_WIDTH-1:0]),
 	.dina(instruction_bram.data_in),
-	.dinb(instruction_bram_mmr.data_in),
+	.dinb(ibram_b_data_in),
 	.ena(instruction_bram.en),
-	.enb(instruction_bram_mmr.en),
+	.enb(ibram_b_en),
 	.wea(instruction_bram.be),
-	.web(instruction_bram_mmr.be)
+	.web(ibram_b_be)
 );
 
 xpm_memory_tdpram #(
@@ -277,15 +357,15 @@ xpm_memory_tdpram_dbram (
 	.rsta(~resetn),
 	.rstb(~resetn),
 	.douta(data_bram.data_out),
-	.doutb(data_bram_mmr.data_out),
+	.doutb(data_bram_axi.data_out),
 	.addra(data_bram.addr[DBRAM_ADDR_WIDTH-1:0]),
-	.addrb(data_bram_mmr.addr[DBRAM_ADDR_WIDTH-1:0]),
+	.addrb(dbram_b_addr[DBRAM_ADDR_WIDTH-1:0]),
 	.dina(data_bram.data_in),
-	.dinb(data_bram_mmr.data_in),
+	.dinb(dbram_b_data_in),
 	.ena(data_bram.en),
-	.enb(data_bram_mmr.en),
+	.enb(dbram_b_en),
 	.wea(data_bram.be),
-	.web(data_bram_mmr.be)
+	.web(dbram_b_be)
 );
 
 xpm_memory_tdpram #(
@@ -301,7 +381,7 @@ xpm_memory_tdpram #(
 	.MEMORY_INIT_PARAM("0"),
 	.MEMORY_OPTIMIZATION("true"),
 	.MEMORY_PRIMITIVE("auto"),
-	.MEMORY_SIZE(2*64*8),
+	.MEMORY_SIZE(ACPBRAM_SIZE),
 	.MESSAGE_CONTROL(0),
 	.READ_DATA_WIDTH_A(ACPBRAM_A_DATA_WIDTH),
 	.READ_DATA_WIDTH_B(ACPBRAM_B_DATA_WIDTH),
@@ -13,6 +13,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+import taiga_types::*;
 import sp_unit_config::*;
 module sp_unit #(
 	parameter int RX_DATA_FIFO_SIZE,
@@ -28,11 +29,15 @@ module sp_unit #(
 	unit_issue_interface.unit issue,
 	unit_writeback_interface.unit wb,
 
+	// A command of the subunit is executing (indexed by sp_subunit_t)
+	output wire logic [SP_NSUBUNITS-1:0] sp_subunits_busy,
+
 	xpm_memory_tdpram_port_interface.master acpram_port_i,
 
 	// For the GEM TX/RX subunits
 	gem_rx_interface.slave gem_rx,
 	gem_tx_interface.master gem_tx,
+	input tsu_time_t tsu_time,
 
 `ifdef RESURRECT_MON
 	fifo_write_interface.monitor_out rx_data_fifo_write_mon,
@@ -55,7 +60,8 @@ module sp_unit #(
 	// For the Common subunit
 	mmr_readwrite_interface.master mmr_rw,
 	mmr_read_interface.master mmr_r,
-	mmr_intr_interface.master mmr_i
+	mmr_intr_interface.master mmr_i,
+	mmr_stats_interface.master mmr_s
 );
 
 /*
@@ -85,6 +91,11 @@ var logic [$bits(wb.rd)-1:0] result;
  */
 assign issue.ready = ~|{acp_cmds_busy, common_cmds_busy, tx_cmds_busy, rx_cmds_busy};
 
+assign sp_subunits_busy[SP_SUBUNIT_RX] = |rx_cmds_busy;
+assign sp_subunits_busy[SP_SUBUNIT_TX] = |tx_cmds_busy;
+assign sp_subunits_busy[SP_SUBUNIT_COMMON] = |common_cmds_busy;
+assign sp_subunits_busy[SP_SUBUNIT_ACP] = |acp_cmds_busy;
+
 /*
  * Binary to one-hot decoding of the current command.
  */
@@ -114,13 +125,19 @@ always_comb begin
 	common_issue_cmd = '0;
 	acp_issue_cmd = '0;
 
-	case (sp_inputs.fn7[4:0])
+	case (sp_inputs.fn7[5:0])
 	//SP_FUNC7_RX_META_NELEMS: rx_issue_cmd[CMD_RX_META_NELEMS] = 1'b1;
 	SP_FUNC7_RX_META_POP: rx_issue_cmd[CMD_RX_META_POP] = 1'b1;
 	SP_FUNC7_RX_META_EMPTY: rx_issue_cmd[CMD_RX_META_EMPTY] = 1'b1;
+	SP_FUNC7_RX_META_GET: rx_issue_cmd[CMD_RX_META_GET] = 1'b1;
 	SP_FUNC7_RX_DATA_SKIP: rx_issue_cmd[CMD_RX_DATA_SKIP] = 1'b1;
 	SP_FUNC7_RX_DATA_DMA_START: rx_issue_cmd[CMD_RX_DATA_DMA_START] = 1'b1;
 	SP_FUNC7_RX_DATA_DMA_STATUS: rx_issue_cmd[CMD_RX_DATA_DMA_STATUS] = 1'b1;
+	SP_FUNC7_RX_CONFIG: rx_issue_cmd[CMD_RX_CONFIG] = 1'b1;
+	SP_FUNC7_RX_FLOW_STATUS: rx_issue_cmd[CMD_RX_FLOW_STATUS] = 1'b1;
+	SP_FUNC7_RX_QUEUE_SELECT: rx_issue_cmd[CMD_RX_QUEUE_SELECT] = 1'b1;
+	SP_FUNC7_RX_MIRROR_DMA_START: rx_issue_cmd[CMD_RX_MIRROR_DMA_START] = 1'b1;
+	SP_FUNC7_RX_META_PEEK: rx_issue_cmd[CMD_RX_META_PEEK] = 1'b1;
 
 	//SP_FUNC7_TX_META_NFREE: tx_issue_cmd[CMD_TX_META_NFREE] = 1'b1;
 	SP_FUNC7_TX_META_PUSH: tx_issue_cmd[CMD_TX_META_PUSH] = 1'b1;
@@ -128,6 +145,15 @@ always_comb begin
 	SP_FUNC7_TX_DATA_COUNT: tx_issue_cmd[CMD_TX_DATA_COUNT] = 1'b1;
 	SP_FUNC7_TX_DATA_DMA_START: tx_issue_cmd[CMD_TX_DATA_DMA_START] = 1'b1;
 	SP_FUNC7_TX_DATA_DMA_STATUS: tx_issue_cmd[CMD_TX_DATA_DMA_STATUS] = 1'b1;
+	SP_FUNC7_TX_TS_EMPTY: tx_issue_cmd[CMD_TX_TS_EMPTY] = 1'b1;
+	SP_FUNC7_TX_TS_POP: tx_issue_cmd[CMD_TX_TS_POP] = 1'b1;
+	SP_FUNC7_TX_TS_GET: tx_issue_cmd[CMD_TX_TS_GET] = 1'b1;
+	SP_FUNC7_TX_HDR_PUSH: tx_issue_cmd[CMD_TX_HDR_PUSH] = 1'b1;
+	SP_FUNC7_TX_CSUM_GET: tx_issue_cmd[CMD_TX_CSUM_GET] = 1'b1;
+	SP_FUNC7_TX_CONFIG: tx_issue_cmd[CMD_TX_CONFIG] = 1'b1;
+	SP_FUNC7_TX_LAUNCH_PUSH: tx_issue_cmd[CMD_TX_LAUNCH_PUSH] = 1'b1;
+	SP_FUNC7_TX_TSU_GET: tx_issue_cmd[CMD_TX_TSU_GET] = 1'b1;
+	SP_FUNC7_TX_CTRL_PUSH: tx_issue_cmd[CMD_TX_CTRL_PUSH] = 1'b1;
 
 	SP_FUNC7_LOAD_REG: common_issue_cmd[CMD_LOAD_REG] = 1'b1;
 	SP_FUNC7_STORE_REG: common_issue_cmd[CMD_STORE_REG] = 1'b1;
@@ -213,14 +239,61 @@ sp_unit_tx#(
 	.m_axi_dma_ar,
 	.m_axi_dma_r,
 
-	.gem_tx
+	.gem_tx,
+	.tsu_time,
+
+	.mmr_r,
+	.mmr_s
 );
 end
 else begin
 assign tx_cmds_busy = '0;
 assign tx_cmds_done = '0;
+
+assign mmr_s.gen_nframes = '0;
+assign mmr_s.tx_nframes = '0;
+assign mmr_s.tx_nbytes = '0;
 end
 
+/*
+ * The ACP subunit and the RX DMA (see "RX DATA DMA START")
+ * share the write channels of the ACP port.
+ */
+axi_write_address_channel #(
+	.AXI_AWADDR_WIDTH(m_axi_acp_aw.AXI_AWADDR_WIDTH),
+	.AXI_AWUSER_WIDTH(m_axi_acp_aw.AXI_AWUSER_WIDTH)
+) acp_unit_aw();
+axi_write_channel #(
+	.AXI_WDATA_WIDTH(m_axi_acp_w.AXI_WDATA_WIDTH)
+) acp_unit_w();
+axi_write_response_channel acp_unit_b();
+
+axi_write_address_channel #(
+	.AXI_AWADDR_WIDTH(m_axi_acp_aw.AXI_AWADDR_WIDTH),
+	.AXI_AWUSER_WIDTH(m_axi_acp_aw.AXI_AWUSER_WIDTH)
+) acp_dma_aw();
+axi_write_channel #(
+	.AXI_WDATA_WIDTH(m_axi_acp_w.AXI_WDATA_WIDTH)
+) acp_dma_w();
+axi_write_response_channel acp_dma_b();
+
+axi_write_arbiter axi_write_arbiter_acp(
+	.clock(clk),
+	.reset_n(~rst),
+
+	.s_axi_0_aw(acp_unit_aw),
+	.s_axi_0_w(acp_unit_w),
+	.s_axi_0_b(acp_unit_b),
+
+	.s_axi_1_aw(acp_dma_aw),
+	.s_axi_1_w(acp_dma_w),
+	.s_axi_1_b(acp_dma_b),
+
+	.m_axi_aw(m_axi_acp_aw),
+	.m_axi_w(m_axi_acp_w),
+	.m_axi_b(m_axi_acp_b)
+);
+
 if (USE_SP_UNIT_RX) begin
 sp_unit_rx#(
 	.RX_DATA_FIFO_SIZE(RX_DATA_FIFO_SIZE),
@@ -243,12 +316,28 @@ sp_unit_rx#(
 	.m_axi_dma_w,
 	.m_axi_dma_b,
 
-	.gem_rx
+	.m_axi_acp_dma_aw(acp_dma_aw),
+	.m_axi_acp_dma_w(acp_dma_w),
+	.m_axi_acp_dma_b(acp_dma_b),
+
+	.gem_rx,
+	.tsu_time,
+
+	.mmr_r,
+	.mmr_s
 );
 end
 else begin
 assign rx_cmds_busy = '0;
 assign rx_cmds_done = '0;
+
+assign mmr_s.rx_nframes = '0;
+assign mmr_s.rx_nbytes = '0;
+assign mmr_s.rx_ndrops = '0;
+
+assign acp_dma_aw.awvalid = 1'b0;
+assign acp_dma_w.wvalid = 1'b0;
+assign acp_dma_b.bready = 1'b0;
 end
 
 sp_unit_common#(
@@ -287,9 +376,9 @@ sp_unit_acp#(
 	.result(acp_result),
 
 	.acpram_port_i(acpram_port_i),
-	.m_axi_acp_aw,
-	.m_axi_acp_w,
-	.m_axi_acp_b,
+	.m_axi_acp_aw(acp_unit_aw),
+	.m_axi_acp_w(acp_unit_w),
+	.m_axi_acp_b(acp_unit_b),
 	.m_axi_acp_ar,
 	.m_axi_acp_r
 );
@@ -44,7 +44,7 @@ module sp_unit_acp#(
  */
 acpram_axi_interface #(
 	.ACPRAM_ADDR_WIDTH($bits(acpram_port_i.din)),
-	.AXI_ADDR_WIDTH(32)
+	.AXI_ADDR_WIDTH(40)
 ) acpram_axi_i();
 
 /*
@@ -74,8 +74,9 @@ always_ff @(posedge clk) begin
 
 			if (issue_cmd[CMD_ACP_READ_START] || issue_cmd[CMD_ACP_WRITE_START]) begin
 				// We want to use byte addresses to avoid violating POLA.
-				acpram_axi_i.acpram_addr <= sp_inputs.rs1[31:4];
-				acpram_axi_i.axi_addr <= sp_inputs.rs2;
+				acpram_axi_i.acpram_addr <= sp_inputs.rs1[23:4];
+				// The AXI address bits 39:32 are passed in bits 31:24 of rs1.
+				acpram_axi_i.axi_addr <= { sp_inputs.rs1[31:24], sp_inputs.rs2 };
 				acpram_axi_i.len <= sp_inputs.fn3[0];
 			end
 		end
@@ -15,32 +15,51 @@
  */
 package sp_unit_config;
 
-typedef enum logic [4:0] {
-	SP_FUNC7_RX_META_NELEMS		= 5'b00000,
-	SP_FUNC7_RX_META_POP		= 5'b00001,
-	SP_FUNC7_RX_META_EMPTY		= 5'b00010,
-	SP_FUNC7_RX_DATA_SKIP		= 5'b00100,
-	SP_FUNC7_RX_DATA_DMA_START	= 5'b00101,
-	SP_FUNC7_RX_DATA_DMA_STATUS	= 5'b00110,
+/*
+ * Bits 4:3 select the subunit.
+ * Bit 5 selects a second bank of commands within the same subunit.
+ */
+typedef enum logic [5:0] {
+	SP_FUNC7_RX_META_NELEMS		= 6'b000000,
+	SP_FUNC7_RX_META_POP		= 6'b000001,
+	SP_FUNC7_RX_META_EMPTY		= 6'b000010,
+	SP_FUNC7_RX_META_GET		= 6'b000011,
+	SP_FUNC7_RX_DATA_SKIP		= 6'b000100,
+	SP_FUNC7_RX_DATA_DMA_START	= 6'b000101,
+	SP_FUNC7_RX_DATA_DMA_STATUS	= 6'b000110,
+	SP_FUNC7_RX_CONFIG			= 6'b000111,
+	SP_FUNC7_RX_FLOW_STATUS		= 6'b100000,
+	SP_FUNC7_RX_QUEUE_SELECT	= 6'b100001,
+	SP_FUNC7_RX_MIRROR_DMA_START	= 6'b100010,
+	SP_FUNC7_RX_META_PEEK		= 6'b100011,
 
-	SP_FUNC7_TX_META_NFREE		= 5'b01000,
-	SP_FUNC7_TX_META_PUSH		= 5'b01001,
-	SP_FUNC7_TX_META_FULL		= 5'b01010,
-	SP_FUNC7_TX_DATA_COUNT		= 5'b01100,
-	SP_FUNC7_TX_DATA_SKIP		= 5'b01101,
-	SP_FUNC7_TX_DATA_DMA_START	= 5'b01110,
-	SP_FUNC7_TX_DATA_DMA_STATUS	= 5'b01111,
+	SP_FUNC7_TX_META_NFREE		= 6'b001000,
+	SP_FUNC7_TX_META_PUSH		= 6'b001001,
+	SP_FUNC7_TX_META_FULL		= 6'b001010,
+	SP_FUNC7_TX_TS_EMPTY		= 6'b001011,
+	SP_FUNC7_TX_DATA_COUNT		= 6'b001100,
+	SP_FUNC7_TX_DATA_SKIP		= 6'b001101,
+	SP_FUNC7_TX_DATA_DMA_START	= 6'b001110,
+	SP_FUNC7_TX_DATA_DMA_STATUS	= 6'b001111,
+	SP_FUNC7_TX_TS_POP			= 6'b101000,
+	SP_FUNC7_TX_TS_GET			= 6'b101001,
+	SP_FUNC7_TX_HDR_PUSH		= 6'b101010,
+	SP_FUNC7_TX_CSUM_GET		= 6'b101011,
+	SP_FUNC7_TX_CONFIG			= 6'b101100,
+	SP_FUNC7_TX_LAUNCH_PUSH		= 6'b101101,
+	SP_FUNC7_TX_TSU_GET			= 6'b101110,
+	SP_FUNC7_TX_CTRL_PUSH		= 6'b101111,
 
-	SP_FUNC7_LOAD_REG			= 5'b10000,
-	SP_FUNC7_STORE_REG			= 5'b10001,
-	SP_FUNC7_INTR				= 5'b10010,
+	SP_FUNC7_LOAD_REG			= 6'b010000,
+	SP_FUNC7_STORE_REG			= 6'b010001,
+	SP_FUNC7_INTR				= 6'b010010,
 
-	SP_FUNC7_ACP_READ_START			= 5'b11000,
-	SP_FUNC7_ACP_READ_STATUS		= 5'b11001,
-	SP_FUNC7_ACP_WRITE_START		= 5'b11010,
-	SP_FUNC7_ACP_WRITE_STATUS		= 5'b11011,
-	SP_FUNC7_ACP_SET_LOCAL_WSTRB	= 5'b11100,
-	SP_FUNC7_ACP_SET_REMOTE_WSTRB	= 5'b11101
+	SP_FUNC7_ACP_READ_START			= 6'b011000,
+	SP_FUNC7_ACP_READ_STATUS		= 6'b011001,
+	SP_FUNC7_ACP_WRITE_START		= 6'b011010,
+	SP_FUNC7_ACP_WRITE_STATUS		= 6'b011011,
+	SP_FUNC7_ACP_SET_LOCAL_WSTRB	= 6'b011100,
+	SP_FUNC7_ACP_SET_REMOTE_WSTRB	= 6'b011101
 } sp_func7_t;
 
 localparam int CMD_RX_META_NELEMS		= 0;
@@ -49,8 +68,14 @@ localparam int CMD_RX_META_EMPTY		= CMD_RX_META_POP + 1;
 localparam int CMD_RX_DATA_SKIP			= CMD_RX_META_EMPTY + 1;
 localparam int CMD_RX_DATA_DMA_START	= CMD_RX_DATA_SKIP + 1;
 localparam int CMD_RX_DATA_DMA_STATUS	= CMD_RX_DATA_DMA_START + 1;
+localparam int CMD_RX_META_GET			= CMD_RX_DATA_DMA_STATUS + 1;
+localparam int CMD_RX_CONFIG			= CMD_RX_META_GET + 1;
+localparam int CMD_RX_FLOW_STATUS		= CMD_RX_CONFIG + 1;
+localparam int CMD_RX_QUEUE_SELECT		= CMD_RX_FLOW_STATUS + 1;
+localparam int CMD_RX_MIRROR_DMA_START	= CMD_RX_QUEUE_SELECT + 1;
+localparam int CMD_RX_META_PEEK			= CMD_RX_MIRROR_DMA_START + 1;
 localparam int CMD_RX_FIRST				= CMD_RX_META_NELEMS;
-localparam int CMD_RX_LAST				= CMD_RX_DATA_DMA_STATUS;
+localparam int CMD_RX_LAST				= CMD_RX_META_PEEK;
 
 localparam int CMD_TX_META_NFREE		= 0;
 localparam int CMD_TX_META_PUSH			= CMD_TX_META_NFREE + 1;
@@ -59,8 +84,17 @@ localparam int CMD_TX_DATA_COUNT		= CMD_TX_META_FULL + 1;
 localparam int CMD_TX_DATA_SKIP			= CMD_TX_DATA_COUNT + 1;
 localparam int CMD_TX_DATA_DMA_START	= CMD_TX_DATA_SKIP + 1;
 localparam int CMD_TX_DATA_DMA_STATUS	= CMD_TX_DATA_DMA_START + 1;
+localparam int CMD_TX_TS_EMPTY			= CMD_TX_DATA_DMA_STATUS + 1;
+localparam int CMD_TX_TS_POP			= CMD_TX_TS_EMPTY + 1;
+localparam int CMD_TX_TS_GET			= CMD_TX_TS_POP + 1;
+localparam int CMD_TX_HDR_PUSH			= CMD_TX_TS_GET + 1;
+localparam int CMD_TX_CSUM_GET			= CMD_TX_HDR_PUSH + 1;
+localparam int CMD_TX_CONFIG			= CMD_TX_CSUM_GET + 1;
+localparam int CMD_TX_LAUNCH_PUSH		= CMD_TX_CONFIG + 1;
+localparam int CMD_TX_TSU_GET			= CMD_TX_LAUNCH_PUSH + 1;
+localparam int CMD_TX_CTRL_PUSH			= CMD_TX_TSU_GET + 1;
 localparam int CMD_TX_FIRST				= CMD_TX_META_NFREE;
-localparam int CMD_TX_LAST				= CMD_TX_DATA_DMA_STATUS;
+localparam int CMD_TX_LAST				= CMD_TX_CTRL_PUSH;
 
 localparam int CMD_LOAD_REG				= 0;
 localparam int CMD_STORE_REG			= CMD_LOAD_REG + 1;
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 import sp_unit_config::*;
+import mmr_config::*;
 module sp_unit_rx#(
 	parameter int RX_DATA_FIFO_SIZE,
 	parameter int RX_DATA_FIFO_WIDTH,
@@ -36,7 +37,18 @@ module sp_unit_rx#(
 	axi_write_channel.master m_axi_dma_w,
 	axi_write_response_channel.master m_axi_dma_b,
 
-	gem_rx_interface.slave gem_rx
+	// Target of "RX DATA DMA START" transfers to the ACP port
+	axi_write_address_channel.master m_axi_acp_dma_aw,
+	axi_write_channel.master m_axi_acp_dma_w,
+	axi_write_response_channel.master m_axi_acp_dma_b,
+
+	gem_rx_interface.slave gem_rx,
+	input tsu_time_t tsu_time,
+
+	// For the flow control registers
+	mmr_read_interface.master mmr_r,
+	// For the RX counters
+	mmr_stats_interface.master mmr_s
 );
 
 // This is currently redundant.
@@ -45,13 +57,47 @@ module sp_unit_rx#(
 if (m_axi_dma_w.AXI_WDATA_WIDTH != RX_DATA_FIFO_WIDTH) begin
 	$error("We don't support m_axi_dma_w.AXI_WDATA_WIDTH != RX_DATA_FIFO_WIDTH)");
 end
+if (m_axi_dma_aw.AXI_AWADDR_WIDTH > 40) begin
+	$error("We don't support DMA addresses wider than 40 bits");
+end
+// VLAN stripping relies on the TPID being in one RX data FIFO word.
+if (RX_DATA_FIFO_WIDTH < 32) begin
+	$error("We don't support RX_DATA_FIFO_WIDTH < 32");
+end
 
-localparam int RX_META_FIFO_WIDTH = 32;
+// Each entry holds the encoded status word followed by the two
+// time stamp words in the layout of the GEM's extended descriptors,
+// the header information word, the LRO words (LRO information,
+// TCP acknowledgment number, TCP window) of gem_rx_hdr_parser and
+// the VLAN word.
+localparam int RX_META_FIFO_NWORDS = 8;
+localparam int RX_META_FIFO_WIDTH = RX_META_FIFO_NWORDS*32;
 localparam int RX_META_FIFO_DEPTH = 2048;
-localparam int RX_DATA_FIFO_DEPTH = RX_DATA_FIFO_SIZE / (RX_DATA_FIFO_WIDTH/8);
+localparam int DMA_ADDR_WIDTH = m_axi_dma_aw.AXI_AWADDR_WIDTH;
+// The DMA can only go to the ACP port if its data width matches.
+localparam bit RX_DMA_ACP = m_axi_acp_dma_w.AXI_WDATA_WIDTH == RX_DATA_FIFO_WIDTH;
+// The number of bytes at the start of a frame that can be mirrored
+// (see "RX MIRROR DMA START")
+localparam int RX_MIRROR_SIZE = 256;
+localparam int RX_MIRROR_NWORDS = RX_MIRROR_SIZE / (RX_DATA_FIFO_WIDTH/8);
+localparam int RX_MIRROR_IDX_WIDTH = $clog2(RX_MIRROR_NWORDS);
+
+// The RX FIFOs are split into one pair of meta and data FIFOs per queue.
+// The queue of a frame is known once its VLAN tag has been received,
+// so the first RX data FIFO word must hold the whole tag.
+localparam int RX_NQUEUES = RX_DATA_FIFO_WIDTH >= 128 ? NGEMQUEUES : 1;
+localparam int RX_QUEUE_WIDTH = 4;
+localparam int RX_META_FIFO_QUEUE_DEPTH = RX_META_FIFO_DEPTH / RX_NQUEUES;
+localparam int RX_DATA_FIFO_QUEUE_SIZE = RX_DATA_FIFO_SIZE / RX_NQUEUES;
+localparam int RX_DATA_FIFO_DEPTH = RX_DATA_FIFO_QUEUE_SIZE / (RX_DATA_FIFO_WIDTH/8);
 
-localparam int RX_META_FIFO_RD_DATA_COUNT_WIDTH = $clog2(RX_META_FIFO_DEPTH) + 1;
-localparam int RX_META_FIFO_WR_DATA_COUNT_WIDTH = $clog2(RX_META_FIFO_DEPTH) + 1;
+// This matches the GEM's default jumbo frame length.
+localparam int MAX_PACKET_LENGTH = 10240;
+// Aligning the payload may cost up to one FIFO word per frame.
+localparam int MAX_PACKET_FIFO_SPACE = MAX_PACKET_LENGTH + RX_DATA_FIFO_WIDTH/8;
+
+localparam int RX_META_FIFO_RD_DATA_COUNT_WIDTH = $clog2(RX_META_FIFO_QUEUE_DEPTH) + 1;
+localparam int RX_META_FIFO_WR_DATA_COUNT_WIDTH = $clog2(RX_META_FIFO_QUEUE_DEPTH) + 1;
 localparam int RX_DATA_FIFO_RD_DATA_COUNT_WIDTH = $clog2(RX_DATA_FIFO_DEPTH) + 1;
 localparam int RX_DATA_FIFO_WR_DATA_COUNT_WIDTH = $clog2(RX_DATA_FIFO_DEPTH) + 1;
 
@@ -64,16 +110,20 @@ assign cmds_done = cmds_done_ff;
 
 /*
  * Interfaces for the RX meta FIFO
+ *
+ * The read side is connected to the FIFO of the selected queue
+ * (see "RX QUEUE SELECT"), the write side to the FIFO of the queue
+ * of the current frame.
  */
 fifo_read_interface #(
 	.DATA_WIDTH(RX_META_FIFO_WIDTH)
 ) rx_meta_fifo_r();
-wire logic [RX_META_FIFO_RD_DATA_COUNT_WIDTH-1:0] rx_meta_fifo_r_rd_data_count;
+wire logic [RX_META_FIFO_WIDTH-1:0] rx_meta_fifo_q_rd_data[RX_NQUEUES];
+wire logic [RX_NQUEUES-1:0] rx_meta_fifo_q_empty;
 
 fifo_write_interface #(
 	.DATA_WIDTH(RX_META_FIFO_WIDTH)
 ) rx_meta_fifo_w();
-wire logic [RX_META_FIFO_WR_DATA_COUNT_WIDTH-1:0] rx_meta_fifo_w_wr_data_count;
 
 /*
  * Interfaces for the RX data FIFO
@@ -81,27 +131,50 @@ wire logic [RX_META_FIFO_WR_DATA_COUNT_WIDTH-1:0] rx_meta_fifo_w_wr_data_count;
 fifo_read_interface #(
 	.DATA_WIDTH(RX_DATA_FIFO_WIDTH)
 ) rx_data_fifo_r();
-wire logic [RX_DATA_FIFO_RD_DATA_COUNT_WIDTH-1:0] rx_data_fifo_r_rd_data_count;
+wire logic [RX_DATA_FIFO_WIDTH-1:0] rx_data_fifo_q_rd_data[RX_NQUEUES];
+wire logic [RX_NQUEUES-1:0] rx_data_fifo_q_empty;
+wire logic [RX_DATA_FIFO_RD_DATA_COUNT_WIDTH-1:0] rx_data_fifo_q_rd_data_count[RX_NQUEUES];
 
 fifo_write_interface #(
 	.DATA_WIDTH(RX_DATA_FIFO_WIDTH)
 ) rx_data_fifo_w();
-wire logic [RX_DATA_FIFO_WR_DATA_COUNT_WIDTH-1:0] rx_data_fifo_w_wr_data_count;
+wire logic [RX_DATA_FIFO_WR_DATA_COUNT_WIDTH-1:0] rx_data_fifo_q_wr_data_count[RX_NQUEUES];
+// The queue that rx_meta_fifo_w and rx_data_fifo_w write to
+var logic [RX_QUEUE_WIDTH-1:0] rx_fifo_w_queue;
 
 memory_write_interface #(
 	.DATA_WIDTH(RX_DATA_FIFO_WIDTH),
-	.ADDR_WIDTH(32)
+	.ADDR_WIDTH(DMA_ADDR_WIDTH)
 ) rx_data_mem_w();
 
+/*
+ * The FIFO side of fifo_to_axi_0
+ *
+ * It is connected to the RX data FIFO or, for "RX MIRROR DMA START",
+ * to the RX mirror buffer.
+ */
+fifo_read_interface #(
+	.DATA_WIDTH(RX_DATA_FIFO_WIDTH)
+) rx_dma_fifo_r();
+
 /*
  * --------  --------  --------  --------
  * PL Clock Domain
  * --------  --------  --------  --------
  */
+var logic [RX_QUEUE_WIDTH-1:0] rx_queue_sel;
+
+assign rx_meta_fifo_r.rd_data = rx_meta_fifo_q_rd_data[rx_queue_sel];
+assign rx_meta_fifo_r.empty = rx_meta_fifo_q_empty[rx_queue_sel];
+assign rx_data_fifo_r.rd_data = rx_data_fifo_q_rd_data[rx_queue_sel];
+
 /*
  * Command "RX META POP"
+ *
+ * The whole entry is latched for "RX META GET", but only the
+ * status word is returned.
  */
-var logic [31:0] rx_meta_fifo_read_rd_data;
+var logic [RX_META_FIFO_WIDTH-1:0] rx_meta_fifo_read_rd_data;
 
 always_comb begin
 	cmds_done_comb[CMD_RX_META_POP] = cmds_done_ff[CMD_RX_META_POP];
@@ -140,6 +213,51 @@ always_ff @(posedge clk) begin
 	end
 end
 
+/*
+ * Command "RX META GET"
+ *
+ * Returns word rs1 of the entry latched by the last "RX META POP".
+ */
+var logic [31:0] rx_meta_get_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_META_GET] = cmds_done_ff[CMD_RX_META_GET];
+	cmds_busy_comb[CMD_RX_META_GET] = cmds_busy_ff[CMD_RX_META_GET];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_META_GET] = 1'b0;
+		cmds_busy_comb[CMD_RX_META_GET] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_META_GET]) begin
+			cmds_done_comb[CMD_RX_META_GET] = 1'b1;
+			cmds_busy_comb[CMD_RX_META_GET] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_META_GET] & wb.ack) begin
+			cmds_done_comb[CMD_RX_META_GET] = 1'b0;
+			cmds_busy_comb[CMD_RX_META_GET] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_META_GET] <= cmds_done_comb[CMD_RX_META_GET];
+	cmds_busy_ff[CMD_RX_META_GET] <= cmds_busy_comb[CMD_RX_META_GET];
+
+	if (rst) begin
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_META_GET]) begin
+			rx_meta_get_result_ff <= '0;
+			for (int i = 0; i < RX_META_FIFO_NWORDS; i++) begin
+				if (sp_inputs.rs1[2:0] == 3'(i)) begin
+					rx_meta_get_result_ff <= rx_meta_fifo_read_rd_data[i*32 +: 32];
+				end
+			end
+		end
+	end
+end
+
 /*
  * "RX META EMPTY" command
  */
@@ -168,9 +286,57 @@ always_ff @(posedge clk) begin
 	cmds_busy_ff[CMD_RX_META_EMPTY] <= cmds_busy_comb[CMD_RX_META_EMPTY];
 end
 
+/*
+ * "RX META PEEK" command
+ *
+ * Returns the status word (word 0) of the element at the head of the RX
+ * meta FIFO without popping it, e.g. to find the ring of the frame
+ * before it has a descriptor. It is undefined if the FIFO is empty.
+ */
+var logic [31:0] rx_meta_peek_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_META_PEEK] = cmds_done_ff[CMD_RX_META_PEEK];
+	cmds_busy_comb[CMD_RX_META_PEEK] = cmds_busy_ff[CMD_RX_META_PEEK];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_META_PEEK] = 1'b0;
+		cmds_busy_comb[CMD_RX_META_PEEK] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_META_PEEK]) begin
+			cmds_done_comb[CMD_RX_META_PEEK] = 1'b1;
+			cmds_busy_comb[CMD_RX_META_PEEK] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_META_PEEK] & wb.ack) begin
+			cmds_done_comb[CMD_RX_META_PEEK] = 1'b0;
+			cmds_busy_comb[CMD_RX_META_PEEK] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_META_PEEK] <= cmds_done_comb[CMD_RX_META_PEEK];
+	cmds_busy_ff[CMD_RX_META_PEEK] <= cmds_busy_comb[CMD_RX_META_PEEK];
+
+	if (issue.new_request & issue.ready & issue_cmd[CMD_RX_META_PEEK]) begin
+		rx_meta_peek_result_ff <= rx_meta_fifo_r.rd_data[31:0];
+	end
+end
+
 /*
  * Command "RX DATA SKIP"
+ *
+ * rs1[15:0] holds the number of bytes to drop from the RX data FIFO.
+ * It is rounded up to whole FIFO words.
+ * "RX DATA DMA STATUS" reports busy until all words have been dropped.
  */
+localparam int RX_DATA_SKIP_NWORDS_WIDTH = 16 - $clog2(RX_DATA_FIFO_WIDTH/8) + 1;
+
+var logic [RX_DATA_SKIP_NWORDS_WIDTH-1:0] rx_data_skip_nwords;
+wire logic rx_data_fifo_empty = rx_data_fifo_q_empty[rx_queue_sel];
+wire logic rx_data_skip_rd_en = rx_data_skip_nwords != '0 & ~rx_data_fifo_empty;
+
 always_comb begin
 	cmds_done_comb[CMD_RX_DATA_SKIP] = cmds_done_ff[CMD_RX_DATA_SKIP];
 	cmds_busy_comb[CMD_RX_DATA_SKIP] = cmds_busy_ff[CMD_RX_DATA_SKIP];
@@ -195,17 +361,35 @@ always_ff @(posedge clk) begin
 	cmds_done_ff[CMD_RX_DATA_SKIP] <= cmds_done_comb[CMD_RX_DATA_SKIP];
 	cmds_busy_ff[CMD_RX_DATA_SKIP] <= cmds_busy_comb[CMD_RX_DATA_SKIP];
 	if (rst) begin
+		rx_data_skip_nwords <= '0;
 	end
 	else begin
+		if (rx_data_skip_rd_en) begin
+			rx_data_skip_nwords <= rx_data_skip_nwords - 1;
+		end
 		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_DATA_SKIP]) begin
-			// XXX Not implemented yet.
+			rx_data_skip_nwords <= RX_DATA_SKIP_NWORDS_WIDTH'(
+				(17'(sp_inputs.rs1[15:0]) + RX_DATA_FIFO_WIDTH/8 - 1) >> $clog2(RX_DATA_FIFO_WIDTH/8));
 		end
 	end
 end
 
 /*
  * Command "RX DATA DMA START"
+ *
+ * rs1 holds the lower 32 bits of the address.
+ * rs2[15:0] holds the length, rs2[23:16] holds the address bits 39:32.
+ * rs2[27:24] holds the AWCACHE of the transfer (0 selects the default
+ * in the DMA_AXI_AXCACHE register) and rs2[29:28] its AWUSER.
+ * If rs2[30] is set, the transfer goes to the ACP port instead of the
+ * DMA port, e.g. to stash a small frame in the L2 cache.
+ * This is ignored unless RX_DATA_FIFO_WIDTH is 128 (the ACP width).
+ * If rs2[31] is set, the first RX_MIRROR_SIZE bytes of the transfer
+ * are also copied into the RX mirror buffer (see "RX MIRROR DMA START").
  */
+// fifo_to_axi_0 reads from the RX mirror buffer.
+var logic rx_dma_src_mirror;
+
 always_comb begin
 	cmds_done_comb[CMD_RX_DATA_DMA_START] = cmds_done_ff[CMD_RX_DATA_DMA_START];
 	cmds_busy_comb[CMD_RX_DATA_DMA_START] = cmds_busy_ff[CMD_RX_DATA_DMA_START];
@@ -231,15 +415,101 @@ always_ff @(posedge clk) begin
 	cmds_busy_ff[CMD_RX_DATA_DMA_START] <= cmds_busy_comb[CMD_RX_DATA_DMA_START];
 
 	if (rst) begin
+		rx_data_mem_w.acp <= 1'b0;
+		rx_dma_src_mirror <= 1'b0;
 	end
 	else begin
 		rx_data_mem_w.start <= 1'b0;
 
-		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_DATA_DMA_START]) begin
+		// "RX MIRROR DMA START" takes the same operands.
+		if (issue.new_request & issue.ready &
+				(issue_cmd[CMD_RX_DATA_DMA_START] | issue_cmd[CMD_RX_MIRROR_DMA_START])) begin
 			rx_data_mem_w.start <= 1'b1;
-			rx_data_mem_w.addr <= sp_inputs.rs1;
-			rx_data_mem_w.len <= sp_inputs.rs2[15:0];
+			rx_data_mem_w.addr <= DMA_ADDR_WIDTH'({ sp_inputs.rs2[23:16], sp_inputs.rs1 });
+			if (issue_cmd[CMD_RX_MIRROR_DMA_START] && sp_inputs.rs2[15:0] > 16'(RX_MIRROR_SIZE))
+				rx_data_mem_w.len <= 16'(RX_MIRROR_SIZE);
+			else
+				rx_data_mem_w.len <= sp_inputs.rs2[15:0];
+			rx_data_mem_w.cache <= sp_inputs.rs2[27:24] != '0 ? sp_inputs.rs2[27:24] :
+				mmr_r.data[MMR_R_REGN_DMA_AXI_AXCACHE][3:0];
+			rx_data_mem_w.user <= sp_inputs.rs2[29:28];
+			rx_data_mem_w.acp <= RX_DMA_ACP && sp_inputs.rs2[30];
+			rx_dma_src_mirror <= issue_cmd[CMD_RX_MIRROR_DMA_START];
+		end
+	end
+end
+
+/*
+ * Command "RX MIRROR DMA START"
+ *
+ * Writes the bytes copied into the RX mirror buffer by the last
+ * "RX DATA DMA START" with rs2[31] set to a second destination,
+ * e.g. a capture ring.
+ * The operands are the same as for "RX DATA DMA START" (without
+ * rs2[31]), but the length is limited to RX_MIRROR_SIZE bytes.
+ * It must not be longer than the transfer that filled the buffer.
+ * "RX DATA DMA STATUS" reports busy until the transfer is done.
+ */
+var logic [RX_DATA_FIFO_WIDTH-1:0] rx_mirror_buf[RX_MIRROR_NWORDS];
+var logic rx_mirror_capture;
+var logic [RX_MIRROR_IDX_WIDTH-1:0] rx_mirror_wr_idx;
+var logic [RX_MIRROR_IDX_WIDTH-1:0] rx_mirror_rd_idx;
+wire logic rx_mirror_wr_en = rx_mirror_capture & rx_data_fifo_r.rd_en;
+
+assign rx_dma_fifo_r.rd_data = rx_dma_src_mirror ? rx_mirror_buf[rx_mirror_rd_idx] : rx_data_fifo_r.rd_data;
+assign rx_data_fifo_r.rd_en = rx_dma_fifo_r.rd_en & ~rx_dma_src_mirror;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_MIRROR_DMA_START] = cmds_done_ff[CMD_RX_MIRROR_DMA_START];
+	cmds_busy_comb[CMD_RX_MIRROR_DMA_START] = cmds_busy_ff[CMD_RX_MIRROR_DMA_START];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_MIRROR_DMA_START] = 1'b0;
+		cmds_busy_comb[CMD_RX_MIRROR_DMA_START] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_MIRROR_DMA_START]) begin
+			cmds_done_comb[CMD_RX_MIRROR_DMA_START] = 1'b1;
+			cmds_busy_comb[CMD_RX_MIRROR_DMA_START] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_MIRROR_DMA_START] & wb.ack) begin
+			cmds_done_comb[CMD_RX_MIRROR_DMA_START] = 1'b0;
+			cmds_busy_comb[CMD_RX_MIRROR_DMA_START] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_MIRROR_DMA_START] <= cmds_done_comb[CMD_RX_MIRROR_DMA_START];
+	cmds_busy_ff[CMD_RX_MIRROR_DMA_START] <= cmds_busy_comb[CMD_RX_MIRROR_DMA_START];
+
+	if (rst) begin
+		rx_mirror_capture <= 1'b0;
+	end
+	else begin
+		if (rx_mirror_wr_en) begin
+			rx_mirror_wr_idx <= rx_mirror_wr_idx + 1;
+			// The buffer is full.
+			if (rx_mirror_wr_idx == RX_MIRROR_IDX_WIDTH'(RX_MIRROR_NWORDS - 1))
+				rx_mirror_capture <= 1'b0;
+		end
+		if (rx_dma_fifo_r.rd_en & rx_dma_src_mirror) begin
+			rx_mirror_rd_idx <= rx_mirror_rd_idx + 1;
+		end
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_DATA_DMA_START]) begin
+			rx_mirror_capture <= sp_inputs.rs2[31];
+			rx_mirror_wr_idx <= '0;
 		end
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_MIRROR_DMA_START]) begin
+			rx_mirror_rd_idx <= '0;
+		end
+	end
+end
+
+// No reset, so it can go into distributed RAM.
+always_ff @(posedge clk) begin
+	if (rx_mirror_wr_en) begin
+		rx_mirror_buf[rx_mirror_wr_idx] <= rx_data_fifo_r.rd_data;
 	end
 end
 
@@ -276,7 +546,191 @@ always_ff @(posedge clk) begin
 	end
 	else begin
 		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_DATA_DMA_STATUS]) begin
-			rx_data_dma_status_result_ff <= rx_data_mem_w.busy;
+			rx_data_dma_status_result_ff <= rx_data_mem_w.busy | rx_data_skip_nwords != '0;
+		end
+	end
+end
+
+/*
+ * Command "RX CONFIG"
+ *
+ * rs1[0]: Start the payload of IPv4 TCP frames on a new RX data FIFO word
+ *         (needed for LRO)
+ * rs1[1]: Strip the VLAN tag of received frames
+ */
+var logic rx_config_align_payload;
+var logic rx_config_strip_vlan;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_CONFIG] = cmds_done_ff[CMD_RX_CONFIG];
+	cmds_busy_comb[CMD_RX_CONFIG] = cmds_busy_ff[CMD_RX_CONFIG];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_CONFIG] = 1'b0;
+		cmds_busy_comb[CMD_RX_CONFIG] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_CONFIG]) begin
+			cmds_done_comb[CMD_RX_CONFIG] = 1'b1;
+			cmds_busy_comb[CMD_RX_CONFIG] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_CONFIG] & wb.ack) begin
+			cmds_done_comb[CMD_RX_CONFIG] = 1'b0;
+			cmds_busy_comb[CMD_RX_CONFIG] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_CONFIG] <= cmds_done_comb[CMD_RX_CONFIG];
+	cmds_busy_ff[CMD_RX_CONFIG] <= cmds_busy_comb[CMD_RX_CONFIG];
+
+	if (rst) begin
+		rx_config_align_payload <= 1'b0;
+		rx_config_strip_vlan <= 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_CONFIG]) begin
+			rx_config_align_payload <= sp_inputs.rs1[0];
+			rx_config_strip_vlan <= sp_inputs.rs1[1];
+		end
+	end
+end
+
+/*
+ * Command "RX FLOW STATUS"
+ *
+ * Flow control
+ *
+ * The RX data FIFO counts as full from the moment its occupancy reaches
+ * the high-water mark until it drops to the low-water mark again.
+ * Meanwhile, the TX SP sends PAUSE or PFC frames (see sp-desc-tx.c).
+ * Both marks are in units of 64 bytes. A high-water mark of 0 disables
+ * flow control.
+ *
+ * The occupancy is the sum over all queues.
+ * Frames that are already on the wire when the pause is requested must
+ * still fit into the RX data FIFO of their queue, so the high-water mark
+ * is limited to the size of a queue's FIFO minus the space of a frame of
+ * MAX_PACKET_LENGTH bytes.
+ *
+ * Returns 1 in result[0] if the RX data FIFO is full and the high-water
+ * mark in effect in result[31:16].
+ */
+localparam int RX_FLOW_CTRL_MARK_WIDTH = 16;
+localparam int RX_FLOW_CTRL_MARK_UNIT = 64;
+localparam int RX_FLOW_CTRL_HIGH_MAX =
+	(RX_DATA_FIFO_QUEUE_SIZE - MAX_PACKET_FIFO_SPACE) / RX_FLOW_CTRL_MARK_UNIT;
+
+if (RX_FLOW_CTRL_HIGH_MAX < 1 || RX_FLOW_CTRL_HIGH_MAX >= 2**RX_FLOW_CTRL_MARK_WIDTH) begin
+	$error("The RX data FIFO of a queue has no room for a high-water mark");
+end
+
+wire logic [RX_FLOW_CTRL_MARK_WIDTH-1:0] rx_flow_ctrl_high_reg =
+	mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL][RX_FLOW_CTRL_MARK_WIDTH-1:0];
+wire logic [RX_FLOW_CTRL_MARK_WIDTH-1:0] rx_flow_ctrl_high =
+	rx_flow_ctrl_high_reg > RX_FLOW_CTRL_MARK_WIDTH'(RX_FLOW_CTRL_HIGH_MAX) ?
+	RX_FLOW_CTRL_MARK_WIDTH'(RX_FLOW_CTRL_HIGH_MAX) : rx_flow_ctrl_high_reg;
+wire logic [RX_FLOW_CTRL_MARK_WIDTH-1:0] rx_flow_ctrl_low =
+	mmr_r.data[MMR_R_REGN_RX_FLOW_CTRL][2*RX_FLOW_CTRL_MARK_WIDTH-1:RX_FLOW_CTRL_MARK_WIDTH];
+var logic [31:0] rx_data_fifo_r_nbytes;
+
+always_comb begin
+	rx_data_fifo_r_nbytes = '0;
+	for (int q = 0; q < RX_NQUEUES; q++) begin
+		rx_data_fifo_r_nbytes = rx_data_fifo_r_nbytes +
+			32'(rx_data_fifo_q_rd_data_count[q]) * (RX_DATA_FIFO_WIDTH/8);
+	end
+end
+var logic rx_flow_xoff;
+var logic [31:0] rx_flow_status_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_FLOW_STATUS] = cmds_done_ff[CMD_RX_FLOW_STATUS];
+	cmds_busy_comb[CMD_RX_FLOW_STATUS] = cmds_busy_ff[CMD_RX_FLOW_STATUS];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_FLOW_STATUS] = 1'b0;
+		cmds_busy_comb[CMD_RX_FLOW_STATUS] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_FLOW_STATUS]) begin
+			cmds_done_comb[CMD_RX_FLOW_STATUS] = 1'b1;
+			cmds_busy_comb[CMD_RX_FLOW_STATUS] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_FLOW_STATUS] & wb.ack) begin
+			cmds_done_comb[CMD_RX_FLOW_STATUS] = 1'b0;
+			cmds_busy_comb[CMD_RX_FLOW_STATUS] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_FLOW_STATUS] <= cmds_done_comb[CMD_RX_FLOW_STATUS];
+	cmds_busy_ff[CMD_RX_FLOW_STATUS] <= cmds_busy_comb[CMD_RX_FLOW_STATUS];
+
+	if (rst) begin
+		rx_flow_xoff <= 1'b0;
+	end
+	else begin
+		if (rx_flow_ctrl_high == '0) begin
+			rx_flow_xoff <= 1'b0;
+		end
+		else if (rx_data_fifo_r_nbytes >= 32'(rx_flow_ctrl_high) * RX_FLOW_CTRL_MARK_UNIT) begin
+			rx_flow_xoff <= 1'b1;
+		end
+		else if (rx_data_fifo_r_nbytes <= 32'(rx_flow_ctrl_low) * RX_FLOW_CTRL_MARK_UNIT) begin
+			rx_flow_xoff <= 1'b0;
+		end
+
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_FLOW_STATUS]) begin
+			rx_flow_status_result_ff <= { rx_flow_ctrl_high, 15'h0000, rx_flow_xoff };
+		end
+	end
+end
+
+/*
+ * Command "RX QUEUE SELECT"
+ *
+ * rs1 holds the queue the RX meta and data commands and the DMA operate
+ * on from now on. Queues that do not exist select queue 0.
+ * It must not be issued while "RX DATA DMA STATUS" reports busy.
+ *
+ * Returns a bit mask of the queues whose RX meta FIFO is not empty.
+ */
+var logic [RX_NQUEUES-1:0] rx_queue_select_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_RX_QUEUE_SELECT] = cmds_done_ff[CMD_RX_QUEUE_SELECT];
+	cmds_busy_comb[CMD_RX_QUEUE_SELECT] = cmds_busy_ff[CMD_RX_QUEUE_SELECT];
+
+	if (rst) begin
+		cmds_done_comb[CMD_RX_QUEUE_SELECT] = 1'b0;
+		cmds_busy_comb[CMD_RX_QUEUE_SELECT] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_QUEUE_SELECT]) begin
+			cmds_done_comb[CMD_RX_QUEUE_SELECT] = 1'b1;
+			cmds_busy_comb[CMD_RX_QUEUE_SELECT] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_RX_QUEUE_SELECT] & wb.ack) begin
+			cmds_done_comb[CMD_RX_QUEUE_SELECT] = 1'b0;
+			cmds_busy_comb[CMD_RX_QUEUE_SELECT] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_RX_QUEUE_SELECT] <= cmds_done_comb[CMD_RX_QUEUE_SELECT];
+	cmds_busy_ff[CMD_RX_QUEUE_SELECT] <= cmds_busy_comb[CMD_RX_QUEUE_SELECT];
+
+	if (rst) begin
+		rx_queue_sel <= '0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_RX_QUEUE_SELECT]) begin
+			rx_queue_sel <= sp_inputs.rs1 < RX_NQUEUES ? RX_QUEUE_WIDTH'(sp_inputs.rs1) : '0;
+			rx_queue_select_result_ff <= ~rx_meta_fifo_q_empty;
 		end
 	end
 end
@@ -299,9 +753,13 @@ always_comb begin
 	// "Reverse case" statement for one-hot encoding.
 	case (1'b1)
 	//cur_cmd[CMD_RX_META_NELEMS]: result = 32'(rx_meta_nelems_comb);
-	cur_cmd[CMD_RX_META_POP]: result = rx_meta_fifo_read_rd_data;
+	cur_cmd[CMD_RX_META_POP]: result = rx_meta_fifo_read_rd_data[31:0];
 	cur_cmd[CMD_RX_META_EMPTY]: result[0] = rx_meta_fifo_r.empty;
+	cur_cmd[CMD_RX_META_GET]: result = rx_meta_get_result_ff;
 	cur_cmd[CMD_RX_DATA_DMA_STATUS]: result[0] = rx_data_dma_status_result_ff;
+	cur_cmd[CMD_RX_FLOW_STATUS]: result = rx_flow_status_result_ff;
+	cur_cmd[CMD_RX_QUEUE_SELECT]: result[RX_NQUEUES-1:0] = rx_queue_select_result_ff;
+	cur_cmd[CMD_RX_META_PEEK]: result = rx_meta_peek_result_ff;
 	endcase
 end
 
@@ -310,9 +768,137 @@ end
  * GEM RX Interface Clock Domain
  * --------  --------  --------  --------
  */
-localparam int MAX_PACKET_LENGTH = 2047;
-//localparam RX_PACKET_BYTE_COUNT_WIDTH = $clog2(MAX_PACKET_LENGTH + 1);
-localparam int RX_PACKET_BYTE_COUNT_WIDTH = 13;
+// The frame length field of the (jumbo enabled) GEM RX descriptor
+// is 14 bits wide.
+localparam int RX_PACKET_BYTE_COUNT_WIDTH = 14;
+
+if (RX_PACKET_BYTE_COUNT_WIDTH < $clog2(MAX_PACKET_LENGTH + 1)) begin
+	$error("RX_PACKET_BYTE_COUNT_WIDTH is too small for MAX_PACKET_LENGTH");
+end
+
+if (RX_DATA_FIFO_QUEUE_SIZE < MAX_PACKET_FIFO_SPACE) begin
+	$error("The RX data FIFO of a queue cannot hold a frame of MAX_PACKET_LENGTH bytes");
+end
+// A frame is only admitted if at least a minimum-size frame fits.
+localparam int MIN_PACKET_FIFO_SPACE = 64 + RX_DATA_FIFO_WIDTH/8;
+
+/*
+ * VLAN stripping
+ *
+ * If enabled, a VLAN tag (TPID 0x8100) following the MAC addresses is
+ * removed from the frame and reported in the RX meta FIFO.
+ * The TPID (bytes 12 and 13) always ends up in one RX data FIFO word,
+ * so when byte 13 completes the TPID, the write index is moved back to
+ * the slot of byte 12. The TCI (bytes 14 and 15) is not written at all.
+ */
+localparam logic [15:0] ETHERTYPE_VLAN = 16'h8100;
+
+(* ASYNC_REG = "TRUE" *) var logic [1:0] rx_strip_vlan_sync;
+// The number of bytes of the frame so far.
+// It saturates because we are only interested in the first bytes.
+var logic [4:0] rx_vlan_idx_ff;
+wire logic [4:0] rx_vlan_idx = gem_rx.rx_w_sop ? '0 : rx_vlan_idx_ff;
+var logic [7:0] rx_vlan_tpid_hi;
+var logic rx_vlan_tagged;
+var logic rx_vlan_stripped;
+var logic [15:0] rx_vlan_tci;
+
+wire logic rx_vlan_tpid = gem_rx.rx_w_wr &
+	rx_vlan_idx == 5'd13 & { rx_vlan_tpid_hi, gem_rx.rx_w_data[7:0] } == ETHERTYPE_VLAN;
+wire logic rx_vlan_tpid_match = rx_strip_vlan_sync[1] & rx_vlan_tpid;
+wire logic rx_vlan_tci_wr = rx_vlan_stripped & gem_rx.rx_w_wr &
+	(rx_vlan_idx == 5'd14 | rx_vlan_idx == 5'd15);
+// The bytes that actually go into the RX data FIFO
+wire logic rx_w_wr = gem_rx.rx_w_wr & ~rx_vlan_tci_wr;
+
+always_ff @(posedge gem_rx.rx_clock) begin
+	rx_strip_vlan_sync <= { rx_strip_vlan_sync[0], rx_config_strip_vlan };
+end
+
+always_ff @(posedge gem_rx.rx_clock) begin
+	if (!gem_rx.rx_resetn) begin
+		rx_vlan_idx_ff <= '0;
+		rx_vlan_tagged <= 1'b0;
+		rx_vlan_stripped <= 1'b0;
+	end
+	else begin
+		if (gem_rx.rx_w_sop) begin
+			rx_vlan_idx_ff <= '0;
+			rx_vlan_tagged <= 1'b0;
+			rx_vlan_stripped <= 1'b0;
+			rx_vlan_tci <= '0;
+		end
+		if (gem_rx.rx_w_wr) begin
+			if (rx_vlan_idx != 5'd16) begin
+				rx_vlan_idx_ff <= rx_vlan_idx + 1;
+			end
+			if (rx_vlan_idx == 5'd12) begin
+				rx_vlan_tpid_hi <= gem_rx.rx_w_data[7:0];
+			end
+		end
+		if (rx_vlan_tpid) begin
+			rx_vlan_tagged <= 1'b1;
+		end
+		if (rx_vlan_tpid_match) begin
+			rx_vlan_stripped <= 1'b1;
+		end
+		if (rx_vlan_tci_wr) begin
+			rx_vlan_tci <= { rx_vlan_tci[7:0], gem_rx.rx_w_data[7:0] };
+		end
+	end
+end
+
+/*
+ * Queue classification
+ *
+ * The priority (PCP) of the VLAN tag selects the queue through the
+ * RX_QUEUE_MAP register (4 bits per priority, priority 0 in 3:0).
+ * Untagged frames and frames mapped to a queue that does not exist go
+ * to queue 0.
+ * The last byte of the tag is written before the first RX data FIFO
+ * word is complete, so all words of a frame go to the same queue.
+ */
+(* ASYNC_REG = "TRUE" *) var logic [31:0] rx_queue_map_sync[2];
+var logic [2:0] rx_vlan_pcp;
+var logic [RX_QUEUE_WIDTH-1:0] rx_queue_ff;
+var logic [RX_QUEUE_WIDTH-1:0] rx_queue;
+var logic [RX_QUEUE_WIDTH-1:0] rx_queue_mapped;
+
+always_ff @(posedge gem_rx.rx_clock) begin
+	rx_queue_map_sync[0] <= mmr_r.data[MMR_R_REGN_RX_QUEUE_MAP];
+	rx_queue_map_sync[1] <= rx_queue_map_sync[0];
+end
+
+always_comb begin
+	rx_queue_mapped = rx_queue_map_sync[1][rx_vlan_pcp*RX_QUEUE_WIDTH +: RX_QUEUE_WIDTH];
+	if (rx_queue_mapped >= RX_NQUEUES) begin
+		rx_queue_mapped = '0;
+	end
+
+	rx_queue = rx_queue_ff;
+	if (gem_rx.rx_w_sop) begin
+		rx_queue = '0;
+	end
+	if (gem_rx.rx_w_wr & rx_vlan_idx == 5'd15 & rx_vlan_tagged) begin
+		rx_queue = rx_queue_mapped;
+	end
+end
+
+always_ff @(posedge gem_rx.rx_clock) begin
+	if (!gem_rx.rx_resetn) begin
+		rx_queue_ff <= '0;
+		rx_fifo_w_queue <= '0;
+	end
+	else begin
+		rx_queue_ff <= rx_queue;
+		// Aligned with the write enables of the RX FIFOs
+		rx_fifo_w_queue <= rx_queue;
+		if (gem_rx.rx_w_wr & rx_vlan_idx == 5'd14) begin
+			rx_vlan_pcp <= gem_rx.rx_w_data[7:5];
+		end
+	end
+end
+
 var logic [RX_PACKET_BYTE_COUNT_WIDTH-1:0] rx_packet_byte_count_ff;
 var logic [RX_PACKET_BYTE_COUNT_WIDTH-1:0] rx_packet_byte_count_comb;
 
@@ -326,9 +912,13 @@ always_comb begin
 		if (gem_rx.rx_w_sop) begin
 			rx_packet_byte_count_comb = '0;
 		end
-		if (gem_rx.rx_w_wr) begin
+		if (rx_w_wr) begin
 			rx_packet_byte_count_comb = rx_packet_byte_count_comb + 1;
 		end
+		// Bytes 12 and 13 have been counted, but are dropped.
+		if (rx_vlan_tpid_match) begin
+			rx_packet_byte_count_comb = rx_packet_byte_count_comb - 2;
+		end
 	end
 end
 
@@ -340,14 +930,84 @@ gem_rx_w_status_encoder gem_rx_w_status_encoder_inst(
 	.out(gem_rx_w_status_encoded)
 );
 
-var logic rx_data_fifo_has_space_ff;
+/*
+ * Time stamping
+ *
+ * The time is sampled at the start of frame (SOP) and stored in the
+ * RX meta FIFO together with the status word at the end of frame.
+ */
+tsu_time_t rx_sample_time;
+
+tsu_sampler tsu_sampler_rx(
+	.clk(clk),
+	.tsu_time(tsu_time),
+	.sample_clk(gem_rx.rx_clock),
+	.sample_resetn(gem_rx.rx_resetn),
+	.sample(gem_rx.rx_w_sop),
+	.sample_time(rx_sample_time),
+	.sample_valid()
+);
+
+// ts_1 = { sec[1:0], nsec[29:0] }, ts_2 = sec[33:2]
+wire logic [31:0] rx_ts_1 = { rx_sample_time.sec[1:0], rx_sample_time.nsec };
+wire logic [31:0] rx_ts_2 = rx_sample_time.sec[33:2];
+
+/*
+ * Header parsing
+ *
+ * The firmware uses the header length for header/data split and
+ * the LRO words for coalescing TCP segments.
+ * The parser sees the frame as received, so the offsets and the header
+ * length are corrected for a stripped VLAN tag.
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0] rx_align_payload_sync;
+wire logic [31:0] rx_hdr_parser_out;
+wire logic [31:0] rx_hdr_info = rx_vlan_stripped ?
+	{ rx_hdr_parser_out[31:24],
+		rx_hdr_parser_out[23:16] - 8'd4,
+		rx_hdr_parser_out[15:8] - 8'd4,
+		rx_hdr_parser_out[7:0] - 8'd4 } :
+	rx_hdr_parser_out;
+wire logic rx_hdr_end;
+wire logic [31:0] rx_lro_info;
+wire logic [31:0] rx_tcp_ack;
+wire logic [31:0] rx_tcp_win;
+var logic [RX_NQUEUES-1:0] rx_data_fifo_has_space_ff;
+wire logic rx_data_fifo_has_space = rx_data_fifo_has_space_ff[rx_queue];
+wire logic rx_frame_truncated;
+
+always_ff @(posedge gem_rx.rx_clock) begin
+	rx_align_payload_sync <= { rx_align_payload_sync[0], rx_config_align_payload };
+end
+
+gem_rx_hdr_parser gem_rx_hdr_parser_inst(
+	.clk(gem_rx.rx_clock),
+	.resetn(gem_rx.rx_resetn),
+	.sop(gem_rx.rx_w_sop),
+	.wr(gem_rx.rx_w_wr),
+	.data(gem_rx.rx_w_data[7:0]),
+	.eop(gem_rx.rx_w_eop),
+	.eop_ok(rx_data_fifo_has_space & ~rx_frame_truncated & ~gem_rx.rx_w_err),
+	.align_payload(rx_align_payload_sync[1]),
+	.out(rx_hdr_parser_out),
+	.hdr_end(rx_hdr_end),
+	.lro(rx_lro_info),
+	.tcp_ack(rx_tcp_ack),
+	.tcp_win(rx_tcp_win)
+);
+
 var logic rx_data_fifo_state;
 // In number of bytes
-var logic [$clog2(RX_DATA_FIFO_SIZE):0] rx_data_fifo_nfree;
-var logic [13:0] gem_rx_w_status_13_0;
+var logic [$clog2(RX_DATA_FIFO_QUEUE_SIZE):0] rx_data_fifo_nfree[RX_NQUEUES];
 
-// This state machine checks whether there is enough space in the FIFO at
-//  the start of frame (SOP).
+// This state machine takes a snapshot of the free space in the FIFO at
+// the start of frame (SOP).
+// The queue is not known yet, so all queues are checked.
+// The frame length is not known before the end of frame, so a frame is
+// admitted if a minimum-size frame fits. A frame that turns out to be
+// larger than the free space is truncated (see below).
+// The FIFO is only read in the meantime, so the snapshot never
+// overstates the free space.
 always_ff @(posedge gem_rx.rx_clock) begin
 	if (!gem_rx.rx_resetn) begin
 		rx_data_fifo_state <= '0;
@@ -356,19 +1016,39 @@ always_ff @(posedge gem_rx.rx_clock) begin
 		case (rx_data_fifo_state)
 		1'b0: begin
 			if (gem_rx.rx_w_sop) begin
-				gem_rx_w_status_13_0 <= gem_rx.rx_w_status[13:0];
-				rx_data_fifo_nfree <= RX_DATA_FIFO_SIZE - { rx_data_fifo_w_wr_data_count, {($clog2(RX_DATA_FIFO_WIDTH/8)){1'b0}} };
+				for (int q = 0; q < RX_NQUEUES; q++) begin
+					rx_data_fifo_nfree[q] <= RX_DATA_FIFO_QUEUE_SIZE -
+						{ rx_data_fifo_q_wr_data_count[q], {($clog2(RX_DATA_FIFO_WIDTH/8)){1'b0}} };
+				end
 				rx_data_fifo_state <= 1'b1;
 			end
 		end
 		1'b1: begin
-			rx_data_fifo_has_space_ff <= rx_data_fifo_nfree >= gem_rx_w_status_13_0;
+			for (int q = 0; q < RX_NQUEUES; q++) begin
+				rx_data_fifo_has_space_ff[q] <= rx_data_fifo_nfree[q] >= MIN_PACKET_FIFO_SPACE;
+			end
 			rx_data_fifo_state <= 1'b0;
 		end
 		endcase
 	end
 end
 
+/*
+ * Truncation
+ *
+ * If the words of a frame use up the free space of the snapshot, the
+ * remaining words are not written. The meta information of the frame
+ * reports the truncation and the number of bytes written, which the
+ * firmware drops from the RX data FIFO together with the frame.
+ */
+// The number of bytes of the current frame in the RX data FIFO
+var logic [$clog2(RX_DATA_FIFO_QUEUE_SIZE):0] rx_frame_nbytes;
+var logic rx_frame_truncated_ff;
+var logic rx_data_fifo_wr;
+wire logic rx_data_fifo_word_free =
+	rx_frame_nbytes + RX_DATA_FIFO_WIDTH/8 <= rx_data_fifo_nfree[rx_queue];
+assign rx_frame_truncated = rx_frame_truncated_ff | rx_data_fifo_wr & ~rx_data_fifo_word_free;
+
 var logic [RX_DATA_FIFO_WIDTH-1:0] rx_cur_buf_comb;
 var logic [RX_DATA_FIFO_WIDTH-1:0] rx_cur_buf_ff;
 // A bit that is set represents a byte that is not valid.
@@ -383,7 +1063,7 @@ always_comb begin
 		if (gem_rx.rx_w_sop) begin
 			rx_cur_buf_comb = '0;
 		end
-		if (gem_rx.rx_w_wr) begin
+		if (rx_w_wr) begin
 			// Reset the buffer for data security/privacy reasons
 			if (rx_cur_buf_idx[0]) begin
 				rx_cur_buf_comb[RX_DATA_FIFO_WIDTH-1:8] = '0;
@@ -400,6 +1080,11 @@ end
 
 assign rx_data_fifo_w.wr_data = rx_cur_buf_ff;
 
+// If we have a full rx_buf_cur, this is the last header byte of a frame
+// whose payload is aligned or this is the last write, store what we have
+// in the RX data FIFO.
+assign rx_data_fifo_wr = gem_rx.rx_w_eop || (rx_w_wr & rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1]) || rx_hdr_end;
+
 always_ff @(posedge gem_rx.rx_clock) begin
 	rx_cur_buf_ff <= rx_cur_buf_comb;
 	rx_packet_byte_count_ff <= rx_packet_byte_count_comb;
@@ -412,26 +1097,52 @@ always_ff @(posedge gem_rx.rx_clock) begin
 	if (!gem_rx.rx_resetn) begin
 		rx_cur_buf_idx[0] <= 1'b1;
 		rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1:1] <= '0;
+		rx_frame_nbytes <= '0;
+		rx_frame_truncated_ff <= 1'b0;
 	end
 	else begin
-		if (gem_rx.rx_w_wr) begin
+		if (gem_rx.rx_w_sop) begin
+			rx_frame_nbytes <= '0;
+			rx_frame_truncated_ff <= 1'b0;
+		end
+		if (rx_w_wr) begin
 			rx_cur_buf_idx <= {
 				rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-2:0],
 				rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1]
 			};
 		end
+		// Go back to the slot of byte 12 to overwrite the TPID.
+		if (rx_vlan_tpid_match) begin
+			rx_cur_buf_idx <= {
+				rx_cur_buf_idx[0],
+				rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1:1]
+			};
+		end
+		// The payload starts on a new word.
+		if (rx_hdr_end) begin
+			rx_cur_buf_idx[0] <= 1'b1;
+			rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1:1] <= '0;
+		end
 		if (gem_rx.rx_w_eop) begin
-			rx_meta_fifo_w.wr_en <= rx_data_fifo_has_space_ff;
-			rx_meta_fifo_w.wr_data <= gem_rx_w_status_encoded;
+			rx_meta_fifo_w.wr_en <= rx_data_fifo_has_space;
+			rx_meta_fifo_w.wr_data <= {
+				rx_frame_truncated, rx_frame_truncated ? 14'(rx_frame_nbytes) : 14'd0, rx_vlan_stripped, rx_vlan_tci,
+				rx_tcp_win, rx_tcp_ack, rx_lro_info,
+				rx_hdr_info, rx_ts_2, rx_ts_1, gem_rx_w_status_encoded
+			};
 
 			rx_cur_buf_idx[0] <= 1'b1;
 			rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1:1] <= '0;
 		end
-		// If we have a full rx_buf_cur or this is the last write, store what we have
-		// in the RX data FIFO.
-		if (gem_rx.rx_w_eop || (gem_rx.rx_w_wr & rx_cur_buf_idx[(RX_DATA_FIFO_WIDTH/8)-1])) begin
-			rx_data_fifo_w.wr_en <= rx_data_fifo_has_space_ff;
-			gem_rx.rx_w_overflow <= ~rx_data_fifo_has_space_ff & gem_rx.rx_w_eop;
+		if (rx_data_fifo_wr) begin
+			rx_data_fifo_w.wr_en <= rx_data_fifo_has_space & ~rx_frame_truncated;
+			gem_rx.rx_w_overflow <= (~rx_data_fifo_has_space | rx_frame_truncated) & gem_rx.rx_w_eop;
+			if (rx_data_fifo_has_space & ~rx_frame_truncated) begin
+				rx_frame_nbytes <= rx_frame_nbytes + RX_DATA_FIFO_WIDTH/8;
+			end
+			if (rx_data_fifo_has_space & rx_frame_truncated) begin
+				rx_frame_truncated_ff <= 1'b1;
+			end
 		end
 	end
 end
@@ -443,111 +1154,221 @@ end
  */
 `ifdef VERILATOR
 `else
-xpm_fifo_async #(
-	.CDC_SYNC_STAGES(2),
-	.DOUT_RESET_VALUE("0"),
-	.ECC_MODE("no_ecc"),
-	.FIFO_MEMORY_TYPE("auto"),
-	.FIFO_READ_LATENCY(0),
-	.FIFO_WRITE_DEPTH(RX_META_FIFO_DEPTH),
-	.FULL_RESET_VALUE(0),
-	.PROG_EMPTY_THRESH(10),
-	.PROG_FULL_THRESH(10),
-	// Processor clock domain
-	.RD_DATA_COUNT_WIDTH(RX_META_FIFO_RD_DATA_COUNT_WIDTH),
-	.READ_DATA_WIDTH(RX_META_FIFO_WIDTH),
-	.READ_MODE("fwft"),
-	.RELATED_CLOCKS(0),
-	.SIM_ASSERT_CHK(0),
-	.USE_ADV_FEATURES("0707"),
-	.WAKEUP_TIME(0),
-	.WRITE_DATA_WIDTH(RX_META_FIFO_WIDTH),
-	// GEM RX clock domain
-	//.WR_DATA_COUNT_WIDTH(RX_META_FIFO_WR_DATA_COUNT_WIDTH)
-	.WR_DATA_COUNT_WIDTH(1)
-) rx_meta_fifo (
-	// reset is synchronized to wr_clk!
-	.rst(~gem_rx.rx_resetn),
-
-	.rd_clk(clk),
-	.rd_en(rx_meta_fifo_r.rd_en),
-	.dout(rx_meta_fifo_r.rd_data),
-	.empty(rx_meta_fifo_r.empty),
-	.rd_data_count(rx_meta_fifo_w_rd_data_count),
-
-	.wr_clk(gem_rx.rx_clock),
-	.wr_en(rx_meta_fifo_w.wr_en),
-	.din(rx_meta_fifo_w.wr_data),
-	.full(rx_meta_fifo_w.full),
-	.wr_data_count(rx_meta_fifo_w_wr_data_count)
-
-	// for future reference:
-	//
-	//.almost_empty(almost_empty),
-	//.almost_full(almost_full),
-	//.data_valid(data_valid),
-	//.dbiterr(dbiterr),
-	//.overflow(overflow),
-	//.prog_empty(prog_empty),
-	//.prog_full(prog_full),
-	//.rd_rst_busy(rd_rst_busy),
-	//.sbiterr(sbiterr),
-	//.underflow(underflow),
-	//.wr_ack(wr_ack),
-	//.wr_rst_busy(wr_rst_busy),
-	//.injectdbiterr(injectdbiterr),
-	//.injectsbiterr(injectsbiterr),
-	//.sleep(sleep),
-);
-xpm_fifo_async #(
-	.CDC_SYNC_STAGES(2),
-	.DOUT_RESET_VALUE("0"),
-	.ECC_MODE("no_ecc"),
-	.FIFO_MEMORY_TYPE("auto"),
-	.FIFO_READ_LATENCY(0),
-	.FIFO_WRITE_DEPTH(RX_DATA_FIFO_DEPTH),
-	.FULL_RESET_VALUE(0),
-	.PROG_EMPTY_THRESH(10),
-	.PROG_FULL_THRESH(10),
-	// Processor clock domain
-	.RD_DATA_COUNT_WIDTH(RX_DATA_FIFO_RD_DATA_COUNT_WIDTH),
-	.READ_DATA_WIDTH(RX_DATA_FIFO_WIDTH),
-	.READ_MODE("fwft"),
-	.RELATED_CLOCKS(0),
-	.SIM_ASSERT_CHK(0),
-	.USE_ADV_FEATURES("0707"),
-	.WAKEUP_TIME(0),
-	.WRITE_DATA_WIDTH(RX_DATA_FIFO_WIDTH),
-	// GEM RX clock domain
-	//.WR_DATA_COUNT_WIDTH(1)
-	.WR_DATA_COUNT_WIDTH(RX_DATA_FIFO_WR_DATA_COUNT_WIDTH)
-) rx_data_fifo (
-	// reset is synchronized to wr_clk!
-	.rst(~gem_rx.rx_resetn),
-
-	.wr_clk(gem_rx.rx_clock),
-	.wr_en(rx_data_fifo_w.wr_en),
-	.din(rx_data_fifo_w.wr_data),
-	.wr_data_count(rx_data_fifo_w_wr_data_count),
-
-	.rd_clk(clk),
-	.rd_en(rx_data_fifo_r.rd_en),
-	.dout(rx_data_fifo_r.rd_data),
-	.rd_data_count(rx_data_fifo_r_rd_data_count)
-);
+for (genvar q = 0; q < RX_NQUEUES; q++) begin : rx_queue_fifos
+	xpm_fifo_async #(
+		.CDC_SYNC_STAGES(2),
+		.DOUT_RESET_VALUE("0"),
+		.ECC_MODE("no_ecc"),
+		.FIFO_MEMORY_TYPE("auto"),
+		.FIFO_READ_LATENCY(0),
+		.FIFO_WRITE_DEPTH(RX_META_FIFO_QUEUE_DEPTH),
+		.FULL_RESET_VALUE(0),
+		.PROG_EMPTY_THRESH(10),
+		.PROG_FULL_THRESH(10),
+		// Processor clock domain
+		.RD_DATA_COUNT_WIDTH(RX_META_FIFO_RD_DATA_COUNT_WIDTH),
+		.READ_DATA_WIDTH(RX_META_FIFO_WIDTH),
+		.READ_MODE("fwft"),
+		.RELATED_CLOCKS(0),
+		.SIM_ASSERT_CHK(0),
+		.USE_ADV_FEATURES("0707"),
+		.WAKEUP_TIME(0),
+		.WRITE_DATA_WIDTH(RX_META_FIFO_WIDTH),
+		// GEM RX clock domain
+		//.WR_DATA_COUNT_WIDTH(RX_META_FIFO_WR_DATA_COUNT_WIDTH)
+		.WR_DATA_COUNT_WIDTH(1)
+	) rx_meta_fifo (
+		// reset is synchronized to wr_clk!
+		.rst(~gem_rx.rx_resetn),
+
+		.rd_clk(clk),
+		.rd_en(rx_meta_fifo_r.rd_en & rx_queue_sel == q),
+		.dout(rx_meta_fifo_q_rd_data[q]),
+		.empty(rx_meta_fifo_q_empty[q]),
+		.rd_data_count(),
+
+		.wr_clk(gem_rx.rx_clock),
+		.wr_en(rx_meta_fifo_w.wr_en & rx_fifo_w_queue == q),
+		.din(rx_meta_fifo_w.wr_data),
+		.full(),
+		.wr_data_count()
+
+		// for future reference:
+		//
+		//.almost_empty(almost_empty),
+		//.almost_full(almost_full),
+		//.data_valid(data_valid),
+		//.dbiterr(dbiterr),
+		//.overflow(overflow),
+		//.prog_empty(prog_empty),
+		//.prog_full(prog_full),
+		//.rd_rst_busy(rd_rst_busy),
+		//.sbiterr(sbiterr),
+		//.underflow(underflow),
+		//.wr_ack(wr_ack),
+		//.wr_rst_busy(wr_rst_busy),
+		//.injectdbiterr(injectdbiterr),
+		//.injectsbiterr(injectsbiterr),
+		//.sleep(sleep),
+	);
+	xpm_fifo_async #(
+		.CDC_SYNC_STAGES(2),
+		.DOUT_RESET_VALUE("0"),
+		.ECC_MODE("no_ecc"),
+		.FIFO_MEMORY_TYPE("auto"),
+		.FIFO_READ_LATENCY(0),
+		.FIFO_WRITE_DEPTH(RX_DATA_FIFO_DEPTH),
+		.FULL_RESET_VALUE(0),
+		.PROG_EMPTY_THRESH(10),
+		.PROG_FULL_THRESH(10),
+		// Processor clock domain
+		.RD_DATA_COUNT_WIDTH(RX_DATA_FIFO_RD_DATA_COUNT_WIDTH),
+		.READ_DATA_WIDTH(RX_DATA_FIFO_WIDTH),
+		.READ_MODE("fwft"),
+		.RELATED_CLOCKS(0),
+		.SIM_ASSERT_CHK(0),
+		.USE_ADV_FEATURES("0707"),
+		.WAKEUP_TIME(0),
+		.WRITE_DATA_WIDTH(RX_DATA_FIFO_WIDTH),
+		// GEM RX clock domain
+		//.WR_DATA_COUNT_WIDTH(1)
+		.WR_DATA_COUNT_WIDTH(RX_DATA_FIFO_WR_DATA_COUNT_WIDTH)
+	) rx_data_fifo (
+		// reset is synchronized to wr_clk!
+		.rst(~gem_rx.rx_resetn),
+
+		.wr_clk(gem_rx.rx_clock),
+		.wr_en(rx_data_fifo_w.wr_en & rx_fifo_w_queue == q),
+		.din(rx_data_fifo_w.wr_data),
+		.wr_data_count(rx_data_fifo_q_wr_data_count[q]),
+
+		.rd_clk(clk),
+		.rd_en((rx_data_fifo_r.rd_en | rx_data_skip_rd_en) & rx_queue_sel == q),
+		.dout(rx_data_fifo_q_rd_data[q]),
+		.empty(rx_data_fifo_q_empty[q]),
+		.rd_data_count(rx_data_fifo_q_rd_data_count[q])
+	);
+end
 `endif
 
+axi_write_address_channel #(
+	.AXI_AWADDR_WIDTH(DMA_ADDR_WIDTH),
+	.AXI_AWUSER_WIDTH(m_axi_dma_aw.AXI_AWUSER_WIDTH)
+) rx_data_dma_aw();
+axi_write_channel #(
+	.AXI_WDATA_WIDTH(RX_DATA_FIFO_WIDTH)
+) rx_data_dma_w();
+axi_write_response_channel rx_data_dma_b();
+
 fifo_to_axi #(
-	.AXI_ADDR_WIDTH(32)
+	.AXI_ADDR_WIDTH(DMA_ADDR_WIDTH)
 )
 fifo_to_axi_0(
 	.clock(clk),
 	.reset_n(~rst),
 	.mem_w(rx_data_mem_w),
-	.fifo_r(rx_data_fifo_r),
-	.axi_aw(m_axi_dma_aw),
-	.axi_w(m_axi_dma_w),
-	.axi_b(m_axi_dma_b)
+	.fifo_r(rx_dma_fifo_r),
+	.axi_aw(rx_data_dma_aw),
+	.axi_w(rx_data_dma_w),
+	.axi_b(rx_data_dma_b)
+);
+
+/*
+ * Route the transfers of fifo_to_axi_0 to the DMA or the ACP port.
+ * rx_data_mem_w.acp only changes with "RX DATA DMA START" and
+ * "RX MIRROR DMA START", which are not issued while a transfer
+ * is in progress.
+ */
+wire logic rx_data_dma_acp = rx_data_mem_w.acp;
+
+assign m_axi_dma_aw.awid = rx_data_dma_aw.awid;
+assign m_axi_dma_aw.awaddr = rx_data_dma_aw.awaddr;
+assign m_axi_dma_aw.awlen = rx_data_dma_aw.awlen;
+assign m_axi_dma_aw.awsize = rx_data_dma_aw.awsize;
+assign m_axi_dma_aw.awburst = rx_data_dma_aw.awburst;
+assign m_axi_dma_aw.awlock = rx_data_dma_aw.awlock;
+assign m_axi_dma_aw.awcache = rx_data_dma_aw.awcache;
+assign m_axi_dma_aw.awprot = rx_data_dma_aw.awprot;
+assign m_axi_dma_aw.awqos = rx_data_dma_aw.awqos;
+assign m_axi_dma_aw.awregion = rx_data_dma_aw.awregion;
+assign m_axi_dma_aw.awuser = rx_data_dma_aw.awuser;
+assign m_axi_dma_aw.awvalid = !rx_data_dma_acp && rx_data_dma_aw.awvalid;
+assign m_axi_dma_w.wdata = rx_data_dma_w.wdata;
+assign m_axi_dma_w.wstrb = rx_data_dma_w.wstrb;
+assign m_axi_dma_w.wlast = rx_data_dma_w.wlast;
+assign m_axi_dma_w.wuser = rx_data_dma_w.wuser;
+assign m_axi_dma_w.wvalid = !rx_data_dma_acp && rx_data_dma_w.wvalid;
+assign m_axi_dma_b.bready = !rx_data_dma_acp && rx_data_dma_b.bready;
+
+if (RX_DMA_ACP) begin
+assign m_axi_acp_dma_aw.awid = rx_data_dma_aw.awid;
+assign m_axi_acp_dma_aw.awaddr = rx_data_dma_aw.awaddr;
+assign m_axi_acp_dma_aw.awlen = rx_data_dma_aw.awlen;
+assign m_axi_acp_dma_aw.awsize = rx_data_dma_aw.awsize;
+assign m_axi_acp_dma_aw.awburst = rx_data_dma_aw.awburst;
+assign m_axi_acp_dma_aw.awlock = rx_data_dma_aw.awlock;
+assign m_axi_acp_dma_aw.awcache = rx_data_dma_aw.awcache;
+assign m_axi_acp_dma_aw.awprot = rx_data_dma_aw.awprot;
+assign m_axi_acp_dma_aw.awqos = rx_data_dma_aw.awqos;
+assign m_axi_acp_dma_aw.awregion = rx_data_dma_aw.awregion;
+assign m_axi_acp_dma_aw.awuser = rx_data_dma_aw.awuser;
+assign m_axi_acp_dma_aw.awvalid = rx_data_dma_acp && rx_data_dma_aw.awvalid;
+assign m_axi_acp_dma_w.wdata = rx_data_dma_w.wdata;
+assign m_axi_acp_dma_w.wstrb = rx_data_dma_w.wstrb;
+assign m_axi_acp_dma_w.wlast = rx_data_dma_w.wlast;
+assign m_axi_acp_dma_w.wuser = rx_data_dma_w.wuser;
+assign m_axi_acp_dma_w.wvalid = rx_data_dma_acp && rx_data_dma_w.wvalid;
+assign m_axi_acp_dma_b.bready = rx_data_dma_acp && rx_data_dma_b.bready;
+
+assign rx_data_dma_aw.awready = rx_data_dma_acp ? m_axi_acp_dma_aw.awready : m_axi_dma_aw.awready;
+assign rx_data_dma_w.wready = rx_data_dma_acp ? m_axi_acp_dma_w.wready : m_axi_dma_w.wready;
+assign rx_data_dma_b.bid = rx_data_dma_acp ? m_axi_acp_dma_b.bid : m_axi_dma_b.bid;
+assign rx_data_dma_b.bresp = rx_data_dma_acp ? m_axi_acp_dma_b.bresp : m_axi_dma_b.bresp;
+assign rx_data_dma_b.buser = rx_data_dma_acp ? m_axi_acp_dma_b.buser : m_axi_dma_b.buser;
+assign rx_data_dma_b.bvalid = rx_data_dma_acp ? m_axi_acp_dma_b.bvalid : m_axi_dma_b.bvalid;
+end
+else begin
+assign m_axi_acp_dma_aw.awvalid = 1'b0;
+assign m_axi_acp_dma_w.wvalid = 1'b0;
+assign m_axi_acp_dma_b.bready = 1'b0;
+
+assign rx_data_dma_aw.awready = m_axi_dma_aw.awready;
+assign rx_data_dma_w.wready = m_axi_dma_w.wready;
+assign rx_data_dma_b.bid = m_axi_dma_b.bid;
+assign rx_data_dma_b.bresp = m_axi_dma_b.bresp;
+assign rx_data_dma_b.buser = m_axi_dma_b.buser;
+assign rx_data_dma_b.bvalid = m_axi_dma_b.bvalid;
+end
+
+/*
+ * RX counters
+ *
+ * Every byte from the GEM (or the loopback) is counted. A frame is
+ * either stored or dropped, the latter if it was received with an error
+ * or did not fit into the RX FIFOs (including truncated frames).
+ */
+counter_sync counter_sync_rx_nframes(
+	.src_clk(gem_rx.rx_clock),
+	.src_resetn(gem_rx.rx_resetn),
+	.inc(gem_rx.rx_w_eop & rx_data_fifo_has_space & ~rx_frame_truncated & ~gem_rx.rx_w_err),
+	.dst_clk(clk),
+	.count(mmr_s.rx_nframes)
+);
+
+counter_sync counter_sync_rx_nbytes(
+	.src_clk(gem_rx.rx_clock),
+	.src_resetn(gem_rx.rx_resetn),
+	.inc(gem_rx.rx_w_wr),
+	.dst_clk(clk),
+	.count(mmr_s.rx_nbytes)
+);
+
+counter_sync counter_sync_rx_ndrops(
+	.src_clk(gem_rx.rx_clock),
+	.src_resetn(gem_rx.rx_resetn),
+	.inc(gem_rx.rx_w_eop & (~rx_data_fifo_has_space | rx_frame_truncated | gem_rx.rx_w_err)),
+	.dst_clk(clk),
+	.count(mmr_s.rx_ndrops)
 );
 
 endmodule
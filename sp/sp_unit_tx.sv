@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 import sp_unit_config::*;
+import mmr_config::*;
 module sp_unit_tx#(
 	parameter int TX_DATA_FIFO_SIZE,
 	parameter int TX_DATA_FIFO_WIDTH,
@@ -35,7 +36,13 @@ module sp_unit_tx#(
 	axi_read_address_channel.master m_axi_dma_ar,
 	axi_read_channel.master m_axi_dma_r,
 
-	gem_tx_interface.master gem_tx
+	gem_tx_interface.master gem_tx,
+	input tsu_time_t tsu_time,
+
+	// For the configuration registers
+	mmr_read_interface.master mmr_r,
+	// For the packet generator and the TX counters
+	mmr_stats_interface.master mmr_s
 );
 
 // This is currently redundant.
@@ -44,9 +51,14 @@ module sp_unit_tx#(
 if (m_axi_dma_r.AXI_RDATA_WIDTH != TX_DATA_FIFO_WIDTH) begin
 	$error("We don't support m_axi_dma_r.AXI_RDATA_WIDTH != TX_DATA_FIFO_WIDTH)");
 end
+if (m_axi_dma_ar.AXI_ARADDR_WIDTH > 40) begin
+	$error("We don't support DMA addresses wider than 40 bits");
+end
 
-localparam int TX_META_FIFO_WIDTH = 32;
+// rs1 of "TX META PUSH" (the meta word) and the VLAN bits of rs2
+localparam int TX_META_FIFO_WIDTH = 32 + 17;
 localparam int TX_META_FIFO_DEPTH = 2048;
+localparam int DMA_ADDR_WIDTH = m_axi_dma_ar.AXI_ARADDR_WIDTH;
 localparam int TX_DATA_FIFO_DEPTH = TX_DATA_FIFO_SIZE / (TX_DATA_FIFO_WIDTH/8);
 
 localparam int TX_META_FIFO_RD_DATA_COUNT_WIDTH = $clog2(TX_META_FIFO_DEPTH) + 1;
@@ -54,7 +66,50 @@ localparam int TX_META_FIFO_WR_DATA_COUNT_WIDTH = $clog2(TX_META_FIFO_DEPTH) + 1
 localparam int TX_DATA_FIFO_RD_DATA_COUNT_WIDTH = $clog2(TX_DATA_FIFO_DEPTH) + 1;
 localparam int TX_DATA_FIFO_WR_DATA_COUNT_WIDTH = $clog2(TX_DATA_FIFO_DEPTH) + 1;
 
+// Each entry holds the two time stamp words in the layout of the GEM's
+// extended descriptors and the status of the frame. The status bit is
+// set if the GEM aborted the frame because its data did not arrive in
+// time (cut-through).
+// The time stamp, the underflow bit and the tag of the frame
+localparam int TX_TS_FIFO_WIDTH = 2*32 + 1 + 4;
+localparam int TX_TS_FIFO_DEPTH = 16;
+
+// Holds the headers of frames which are put together from a header
+// pushed by the firmware and a payload in the TX data FIFO (TSO).
+localparam int TX_HDR_FIFO_WIDTH = 32;
+localparam int TX_HDR_FIFO_DEPTH = 1024;
+
+// Holds the launch times of frames in the layout of the TX time stamp
+// FIFO.
+localparam int TX_LAUNCH_FIFO_WIDTH = 2*32;
+localparam int TX_LAUNCH_FIFO_DEPTH = 16;
+
+// Holds one control frame (e.g. PAUSE) that is sent ahead of the frames
+// in the TX meta FIFO.
+localparam int TX_CTRL_NWORDS = 16;
+localparam int TX_CTRL_LEN_WIDTH = $clog2(TX_CTRL_NWORDS * 4) + 1;
+
 localparam int TX_META_DESC_NOCRC_BITN = 31;
+localparam int TX_META_DESC_TSTAMP_BITN = 30;
+// The frame was pushed before all of its data is in the TX data FIFO.
+localparam int TX_META_DESC_CUT_THROUGH_BITN = 29;
+// The frame has an entry in the TX launch FIFO.
+localparam int TX_META_DESC_LAUNCH_BITN = 28;
+// Returned with the time stamp, so the firmware can tell which frame
+// it belongs to.
+localparam int TX_META_DESC_TS_TAG_BITN = 24;
+localparam int TX_META_DESC_TS_TAG_WIDTH = 4;
+// The number of bytes to take from the TX header FIFO before the
+// TX data FIFO.
+localparam int TX_META_DESC_HDR_LEN_BITN = 16;
+localparam int TX_META_DESC_HDR_LEN_WIDTH = 8;
+// Taken from rs2[16:0]: insert a VLAN tag with the TCI in 15:0.
+localparam int TX_META_VLAN_TCI_BITN = 32;
+localparam int TX_META_VLAN_TCI_WIDTH = 16;
+localparam int TX_META_VLAN_INSERT_BITN = 48;
+
+// Wide enough for jumbo frames.
+localparam int TX_PACKET_BYTE_COUNT_WIDTH = 14;
 
 if (TX_DATA_FIFO_WIDTH < 32) begin
 	$error("We don't support a TX DATA FIFO width of less than 32.");
@@ -95,11 +150,56 @@ fifo_write_interface #(
 ) tx_data_fifo_w();
 wire logic [TX_DATA_FIFO_WR_DATA_COUNT_WIDTH-1:0] tx_data_fifo_w_wr_data_count;
 
+/*
+ * Interfaces for the TX time stamp FIFO
+ */
+fifo_read_interface #(
+	.DATA_WIDTH(TX_TS_FIFO_WIDTH)
+) tx_ts_fifo_r();
+
+fifo_write_interface #(
+	.DATA_WIDTH(TX_TS_FIFO_WIDTH)
+) tx_ts_fifo_w();
+
+/*
+ * Interfaces for the TX header FIFO
+ */
+fifo_read_interface #(
+	.DATA_WIDTH(TX_HDR_FIFO_WIDTH)
+) tx_hdr_fifo_r();
+
+fifo_write_interface #(
+	.DATA_WIDTH(TX_HDR_FIFO_WIDTH)
+) tx_hdr_fifo_w();
+
+/*
+ * Interfaces for the TX launch FIFO
+ */
+fifo_read_interface #(
+	.DATA_WIDTH(TX_LAUNCH_FIFO_WIDTH)
+) tx_launch_fifo_r();
+
+fifo_write_interface #(
+	.DATA_WIDTH(TX_LAUNCH_FIFO_WIDTH)
+) tx_launch_fifo_w();
+
 memory_read_interface #(
 	.DATA_WIDTH(TX_DATA_FIFO_WIDTH),
-	.ADDR_WIDTH(32)
+	.ADDR_WIDTH(DMA_ADDR_WIDTH)
 ) tx_data_mem_r();
 
+/*
+ * Interfaces of the packet generator to the TX meta and data FIFOs
+ */
+fifo_write_interface #(
+	.DATA_WIDTH(TX_META_FIFO_WIDTH)
+) tx_gen_meta_fifo_w();
+
+fifo_write_interface #(
+	.DATA_WIDTH(TX_DATA_FIFO_WIDTH)
+) tx_gen_data_fifo_w();
+wire logic tx_gen_active;
+
 /*
  * --------  --------  --------  --------
  * PL Clock Domain
@@ -141,7 +241,7 @@ always_ff @(posedge clk) begin
 
 		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_META_PUSH]) begin
 			tx_meta_fifo_w.wr_en <= 1'b1;
-			tx_meta_fifo_w.wr_data <= sp_inputs.rs1;
+			tx_meta_fifo_w.wr_data <= { sp_inputs.rs2[16:0], sp_inputs.rs1 };
 		end
 	end
 end
@@ -214,6 +314,12 @@ end
 
 /*
  * Command "TX DATA DMA START"
+ *
+ * rs1 holds the lower 32 bits of the address.
+ * rs2[15:0] holds the length, rs2[23:16] holds the address bits 39:32
+ * and rs2[31] is set if more data of the same frame follows.
+ * rs2[27:24] holds the ARCACHE of the transfer (0 selects the default
+ * in the DMA_AXI_AXCACHE register) and rs2[29:28] its ARUSER.
  */
 always_comb begin
 	cmds_done_comb[CMD_TX_DATA_DMA_START] = cmds_done_ff[CMD_TX_DATA_DMA_START];
@@ -246,9 +352,12 @@ always_ff @(posedge clk) begin
 
 		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_DATA_DMA_START]) begin
 			tx_data_mem_r.start <= 1'b1;
-			tx_data_mem_r.addr <= sp_inputs.rs1;
+			tx_data_mem_r.addr <= DMA_ADDR_WIDTH'({ sp_inputs.rs2[23:16], sp_inputs.rs1 });
 			tx_data_mem_r.len <= sp_inputs.rs2[15:0];
 			tx_data_mem_r.cont <= sp_inputs.rs2[31];
+			tx_data_mem_r.cache <= sp_inputs.rs2[27:24] != '0 ? sp_inputs.rs2[27:24] :
+				mmr_r.data[MMR_R_REGN_DMA_AXI_AXCACHE][3:0];
+			tx_data_mem_r.user <= sp_inputs.rs2[29:28];
 		end
 	end
 end
@@ -291,6 +400,470 @@ always_ff @(posedge clk) begin
 	end
 end
 
+/*
+ * Command "TX TS EMPTY"
+ */
+always_comb begin
+	cmds_done_comb[CMD_TX_TS_EMPTY] = cmds_done_ff[CMD_TX_TS_EMPTY];
+	cmds_busy_comb[CMD_TX_TS_EMPTY] = cmds_busy_ff[CMD_TX_TS_EMPTY];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_TS_EMPTY] = 1'b0;
+		cmds_busy_comb[CMD_TX_TS_EMPTY] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TS_EMPTY]) begin
+			cmds_done_comb[CMD_TX_TS_EMPTY] = 1'b1;
+			cmds_busy_comb[CMD_TX_TS_EMPTY] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_TS_EMPTY] & wb.ack) begin
+			cmds_done_comb[CMD_TX_TS_EMPTY] = 1'b0;
+			cmds_busy_comb[CMD_TX_TS_EMPTY] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_TS_EMPTY] <= cmds_done_comb[CMD_TX_TS_EMPTY];
+	cmds_busy_ff[CMD_TX_TS_EMPTY] <= cmds_busy_comb[CMD_TX_TS_EMPTY];
+end
+
+/*
+ * Command "TX TS POP"
+ *
+ * The whole entry is latched for "TX TS GET", but only the
+ * first word is returned.
+ */
+var logic [TX_TS_FIFO_WIDTH-1:0] tx_ts_fifo_read_rd_data;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_TS_POP] = cmds_done_ff[CMD_TX_TS_POP];
+	cmds_busy_comb[CMD_TX_TS_POP] = cmds_busy_ff[CMD_TX_TS_POP];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_TS_POP] = 1'b0;
+		cmds_busy_comb[CMD_TX_TS_POP] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TS_POP]) begin
+			cmds_done_comb[CMD_TX_TS_POP] = 1'b1;
+			cmds_busy_comb[CMD_TX_TS_POP] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_TS_POP] & wb.ack) begin
+			cmds_done_comb[CMD_TX_TS_POP] = 1'b0;
+			cmds_busy_comb[CMD_TX_TS_POP] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_TS_POP] <= cmds_done_comb[CMD_TX_TS_POP];
+	cmds_busy_ff[CMD_TX_TS_POP] <= cmds_busy_comb[CMD_TX_TS_POP];
+
+	if (rst) begin
+		tx_ts_fifo_r.rd_en <= 1'b0;
+	end
+	else begin
+		tx_ts_fifo_r.rd_en <= 1'b0;
+
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TS_POP]) begin
+			tx_ts_fifo_r.rd_en <= 1'b1;
+			tx_ts_fifo_read_rd_data <= tx_ts_fifo_r.rd_data;
+		end
+	end
+end
+
+/*
+ * Command "TX TS GET"
+ *
+ * Returns word rs1 of the entry latched by the last "TX TS POP".
+ * Word 2 holds the status bits and the tag of the frame.
+ */
+var logic [31:0] tx_ts_get_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_TS_GET] = cmds_done_ff[CMD_TX_TS_GET];
+	cmds_busy_comb[CMD_TX_TS_GET] = cmds_busy_ff[CMD_TX_TS_GET];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_TS_GET] = 1'b0;
+		cmds_busy_comb[CMD_TX_TS_GET] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TS_GET]) begin
+			cmds_done_comb[CMD_TX_TS_GET] = 1'b1;
+			cmds_busy_comb[CMD_TX_TS_GET] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_TS_GET] & wb.ack) begin
+			cmds_done_comb[CMD_TX_TS_GET] = 1'b0;
+			cmds_busy_comb[CMD_TX_TS_GET] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_TS_GET] <= cmds_done_comb[CMD_TX_TS_GET];
+	cmds_busy_ff[CMD_TX_TS_GET] <= cmds_busy_comb[CMD_TX_TS_GET];
+
+	if (rst) begin
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TS_GET]) begin
+			case (sp_inputs.rs1[1:0])
+			2'd0: tx_ts_get_result_ff <= tx_ts_fifo_read_rd_data[31:0];
+			2'd1: tx_ts_get_result_ff <= tx_ts_fifo_read_rd_data[63:32];
+			default: tx_ts_get_result_ff <= 32'(tx_ts_fifo_read_rd_data[TX_TS_FIFO_WIDTH-1:64]);
+			endcase
+		end
+	end
+end
+
+/*
+ * Command "TX HDR PUSH"
+ *
+ * Pushes rs1 into the TX header FIFO.
+ * Returns 1 if the FIFO was full and nothing was pushed.
+ */
+var logic tx_hdr_push_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_HDR_PUSH] = cmds_done_ff[CMD_TX_HDR_PUSH];
+	cmds_busy_comb[CMD_TX_HDR_PUSH] = cmds_busy_ff[CMD_TX_HDR_PUSH];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_HDR_PUSH] = 1'b0;
+		cmds_busy_comb[CMD_TX_HDR_PUSH] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_HDR_PUSH]) begin
+			cmds_done_comb[CMD_TX_HDR_PUSH] = 1'b1;
+			cmds_busy_comb[CMD_TX_HDR_PUSH] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_HDR_PUSH] & wb.ack) begin
+			cmds_done_comb[CMD_TX_HDR_PUSH] = 1'b0;
+			cmds_busy_comb[CMD_TX_HDR_PUSH] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_HDR_PUSH] <= cmds_done_comb[CMD_TX_HDR_PUSH];
+	cmds_busy_ff[CMD_TX_HDR_PUSH] <= cmds_busy_comb[CMD_TX_HDR_PUSH];
+
+	if (rst) begin
+		tx_hdr_fifo_w.wr_en <= 1'b0;
+	end
+	else begin
+		// Unpulse
+		tx_hdr_fifo_w.wr_en <= 1'b0;
+
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_HDR_PUSH]) begin
+			tx_hdr_fifo_w.wr_en <= ~tx_hdr_fifo_w.full;
+			tx_hdr_fifo_w.wr_data <= sp_inputs.rs1;
+			tx_hdr_push_result_ff <= tx_hdr_fifo_w.full;
+		end
+	end
+end
+
+/*
+ * Command "TX LAUNCH PUSH"
+ *
+ * Pushes the launch time of the next frame into the TX launch FIFO.
+ * rs1 = { sec[1:0], nsec[29:0] }, rs2 = sec[33:2]
+ * Returns 1 if the FIFO was full and nothing was pushed.
+ */
+var logic tx_launch_push_result_ff;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_LAUNCH_PUSH] = cmds_done_ff[CMD_TX_LAUNCH_PUSH];
+	cmds_busy_comb[CMD_TX_LAUNCH_PUSH] = cmds_busy_ff[CMD_TX_LAUNCH_PUSH];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_LAUNCH_PUSH] = 1'b0;
+		cmds_busy_comb[CMD_TX_LAUNCH_PUSH] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_LAUNCH_PUSH]) begin
+			cmds_done_comb[CMD_TX_LAUNCH_PUSH] = 1'b1;
+			cmds_busy_comb[CMD_TX_LAUNCH_PUSH] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_LAUNCH_PUSH] & wb.ack) begin
+			cmds_done_comb[CMD_TX_LAUNCH_PUSH] = 1'b0;
+			cmds_busy_comb[CMD_TX_LAUNCH_PUSH] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_LAUNCH_PUSH] <= cmds_done_comb[CMD_TX_LAUNCH_PUSH];
+	cmds_busy_ff[CMD_TX_LAUNCH_PUSH] <= cmds_busy_comb[CMD_TX_LAUNCH_PUSH];
+
+	if (rst) begin
+		tx_launch_fifo_w.wr_en <= 1'b0;
+	end
+	else begin
+		// Unpulse
+		tx_launch_fifo_w.wr_en <= 1'b0;
+
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_LAUNCH_PUSH]) begin
+			tx_launch_fifo_w.wr_en <= ~tx_launch_fifo_w.full;
+			tx_launch_fifo_w.wr_data <= { sp_inputs.rs2, sp_inputs.rs1 };
+			tx_launch_push_result_ff <= tx_launch_fifo_w.full;
+		end
+	end
+end
+
+/*
+ * Command "TX TSU GET"
+ *
+ * Returns word rs1 of the TSU time, in the layout of the TX time stamps.
+ * Word 0 = { sec[1:0], nsec[29:0] } latches word 1 = sec[33:2], so
+ * reading word 0 first gives a consistent time.
+ */
+var logic [31:0] tx_tsu_get_result_ff;
+var logic [31:0] tx_tsu_sec_shadow;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_TSU_GET] = cmds_done_ff[CMD_TX_TSU_GET];
+	cmds_busy_comb[CMD_TX_TSU_GET] = cmds_busy_ff[CMD_TX_TSU_GET];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_TSU_GET] = 1'b0;
+		cmds_busy_comb[CMD_TX_TSU_GET] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TSU_GET]) begin
+			cmds_done_comb[CMD_TX_TSU_GET] = 1'b1;
+			cmds_busy_comb[CMD_TX_TSU_GET] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_TSU_GET] & wb.ack) begin
+			cmds_done_comb[CMD_TX_TSU_GET] = 1'b0;
+			cmds_busy_comb[CMD_TX_TSU_GET] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_TSU_GET] <= cmds_done_comb[CMD_TX_TSU_GET];
+	cmds_busy_ff[CMD_TX_TSU_GET] <= cmds_busy_comb[CMD_TX_TSU_GET];
+
+	if (rst) begin
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_TSU_GET]) begin
+			if (~sp_inputs.rs1[0]) begin
+				tx_tsu_get_result_ff <= { tsu_time.sec[1:0], tsu_time.nsec };
+				tx_tsu_sec_shadow <= tsu_time.sec[33:2];
+			end
+			else begin
+				tx_tsu_get_result_ff <= tx_tsu_sec_shadow;
+			end
+		end
+	end
+end
+
+/*
+ * Command "TX CTRL PUSH"
+ *
+ * Writes rs1 into the next word of the TX control frame slot.
+ * A non-zero rs2 marks the last word and holds the length of the frame
+ * in bytes (at most TX_CTRL_NWORDS * 4). The frame is then handed to
+ * the GEM at the next frame boundary (see Control frames).
+ * Returns 1 if the slot still held a frame and nothing was written.
+ */
+var logic [TX_CTRL_NWORDS-1:0][31:0] tx_ctrl_buf;
+var logic [TX_CTRL_LEN_WIDTH-1:0] tx_ctrl_len;
+var logic [$clog2(TX_CTRL_NWORDS)-1:0] tx_ctrl_wr_idx;
+var logic tx_ctrl_push_result_ff;
+// Toggled for each frame put into the slot and for each frame sent
+// (in the GEM TX clock domain).
+var logic tx_ctrl_req_tog = 1'b0;
+var logic tx_ctrl_ack_tog = 1'b0;
+(* ASYNC_REG = "TRUE" *) var logic [1:0] tx_ctrl_ack_sync;
+wire logic tx_ctrl_busy = tx_ctrl_req_tog != tx_ctrl_ack_sync[1];
+
+always_comb begin
+	cmds_done_comb[CMD_TX_CTRL_PUSH] = cmds_done_ff[CMD_TX_CTRL_PUSH];
+	cmds_busy_comb[CMD_TX_CTRL_PUSH] = cmds_busy_ff[CMD_TX_CTRL_PUSH];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_CTRL_PUSH] = 1'b0;
+		cmds_busy_comb[CMD_TX_CTRL_PUSH] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CTRL_PUSH]) begin
+			cmds_done_comb[CMD_TX_CTRL_PUSH] = 1'b1;
+			cmds_busy_comb[CMD_TX_CTRL_PUSH] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_CTRL_PUSH] & wb.ack) begin
+			cmds_done_comb[CMD_TX_CTRL_PUSH] = 1'b0;
+			cmds_busy_comb[CMD_TX_CTRL_PUSH] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_CTRL_PUSH] <= cmds_done_comb[CMD_TX_CTRL_PUSH];
+	cmds_busy_ff[CMD_TX_CTRL_PUSH] <= cmds_busy_comb[CMD_TX_CTRL_PUSH];
+	tx_ctrl_ack_sync <= { tx_ctrl_ack_sync[0], tx_ctrl_ack_tog };
+
+	if (rst) begin
+		tx_ctrl_wr_idx <= '0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CTRL_PUSH]) begin
+			tx_ctrl_push_result_ff <= tx_ctrl_busy;
+			if (~tx_ctrl_busy) begin
+				tx_ctrl_buf[tx_ctrl_wr_idx] <= sp_inputs.rs1;
+				tx_ctrl_wr_idx <= tx_ctrl_wr_idx + 1;
+				if (sp_inputs.rs2 != '0) begin
+					tx_ctrl_len <= TX_CTRL_LEN_WIDTH'(sp_inputs.rs2);
+					tx_ctrl_wr_idx <= '0;
+					tx_ctrl_req_tog <= ~tx_ctrl_req_tog;
+				end
+			end
+		end
+	end
+end
+
+/*
+ * Checksum
+ *
+ * The 16-bit one's complement sum (as used by IP, TCP and UDP) of all
+ * bytes written to the TX data FIFO is accumulated here.
+ * Only the bytes requested by "TX DATA DMA START" are taken into account,
+ * so the unused bytes of the last word of a frame do not matter.
+ * Sums are built on even byte offsets relative to the start of the
+ * first DMA transfer. Transfers chained with rs2[31] are packed back to
+ * back, so the offsets go on across them.
+ */
+localparam int TX_DATA_FIFO_NBYTES = TX_DATA_FIFO_WIDTH / 8;
+
+var logic [15:0] tx_csum_expected;
+var logic [15:0] tx_csum_written;
+var logic [31:0] tx_csum_acc;
+var logic [15:0] tx_csum_remaining_comb;
+var logic [15:0] tx_csum_valid_comb;
+var logic [31:0] tx_csum_word_sum_comb;
+
+always_comb begin
+	tx_csum_remaining_comb = tx_csum_expected - tx_csum_written;
+	if (tx_csum_remaining_comb >= TX_DATA_FIFO_NBYTES)
+		tx_csum_valid_comb = TX_DATA_FIFO_NBYTES;
+	else
+		tx_csum_valid_comb = tx_csum_remaining_comb;
+
+	tx_csum_word_sum_comb = '0;
+	for (int i = 0; i < TX_DATA_FIFO_NBYTES; i += 2) begin
+		tx_csum_word_sum_comb += {
+			i < tx_csum_valid_comb ? tx_data_fifo_w.wr_data[i*8 +: 8] : 8'h00,
+			i + 1 < tx_csum_valid_comb ? tx_data_fifo_w.wr_data[(i+1)*8 +: 8] : 8'h00
+		};
+	end
+end
+
+/*
+ * Command "TX CSUM GET"
+ *
+ * Returns the folded (but not complemented) sum and starts over.
+ */
+var logic [15:0] tx_csum_get_result_ff;
+var logic [16:0] tx_csum_fold_comb;
+
+always_comb begin
+	tx_csum_fold_comb = tx_csum_acc[31:16] + tx_csum_acc[15:0];
+	tx_csum_fold_comb = tx_csum_fold_comb[16] + tx_csum_fold_comb[15:0];
+end
+
+always_comb begin
+	cmds_done_comb[CMD_TX_CSUM_GET] = cmds_done_ff[CMD_TX_CSUM_GET];
+	cmds_busy_comb[CMD_TX_CSUM_GET] = cmds_busy_ff[CMD_TX_CSUM_GET];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_CSUM_GET] = 1'b0;
+		cmds_busy_comb[CMD_TX_CSUM_GET] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CSUM_GET]) begin
+			cmds_done_comb[CMD_TX_CSUM_GET] = 1'b1;
+			cmds_busy_comb[CMD_TX_CSUM_GET] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_CSUM_GET] & wb.ack) begin
+			cmds_done_comb[CMD_TX_CSUM_GET] = 1'b0;
+			cmds_busy_comb[CMD_TX_CSUM_GET] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_CSUM_GET] <= cmds_done_comb[CMD_TX_CSUM_GET];
+	cmds_busy_ff[CMD_TX_CSUM_GET] <= cmds_busy_comb[CMD_TX_CSUM_GET];
+
+	if (rst) begin
+		tx_csum_expected <= '0;
+		tx_csum_written <= '0;
+		tx_csum_acc <= '0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_DATA_DMA_START]) begin
+			tx_csum_expected <= tx_csum_expected + sp_inputs.rs2[15:0];
+		end
+		if (tx_data_fifo_w.wr_en) begin
+			tx_csum_written <= tx_csum_written + tx_csum_valid_comb;
+		end
+
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CSUM_GET]) begin
+			tx_csum_get_result_ff <= tx_csum_fold_comb[15:0];
+			tx_csum_acc <= tx_data_fifo_w.wr_en ? tx_csum_word_sum_comb : '0;
+		end
+		else if (tx_data_fifo_w.wr_en) begin
+			tx_csum_acc <= tx_csum_acc + tx_csum_word_sum_comb;
+		end
+	end
+end
+
+/*
+ * TX CONFIG
+ *
+ * rs1[13:0]: The number of bytes of a cut-through frame that must be in
+ *            the TX data FIFO before the frame is handed to the GEM
+ */
+var logic [TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_config_ct_threshold;
+
+always_comb begin
+	cmds_done_comb[CMD_TX_CONFIG] = cmds_done_ff[CMD_TX_CONFIG];
+	cmds_busy_comb[CMD_TX_CONFIG] = cmds_busy_ff[CMD_TX_CONFIG];
+
+	if (rst) begin
+		cmds_done_comb[CMD_TX_CONFIG] = 1'b0;
+		cmds_busy_comb[CMD_TX_CONFIG] = 1'b0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CONFIG]) begin
+			cmds_done_comb[CMD_TX_CONFIG] = 1'b1;
+			cmds_busy_comb[CMD_TX_CONFIG] = 1'b1;
+		end
+		if (cmds_done_ff[CMD_TX_CONFIG] & wb.ack) begin
+			cmds_done_comb[CMD_TX_CONFIG] = 1'b0;
+			cmds_busy_comb[CMD_TX_CONFIG] = 1'b0;
+		end
+	end
+end
+
+always_ff @(posedge clk) begin
+	cmds_done_ff[CMD_TX_CONFIG] <= cmds_done_comb[CMD_TX_CONFIG];
+	cmds_busy_ff[CMD_TX_CONFIG] <= cmds_busy_comb[CMD_TX_CONFIG];
+
+	if (rst) begin
+		tx_config_ct_threshold <= '0;
+	end
+	else begin
+		if (issue.new_request & issue.ready & issue_cmd[CMD_TX_CONFIG]) begin
+			tx_config_ct_threshold <= sp_inputs.rs1[TX_PACKET_BYTE_COUNT_WIDTH-1:0];
+		end
+	end
+end
+
 var logic [SP_UNIT_TX_NCMDS-1:0] cur_cmd;
 
 always_ff @(posedge clk) begin
@@ -312,6 +885,14 @@ always_comb begin
 	cur_cmd[CMD_TX_META_FULL]: result[0] = tx_meta_fifo_w.full;
 	cur_cmd[CMD_TX_DATA_COUNT]: result = 31'(tx_data_count_result_ff);
 	cur_cmd[CMD_TX_DATA_DMA_STATUS]: result[0] = tx_data_dma_status_result_ff;
+	cur_cmd[CMD_TX_TS_EMPTY]: result[0] = tx_ts_fifo_r.empty;
+	cur_cmd[CMD_TX_TS_POP]: result = tx_ts_fifo_read_rd_data[31:0];
+	cur_cmd[CMD_TX_TS_GET]: result = tx_ts_get_result_ff;
+	cur_cmd[CMD_TX_HDR_PUSH]: result[0] = tx_hdr_push_result_ff;
+	cur_cmd[CMD_TX_CSUM_GET]: result = 32'(tx_csum_get_result_ff);
+	cur_cmd[CMD_TX_LAUNCH_PUSH]: result[0] = tx_launch_push_result_ff;
+	cur_cmd[CMD_TX_TSU_GET]: result = tx_tsu_get_result_ff;
+	cur_cmd[CMD_TX_CTRL_PUSH]: result[0] = tx_ctrl_push_result_ff;
 	endcase
 end
 
@@ -320,7 +901,6 @@ end
  * GEM TX Interface Clock Domain
  * --------  --------  --------  --------
  */
-localparam int TX_PACKET_BYTE_COUNT_WIDTH = 13;
 var logic [TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_packet_byte_count_ff;
 var logic [TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_packet_byte_count_comb;
 
@@ -328,6 +908,132 @@ var logic [TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_packet_byte_count_comb;
 var logic tx_state = 1'b0;
 var logic tx_last_byte_comb;
 
+// The header (if any) is sent before the contents of the TX data FIFO.
+var logic [TX_META_DESC_HDR_LEN_WIDTH-1:0] tx_hdr_bytes_left;
+var logic [TX_HDR_FIFO_WIDTH-1:0] tx_hdr_buf;
+var logic [$clog2(TX_HDR_FIFO_WIDTH/8)-1:0] tx_hdr_buf_idx;
+wire logic [TX_META_DESC_HDR_LEN_WIDTH-1:0] tx_meta_hdr_len =
+	tx_meta_fifo_r.rd_data[TX_META_DESC_HDR_LEN_BITN +: TX_META_DESC_HDR_LEN_WIDTH];
+wire logic tx_meta_hdr_only = TX_PACKET_BYTE_COUNT_WIDTH'(tx_meta_hdr_len) ==
+	tx_meta_fifo_r.rd_data[TX_PACKET_BYTE_COUNT_WIDTH-1:0];
+
+var logic [TX_DATA_FIFO_WIDTH-1:0] tx_cur_buf;
+// All zero if the next word was not yet in the TX data FIFO when the
+// buffer was used up (cut-through frames only).
+var logic [(TX_DATA_FIFO_WIDTH/8)-1:0] tx_cur_buf_valid;
+
+/*
+ * Cut-through
+ *
+ * A frame pushed with TX_META_DESC_CUT_THROUGH_BITN set is handed to the
+ * GEM as soon as the configured number of bytes (or the whole frame) is
+ * in the TX data FIFO. If the GEM then reads a byte that has not arrived
+ * yet, tx_r_underflow is signalled, the GEM aborts the frame and the
+ * rest of the frame is dropped from the TX data FIFO as it comes in.
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0][TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_ct_threshold_sync;
+var logic tx_drain = 1'b0;
+
+always_ff @(posedge gem_tx.tx_clock) begin
+	// The threshold is only changed while TX is idle.
+	tx_ct_threshold_sync <= { tx_ct_threshold_sync[0], tx_config_ct_threshold };
+end
+
+wire logic tx_meta_cut_through = tx_meta_fifo_r.rd_data[TX_META_DESC_CUT_THROUGH_BITN];
+wire logic [31:0] tx_data_fifo_r_nbytes =
+	32'(tx_data_fifo_r_rd_data_count) * (TX_DATA_FIFO_WIDTH/8);
+wire logic tx_start_ok = ~tx_meta_cut_through | (~tx_data_fifo_r.empty &
+	(tx_data_fifo_r_nbytes >= 32'(tx_ct_threshold_sync[1]) |
+	tx_data_fifo_r_nbytes >= 32'(tx_meta_fifo_r.rd_data[TX_PACKET_BYTE_COUNT_WIDTH-1:0])));
+
+/*
+ * Launch time
+ *
+ * A frame pushed with TX_META_DESC_LAUNCH_BITN set is held until the
+ * TSU time reaches the launch time at the head of the TX launch FIFO.
+ * The TSU time is sampled continuously into the GEM TX clock domain, so
+ * frames go out a few PL and GEM TX clock cycles after their launch time.
+ * Since the frames of all queues wait behind such a frame, the firmware
+ * only pushes it shortly before its launch time (see sp-desc-tx.c).
+ */
+tsu_time_t tx_now;
+var logic tx_launch_due;
+
+tsu_sampler tsu_sampler_tx_now(
+	.clk(clk),
+	.tsu_time(tsu_time),
+	.sample_clk(gem_tx.tx_clock),
+	.sample_resetn(gem_tx.tx_resetn),
+	.sample(1'b1),
+	.sample_time(tx_now),
+	.sample_valid()
+);
+
+wire logic tx_meta_launch = tx_meta_fifo_r.rd_data[TX_META_DESC_LAUNCH_BITN];
+
+always_ff @(posedge gem_tx.tx_clock) begin
+	// ts_1 = { sec[1:0], nsec[29:0] }, ts_2 = sec[33:2]
+	tx_launch_due <= ~tx_launch_fifo_r.empty &&
+		{ tx_now.sec[33:0], tx_now.nsec } >= { tx_launch_fifo_r.rd_data[63:32],
+			tx_launch_fifo_r.rd_data[31:30], tx_launch_fifo_r.rd_data[29:0] };
+end
+
+/*
+ * Control frames
+ *
+ * A frame in the TX control frame slot (see "TX CTRL PUSH") is handed
+ * to the GEM at the next frame boundary, ahead of the frame at the head
+ * of the TX meta FIFO and regardless of the launch time, so a PAUSE
+ * frame does not wait behind queued frames. It is sent like a frame
+ * that is all header, with the slot in place of the TX header FIFO,
+ * and it is never time stamped.
+ * The slot is not written while it holds a frame, so its words and
+ * length are stable here once the request has been synchronized.
+ */
+(* ASYNC_REG = "TRUE" *) var logic [1:0] tx_ctrl_req_sync;
+var logic tx_ctrl_active = 1'b0;
+var logic [$clog2(TX_CTRL_NWORDS)-1:0] tx_ctrl_rd_idx;
+
+always_ff @(posedge gem_tx.tx_clock) begin
+	tx_ctrl_req_sync <= { tx_ctrl_req_sync[0], tx_ctrl_req_tog };
+end
+
+wire logic tx_ctrl_pending = tx_ctrl_req_sync[1] != tx_ctrl_ack_tog;
+
+/*
+ * VLAN insertion
+ *
+ * A frame pushed with TX_META_VLAN_INSERT_BITN set gets a VLAN tag
+ * (TPID 0x8100 and the TCI of the entry) after its MAC addresses.
+ * Once 12 bytes are sent, the 4 bytes of the tag are put on the bus
+ * instead of bytes from the TX header or data FIFO.
+ */
+localparam logic [15:0] ETHERTYPE_VLAN = 16'h8100;
+
+wire logic tx_meta_vlan_insert = tx_meta_fifo_r.rd_data[TX_META_VLAN_INSERT_BITN];
+wire logic [TX_PACKET_BYTE_COUNT_WIDTH-1:0] tx_meta_frame_length =
+	tx_meta_fifo_r.rd_data[TX_PACKET_BYTE_COUNT_WIDTH-1:0] + (tx_meta_vlan_insert ? 4 : 0);
+var logic [31:0] tx_vlan_tag;
+var logic [2:0] tx_vlan_bytes_left;
+// The number of bytes sent so far.
+// It saturates because we are only interested in the first bytes.
+var logic [3:0] tx_vlan_idx;
+wire logic tx_vlan_now = tx_vlan_bytes_left != '0 & tx_vlan_idx == 4'd12;
+
+// The time stamp of the last frame is not in the TX time stamp FIFO yet
+// (see Time stamping).
+wire logic tx_ts_stall;
+
+// The frame at the head of the TX meta FIFO may be handed to the GEM.
+wire logic tx_meta_ready = ~tx_meta_fifo_r.empty & tx_start_ok &
+	(~tx_meta_launch | tx_launch_due) & ~tx_ts_stall;
+// The control frame goes first.
+wire logic tx_ctrl_ready = tx_ctrl_pending & ~tx_ts_stall;
+
+// The GEM reads a byte of a cut-through frame that is not there yet.
+wire logic tx_underflow_comb = tx_state & gem_tx.tx_r_rd & ~tx_vlan_now &
+	tx_hdr_bytes_left == '0 & tx_cur_buf_valid == '0 & tx_data_fifo_r.empty;
+
 always_comb begin
 	tx_packet_byte_count_comb = tx_packet_byte_count_ff;
 
@@ -335,25 +1041,38 @@ always_comb begin
 		tx_packet_byte_count_comb = '0;
 	end
 	else begin
-		if (~tx_state) begin
-			if (~tx_meta_fifo_r.empty) begin
-				tx_packet_byte_count_comb = tx_meta_fifo_r.rd_data[TX_PACKET_BYTE_COUNT_WIDTH-1:0];
+		if (tx_drain) begin
+			if (tx_data_fifo_r.rd_en) begin
+				if (tx_packet_byte_count_comb > TX_PACKET_BYTE_COUNT_WIDTH'(TX_DATA_FIFO_WIDTH/8))
+					tx_packet_byte_count_comb = tx_packet_byte_count_comb - TX_DATA_FIFO_WIDTH/8;
+				else
+					tx_packet_byte_count_comb = '0;
+			end
+		end
+		else if (~tx_state) begin
+			if (tx_ctrl_pending) begin
+				tx_packet_byte_count_comb = TX_PACKET_BYTE_COUNT_WIDTH'(tx_ctrl_len);
+			end
+			else if (~tx_meta_fifo_r.empty) begin
+				tx_packet_byte_count_comb = tx_meta_frame_length;
 			end
 		end
 		else begin
-			if (gem_tx.tx_r_rd) begin
+			// On an underflow, the byte is left for the drain.
+			// A VLAN tag that was not sent yet is not in the TX data FIFO.
+			if (gem_tx.tx_r_rd & ~tx_underflow_comb) begin
 				tx_packet_byte_count_comb = tx_packet_byte_count_comb - 1;
 			end
+			if (tx_underflow_comb) begin
+				tx_packet_byte_count_comb = tx_packet_byte_count_comb -
+					TX_PACKET_BYTE_COUNT_WIDTH'(tx_vlan_bytes_left);
+			end
 		end
 	end
 	tx_last_byte_comb = ~|tx_packet_byte_count_ff[$bits(tx_packet_byte_count_ff)-1:1] & tx_packet_byte_count_ff[0];
 end
 
 assign gem_tx.tx_r_err = 1'b0;
-assign gem_tx.tx_r_underflow = 1'b0;
-
-var logic [TX_DATA_FIFO_WIDTH-1:0] tx_cur_buf;
-var logic [(TX_DATA_FIFO_WIDTH/8)-1:0] tx_cur_buf_valid;
 
 always_ff @(posedge gem_tx.tx_clock) begin
 	tx_packet_byte_count_ff <= tx_packet_byte_count_comb;
@@ -364,22 +1083,62 @@ always_ff @(posedge gem_tx.tx_clock) begin
 		// Unpulse
 		gem_tx.tx_r_valid <= 1'b0;
 		gem_tx.tx_r_eop <= 1'b0;
+		gem_tx.tx_r_underflow <= 1'b0;
 		tx_meta_fifo_r.rd_en <= 1'b0;
 		tx_data_fifo_r.rd_en <= 1'b0;
+		tx_hdr_fifo_r.rd_en <= 1'b0;
+		tx_launch_fifo_r.rd_en <= 1'b0;
 
+		if (tx_drain) begin
+			// Pop every other cycle so that 'empty' is up to date.
+			if (tx_packet_byte_count_ff == '0) begin
+				tx_drain <= 1'b0;
+			end
+			else if (~tx_data_fifo_r.rd_en & ~tx_data_fifo_r.empty) begin
+				tx_data_fifo_r.rd_en <= 1'b1;
+			end
+		end
 		/*
 		 * If there is a packet available.
 		 */
-		if (~tx_state) begin
-			if (~tx_meta_fifo_r.empty) begin
+		else if (~tx_state) begin
+			if (tx_ctrl_ready) begin
+				gem_tx.tx_r_data_rdy <= 1'b1;
+				tx_state <= 1'b1;
+				tx_ctrl_active <= 1'b1;
+				gem_tx.tx_r_control <= 1'b0;
+
+				tx_vlan_bytes_left <= 3'd0;
+				tx_vlan_idx <= '0;
+
+				tx_hdr_bytes_left <= TX_META_DESC_HDR_LEN_WIDTH'(tx_ctrl_len);
+				tx_hdr_buf_idx <= '0;
+				tx_hdr_buf <= tx_ctrl_buf[0];
+				tx_ctrl_rd_idx <= 1;
+			end
+			else if (tx_meta_ready) begin
 				gem_tx.tx_r_data_rdy <= 1'b1;
 				tx_state <= 1'b1;
 				tx_meta_fifo_r.rd_en <= 1'b1;
+				tx_launch_fifo_r.rd_en <= tx_meta_launch;
 				gem_tx.tx_r_control <= tx_meta_fifo_r.rd_data[TX_META_DESC_NOCRC_BITN];
-				tx_data_fifo_r.rd_en <= 1'b1;
+				// A frame that is all header has nothing in the
+				// TX data FIFO.
+				tx_data_fifo_r.rd_en <= ~tx_meta_hdr_only;
 				tx_cur_buf <= tx_data_fifo_r.rd_data;
 				tx_cur_buf_valid <= '1;
 
+				tx_vlan_tag <= { ETHERTYPE_VLAN,
+					tx_meta_fifo_r.rd_data[TX_META_VLAN_TCI_BITN +: TX_META_VLAN_TCI_WIDTH] };
+				tx_vlan_bytes_left <= tx_meta_vlan_insert ? 3'd4 : 3'd0;
+				tx_vlan_idx <= '0;
+
+				tx_hdr_bytes_left <= tx_meta_hdr_len;
+				tx_hdr_buf_idx <= '0;
+				if (tx_meta_hdr_len != '0) begin
+					tx_hdr_fifo_r.rd_en <= 1'b1;
+					tx_hdr_buf <= tx_hdr_fifo_r.rd_data;
+				end
 			end
 		end
 		else begin
@@ -389,24 +1148,80 @@ always_ff @(posedge gem_tx.tx_clock) begin
 				gem_tx.tx_r_data_rdy <= 1'b0;
 				gem_tx.tx_r_valid <= 1'b1;
 
-				// Put the lower 8 bits from the TX buffer on the bus.
-				gem_tx.tx_r_data <= tx_cur_buf[7:0];
-
-				// If the TX buffer will be completely invalid after this
-				// cycle, reload the buffer from the FWFT FIFO, pop the
-				// element from the FIFO and update the "valid" register.
-				if (|tx_cur_buf_valid[(TX_DATA_FIFO_WIDTH/8)-1:1] == 1'b0 &&
-					tx_cur_buf_valid[0] == 1'b1)
-				begin
-					tx_cur_buf <= tx_data_fifo_r.rd_data;
-					tx_cur_buf_valid <= '1;
-					tx_data_fifo_r.rd_en <= ~tx_last_byte_comb;
+				if (~tx_vlan_now && tx_vlan_idx != 4'd12) begin
+					tx_vlan_idx <= tx_vlan_idx + 1;
+				end
+
+				if (tx_vlan_now) begin
+					// Put the next byte of the VLAN tag on the bus.
+					gem_tx.tx_r_data <= tx_vlan_tag[31:24];
+					tx_vlan_tag <= { tx_vlan_tag[23:0], 8'h00 };
+					tx_vlan_bytes_left <= tx_vlan_bytes_left - 1;
+				end
+				else if (tx_hdr_bytes_left != '0) begin
+					// Put the lower 8 bits from the header buffer on the bus.
+					gem_tx.tx_r_data <= tx_hdr_buf[7:0];
+					tx_hdr_bytes_left <= tx_hdr_bytes_left - 1;
+					tx_hdr_buf_idx <= tx_hdr_buf_idx + 1;
+
+					// Reload the header buffer when it is used up.
+					// Only pop the FIFO if the header continues.
+					if (tx_hdr_buf_idx == '1) begin
+						if (tx_ctrl_active) begin
+							tx_hdr_buf <= tx_ctrl_buf[tx_ctrl_rd_idx];
+							tx_ctrl_rd_idx <= tx_ctrl_rd_idx + 1;
+						end
+						else begin
+							tx_hdr_buf <= tx_hdr_fifo_r.rd_data;
+							tx_hdr_fifo_r.rd_en <= tx_hdr_bytes_left != 1;
+						end
+					end
+					else begin
+						tx_hdr_buf <= { 8'h00, tx_hdr_buf[TX_HDR_FIFO_WIDTH-1:8] };
+					end
+				end
+				else if (tx_cur_buf_valid == '0) begin
+					// The TX buffer could not be reloaded (cut-through).
+					if (tx_data_fifo_r.empty) begin
+						// The data did not arrive in time.
+						gem_tx.tx_r_underflow <= 1'b1;
+						tx_drain <= 1'b1;
+					end
+					else begin
+						// Put the lower 8 bits from the FWFT FIFO on the bus
+						// and keep the rest of the word.
+						gem_tx.tx_r_data <= tx_data_fifo_r.rd_data[7:0];
+						tx_cur_buf <= { 8'h00, tx_data_fifo_r.rd_data[TX_DATA_FIFO_WIDTH-1:8] };
+						tx_cur_buf_valid <= { 1'b0, {((TX_DATA_FIFO_WIDTH/8)-1){1'b1}} };
+						tx_data_fifo_r.rd_en <= 1'b1;
+					end
 				end
 				else begin
-					// Shift the TX buffer right by 8 bits.
-					// Shift the TX buffer valid bits right by 1 bit.
-					tx_cur_buf <= { 8'h00, tx_cur_buf[TX_DATA_FIFO_WIDTH-1:8] };
-					tx_cur_buf_valid <= { 1'b0, tx_cur_buf_valid[(TX_DATA_FIFO_WIDTH/8)-1:1] };
+					// Put the lower 8 bits from the TX buffer on the bus.
+					gem_tx.tx_r_data <= tx_cur_buf[7:0];
+
+					// If the TX buffer will be completely invalid after this
+					// cycle, reload the buffer from the FWFT FIFO, pop the
+					// element from the FIFO and update the "valid" register.
+					// With cut-through, the next word may not be there yet.
+					if (|tx_cur_buf_valid[(TX_DATA_FIFO_WIDTH/8)-1:1] == 1'b0 &&
+						tx_cur_buf_valid[0] == 1'b1)
+					begin
+						if (tx_data_fifo_r.empty & ~tx_last_byte_comb) begin
+							tx_cur_buf_valid <= '0;
+						end
+						else begin
+							tx_cur_buf <= tx_data_fifo_r.rd_data;
+							tx_cur_buf_valid <= '1;
+							tx_data_fifo_r.rd_en <= ~tx_last_byte_comb;
+						end
+					end
+					else begin
+						// Shift the TX buffer right by 8 bits.
+						// Shift the TX buffer valid bits right by 1 bit.
+						tx_cur_buf <= { 8'h00, tx_cur_buf[TX_DATA_FIFO_WIDTH-1:8] };
+						tx_cur_buf_valid <= { 1'b0, tx_cur_buf_valid[(TX_DATA_FIFO_WIDTH/8)-1:1] };
+					end
 				end
 
 				// This is more like a resource utilization hack.
@@ -414,13 +1229,99 @@ always_ff @(posedge gem_tx.tx_clock) begin
 				// it will be 1'b1 only the first time we come around
 				// here.
 				gem_tx.tx_r_sop <= gem_tx.tx_r_data_rdy;
-				gem_tx.tx_r_eop <= tx_last_byte_comb;
-				tx_state <= ~tx_last_byte_comb;
+				gem_tx.tx_r_eop <= tx_last_byte_comb & ~tx_underflow_comb;
+				tx_state <= ~tx_last_byte_comb & ~tx_underflow_comb;
+
+				if (tx_ctrl_active & tx_last_byte_comb) begin
+					// The slot may take the next control frame.
+					tx_ctrl_active <= 1'b0;
+					tx_ctrl_ack_tog <= ~tx_ctrl_ack_tog;
+				end
 			end
 		end
 	end
 end
 
+/*
+ * Time stamping
+ *
+ * The time is sampled when the GEM reads the first byte of a frame.
+ * If the frame was pushed with TX_META_DESC_TSTAMP_BITN or
+ * TX_META_DESC_CUT_THROUGH_BITN set, the time stamp and the status of
+ * the frame are stored in the TX time stamp FIFO for the firmware to
+ * pick up once the frame has ended and the time stamp has arrived,
+ * together with the tag the frame was pushed with.
+ * If the FIFO is full, the entry waits and no further frame is started,
+ * so the firmware never loses a time stamp.
+ */
+var logic tx_tstamp_ff;
+var logic tx_tstamp_sampled_ff;
+var logic [TX_META_DESC_TS_TAG_WIDTH-1:0] tx_ts_tag_ff;
+var logic [TX_META_DESC_TS_TAG_WIDTH-1:0] tx_ts_tag;
+tsu_time_t tx_sample_time;
+wire logic tx_sample_valid;
+var logic [63:0] tx_ts_time;
+var logic tx_ts_time_valid;
+var logic tx_ts_end;
+var logic tx_ts_underflow;
+
+tsu_sampler tsu_sampler_tx(
+	.clk(clk),
+	.tsu_time(tsu_time),
+	.sample_clk(gem_tx.tx_clock),
+	.sample_resetn(gem_tx.tx_resetn),
+	.sample(tx_state & gem_tx.tx_r_rd & gem_tx.tx_r_data_rdy),
+	.sample_time(tx_sample_time),
+	.sample_valid(tx_sample_valid)
+);
+
+always_ff @(posedge gem_tx.tx_clock) begin
+	// Unpulse
+	tx_ts_fifo_w.wr_en <= 1'b0;
+
+	if (!gem_tx.tx_resetn) begin
+		tx_ts_time_valid <= 1'b0;
+		tx_ts_end <= 1'b0;
+	end
+	else begin
+		if (~tx_state & tx_ctrl_pending) begin
+			tx_tstamp_ff <= 1'b0;
+		end
+		else if (~tx_state & ~tx_meta_fifo_r.empty) begin
+			tx_tstamp_ff <= tx_meta_fifo_r.rd_data[TX_META_DESC_TSTAMP_BITN] |
+				tx_meta_fifo_r.rd_data[TX_META_DESC_CUT_THROUGH_BITN];
+			tx_ts_tag_ff <= tx_meta_fifo_r.rd_data[TX_META_DESC_TS_TAG_BITN +: TX_META_DESC_TS_TAG_WIDTH];
+		end
+		if (tx_state & gem_tx.tx_r_rd & gem_tx.tx_r_data_rdy) begin
+			tx_tstamp_sampled_ff <= tx_tstamp_ff;
+			tx_ts_tag <= tx_ts_tag_ff;
+			tx_ts_time_valid <= 1'b0;
+			tx_ts_end <= 1'b0;
+		end
+		if (tx_sample_valid) begin
+			// ts_1 = { sec[1:0], nsec[29:0] }, ts_2 = sec[33:2]
+			tx_ts_time <= {
+				tx_sample_time.sec[33:2],
+				tx_sample_time.sec[1:0], tx_sample_time.nsec
+			};
+			tx_ts_time_valid <= 1'b1;
+		end
+		if (tx_state & gem_tx.tx_r_rd & (tx_last_byte_comb | tx_underflow_comb)) begin
+			tx_ts_end <= 1'b1;
+			tx_ts_underflow <= tx_underflow_comb;
+		end
+		if (tx_ts_time_valid & tx_ts_end & ~(tx_tstamp_sampled_ff & tx_ts_fifo_w.full)) begin
+			tx_ts_fifo_w.wr_en <= tx_tstamp_sampled_ff;
+			tx_ts_fifo_w.wr_data <= { tx_ts_tag, tx_ts_underflow, tx_ts_time };
+			tx_ts_time_valid <= 1'b0;
+			tx_ts_end <= 1'b0;
+		end
+	end
+end
+
+// The next frame would clear the pending entry, so it has to wait.
+assign tx_ts_stall = tx_tstamp_sampled_ff & tx_ts_end;
+
 var logic gem_dma_tx_end_tog_prev;
 
 always_ff @(posedge gem_tx.tx_clock) begin
@@ -476,8 +1377,8 @@ xpm_fifo_async #(
 	.rd_data_count(tx_meta_fifo_r_rd_data_count), 
 
 	.wr_clk(clk),
-	.wr_en(tx_meta_fifo_w.wr_en),
-	.din(tx_meta_fifo_w.wr_data),
+	.wr_en(tx_gen_active ? tx_gen_meta_fifo_w.wr_en : tx_meta_fifo_w.wr_en),
+	.din(tx_gen_active ? tx_gen_meta_fifo_w.wr_data : tx_meta_fifo_w.wr_data),
 	.full(tx_meta_fifo_w.full),
 	.wr_data_count(tx_meta_fifo_w_wr_data_count)
 );
@@ -492,8 +1393,7 @@ xpm_fifo_async #(
 	.PROG_EMPTY_THRESH(10),
 	.PROG_FULL_THRESH(10),
 	// GEM TX clock domain
-	//.RD_DATA_COUNT_WIDTH(TX_DATA_FIFO_RD_DATA_COUNT_WIDTH),
-	.RD_DATA_COUNT_WIDTH(1),
+	.RD_DATA_COUNT_WIDTH(TX_DATA_FIFO_RD_DATA_COUNT_WIDTH),
 	.READ_DATA_WIDTH(TX_DATA_FIFO_WIDTH),
 	.READ_MODE("fwft"),
 	.RELATED_CLOCKS(0),
@@ -508,26 +1408,196 @@ xpm_fifo_async #(
 	.rst(rst),
 
 	.wr_clk(clk),
-	.wr_en(tx_data_fifo_w.wr_en),
-	.din(tx_data_fifo_w.wr_data),
+	.wr_en(tx_gen_active ? tx_gen_data_fifo_w.wr_en : tx_data_fifo_w.wr_en),
+	.din(tx_gen_active ? tx_gen_data_fifo_w.wr_data : tx_data_fifo_w.wr_data),
 	.wr_data_count(tx_data_fifo_w_wr_data_count),
 
 	.rd_clk(gem_tx.tx_clock),
 	.rd_en(tx_data_fifo_r.rd_en),
 	.dout(tx_data_fifo_r.rd_data),
+	.empty(tx_data_fifo_r.empty),
 	.rd_data_count(tx_data_fifo_r_rd_data_count)
 );
+xpm_fifo_async #(
+	.CDC_SYNC_STAGES(2),
+	.DOUT_RESET_VALUE("0"),
+	.ECC_MODE("no_ecc"),
+	.FIFO_MEMORY_TYPE("distributed"),
+	.FIFO_READ_LATENCY(0),
+	.FIFO_WRITE_DEPTH(TX_TS_FIFO_DEPTH),
+	.FULL_RESET_VALUE(0),
+	.PROG_EMPTY_THRESH(10),
+	.PROG_FULL_THRESH(10),
+	// Processor clock domain
+	.RD_DATA_COUNT_WIDTH(1),
+	.READ_DATA_WIDTH(TX_TS_FIFO_WIDTH),
+	.READ_MODE("fwft"),
+	.RELATED_CLOCKS(0),
+	.SIM_ASSERT_CHK(0),
+	.USE_ADV_FEATURES("0707"),
+	.WAKEUP_TIME(0),
+	.WRITE_DATA_WIDTH(TX_TS_FIFO_WIDTH),
+	// GEM TX clock domain
+	.WR_DATA_COUNT_WIDTH(1)
+) tx_ts_fifo (
+	// reset is synchronized to wr_clk!
+	.rst(~gem_tx.tx_resetn),
+
+	.wr_clk(gem_tx.tx_clock),
+	.wr_en(tx_ts_fifo_w.wr_en),
+	.din(tx_ts_fifo_w.wr_data),
+	.full(tx_ts_fifo_w.full),
+
+	.rd_clk(clk),
+	.rd_en(tx_ts_fifo_r.rd_en),
+	.dout(tx_ts_fifo_r.rd_data),
+	.empty(tx_ts_fifo_r.empty)
+);
+xpm_fifo_async #(
+	.CDC_SYNC_STAGES(2),
+	.DOUT_RESET_VALUE("0"),
+	.ECC_MODE("no_ecc"),
+	.FIFO_MEMORY_TYPE("auto"),
+	.FIFO_READ_LATENCY(0),
+	.FIFO_WRITE_DEPTH(TX_HDR_FIFO_DEPTH),
+	.FULL_RESET_VALUE(0),
+	.PROG_EMPTY_THRESH(10),
+	.PROG_FULL_THRESH(10),
+	// GEM TX clock domain
+	.RD_DATA_COUNT_WIDTH(1),
+	.READ_DATA_WIDTH(TX_HDR_FIFO_WIDTH),
+	.READ_MODE("fwft"),
+	.RELATED_CLOCKS(0),
+	.SIM_ASSERT_CHK(0),
+	.USE_ADV_FEATURES("0707"),
+	.WAKEUP_TIME(0),
+	.WRITE_DATA_WIDTH(TX_HDR_FIFO_WIDTH),
+	// Processor clock domain
+	.WR_DATA_COUNT_WIDTH(1)
+) tx_hdr_fifo (
+	// reset is synchronized to wr_clk!
+	.rst(rst),
+
+	.wr_clk(clk),
+	.wr_en(tx_hdr_fifo_w.wr_en),
+	.din(tx_hdr_fifo_w.wr_data),
+	.full(tx_hdr_fifo_w.full),
+
+	.rd_clk(gem_tx.tx_clock),
+	.rd_en(tx_hdr_fifo_r.rd_en),
+	.dout(tx_hdr_fifo_r.rd_data),
+	.empty(tx_hdr_fifo_r.empty)
+);
+xpm_fifo_async #(
+	.CDC_SYNC_STAGES(2),
+	.DOUT_RESET_VALUE("0"),
+	.ECC_MODE("no_ecc"),
+	.FIFO_MEMORY_TYPE("distributed"),
+	.FIFO_READ_LATENCY(0),
+	.FIFO_WRITE_DEPTH(TX_LAUNCH_FIFO_DEPTH),
+	.FULL_RESET_VALUE(0),
+	.PROG_EMPTY_THRESH(10),
+	.PROG_FULL_THRESH(10),
+	// GEM TX clock domain
+	.RD_DATA_COUNT_WIDTH(1),
+	.READ_DATA_WIDTH(TX_LAUNCH_FIFO_WIDTH),
+	.READ_MODE("fwft"),
+	.RELATED_CLOCKS(0),
+	.SIM_ASSERT_CHK(0),
+	.USE_ADV_FEATURES("0707"),
+	.WAKEUP_TIME(0),
+	.WRITE_DATA_WIDTH(TX_LAUNCH_FIFO_WIDTH),
+	// Processor clock domain
+	.WR_DATA_COUNT_WIDTH(1)
+) tx_launch_fifo (
+	// reset is synchronized to wr_clk!
+	.rst(rst),
+
+	.wr_clk(clk),
+	.wr_en(tx_launch_fifo_w.wr_en),
+	.din(tx_launch_fifo_w.wr_data),
+	.full(tx_launch_fifo_w.full),
+
+	.rd_clk(gem_tx.tx_clock),
+	.rd_en(tx_launch_fifo_r.rd_en),
+	.dout(tx_launch_fifo_r.rd_data),
+	.empty(tx_launch_fifo_r.empty)
+);
 `endif
 
+// axi_to_fifo only issues a burst when the TX data FIFO has room for it,
+// so the FIFO must at least hold a burst of 256 beats (and some margin).
+if (TX_DATA_FIFO_DEPTH < 256 + 8) begin
+	$error("The TX data FIFO cannot hold a burst of 256 beats");
+end
+
+wire logic [TX_DATA_FIFO_WR_DATA_COUNT_WIDTH-1:0] tx_data_fifo_w_nfree =
+	TX_DATA_FIFO_WR_DATA_COUNT_WIDTH'(TX_DATA_FIFO_DEPTH) - tx_data_fifo_w_wr_data_count;
+
 axi_to_fifo #(
-	.AXI_ADDR_WIDTH(32)
+	.AXI_ADDR_WIDTH(DMA_ADDR_WIDTH),
+	.FIFO_NFREE_WIDTH(TX_DATA_FIFO_WR_DATA_COUNT_WIDTH)
 )
 axi_to_fifo_0(
 	.clock(clk),
 	.reset_n(~rst),
 	.mem_r(tx_data_mem_r),
 	.fifo_w(tx_data_fifo_w),
+	.fifo_w_nfree(tx_data_fifo_w_nfree),
 	.axi_ar(m_axi_dma_ar),
 	.axi_r(m_axi_dma_r)
 );
+
+/*
+ * Packet generator
+ *
+ * While it is active, it owns the write sides of the TX meta and data
+ * FIFOs. Writes by "TX META PUSH" and "TX DATA DMA START" are lost, so
+ * the firmware must not transmit while the generator is enabled.
+ */
+assign tx_gen_meta_fifo_w.full = tx_meta_fifo_w.full;
+assign tx_gen_meta_fifo_w.almost_full = 1'b0;
+assign tx_gen_data_fifo_w.full = 1'b0;
+assign tx_gen_data_fifo_w.almost_full = 1'b0;
+
+tx_pkt_gen #(
+	.DATA_WIDTH(TX_DATA_FIFO_WIDTH),
+	.META_WIDTH(TX_META_FIFO_WIDTH),
+	.FIFO_NFREE_WIDTH(TX_DATA_FIFO_WR_DATA_COUNT_WIDTH)
+)
+tx_pkt_gen_0(
+	.clock(clk),
+	.reset_n(~rst),
+	.enable(mmr_r.data[MMR_R_REGN_BENCH][BENCH_GEN_ENABLE_BITN]),
+	.min_length(mmr_r.data[MMR_R_REGN_GEN_LENGTH][GEN_LENGTH_MIN_BITN +: GEN_LENGTH_WIDTH]),
+	.max_length(mmr_r.data[MMR_R_REGN_GEN_LENGTH][GEN_LENGTH_MAX_BITN +: GEN_LENGTH_WIDTH]),
+	.period(mmr_r.data[MMR_R_REGN_GEN_PERIOD]),
+	.active(tx_gen_active),
+	.nframes(mmr_s.gen_nframes),
+	.meta_fifo_w(tx_gen_meta_fifo_w),
+	.data_fifo_w(tx_gen_data_fifo_w),
+	.data_fifo_w_nfree(tx_data_fifo_w_nfree)
+);
+
+/*
+ * TX counters
+ *
+ * Every byte and every complete frame the GEM (or the loopback)
+ * reads is counted.
+ */
+counter_sync counter_sync_tx_nframes(
+	.src_clk(gem_tx.tx_clock),
+	.src_resetn(gem_tx.tx_resetn),
+	.inc(gem_tx.tx_r_valid & gem_tx.tx_r_eop),
+	.dst_clk(clk),
+	.count(mmr_s.tx_nframes)
+);
+
+counter_sync counter_sync_tx_nbytes(
+	.src_clk(gem_tx.tx_clock),
+	.src_resetn(gem_tx.tx_resetn),
+	.inc(gem_tx.tx_r_valid & ~gem_tx.tx_r_underflow),
+	.dst_clk(clk),
+	.count(mmr_s.tx_nbytes)
+);
 endmodule
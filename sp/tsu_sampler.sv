@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+import mmr_config::*;
+
+/*
+ * Samples the TSU time (which lives in the PL clock domain) on behalf of
+ * another clock domain, e.g. the GEM RX or TX clock domain.
+ *
+ * A pulse on 'sample' toggles a request bit which is synchronized into the
+ * PL clock domain. There, the current TSU time is latched and an
+ * acknowledge bit is toggled. Once the acknowledge has been synchronized
+ * back, the latched time is stable and is captured into 'sample_time'.
+ * 'sample_valid' pulses for one 'sample_clk' cycle at that point.
+ *
+ * The time stamp lags the sample pulse by the synchronizer latency into
+ * the PL clock domain, i.e. by three to four PL clock cycles. This is a
+ * constant offset (plus one cycle of jitter) that the host may correct for.
+ * Sample pulses arriving while a request is still in flight are ignored.
+ */
+module tsu_sampler
+(
+	input wire logic clk,
+	input tsu_time_t tsu_time,
+
+	input wire logic sample_clk,
+	input wire logic sample_resetn,
+	input wire logic sample,
+	output tsu_time_t sample_time,
+	output var logic sample_valid
+);
+
+/*
+ * --------  --------  --------  --------
+ * Sample Clock Domain
+ * --------  --------  --------  --------
+ */
+var logic req = 1'b0;
+(* ASYNC_REG = "TRUE" *) var logic [2:0] ack_sync = '0;
+var logic pending_ff = 1'b0;
+wire logic pending = req ^ ack_sync[2];
+
+/*
+ * --------  --------  --------  --------
+ * PL Clock Domain
+ * --------  --------  --------  --------
+ */
+(* ASYNC_REG = "TRUE" *) var logic [2:0] req_sync = '0;
+var logic ack = 1'b0;
+tsu_time_t held;
+
+always_ff @(posedge clk) begin
+	req_sync <= { req_sync[1:0], req };
+
+	if (req_sync[2] != req_sync[1]) begin
+		held <= tsu_time;
+		ack <= ~ack;
+	end
+end
+
+// The handshake itself is never reset so that a request which is still
+// in flight across a reset cannot leave both sides out of step.
+always_ff @(posedge sample_clk) begin
+	ack_sync <= { ack_sync[1:0], ack };
+	pending_ff <= pending;
+
+	// Unpulse
+	sample_valid <= 1'b0;
+
+	if (pending_ff & ~pending) begin
+		sample_time <= held;
+		sample_valid <= sample_resetn;
+	end
+	if (sample_resetn & ~pending & sample) begin
+		req <= ~req;
+	end
+end
+
+endmodule
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Packet generator for benchmarking without a link partner
+ *
+ * While 'enable' is set, it writes frames into the TX data and meta FIFOs
+ * just like "TX DATA DMA START" and "TX META PUSH" would. A new frame is
+ * started at most every 'period' cycles, and its length is picked
+ * (pseudo-)randomly between 'min_length' and 'max_length'.
+ * A frame is only started when the TX data FIFO has room for all of it,
+ * so the generator never stalls the FIFO in the middle of a frame.
+ *
+ * The frames are broadcast frames from a locally administered address
+ * with the local experimental EtherType 0x88b5. Bytes 14 and 15 hold the
+ * lower 16 bits of 'nframes' (a sequence number) and byte k of the rest
+ * of the frame is k[7:0]. The GEM appends the FCS.
+ *
+ * 'active' stays set after 'enable' is cleared until the current frame
+ * is complete, so the FIFOs can be handed back to the firmware then.
+ */
+module tx_pkt_gen #(
+	parameter int DATA_WIDTH,
+	parameter int META_WIDTH,
+	parameter int FIFO_NFREE_WIDTH
+)
+(
+	input wire logic clock,
+	input wire logic reset_n,
+
+	input wire logic enable,
+	input wire logic [13:0] min_length,
+	input wire logic [13:0] max_length,
+	input wire logic [31:0] period,
+
+	output wire logic active,
+	output var logic [31:0] nframes,
+
+	fifo_write_interface.master meta_fifo_w,
+	fifo_write_interface.master data_fifo_w,
+	input wire logic [FIFO_NFREE_WIDTH-1:0] data_fifo_w_nfree
+);
+
+localparam int NBYTES = DATA_WIDTH / 8;
+localparam int LENGTH_WIDTH = 14;
+localparam int NWORDS_WIDTH = LENGTH_WIDTH + 1;
+// The write data count of the FIFO lags behind the writes by a few cycles.
+localparam int NFREE_MARGIN = 8;
+
+typedef enum logic [1:0] {
+	GEN_IDLE,
+	GEN_DATA,
+	GEN_META
+} gen_state_t;
+
+var gen_state_t state;
+var logic [15:0] lfsr;
+var logic [31:0] countdown;
+var logic [LENGTH_WIDTH-1:0] length;
+var logic [LENGTH_WIDTH-1:0] offset;
+var logic [NWORDS_WIDTH-1:0] words_left;
+
+var logic [LENGTH_WIDTH-1:0] length_next_comb;
+var logic [NWORDS_WIDTH-1:0] nwords_next_comb;
+var logic [DATA_WIDTH-1:0] data_word_comb;
+
+assign active = enable || state != GEN_IDLE;
+
+function automatic logic [7:0] gen_byte(
+	input logic [LENGTH_WIDTH-1:0] k,
+	input logic [15:0] seq
+);
+	if (k < 6)
+		return 8'hff;
+	else if (k == 6)
+		return 8'h02;
+	else if (k < 12)
+		return 8'h00;
+	else if (k == 12)
+		return 8'h88;
+	else if (k == 13)
+		return 8'hb5;
+	else if (k == 14)
+		return seq[15:8];
+	else if (k == 15)
+		return seq[7:0];
+	else
+		return k[7:0];
+endfunction
+
+always_comb begin
+	if (max_length > min_length) begin
+		length_next_comb = min_length + LENGTH_WIDTH'(
+			(32'(lfsr) * (32'(max_length) - 32'(min_length) + 1)) >> 16);
+	end
+	else begin
+		length_next_comb = min_length;
+	end
+	nwords_next_comb = NWORDS_WIDTH'((NWORDS_WIDTH'(length_next_comb) + (NBYTES-1)) / NBYTES);
+
+	for (int i = 0; i < NBYTES; i++) begin
+		data_word_comb[i*8 +: 8] = gen_byte(offset + LENGTH_WIDTH'(i), nframes[15:0]);
+	end
+end
+
+wire logic start_comb = enable && countdown == 0 && length_next_comb != '0 &&
+	32'(data_fifo_w_nfree) >= 32'(nwords_next_comb) + NFREE_MARGIN;
+
+always_ff @(posedge clock) begin
+	if (!reset_n) begin
+		state <= GEN_IDLE;
+		lfsr <= 16'hace1;
+		countdown <= '0;
+		nframes <= '0;
+		data_fifo_w.wr_en <= 1'b0;
+		meta_fifo_w.wr_en <= 1'b0;
+	end
+	else begin
+		// Unpulse
+		data_fifo_w.wr_en <= 1'b0;
+		meta_fifo_w.wr_en <= 1'b0;
+
+		if (countdown != 0) begin
+			countdown <= countdown - 1;
+		end
+
+		case (state)
+		GEN_IDLE: begin
+			if (start_comb) begin
+				state <= GEN_DATA;
+				countdown <= period;
+				length <= length_next_comb;
+				offset <= '0;
+				words_left <= nwords_next_comb;
+				// x^16 + x^14 + x^13 + x^11 + 1
+				lfsr <= (lfsr >> 1) ^ (lfsr[0] ? 16'hb400 : 16'h0000);
+			end
+		end
+		GEN_DATA: begin
+			data_fifo_w.wr_en <= 1'b1;
+			data_fifo_w.wr_data <= data_word_comb;
+			offset <= offset + LENGTH_WIDTH'(NBYTES);
+			words_left <= words_left - 1;
+			if (words_left == 1) begin
+				state <= GEN_META;
+			end
+		end
+		GEN_META: begin
+			if (!meta_fifo_w.full) begin
+				meta_fifo_w.wr_en <= 1'b1;
+				meta_fifo_w.wr_data <= META_WIDTH'(length);
+				nframes <= nframes + 1;
+				state <= GEN_IDLE;
+			end
+		end
+		default: begin
+			state <= GEN_IDLE;
+		end
+		endcase
+	end
+end
+
+endmodule
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * sp-bench: Runs traffic through a TX/RX pair of SPs without a link
+ * partner and reports the sustained rates.
+ *
+ * The packet generator of the TX SP fills its TX FIFOs, and the frames
+ * are looped back from the TX SP into the RX SP instead of going through
+ * the GEM. So the TX side of the TX firmware is bypassed, while the RX
+ * firmware handles the frames as usual. With -L, the frames go out through
+ * the GEM instead (e.g. into a loopback plug), and with -G, the generator
+ * is left alone so that traffic from the host can be measured.
+ *
+ * The counters are read through /dev/mem.
+ */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * MMR offsets and bits (see mmr/mmr_config.sv)
+ */
+#define REGOFF_BENCH					0x1a0
+#define REGOFF_GEN_LENGTH				0x1a4
+#define REGOFF_GEN_PERIOD				0x1a8
+#define REGOFF_GEN_NFRAMES				0x1ac
+#define REGOFF_TX_NFRAMES				0x1b0
+#define REGOFF_TX_NBYTES				0x1b4
+#define REGOFF_RX_NFRAMES				0x1b8
+#define REGOFF_RX_NBYTES				0x1bc
+#define REGOFF_RX_NDROPS				0x1c0
+#define BENCH_LOOPBACK					(1 << 0)
+#define BENCH_GEN_ENABLE				(1 << 1)
+#define GEN_LENGTH_MAX_BITN				16
+#define GEN_LENGTH_LIMIT				0x3fff
+#define MMR_SIZE						0x1000
+
+struct counters {
+	uint32_t gen_nframes;
+	uint32_t tx_nframes;
+	uint32_t tx_nbytes;
+	uint32_t rx_nframes;
+	uint32_t rx_nbytes;
+	uint32_t rx_ndrops;
+};
+
+// The counters are 32 bits wide and wrap around, so the byte counters
+// must be sampled at least every few seconds at the line rate.
+#define MAX_INTERVAL					4
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"usage: sp-bench [-a tx_mmr_addr] [-A rx_mmr_addr] [-l min[:max]] [-p period]\n"
+		"                [-t seconds] [-i interval] [-L] [-G] [-k]\n"
+		"\n"
+		"  -a tx_mmr_addr Physical address of the MMRs of the TX SP (default 0xa0006000).\n"
+		"  -A rx_mmr_addr Physical address of the MMRs of the RX SP (default 0xa0007000).\n"
+		"  -l min[:max]   Lengths of generated frames without the FCS (default 60:1514).\n"
+		"  -p period      Minimum number of SP clock cycles from the start of one\n"
+		"                 generated frame to the next (default 0).\n"
+		"  -t seconds     Time to run for (default 10).\n"
+		"  -i interval    Seconds between two reports (default 1, at most %d).\n"
+		"  -L             Send the frames through the GEM instead of the loopback.\n"
+		"  -G             Do not use the packet generator.\n"
+		"  -k             Keep the loopback and the generator enabled on exit.\n",
+		MAX_INTERVAL);
+	exit(1);
+}
+
+static uint32_t
+mmr_read(volatile uint32_t *mmr, uint32_t off)
+{
+	return mmr[off / 4];
+}
+
+static void
+mmr_write(volatile uint32_t *mmr, uint32_t off, uint32_t x)
+{
+	mmr[off / 4] = x;
+}
+
+static volatile uint32_t *
+mmr_map(int fd, uint64_t mmr_addr)
+{
+	volatile uint32_t *mmr = mmap(NULL, MMR_SIZE, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, mmr_addr);
+	if (mmr == MAP_FAILED) {
+		perror("mmap");
+		return NULL;
+	}
+	return mmr;
+}
+
+static void
+read_counters(volatile uint32_t *tx_mmr, volatile uint32_t *rx_mmr, struct counters *c)
+{
+	c->gen_nframes = mmr_read(tx_mmr, REGOFF_GEN_NFRAMES);
+	c->tx_nframes = mmr_read(tx_mmr, REGOFF_TX_NFRAMES);
+	c->tx_nbytes = mmr_read(tx_mmr, REGOFF_TX_NBYTES);
+	c->rx_nframes = mmr_read(rx_mmr, REGOFF_RX_NFRAMES);
+	c->rx_nbytes = mmr_read(rx_mmr, REGOFF_RX_NBYTES);
+	c->rx_ndrops = mmr_read(rx_mmr, REGOFF_RX_NDROPS);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Prints the rates between two samples 'dt' seconds apart.
+ * The byte counts are passed separately since they may have wrapped
+ * around more than once in between.
+ */
+static void
+print_rates(const char *label, const struct counters *a, const struct counters *b,
+	uint64_t tx_nbytes, uint64_t rx_nbytes, double dt)
+{
+	uint32_t gen = b->gen_nframes - a->gen_nframes;
+	uint32_t tx = b->tx_nframes - a->tx_nframes;
+	uint32_t rx = b->rx_nframes - a->rx_nframes;
+	uint32_t drops = b->rx_ndrops - a->rx_ndrops;
+
+	printf("%-8s %10.0f %10.0f %9.2f %10.0f %9.2f %10u\n",
+		label,
+		gen / dt,
+		tx / dt,
+		tx_nbytes * 8 / dt / 1e6,
+		rx / dt,
+		rx_nbytes * 8 / dt / 1e6,
+		drops);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t tx_mmr_addr = 0xa0006000;
+	uint64_t rx_mmr_addr = 0xa0007000;
+	uint32_t min_length = 60;
+	uint32_t max_length = 1514;
+	uint32_t period = 0;
+	unsigned seconds = 10;
+	unsigned interval = 1;
+	bool loopback = true;
+	bool gen = true;
+	bool keep = false;
+	char *end;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "a:A:l:p:t:i:LGk")) != -1) {
+		switch (ch) {
+		case 'a': tx_mmr_addr = strtoull(optarg, NULL, 0); break;
+		case 'A': rx_mmr_addr = strtoull(optarg, NULL, 0); break;
+		case 'l':
+			min_length = strtoul(optarg, &end, 0);
+			max_length = *end == ':' ? strtoul(end + 1, NULL, 0) : min_length;
+			break;
+		case 'p': period = strtoul(optarg, NULL, 0); break;
+		case 't': seconds = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'L': loopback = false; break;
+		case 'G': gen = false; break;
+		case 'k': keep = true; break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	if (argc != 0 || min_length < 14 || max_length < min_length ||
+		max_length > GEN_LENGTH_LIMIT || interval == 0 || interval > MAX_INTERVAL)
+		usage();
+
+	int fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (fd < 0) {
+		perror("/dev/mem");
+		return 1;
+	}
+	volatile uint32_t *tx_mmr = mmr_map(fd, tx_mmr_addr);
+	volatile uint32_t *rx_mmr = mmr_map(fd, rx_mmr_addr);
+	close(fd);
+	if (tx_mmr == NULL || rx_mmr == NULL)
+		return 1;
+
+	// Only the loopback bit of the TX SP is used; both are ORed.
+	mmr_write(rx_mmr, REGOFF_BENCH, 0);
+	mmr_write(tx_mmr, REGOFF_BENCH, 0);
+	mmr_write(tx_mmr, REGOFF_GEN_LENGTH, min_length | max_length << GEN_LENGTH_MAX_BITN);
+	mmr_write(tx_mmr, REGOFF_GEN_PERIOD, period);
+	// Give frames in flight time to drain before switching the path.
+	usleep(10000);
+	mmr_write(tx_mmr, REGOFF_BENCH, loopback ? BENCH_LOOPBACK : 0);
+	usleep(10000);
+
+	struct counters start, prev, cur;
+	read_counters(tx_mmr, rx_mmr, &start);
+	double t_start = now();
+	if (gen)
+		mmr_write(tx_mmr, REGOFF_BENCH, (loopback ? BENCH_LOOPBACK : 0) | BENCH_GEN_ENABLE);
+
+	printf("%s, %s, lengths %u to %u, period %u\n",
+		loopback ? "loopback" : "GEM",
+		gen ? "generator" : "no generator",
+		min_length, max_length, period);
+	printf("%-8s %10s %10s %9s %10s %9s %10s\n",
+		"", "gen pkt/s", "tx pkt/s", "tx Mbit/s", "rx pkt/s", "rx Mbit/s", "rx drops");
+
+	uint64_t tx_nbytes_total = 0;
+	uint64_t rx_nbytes_total = 0;
+	double t_prev = t_start;
+	prev = start;
+	cur = start;
+	for (unsigned elapsed = 0; elapsed < seconds; elapsed += interval) {
+		sleep(interval);
+		read_counters(tx_mmr, rx_mmr, &cur);
+		double t = now();
+
+		uint32_t tx_nbytes = cur.tx_nbytes - prev.tx_nbytes;
+		uint32_t rx_nbytes = cur.rx_nbytes - prev.rx_nbytes;
+		tx_nbytes_total += tx_nbytes;
+		rx_nbytes_total += rx_nbytes;
+
+		char label[16];
+		snprintf(label, sizeof(label), "%us", elapsed + interval);
+		print_rates(label, &prev, &cur, tx_nbytes, rx_nbytes, t - t_prev);
+		prev = cur;
+		t_prev = t;
+	}
+
+	if (!keep)
+		mmr_write(tx_mmr, REGOFF_BENCH, loopback ? BENCH_LOOPBACK : 0);
+
+	print_rates("total", &start, &cur, tx_nbytes_total, rx_nbytes_total, t_prev - t_start);
+	printf("%u frames generated, %u sent, %u received, %u dropped\n",
+		cur.gen_nframes - start.gen_nframes,
+		cur.tx_nframes - start.tx_nframes,
+		cur.rx_nframes - start.rx_nframes,
+		cur.rx_ndrops - start.rx_ndrops);
+
+	if (!keep) {
+		// Let the TX FIFOs drain through the loopback before the GEM
+		// gets them back.
+		usleep(100000);
+		mmr_write(tx_mmr, REGOFF_BENCH, 0);
+	}
+
+	munmap((void *)tx_mmr, MMR_SIZE);
+	munmap((void *)rx_mmr, MMR_SIZE);
+	return 0;
+}
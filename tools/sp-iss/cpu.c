@@ -0,0 +1,644 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * RV32IMAC with Zicsr, as configured for Taiga in core/taiga_config.sv,
+ * plus the CUSTOM_0 instructions of the SP unit.
+ * There is only machine mode and no trap handling: anything that
+ * would trap stops the simulation.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "iss.h"
+
+#define OPCODE_LOAD			0x03
+#define OPCODE_CUSTOM_0		0x0b
+#define OPCODE_MISC_MEM		0x0f
+#define OPCODE_OP_IMM		0x13
+#define OPCODE_AUIPC		0x17
+#define OPCODE_STORE		0x23
+#define OPCODE_CUSTOM_1		0x2b
+#define OPCODE_AMO			0x2f
+#define OPCODE_OP			0x33
+#define OPCODE_LUI			0x37
+#define OPCODE_BRANCH		0x63
+#define OPCODE_JALR			0x67
+#define OPCODE_JAL			0x6f
+#define OPCODE_SYSTEM		0x73
+
+#define CSR_CYCLE			0xc00
+#define CSR_TIME			0xc01
+#define CSR_INSTRET			0xc02
+#define CSR_CYCLEH			0xc80
+#define CSR_TIMEH			0xc81
+#define CSR_INSTRETH		0xc82
+#define CSR_MHPMEVENT3		0x323
+#define CSR_MHPMCOUNTER3	0xb03
+#define CSR_MHPMCOUNTER3H	0xb83
+#define CSR_HPMCOUNTER3		0xc03
+#define CSR_HPMCOUNTER3H	0xc83
+
+/*
+ * The events of the hardware performance counters that are modelled
+ * (see hpm_event_t in core/taiga_types.sv). The others count nothing.
+ */
+#define HPM_EVENT_CYCLE					1
+#define HPM_EVENT_INSTRUCTION_ISSUED	2
+#define HPM_EVENT_LOAD					13
+#define HPM_EVENT_STORE					14
+
+static inline int32_t
+imm_i(uint32_t insn)
+{
+	return (int32_t)insn >> 20;
+}
+
+static inline int32_t
+imm_s(uint32_t insn)
+{
+	return ((int32_t)insn >> 25) << 5 | ((insn >> 7) & 0x1f);
+}
+
+static inline int32_t
+imm_b(uint32_t insn)
+{
+	return ((int32_t)insn >> 31) << 12 | ((insn >> 7) & 0x1) << 11 |
+		((insn >> 25) & 0x3f) << 5 | ((insn >> 8) & 0xf) << 1;
+}
+
+static inline int32_t
+imm_j(uint32_t insn)
+{
+	return ((int32_t)insn >> 31) << 20 | ((insn >> 12) & 0xff) << 12 |
+		((insn >> 20) & 0x1) << 11 | ((insn >> 21) & 0x3ff) << 1;
+}
+
+/*
+ * Expand a compressed instruction like core/rvc_expander.sv does.
+ * Reserved encodings and the floating-point loads and stores
+ * expand to 0, which is an illegal instruction.
+ */
+static uint32_t
+rvc_expand(uint32_t c)
+{
+	uint32_t rd = (c >> 7) & 0x1f;
+	uint32_t rs2 = (c >> 2) & 0x1f;
+	uint32_t rd_p = 8 + ((c >> 2) & 7);
+	uint32_t rs1_p = 8 + ((c >> 7) & 7);
+	uint32_t imm6 = (uint32_t)(((int32_t)(c << 19) >> 26 & ~0x1f) | rs2) & 0xfff;
+	uint32_t imm, j, b;
+
+	/* The offsets of C.J, C.JAL and C.BEQZ, C.BNEZ in the 32-bit formats */
+	j = ((c >> 12) & 1) << 11 | ((c >> 11) & 1) << 4 | ((c >> 9) & 3) << 8 |
+		((c >> 8) & 1) << 10 | ((c >> 7) & 1) << 6 | ((c >> 6) & 1) << 7 |
+		((c >> 3) & 7) << 1 | ((c >> 2) & 1) << 5;
+	j = (uint32_t)((int32_t)(j << 20) >> 20);
+	j = (j & 0x100000) << 11 | (j & 0x7fe) << 20 | (j & 0x800) << 9 | (j & 0xff000);
+	b = ((c >> 12) & 1) << 8 | ((c >> 10) & 3) << 3 | ((c >> 5) & 3) << 6 |
+		((c >> 3) & 3) << 1 | ((c >> 2) & 1) << 5;
+	b = (uint32_t)((int32_t)(b << 23) >> 23);
+	b = (b & 0x1000) << 19 | (b & 0x7e0) << 20 | (b & 0x1e) << 7 | (b & 0x800) >> 4;
+
+	switch ((c & 3) << 3 | c >> 13) {
+	case 000: /* C.ADDI4SPN */
+		imm = ((c >> 7) & 0xf) << 6 | ((c >> 11) & 3) << 4 |
+			((c >> 5) & 1) << 3 | ((c >> 6) & 1) << 2;
+		return imm ? imm << 20 | 2 << 15 | rd_p << 7 | OPCODE_OP_IMM : 0;
+	case 002: /* C.LW */
+	case 006: /* C.SW */
+		imm = ((c >> 5) & 1) << 6 | ((c >> 10) & 7) << 3 | ((c >> 6) & 1) << 2;
+		if (c >> 13 == 2)
+			return imm << 20 | rs1_p << 15 | 2 << 12 | rd_p << 7 | OPCODE_LOAD;
+		return (imm >> 5) << 25 | rd_p << 20 | rs1_p << 15 | 2 << 12 |
+			(imm & 0x1f) << 7 | OPCODE_STORE;
+	case 010: /* C.ADDI */
+		return imm6 << 20 | rd << 15 | rd << 7 | OPCODE_OP_IMM;
+	case 011: /* C.JAL */
+		return j | 1 << 7 | OPCODE_JAL;
+	case 012: /* C.LI */
+		return imm6 << 20 | rd << 7 | OPCODE_OP_IMM;
+	case 013: /* C.ADDI16SP, C.LUI */
+		if (rd == 2) {
+			imm = ((c >> 12) & 1) << 9 | ((c >> 3) & 3) << 7 | ((c >> 5) & 1) << 6 |
+				((c >> 2) & 1) << 5 | ((c >> 6) & 1) << 4;
+			imm = (uint32_t)((int32_t)(imm << 22) >> 22) & 0xfff;
+			return imm ? imm << 20 | 2 << 15 | 2 << 7 | OPCODE_OP_IMM : 0;
+		}
+		imm = (uint32_t)((int32_t)(imm6 << 20) >> 8);
+		return imm ? imm | rd << 7 | OPCODE_LUI : 0;
+	case 014:
+		switch ((c >> 10) & 3) {
+		case 0: /* C.SRLI */
+		case 1: /* C.SRAI */
+			if (c & 0x1000)
+				return 0;
+			return ((c >> 10) & 1) << 30 | rs2 << 20 | rs1_p << 15 | 5 << 12 |
+				rs1_p << 7 | OPCODE_OP_IMM;
+		case 2: /* C.ANDI */
+			return imm6 << 20 | rs1_p << 15 | 7 << 12 | rs1_p << 7 | OPCODE_OP_IMM;
+		default: {
+			/* C.SUB, C.XOR, C.OR, C.AND */
+			static const uint32_t funct[4] = { 0x40000000, 4 << 12, 6 << 12, 7 << 12 };
+			if (c & 0x1000)
+				return 0;
+			return funct[(c >> 5) & 3] | rd_p << 20 | rs1_p << 15 | rs1_p << 7 | OPCODE_OP;
+		}
+		}
+	case 015: /* C.J */
+		return j | OPCODE_JAL;
+	case 016: /* C.BEQZ */
+	case 017: /* C.BNEZ */
+		return b | rs1_p << 15 | ((c >> 13) & 1) << 12 | OPCODE_BRANCH;
+	case 020: /* C.SLLI */
+		if (c & 0x1000)
+			return 0;
+		return rs2 << 20 | rd << 15 | 1 << 12 | rd << 7 | OPCODE_OP_IMM;
+	case 022: /* C.LWSP */
+		imm = ((c >> 2) & 3) << 6 | ((c >> 12) & 1) << 5 | ((c >> 4) & 7) << 2;
+		return rd ? imm << 20 | 2 << 15 | 2 << 12 | rd << 7 | OPCODE_LOAD : 0;
+	case 024:
+		if (rs2 != 0) /* C.MV, C.ADD */
+			return rs2 << 20 | (c & 0x1000 ? rd : 0) << 15 | rd << 7 | OPCODE_OP;
+		if (rd != 0) /* C.JR, C.JALR */
+			return rd << 15 | (c & 0x1000 ? 1 : 0) << 7 | OPCODE_JALR;
+		return c & 0x1000 ? 0x00100073 : 0; /* C.EBREAK */
+	case 026: /* C.SWSP */
+		imm = ((c >> 7) & 3) << 6 | ((c >> 9) & 0xf) << 2;
+		return (imm >> 5) << 25 | rs2 << 20 | 2 << 15 | 2 << 12 |
+			(imm & 0x1f) << 7 | OPCODE_STORE;
+	}
+	return 0;
+}
+
+void
+cpu_reset(struct cpu *cpu, uint32_t pc)
+{
+	memset(cpu, 0, sizeof(*cpu));
+	cpu->pc = pc;
+}
+
+static uint32_t
+csr_read(struct cpu *cpu, int csr)
+{
+	switch (csr) {
+	// There is no separate timer, time is the cycle counter.
+	case CSR_CYCLE:
+	case CSR_TIME:
+		return (uint32_t)cpu->cycle;
+	case CSR_CYCLEH:
+	case CSR_TIMEH:
+		return (uint32_t)(cpu->cycle >> 32);
+	case CSR_INSTRET:
+		return (uint32_t)cpu->instret;
+	case CSR_INSTRETH:
+		return (uint32_t)(cpu->instret >> 32);
+	}
+	for (int i = 0; i < NHPMCOUNTERS; i++) {
+		if (csr == CSR_MHPMCOUNTER3 + i || csr == CSR_HPMCOUNTER3 + i)
+			return (uint32_t)cpu->hpmcounter[i];
+		if (csr == CSR_MHPMCOUNTER3H + i || csr == CSR_HPMCOUNTER3H + i)
+			return (uint32_t)(cpu->hpmcounter[i] >> 32);
+		if (csr == CSR_MHPMEVENT3 + i)
+			return cpu->hpmevent[i];
+	}
+	return cpu->csr[csr];
+}
+
+static void
+csr_write(struct cpu *cpu, int csr, uint32_t x)
+{
+	for (int i = 0; i < NHPMCOUNTERS; i++) {
+		if (csr == CSR_MHPMCOUNTER3 + i) {
+			cpu->hpmcounter[i] = (cpu->hpmcounter[i] & ~(uint64_t)UINT32_MAX) | x;
+			return;
+		}
+		if (csr == CSR_MHPMCOUNTER3H + i) {
+			cpu->hpmcounter[i] = (uint64_t)x << 32 | (uint32_t)cpu->hpmcounter[i];
+			return;
+		}
+		if (csr == CSR_MHPMEVENT3 + i) {
+			cpu->hpmevent[i] = x;
+			return;
+		}
+	}
+	cpu->csr[csr] = x;
+}
+
+static void
+hpm_count(struct cpu *cpu, uint32_t opcode, unsigned cycles)
+{
+	for (int i = 0; i < NHPMCOUNTERS; i++) {
+		switch (cpu->hpmevent[i]) {
+		case HPM_EVENT_CYCLE: cpu->hpmcounter[i] += cycles; break;
+		case HPM_EVENT_INSTRUCTION_ISSUED: cpu->hpmcounter[i]++; break;
+		case HPM_EVENT_LOAD: cpu->hpmcounter[i] += opcode == OPCODE_LOAD; break;
+		case HPM_EVENT_STORE: cpu->hpmcounter[i] += opcode == OPCODE_STORE; break;
+		}
+	}
+}
+
+static uint32_t
+mul(uint32_t a, uint32_t b, int funct3)
+{
+	switch (funct3) {
+	case 0:
+		return a * b;
+	case 1:
+		return (uint32_t)(((int64_t)(int32_t)a * (int32_t)b) >> 32);
+	case 2:
+		return (uint32_t)(((int64_t)(int32_t)a * (uint64_t)b) >> 32);
+	case 3:
+		return (uint32_t)(((uint64_t)a * b) >> 32);
+	case 4:
+		if (b == 0)
+			return UINT32_MAX;
+		if (a == 0x80000000 && b == UINT32_MAX)
+			return a;
+		return (uint32_t)((int32_t)a / (int32_t)b);
+	case 5:
+		if (b == 0)
+			return UINT32_MAX;
+		return a / b;
+	case 6:
+		if (b == 0)
+			return a;
+		if (a == 0x80000000 && b == UINT32_MAX)
+			return 0;
+		return (uint32_t)((int32_t)a % (int32_t)b);
+	default:
+		if (b == 0)
+			return a;
+		return a % b;
+	}
+}
+
+static uint32_t
+amo(uint32_t x, uint32_t y, int funct5)
+{
+	switch (funct5) {
+	case 0x00: return x + y;
+	case 0x01: return y;
+	case 0x04: return x ^ y;
+	case 0x08: return x | y;
+	case 0x0c: return x & y;
+	case 0x10: return (int32_t)x < (int32_t)y ? x : y;
+	case 0x14: return (int32_t)x > (int32_t)y ? x : y;
+	case 0x18: return x < y ? x : y;
+	default: return x > y ? x : y;
+	}
+}
+
+static uint32_t
+ror(uint32_t x, int n)
+{
+	n &= 0x1f;
+	return n == 0 ? x : x >> n | x << (32 - n);
+}
+
+/*
+ * The Zbb instructions that are not a variant of a base instruction.
+ * Returns false if insn is none of them.
+ */
+static bool
+zbb(uint32_t insn, uint32_t a, uint32_t b, uint32_t *result)
+{
+	int opcode = insn & 0x7f;
+	int funct3 = (insn >> 12) & 0x7;
+	int funct7 = insn >> 25;
+	int rs2 = (insn >> 20) & 0x1f;
+
+	if (opcode == OPCODE_OP_IMM) {
+		if (funct3 == 1 && funct7 == 0x30) {
+			switch (rs2) {
+			case 0: *result = a == 0 ? 32 : __builtin_clz(a); return true;
+			case 1: *result = a == 0 ? 32 : __builtin_ctz(a); return true;
+			case 2: *result = __builtin_popcount(a); return true;
+			case 4: *result = (int32_t)(int8_t)a; return true;
+			case 5: *result = (int32_t)(int16_t)a; return true;
+			}
+		}
+		else if (funct3 == 5 && funct7 == 0x30) {
+			*result = ror(a, rs2);
+			return true;
+		}
+		else if (funct3 == 5 && (insn >> 20) == 0x287) {
+			*result = 0;
+			for (int i = 0; i < 32; i += 8)
+				*result |= (a >> i & 0xff) != 0 ? 0xffu << i : 0;
+			return true;
+		}
+		else if (funct3 == 5 && (insn >> 20) == 0x698) {
+			*result = __builtin_bswap32(a);
+			return true;
+		}
+		return false;
+	}
+	switch (funct7) {
+	case 0x20:
+		switch (funct3) {
+		case 4: *result = ~(a ^ b); return true;
+		case 6: *result = a | ~b; return true;
+		case 7: *result = a & ~b; return true;
+		}
+		break;
+	case 0x05:
+		switch (funct3) {
+		case 4: *result = (int32_t)a < (int32_t)b ? a : b; return true;
+		case 5: *result = a < b ? a : b; return true;
+		case 6: *result = (int32_t)a > (int32_t)b ? a : b; return true;
+		case 7: *result = a > b ? a : b; return true;
+		}
+		break;
+	case 0x04:
+		if (funct3 == 4 && rs2 == 0) {
+			*result = a & 0xffff;
+			return true;
+		}
+		break;
+	case 0x30:
+		if (funct3 == 1) {
+			*result = ror(a, 32 - (b & 0x1f));
+			return true;
+		}
+		if (funct3 == 5) {
+			*result = ror(a, b);
+			return true;
+		}
+		break;
+	}
+	return false;
+}
+
+/*
+ * The CRC32C and Toeplitz hash instructions (see alu_unit.sv).
+ */
+static uint32_t
+crc32c(uint32_t crc, uint32_t data, int nbytes)
+{
+	for (int i = 0; i < nbytes * 8; i++)
+		crc = crc >> 1 ^ (((crc ^ data >> i) & 1) ? 0x82f63b78 : 0);
+	return crc;
+}
+
+static bool
+hash(int funct3, int funct7, uint32_t a, uint32_t b, uint32_t *result)
+{
+	if (funct3 != 0)
+		return false;
+	*result = 0;
+	switch (funct7) {
+	case 0: *result = crc32c(a, b, 1); return true;
+	case 1: *result = crc32c(a, b, 2); return true;
+	case 2: *result = crc32c(a, b, 4); return true;
+	case 4:
+		for (int i = 0; i < 32; i++)
+			if (b >> (31 - i) & 1)
+				*result ^= a << i;
+		return true;
+	case 5:
+		for (int i = 1; i < 32; i++)
+			if (b >> (31 - i) & 1)
+				*result ^= a >> (32 - i);
+		return true;
+	}
+	return false;
+}
+
+unsigned
+cpu_step(struct cpu *cpu)
+{
+	uint32_t pc = cpu->pc;
+	uint32_t next_pc = pc + 4;
+	unsigned cycles = CYCLES_ALU;
+
+	if (pc - BRAM_ADDR > BRAM_SIZE - 2 || (pc & 1) != 0) {
+		cpu->halt = "instruction fetch outside of the BRAM";
+		return 0;
+	}
+	uint16_t parcel;
+	uint32_t insn;
+	memcpy(&parcel, &bram[pc - BRAM_ADDR], sizeof(parcel));
+	if ((parcel & 3) != 3) {
+		insn = rvc_expand(parcel);
+		next_pc = pc + 2;
+	}
+	else {
+		if (pc - BRAM_ADDR > BRAM_SIZE - 4) {
+			cpu->halt = "instruction fetch outside of the BRAM";
+			return 0;
+		}
+		memcpy(&insn, &bram[pc - BRAM_ADDR], sizeof(insn));
+	}
+
+	int rd = (insn >> 7) & 0x1f;
+	int rs1 = (insn >> 15) & 0x1f;
+	int rs2 = (insn >> 20) & 0x1f;
+	int funct3 = (insn >> 12) & 0x7;
+	int funct7 = insn >> 25;
+	uint32_t a = cpu->x[rs1];
+	uint32_t b = cpu->x[rs2];
+	uint32_t result = 0;
+	bool write_rd = true;
+
+	switch (insn & 0x7f) {
+	case OPCODE_LUI:
+		result = insn & 0xfffff000;
+		break;
+	case OPCODE_AUIPC:
+		result = pc + (insn & 0xfffff000);
+		break;
+	case OPCODE_JAL:
+		result = next_pc;
+		next_pc = pc + imm_j(insn);
+		cycles = CYCLES_JUMP;
+		// The firmware parks in "for (;;) { }" after fatal errors.
+		if (next_pc == pc)
+			cpu->halt = "endless loop";
+		break;
+	case OPCODE_JALR:
+		result = next_pc;
+		next_pc = (a + imm_i(insn)) & ~(uint32_t)1;
+		cycles = CYCLES_JUMP;
+		break;
+	case OPCODE_BRANCH: {
+		bool taken;
+		switch (funct3) {
+		case 0: taken = a == b; break;
+		case 1: taken = a != b; break;
+		case 4: taken = (int32_t)a < (int32_t)b; break;
+		case 5: taken = (int32_t)a >= (int32_t)b; break;
+		case 6: taken = a < b; break;
+		case 7: taken = a >= b; break;
+		default:
+			cpu->halt = "illegal instruction";
+			return 0;
+		}
+		if (taken) {
+			next_pc = pc + imm_b(insn);
+			cycles = CYCLES_BRANCH_TAKEN;
+		}
+		write_rd = false;
+		break;
+	}
+	case OPCODE_LOAD: {
+		uint32_t addr = a + imm_i(insn);
+		cycles = CYCLES_LOAD;
+		switch (funct3) {
+		case 0: result = (int32_t)(int8_t)mem_load(addr, 1, &cycles); break;
+		case 1: result = (int32_t)(int16_t)mem_load(addr, 2, &cycles); break;
+		case 2: result = mem_load(addr, 4, &cycles); break;
+		case 4: result = mem_load(addr, 1, &cycles); break;
+		case 5: result = mem_load(addr, 2, &cycles); break;
+		default:
+			cpu->halt = "illegal instruction";
+			return 0;
+		}
+		break;
+	}
+	case OPCODE_STORE: {
+		uint32_t addr = a + imm_s(insn);
+		cycles = CYCLES_STORE;
+		if (funct3 > 2) {
+			cpu->halt = "illegal instruction";
+			return 0;
+		}
+		mem_store(addr, b, 1 << funct3, &cycles);
+		if (cpu->reserved && (addr & ~(uint32_t)3) == cpu->reserved_addr)
+			cpu->reserved = false;
+		write_rd = false;
+		break;
+	}
+	case OPCODE_OP_IMM: {
+		int32_t imm = imm_i(insn);
+		int shamt = imm & 0x1f;
+		if (zbb(insn, a, b, &result))
+			break;
+		switch (funct3) {
+		case 0: result = a + imm; break;
+		case 1: result = a << shamt; break;
+		case 2: result = (int32_t)a < imm; break;
+		case 3: result = a < (uint32_t)imm; break;
+		case 4: result = a ^ imm; break;
+		case 5:
+			if (funct7 & 0x20)
+				result = (int32_t)a >> shamt;
+			else
+				result = a >> shamt;
+			break;
+		case 6: result = a | imm; break;
+		case 7: result = a & imm; break;
+		}
+		break;
+	}
+	case OPCODE_OP:
+		if (funct7 == 0x01) {
+			result = mul(a, b, funct3);
+			cycles = funct3 < 4 ? CYCLES_MUL : CYCLES_DIV;
+			break;
+		}
+		if (zbb(insn, a, b, &result))
+			break;
+		switch (funct3) {
+		case 0: result = funct7 & 0x20 ? a - b : a + b; break;
+		case 1: result = a << (b & 0x1f); break;
+		case 2: result = (int32_t)a < (int32_t)b; break;
+		case 3: result = a < b; break;
+		case 4: result = a ^ b; break;
+		case 5:
+			if (funct7 & 0x20)
+				result = (int32_t)a >> (b & 0x1f);
+			else
+				result = a >> (b & 0x1f);
+			break;
+		case 6: result = a | b; break;
+		case 7: result = a & b; break;
+		}
+		break;
+	case OPCODE_AMO: {
+		int funct5 = funct7 >> 2;
+		cycles = CYCLES_AMO;
+		if (funct3 != 2) {
+			cpu->halt = "illegal instruction";
+			return 0;
+		}
+		if (funct5 == 0x02) {
+			// LR.W
+			result = mem_load(a, 4, &cycles);
+			cpu->reserved = true;
+			cpu->reserved_addr = a;
+		}
+		else if (funct5 == 0x03) {
+			// SC.W
+			if (cpu->reserved && cpu->reserved_addr == a) {
+				mem_store(a, b, 4, &cycles);
+				result = 0;
+			}
+			else {
+				result = 1;
+			}
+			cpu->reserved = false;
+		}
+		else {
+			result = mem_load(a, 4, &cycles);
+			mem_store(a, amo(result, b, funct5), 4, &cycles);
+		}
+		break;
+	}
+	case OPCODE_MISC_MEM:
+		// FENCE and FENCE.I: There is nothing to wait for.
+		write_rd = false;
+		break;
+	case OPCODE_SYSTEM: {
+		int csr = insn >> 20;
+		uint32_t x = funct3 & 4 ? (uint32_t)rs1 : a;
+		if (funct3 == 0) {
+			cpu->halt = insn == 0x00100073 ? "ebreak" : "ecall or xret";
+			return 0;
+		}
+		cycles = CYCLES_CSR;
+		result = csr_read(cpu, csr);
+		switch (funct3 & 3) {
+		case 1: csr_write(cpu, csr, x); break;
+		case 2: if (rs1 != 0) csr_write(cpu, csr, result | x); break;
+		case 3: if (rs1 != 0) csr_write(cpu, csr, result & ~x); break;
+		}
+		break;
+	}
+	case OPCODE_CUSTOM_0:
+		cycles = CYCLES_SP;
+		result = sp_exec(cpu->cycle, funct3, funct7, a, b, &cpu->halt);
+		break;
+	case OPCODE_CUSTOM_1:
+		if (!hash(funct3, funct7, a, b, &result)) {
+			cpu->halt = "illegal instruction";
+			return 0;
+		}
+		break;
+	default:
+		cpu->halt = "illegal instruction";
+		return 0;
+	}
+
+	if (write_rd && rd != 0)
+		cpu->x[rd] = result;
+	cpu->pc = next_pc;
+	cpu->cycle += cycles;
+	cpu->instret++;
+	hpm_count(cpu, insn & 0x7f, cycles);
+	return cycles;
+}
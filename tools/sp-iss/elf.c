@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iss.h"
+
+struct symbol *symbols;
+int nsymbols;
+
+static int
+symbol_cmp(const void *a, const void *b)
+{
+	const struct symbol *x = a;
+	const struct symbol *y = b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static void
+load_symbols(const uint8_t *image, size_t size, const Elf32_Ehdr *ehdr)
+{
+	const Elf32_Shdr *shdrs = (const Elf32_Shdr *)(image + ehdr->e_shoff);
+
+	if (ehdr->e_shoff == 0 || ehdr->e_shoff + ehdr->e_shnum * sizeof(Elf32_Shdr) > size)
+		return;
+
+	for (int i = 0; i < ehdr->e_shnum; i++) {
+		if (shdrs[i].sh_type != SHT_SYMTAB || shdrs[i].sh_link >= ehdr->e_shnum)
+			continue;
+		const Elf32_Shdr *strtab = &shdrs[shdrs[i].sh_link];
+		const Elf32_Sym *syms = (const Elf32_Sym *)(image + shdrs[i].sh_offset);
+		int n = shdrs[i].sh_size / sizeof(Elf32_Sym);
+
+		symbols = calloc(n, sizeof(*symbols));
+		for (int j = 0; j < n; j++) {
+			if (ELF32_ST_TYPE(syms[j].st_info) != STT_FUNC)
+				continue;
+			symbols[nsymbols].addr = syms[j].st_value;
+			symbols[nsymbols].size = syms[j].st_size;
+			symbols[nsymbols].name = strdup((const char *)image +
+				strtab->sh_offset + syms[j].st_name);
+			nsymbols++;
+		}
+		break;
+	}
+	qsort(symbols, nsymbols, sizeof(*symbols), symbol_cmp);
+}
+
+/*
+ * Loads the PT_LOAD segments of a firmware ELF file into the BRAMs.
+ */
+int
+elf_load(const char *path, uint32_t *entry)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	uint8_t *image = malloc(size);
+	if (image == NULL || fread(image, 1, size, fp) != (size_t)size) {
+		fprintf(stderr, "%s: Cannot read file\n", path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)image;
+	if (size < (long)sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+		ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_machine != EM_RISCV) {
+		fprintf(stderr, "%s: Not a 32-bit RISC-V ELF file\n", path);
+		return -1;
+	}
+
+	const Elf32_Phdr *phdrs = (const Elf32_Phdr *)(image + ehdr->e_phoff);
+	for (int i = 0; i < ehdr->e_phnum; i++) {
+		const Elf32_Phdr *phdr = &phdrs[i];
+		if (phdr->p_type != PT_LOAD || phdr->p_memsz == 0)
+			continue;
+		if (phdr->p_paddr - BRAM_ADDR > BRAM_SIZE ||
+			phdr->p_paddr - BRAM_ADDR + phdr->p_memsz > BRAM_SIZE) {
+			fprintf(stderr, "%s: Segment at 0x%08x does not fit into the BRAMs\n",
+				path, phdr->p_paddr);
+			return -1;
+		}
+		uint8_t *p = &bram[phdr->p_paddr - BRAM_ADDR];
+		memcpy(p, image + phdr->p_offset, phdr->p_filesz);
+		memset(p + phdr->p_filesz, 0, phdr->p_memsz - phdr->p_filesz);
+	}
+	*entry = ehdr->e_entry;
+
+	load_symbols(image, size, ehdr);
+	free(image);
+	return 0;
+}
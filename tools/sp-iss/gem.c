@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Model of the GEM and of the host driver
+ *
+ * The GEM receives synthetic IPv4/UDP frames at a fixed interval and
+ * puts them into the RX FIFOs. It takes frames out of the TX FIFOs at
+ * the link speed.
+ *
+ * The driver sets up the descriptor rings in DDR memory and runs at a
+ * fixed interval like a polling (NAPI) driver: it gives used RX
+ * descriptors back, reaps sent TX descriptors, posts new TX frames and
+ * kicks the SP with START_TX whenever TX descriptors are outstanding.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "iss.h"
+
+// Registers (see firmware/src/gem-dma.h)
+#define GEM_NETWORK_CONFIG_OFFSET				0x004
+#define GEM_DMA_CONFIG_OFFSET					0x010
+#define GEM_DMA_RXBUF_SIZE_Q1_OFFSET			0x4a0
+#define GEM_NETWORK_CONFIG_DATA_BUS_WIDTH_BITN	21
+#define GEM_DMA_CONFIG_RX_BUF_SIZE_BITN			16
+#define GEM_DMA_RX_BUF_SIZE_UNIT				64
+
+// Descriptor bits
+#define GEM_RX_DD0_VALID_BITN					0
+#define GEM_RX_DD0_WRAP_BITN					1
+#define GEM_RX_DD1_SOF_BITN						14
+#define GEM_RX_DD1_EOF_BITN						15
+#define GEM_TX_DD1_EOF_BITN						15
+#define GEM_TX_DD1_WRAP_BITN					30
+#define GEM_TX_DD1_USED_BITN					31
+
+// RX meta FIFO words (see firmware/src/sp.h)
+#define SP_RX_HDR_INFO_L3_OFF_BITN				0
+#define SP_RX_HDR_INFO_L4_OFF_BITN				8
+#define SP_RX_HDR_INFO_HDR_LEN_BITN				16
+#define SP_RX_HDR_INFO_IPV4_BITN				25
+#define SP_RX_HDR_INFO_UDP_BITN					28
+// IP and UDP checksums have been checked
+#define RX_STATUS_CHKSUM_ENC_UDP				3
+#define RX_STATUS_CHKSUM_ENC_BITN				22
+
+/*
+ * Layout of the DDR memory
+ */
+#define DESC_NWORDS			2
+#define RX_DESC_BASE(q)		(0x10000000 + (q) * 0x100000)
+#define TX_DESC_BASE(q)		(0x10800000 + (q) * 0x100000)
+#define RX_BUF_SIZE			1536
+#define RX_BUF(q, i)		(0x20000000 + (uint64_t)(q) * 0x1000000 + (uint64_t)(i) * 2048)
+#define TX_BUF(q, i)		(0x40000000 + (uint64_t)(q) * 0x1000000 + (uint64_t)(i) * 16384)
+#define MAX_FRAME_LENGTH	9000
+
+#define TICK_INTERVAL		64
+
+struct gem_stats gem_stats;
+
+static uint32_t regs[0x1000 / 4];
+
+static struct {
+	uint64_t rx_next;
+	uint64_t tx_wire_free;
+	uint64_t host_next;
+	int rx_interval;
+	uint64_t rx_seq;
+	// The next RX descriptor the driver looks at
+	int rx_next_desc[NQUEUES];
+	// The TX descriptors between tx_reap and tx_post are owned by the SP.
+	int tx_post[NQUEUES];
+	int tx_reap[NQUEUES];
+	int tx_outstanding[NQUEUES];
+} gem;
+
+static uint16_t
+ip_csum(const uint8_t *p, int length)
+{
+	uint32_t sum = 0;
+
+	for (int i = 0; i < length; i += 2)
+		sum += (uint32_t)p[i] << 8 | p[i + 1];
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+/*
+ * An IPv4/UDP frame without FCS
+ */
+static void
+build_frame(uint8_t *p, int length, uint32_t seq)
+{
+	static const uint8_t hdr[42] = {
+		// Ethernet
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x02,
+		0x08, 0x00,
+		// IPv4
+		0x45, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
+		0x40, 0x11, 0x00, 0x00,
+		10, 0, 0, 2,
+		10, 0, 0, 1,
+		// UDP
+		0x04, 0xd2, 0x16, 0x2e, 0x00, 0x00, 0x00, 0x00
+	};
+	int ip_length = length - 14;
+	int udp_length = length - 34;
+
+	memcpy(p, hdr, sizeof(hdr));
+	p[16] = ip_length >> 8;
+	p[17] = ip_length;
+	p[18] = seq >> 8;
+	p[19] = seq;
+	uint16_t csum = ip_csum(p + 14, 20);
+	p[24] = csum >> 8;
+	p[25] = csum;
+	p[38] = udp_length >> 8;
+	p[39] = udp_length;
+	for (int i = sizeof(hdr); i < length; i++)
+		p[i] = seq + i;
+}
+
+// Cycles on the wire, including the preamble, FCS and inter-frame gap.
+static uint64_t
+wire_cycles(int length)
+{
+	return (uint64_t)(length + 24) * 8 * config.clk_mhz / config.link_mbps;
+}
+
+static int
+clamp_length(int length)
+{
+	if (length < 60)
+		return 60;
+	if (length > MAX_FRAME_LENGTH)
+		return MAX_FRAME_LENGTH;
+	return length;
+}
+
+void
+gem_init(void)
+{
+	uint8_t frame[MAX_FRAME_LENGTH];
+
+	config.rx_length = clamp_length(config.rx_length);
+	config.tx_length = clamp_length(config.tx_length);
+	if (config.rx_nqueues > sp_rx_nqueues())
+		config.rx_nqueues = sp_rx_nqueues();
+	if (config.tx_nqueues > NQUEUES)
+		config.tx_nqueues = NQUEUES;
+
+	regs[GEM_DMA_CONFIG_OFFSET / 4] =
+		RX_BUF_SIZE / GEM_DMA_RX_BUF_SIZE_UNIT << GEM_DMA_CONFIG_RX_BUF_SIZE_BITN;
+	regs[GEM_DMA_RXBUF_SIZE_Q1_OFFSET / 4] = RX_BUF_SIZE / GEM_DMA_RX_BUF_SIZE_UNIT;
+	// 0: 32 bits, 1: 64 bits, 2: 128 bits
+	regs[GEM_NETWORK_CONFIG_OFFSET / 4] = (config.data_fifo_width >= 128 ? 2 :
+		config.data_fifo_width == 64 ? 1 : 0) << GEM_NETWORK_CONFIG_DATA_BUS_WIDTH_BITN;
+
+	mmr.r[MMR_R_REGN_RX_DMA_DESC_BASE_0] = RX_DESC_BASE(0);
+	mmr.r[MMR_R_REGN_RX_DMA_DESC_BASE_1] = RX_DESC_BASE(1);
+	mmr.r[MMR_R_REGN_TX_DMA_DESC_BASE_0] = TX_DESC_BASE(0);
+	mmr.r[MMR_R_REGN_TX_DMA_DESC_BASE_1] = TX_DESC_BASE(1);
+	mmr.rw[0] = 1 << CONTROL_ENABLE_RX_BITN | 1 << CONTROL_ENABLE_TX_BITN;
+
+	for (int q = 0; q < NQUEUES; q++) {
+		for (int i = 0; i < config.rx_ring_size; i++) {
+			uint64_t descp = RX_DESC_BASE(q) + i * DESC_NWORDS * 4;
+			bool last = i == config.rx_ring_size - 1;
+			ddr_write32(descp, (uint32_t)RX_BUF(q, i) | (uint32_t)last << GEM_RX_DD0_WRAP_BITN);
+			ddr_write32(descp + 4, 0);
+		}
+		// All TX descriptors belong to the driver until it posts frames.
+		for (int i = 0; i < config.tx_ring_size; i++) {
+			uint64_t descp = TX_DESC_BASE(q) + i * DESC_NWORDS * 4;
+			bool last = i == config.tx_ring_size - 1;
+			build_frame(frame, config.tx_length, i);
+			ddr_write(TX_BUF(q, i), frame, config.tx_length);
+			ddr_write32(descp, (uint32_t)TX_BUF(q, i));
+			ddr_write32(descp + 4, (uint32_t)1 << GEM_TX_DD1_USED_BITN |
+				(uint32_t)last << GEM_TX_DD1_WRAP_BITN);
+		}
+	}
+
+	gem.rx_interval = config.rx_interval != 0 ? config.rx_interval :
+		wire_cycles(config.rx_length);
+}
+
+uint32_t
+gem_read_reg(uint32_t off)
+{
+	return regs[off / 4];
+}
+
+void
+gem_write_reg(uint32_t off, uint32_t x)
+{
+	regs[off / 4] = x;
+}
+
+static void
+gem_rx(uint64_t now)
+{
+	uint8_t frame[MAX_FRAME_LENGTH];
+	uint32_t meta[RX_META_NWORDS] = { 0 };
+	int length = config.rx_length;
+	int q = gem.rx_seq % config.rx_nqueues;
+
+	build_frame(frame, length, gem.rx_seq);
+	meta[0] = 1 << GEM_RX_DD1_SOF_BITN | 1 << GEM_RX_DD1_EOF_BITN |
+		RX_STATUS_CHKSUM_ENC_UDP << RX_STATUS_CHKSUM_ENC_BITN | length;
+	sp_tsu_time(now, &meta[1], &meta[2]);
+	meta[3] = 14 << SP_RX_HDR_INFO_L3_OFF_BITN | 34 << SP_RX_HDR_INFO_L4_OFF_BITN |
+		42 << SP_RX_HDR_INFO_HDR_LEN_BITN |
+		1 << SP_RX_HDR_INFO_IPV4_BITN | 1 << SP_RX_HDR_INFO_UDP_BITN;
+
+	if (sp_rx_push(now, q, frame, length, meta))
+		gem_stats.rx_frames++;
+	else
+		gem_stats.rx_dropped++;
+	gem.rx_seq++;
+}
+
+static void
+host_rx(int q)
+{
+	for (int n = 0; n < config.rx_ring_size; n++) {
+		uint64_t descp = RX_DESC_BASE(q) + gem.rx_next_desc[q] * DESC_NWORDS * 4;
+		uint32_t desc_0 = ddr_read32(descp);
+		uint32_t desc_1 = ddr_read32(descp + 4);
+
+		if (!(desc_0 & (1 << GEM_RX_DD0_VALID_BITN)))
+			break;
+		if (desc_1 & (1 << GEM_RX_DD1_EOF_BITN)) {
+			gem_stats.rx_delivered++;
+			if ((desc_1 & (1 << GEM_RX_DD1_SOF_BITN)) &&
+				(desc_1 & 0x3fff) != (uint32_t)config.rx_length)
+				gem_stats.rx_bad_length++;
+		}
+		ddr_write32(descp, desc_0 & ~((uint32_t)1 << GEM_RX_DD0_VALID_BITN));
+		gem.rx_next_desc[q] = (gem.rx_next_desc[q] + 1) % config.rx_ring_size;
+	}
+}
+
+static void
+host_tx(int q)
+{
+	while (gem.tx_outstanding[q] > 0) {
+		uint64_t descp = TX_DESC_BASE(q) + gem.tx_reap[q] * DESC_NWORDS * 4;
+		if (!(ddr_read32(descp + 4) & ((uint32_t)1 << GEM_TX_DD1_USED_BITN)))
+			break;
+		gem_stats.tx_completed++;
+		gem.tx_reap[q] = (gem.tx_reap[q] + 1) % config.tx_ring_size;
+		gem.tx_outstanding[q]--;
+	}
+	while (gem.tx_outstanding[q] < config.tx_ring_size &&
+		(config.tx_nframes < 0 || gem_stats.tx_posted < (uint64_t)config.tx_nframes)) {
+		uint64_t descp = TX_DESC_BASE(q) + gem.tx_post[q] * DESC_NWORDS * 4;
+		bool last = gem.tx_post[q] == config.tx_ring_size - 1;
+		ddr_write32(descp + 4, (uint32_t)last << GEM_TX_DD1_WRAP_BITN |
+			1 << GEM_TX_DD1_EOF_BITN | config.tx_length);
+		gem_stats.tx_posted++;
+		gem.tx_post[q] = (gem.tx_post[q] + 1) % config.tx_ring_size;
+		gem.tx_outstanding[q]++;
+	}
+	if (gem.tx_outstanding[q] > 0)
+		mmr.rw[0] |= 1 << CONTROL_START_TX_BITN;
+}
+
+uint64_t
+gem_tick(uint64_t now)
+{
+	uint64_t next = now + TICK_INTERVAL;
+
+	while (now >= gem.rx_next &&
+		(config.rx_nframes < 0 || gem.rx_seq < (uint64_t)config.rx_nframes)) {
+		gem_rx(now);
+		gem.rx_next += gem.rx_interval;
+	}
+	if (gem.rx_next < next)
+		next = gem.rx_next;
+
+	sp_tick(now);
+	if (now >= gem.tx_wire_free) {
+		uint32_t meta;
+		if (sp_tx_pop(now, &meta)) {
+			int length = meta & 0x3fff;
+			gem_stats.tx_sent++;
+			gem_stats.tx_bytes += length;
+			gem.tx_wire_free = now + wire_cycles(length);
+			sp_tick(now);
+		}
+	}
+
+	if (now >= gem.host_next) {
+		for (int q = 0; q < NQUEUES; q++)
+			host_rx(q);
+		for (int q = 0; q < config.tx_nqueues; q++)
+			host_tx(q);
+		gem.host_next = now + config.host_interval;
+	}
+	if (gem.host_next < next)
+		next = gem.host_next;
+
+	return next;
+}
+
+/*
+ * Returns true when all the frames asked for have been received or
+ * dropped and all the frames asked for have been sent.
+ */
+bool
+gem_done(void)
+{
+	if (config.rx_nframes < 0 || config.tx_nframes < 0)
+		return false;
+	if (config.rx_nframes == 0 && config.tx_nframes == 0)
+		return false;
+	return gem_stats.rx_delivered + gem_stats.rx_dropped >= (uint64_t)config.rx_nframes &&
+		gem_stats.tx_completed >= (uint64_t)config.tx_nframes;
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _ISS_H_
+#define _ISS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Memory map of the SP
+ * (see core/taiga_config.sv and firmware/Makefile)
+ */
+#define IBRAM_ADDR				0x00020000
+#define IBRAM_SIZE				(32 * 1024)
+#define DBRAM_ADDR				0x00028000
+#define DBRAM_SIZE				(32 * 1024)
+#define BRAM_ADDR				IBRAM_ADDR
+#define BRAM_SIZE				(IBRAM_SIZE + DBRAM_SIZE)
+// ACPBRAM_SIZE is 4*64*8 bits. Like the BRAM, the ACP RAM ignores the
+// address bits above its size, so the rest of the range aliases it.
+#define ACPRAM_ADDR				0x00030000
+#define ACPRAM_SIZE				256
+#define ACPRAM_ADDR_H			0x0003ffff
+// Everything else goes to the I/O AXI bus.
+
+#define NQUEUES					2
+
+/*
+ * Cycle model
+ *
+ * Taiga issues at most one instruction per cycle. The costs below are
+ * rough averages of its execution units. Operand dependencies, the
+ * branch predictor and instruction fetch stalls are not modelled.
+ */
+#define CYCLES_ALU				1
+// The fetch stages are flushed.
+#define CYCLES_BRANCH_TAKEN		3
+#define CYCLES_JUMP				3
+#define CYCLES_LOAD				2
+#define CYCLES_STORE			1
+#define CYCLES_MUL				2
+#define CYCLES_DIV				34
+#define CYCLES_AMO				4
+#define CYCLES_CSR				2
+// Issue and write-back through the SP unit
+#define CYCLES_SP				2
+// A round trip through the I/O AXI interconnect
+#define CYCLES_IO_LOAD			40
+#define CYCLES_IO_STORE			4
+// The DMA engines (C_M_AXI_DMA_DATA_WIDTH = 32)
+#define CYCLES_DMA_SETUP		30
+#define DMA_BYTES_PER_CYCLE		4
+// The ACP engine (C_M_AXI_ACP_DATA_WIDTH = 128)
+#define CYCLES_ACP_SETUP		30
+#define ACP_BYTES_PER_CYCLE		16
+
+#define NHPMCOUNTERS			4
+
+struct cpu {
+	uint32_t x[32];
+	uint32_t pc;
+	uint64_t cycle;
+	uint64_t instret;
+	// LR/SC reservation
+	bool reserved;
+	uint32_t reserved_addr;
+	uint32_t csr[4096];
+	// mhpmcounter3 and up (see core/taiga_config.sv)
+	uint64_t hpmcounter[NHPMCOUNTERS];
+	uint32_t hpmevent[NHPMCOUNTERS];
+	const char *halt;
+};
+
+/*
+ * Options
+ */
+struct iss_config {
+	// The PL clock in MHz
+	int clk_mhz;
+	// The Ethernet link speed in Mbit/s
+	int link_mbps;
+	// The width of the RX and TX data FIFOs in bits
+	int data_fifo_width;
+	// Extended (time stamp) or 64-bit descriptors
+	bool ext_desc_ts;
+	bool desc_64bit;
+	int rx_ring_size;
+	int tx_ring_size;
+	// RX and TX frames (0 disables the traffic, -1 does not limit it)
+	long rx_nframes;
+	long tx_nframes;
+	int rx_length;
+	int tx_length;
+	// The number of cycles between two received frames (0 is line rate)
+	int rx_interval;
+	// The number of RX and TX queues that get traffic
+	int rx_nqueues;
+	int tx_nqueues;
+	// The number of cycles between two runs of the host driver
+	int host_interval;
+	bool quiet;
+};
+
+extern struct iss_config config;
+
+/*
+ * cpu.c
+ */
+void cpu_reset(struct cpu *cpu, uint32_t pc);
+// Returns the number of cycles of the instruction.
+unsigned cpu_step(struct cpu *cpu);
+
+/*
+ * mem.c
+ */
+extern uint8_t bram[BRAM_SIZE];
+extern uint8_t acpram[ACPRAM_SIZE];
+
+uint32_t mem_load(uint32_t addr, int size, unsigned *cycles);
+void mem_store(uint32_t addr, uint32_t x, int size, unsigned *cycles);
+void ddr_read(uint64_t addr, void *p, size_t n);
+void ddr_write(uint64_t addr, const void *p, size_t n);
+uint32_t ddr_read32(uint64_t addr);
+void ddr_write32(uint64_t addr, uint32_t x);
+
+/*
+ * elf.c
+ */
+struct symbol {
+	uint32_t addr;
+	uint32_t size;
+	char *name;
+};
+
+int elf_load(const char *path, uint32_t *entry);
+extern struct symbol *symbols;
+extern int nsymbols;
+
+/*
+ * sp-model.c
+ */
+// The MMR registers as defined in mmr/mmr_config.sv
+#define MMR_RW_NREGS			2
+#define MMR_R_NREGS				37
+#define MMR_R_BITN				8
+// The modeled SP pair is attached to GEM3
+#define GEM3_BASE				0xff0e0000
+
+enum {
+	MMR_R_REGN_IO_AXI_AXCACHE,
+	MMR_R_REGN_DMA_AXI_AXCACHE,
+	MMR_R_REGN_RESERVED0,
+	MMR_R_REGN_RX_DMA_DESC_BASE_0,
+	MMR_R_REGN_RX_DMA_DESC_BASE_1,
+	MMR_R_REGN_TX_DMA_DESC_BASE_0,
+	MMR_R_REGN_TX_DMA_DESC_BASE_1,
+	MMR_R_REGN_RX_DATA_FIFO_SIZE,
+	MMR_R_REGN_RX_DATA_FIFO_WIDTH,
+	MMR_R_REGN_TX_DATA_FIFO_SIZE,
+	MMR_R_REGN_TX_DATA_FIFO_WIDTH,
+	MMR_R_REGN_RX_HDR_SPLIT,
+	MMR_R_REGN_RX_COPYBREAK,
+	MMR_R_REGN_RX_LRO,
+	MMR_R_REGN_TX_CUT_THROUGH,
+	MMR_R_REGN_TX_SCHED,
+	MMR_R_REGN_TX_SCHED_WEIGHTS,
+	MMR_R_REGN_TX_SHAPER_RATE_0,
+	MMR_R_REGN_TX_SHAPER_BURST_0,
+	MMR_R_REGN_TX_SHAPER_RATE_1,
+	MMR_R_REGN_TX_SHAPER_BURST_1,
+	MMR_R_REGN_VLAN,
+	MMR_R_REGN_RX_FLOW_CTRL,
+	MMR_R_REGN_RX_FLOW_CTRL_PAUSE,
+	MMR_R_REGN_RX_QUEUE_MAP,
+	MMR_R_REGN_RX_STASH,
+	MMR_R_REGN_BENCH,
+	MMR_R_REGN_GEN_LENGTH,
+	MMR_R_REGN_GEN_PERIOD,
+	MMR_R_REGN_RX_MIRROR,
+	MMR_R_REGN_RX_MIRROR_FILTER,
+	MMR_R_REGN_RX_MIRROR_RING_BASE,
+	MMR_R_REGN_RX_MIRROR_RING_BASE_H,
+	MMR_R_REGN_RX_MIRROR_RING_SIZE,
+	MMR_R_REGN_TX_LAUNCH,
+	MMR_R_REGN_GEM_BASE,
+	MMR_R_REGN_PEER_STATUS
+};
+
+#define CONTROL_ENABLE_RX_BITN	0
+#define CONTROL_ENABLE_TX_BITN	1
+#define CONTROL_START_TX_BITN	3
+#define CONTROL_EXT_DESC_TS_BITN	4
+#define CONTROL_64BIT_DESC_BITN	5
+
+#define MMR_RW_REGN_STATUS		1
+#define STATUS_RX_PAUSE_BITN	1
+
+#define RX_META_NWORDS			8
+
+struct sp_mmr {
+	uint32_t rw[MMR_RW_NREGS];
+	uint32_t r[MMR_R_NREGS];
+};
+
+struct sp_stats {
+	// The number of RX done and TX done interrupts per queue
+	uint64_t rx_intrs[NQUEUES];
+	uint64_t tx_intrs[NQUEUES];
+	uint64_t rx_dma_bytes;
+	uint64_t tx_dma_bytes;
+	uint64_t acp_reads;
+	uint64_t acp_writes;
+	// The number of times the RX firmware asked for a pause
+	uint64_t pause_requests;
+};
+
+extern struct sp_mmr mmr;
+extern struct sp_stats sp_stats;
+
+void sp_init(void);
+// Executes a custom instruction and returns its result.
+uint32_t sp_exec(uint64_t now, int funct3, int funct7, uint32_t rs1, uint32_t rs2, const char **halt);
+void sp_tick(uint64_t now);
+int sp_rx_nqueues(void);
+bool sp_rx_push(uint64_t now, int q, const uint8_t *data, int length, const uint32_t *meta);
+bool sp_tx_pop(uint64_t now, uint32_t *meta);
+void sp_tsu_time(uint64_t now, uint32_t *ts_1, uint32_t *ts_2);
+
+/*
+ * gem.c
+ */
+struct gem_stats {
+	uint64_t rx_frames;
+	uint64_t rx_dropped;
+	uint64_t rx_delivered;
+	uint64_t rx_bad_length;
+	uint64_t tx_posted;
+	uint64_t tx_sent;
+	uint64_t tx_bytes;
+	uint64_t tx_completed;
+};
+
+extern struct gem_stats gem_stats;
+
+void gem_init(void);
+uint32_t gem_read_reg(uint32_t off);
+void gem_write_reg(uint32_t off, uint32_t x);
+// Returns the cycle of the next event.
+uint64_t gem_tick(uint64_t now);
+bool gem_done(void);
+
+#endif
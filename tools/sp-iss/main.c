@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * sp-iss: An instruction set simulator for the SP firmware
+ *
+ * Runs an unmodified firmware ELF file against models of the SP unit,
+ * the GEM and the host driver, and reports where the cycles go.
+ */
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "iss.h"
+
+struct iss_config config = {
+	.clk_mhz = 300,
+	.link_mbps = 1000,
+	.data_fifo_width = 128,
+	.rx_ring_size = 256,
+	.tx_ring_size = 256,
+	.rx_nframes = -1,
+	.tx_nframes = -1,
+	.rx_length = 64,
+	.tx_length = 64,
+	.rx_interval = 0,
+	.rx_nqueues = 1,
+	.tx_nqueues = 1,
+	.host_interval = 3000,
+	.quiet = false
+};
+
+static volatile sig_atomic_t interrupted;
+
+// The function of each instruction word of the BRAMs (0 is unknown)
+static int fn_map[BRAM_SIZE / 4];
+static uint64_t *fn_cycles;
+static uint64_t *fn_insns;
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"usage: sp-iss [-q] [-c ncycles] [-n ninsns] [-f mhz] [-s mbps] [-w width]\n"
+		"              [-r nframes] [-l length] [-i interval] [-Q nqueues]\n"
+		"              [-t nframes] [-L length] [-T nqueues] [-H interval]\n"
+		"              [-m regn=value] [-p nfuncs] firmware.elf\n"
+		"\n"
+		"  -q            Do not print the serial output of the firmware.\n"
+		"  -c ncycles    Stop after ncycles cycles (default 30000000).\n"
+		"  -n ninsns     Stop after ninsns instructions.\n"
+		"  -f mhz        PL clock (default 300).\n"
+		"  -s mbps       Link speed (default 1000).\n"
+		"  -w width      Width of the RX and TX data FIFOs in bits (default 128).\n"
+		"  -r nframes    Number of frames to receive (default unlimited).\n"
+		"  -l length     Length of the received frames (default 64).\n"
+		"  -i interval   Cycles between two received frames (default line rate).\n"
+		"  -Q nqueues    Number of RX queues that receive frames (default 1).\n"
+		"  -t nframes    Number of frames to send (default unlimited).\n"
+		"  -L length     Length of the sent frames (default 64).\n"
+		"  -T nqueues    Number of TX queues that send frames (default 1).\n"
+		"  -H interval   Cycles between two runs of the driver (default 3000).\n"
+		"  -m regn=value Set read-only MMR register regn (SP_MMR_R_REGN_*).\n"
+		"  -p nfuncs     Number of functions in the profile (default 25).\n"
+		"\n"
+		"The simulation also stops when all frames asked for with -r and -t\n"
+		"are done.\n");
+	exit(1);
+}
+
+static void
+on_sigint(int sig)
+{
+	interrupted = 1;
+}
+
+static void
+build_fn_map(void)
+{
+	fn_cycles = calloc(nsymbols + 1, sizeof(*fn_cycles));
+	fn_insns = calloc(nsymbols + 1, sizeof(*fn_insns));
+
+	for (int i = 0; i < nsymbols; i++) {
+		uint32_t start = symbols[i].addr;
+		uint32_t end = start + symbols[i].size;
+		// Assembler functions often come without a size.
+		if (symbols[i].size == 0)
+			end = i + 1 < nsymbols ? symbols[i + 1].addr : BRAM_ADDR + BRAM_SIZE;
+		for (uint32_t pc = start; pc < end; pc += 4) {
+			if (pc - BRAM_ADDR < BRAM_SIZE)
+				fn_map[(pc - BRAM_ADDR) / 4] = i + 1;
+		}
+	}
+}
+
+static int
+fn_cmp(const void *a, const void *b)
+{
+	uint64_t x = fn_cycles[*(const int *)a];
+	uint64_t y = fn_cycles[*(const int *)b];
+
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static void
+print_profile(const struct cpu *cpu, int nfuncs)
+{
+	int n = nsymbols + 1;
+	int *order = malloc(n * sizeof(*order));
+
+	for (int i = 0; i < n; i++)
+		order[i] = i;
+	qsort(order, n, sizeof(*order), fn_cmp);
+
+	printf("%14s %7s %14s %6s  %s\n", "cycles", "%", "insns", "CPI", "function");
+	for (int i = 0; i < n && i < nfuncs; i++) {
+		int fn = order[i];
+		if (fn_cycles[fn] == 0)
+			break;
+		printf("%14llu %6.2f%% %14llu %6.2f  %s\n",
+			(unsigned long long)fn_cycles[fn],
+			100.0 * fn_cycles[fn] / cpu->cycle,
+			(unsigned long long)fn_insns[fn],
+			(double)fn_cycles[fn] / fn_insns[fn],
+			fn == 0 ? "(unknown)" : symbols[fn - 1].name);
+	}
+	free(order);
+}
+
+static void
+print_stats(const struct cpu *cpu, double seconds)
+{
+	uint64_t rx_intrs = 0;
+	uint64_t tx_intrs = 0;
+
+	for (int q = 0; q < NQUEUES; q++) {
+		rx_intrs += sp_stats.rx_intrs[q];
+		tx_intrs += sp_stats.tx_intrs[q];
+	}
+
+	printf("\n");
+	printf("Stopped at pc 0x%08x: %s\n", cpu->pc, cpu->halt);
+	printf("Cycles      : %llu (%.3f ms at %d MHz)\n",
+		(unsigned long long)cpu->cycle,
+		(double)cpu->cycle / config.clk_mhz / 1000, config.clk_mhz);
+	printf("Instructions: %llu (CPI %.2f, %.1f MIPS simulated)\n",
+		(unsigned long long)cpu->instret,
+		cpu->instret != 0 ? (double)cpu->cycle / cpu->instret : 0.0,
+		seconds > 0 ? cpu->instret / seconds / 1e6 : 0.0);
+	printf("RX frames   : %llu received, %llu dropped, %llu delivered, %llu bad length\n",
+		(unsigned long long)gem_stats.rx_frames,
+		(unsigned long long)gem_stats.rx_dropped,
+		(unsigned long long)gem_stats.rx_delivered,
+		(unsigned long long)gem_stats.rx_bad_length);
+	printf("TX frames   : %llu posted, %llu sent, %llu completed\n",
+		(unsigned long long)gem_stats.tx_posted,
+		(unsigned long long)gem_stats.tx_sent,
+		(unsigned long long)gem_stats.tx_completed);
+	printf("Interrupts  : %llu RX done, %llu TX done\n",
+		(unsigned long long)rx_intrs, (unsigned long long)tx_intrs);
+	printf("Pause reqs  : %llu\n", (unsigned long long)sp_stats.pause_requests);
+	printf("ACP         : %llu reads, %llu writes\n",
+		(unsigned long long)sp_stats.acp_reads,
+		(unsigned long long)sp_stats.acp_writes);
+	if (gem_stats.rx_delivered != 0)
+		printf("Cycles per RX frame: %.1f\n", (double)cpu->cycle / gem_stats.rx_delivered);
+	if (gem_stats.tx_completed != 0)
+		printf("Cycles per TX frame: %.1f\n", (double)cpu->cycle / gem_stats.tx_completed);
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t max_cycles = 30000000;
+	uint64_t max_insns = UINT64_MAX;
+	int nfuncs = 25;
+	int ch;
+
+	struct {
+		int regn;
+		uint32_t x;
+	} regs[MMR_R_NREGS];
+	int nregs = 0;
+
+	while ((ch = getopt(argc, argv, "qc:n:f:s:w:r:l:i:Q:t:L:T:H:m:p:")) != -1) {
+		switch (ch) {
+		case 'q': config.quiet = true; break;
+		case 'c': max_cycles = strtoull(optarg, NULL, 0); break;
+		case 'n': max_insns = strtoull(optarg, NULL, 0); break;
+		case 'f': config.clk_mhz = atoi(optarg); break;
+		case 's': config.link_mbps = atoi(optarg); break;
+		case 'w': config.data_fifo_width = atoi(optarg); break;
+		case 'r': config.rx_nframes = strtol(optarg, NULL, 0); break;
+		case 'l': config.rx_length = atoi(optarg); break;
+		case 'i': config.rx_interval = atoi(optarg); break;
+		case 'Q': config.rx_nqueues = atoi(optarg); break;
+		case 't': config.tx_nframes = strtol(optarg, NULL, 0); break;
+		case 'L': config.tx_length = atoi(optarg); break;
+		case 'T': config.tx_nqueues = atoi(optarg); break;
+		case 'H': config.host_interval = atoi(optarg); break;
+		case 'p': nfuncs = atoi(optarg); break;
+		case 'm': {
+			char *end;
+			if (nregs == MMR_R_NREGS)
+				usage();
+			regs[nregs].regn = strtol(optarg, &end, 0);
+			if (*end != '=' || regs[nregs].regn < 0 || regs[nregs].regn >= MMR_R_NREGS)
+				usage();
+			regs[nregs].x = strtoul(end + 1, NULL, 0);
+			nregs++;
+			break;
+		}
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1)
+		usage();
+	if (config.clk_mhz <= 0 || config.link_mbps <= 0 || config.host_interval <= 0 ||
+		config.rx_nqueues <= 0 || config.tx_nqueues <= 0 ||
+		config.rx_ring_size <= 0 || config.tx_ring_size <= 0 ||
+		(config.data_fifo_width != 32 && config.data_fifo_width != 64 &&
+		config.data_fifo_width != 128))
+		usage();
+
+	uint32_t entry;
+	if (elf_load(argv[0], &entry) != 0)
+		return 1;
+	build_fn_map();
+
+	sp_init();
+	gem_init();
+	for (int i = 0; i < nregs; i++)
+		mmr.r[regs[i].regn] = regs[i].x;
+
+	static struct cpu cpu;
+	cpu_reset(&cpu, entry);
+
+	signal(SIGINT, on_sigint);
+	clock_t start = clock();
+
+	uint64_t next_event = 0;
+	while (cpu.halt == NULL) {
+		int fn = fn_map[((cpu.pc - BRAM_ADDR) / 4) % (BRAM_SIZE / 4)];
+		unsigned cycles = cpu_step(&cpu);
+		fn_cycles[fn] += cycles;
+		fn_insns[fn]++;
+
+		if (cpu.cycle >= next_event) {
+			next_event = gem_tick(cpu.cycle);
+			if (cpu.cycle >= max_cycles)
+				cpu.halt = "cycle limit";
+			else if (cpu.instret >= max_insns)
+				cpu.halt = "instruction limit";
+			else if (gem_done())
+				cpu.halt = "all frames done";
+			else if (interrupted)
+				cpu.halt = "interrupted";
+		}
+	}
+
+	fflush(stdout);
+	print_stats(&cpu, (double)(clock() - start) / CLOCKS_PER_SEC);
+	print_profile(&cpu, nfuncs);
+
+	return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iss.h"
+
+uint8_t bram[BRAM_SIZE];
+uint8_t acpram[ACPRAM_SIZE];
+
+/*
+ * I/O devices used by the firmware
+ * (see firmware/src/uart.h, uartlite.h and gem-dma.h)
+ */
+#define UART1_BASE				0xff010000
+#define UART_SR_OFF				0x2c
+#define UART_FIFO_OFF			0x30
+#define UART_SR_TXEMPTY			(1 << 3)
+#define UARTLITE0_BASE			0xa0010000
+#define UARTLITE_TX_FIFO_OFF	0x04
+#define UARTLITE_STAT_REG_OFF	0x08
+#define UARTLITE_STAT_TXEMPTY	(1 << 2)
+#define IO_DEV_SIZE				0x1000
+
+/*
+ * DDR memory (and everything else on the I/O bus)
+ *
+ * The 40-bit address space is allocated in pages as it is touched.
+ */
+#define DDR_PAGE_SHIFT			12
+#define DDR_PAGE_SIZE			(1 << DDR_PAGE_SHIFT)
+#define DDR_NBUCKETS			4096
+
+struct ddr_page {
+	uint64_t n;
+	struct ddr_page *next;
+	uint8_t data[DDR_PAGE_SIZE];
+};
+
+static struct ddr_page *ddr_buckets[DDR_NBUCKETS];
+static struct ddr_page *ddr_last_page;
+
+static uint8_t *
+ddr_page(uint64_t addr)
+{
+	uint64_t n = addr >> DDR_PAGE_SHIFT;
+
+	if (ddr_last_page != NULL && ddr_last_page->n == n)
+		return ddr_last_page->data;
+
+	struct ddr_page **bucket = &ddr_buckets[n % DDR_NBUCKETS];
+	struct ddr_page *page;
+	for (page = *bucket; page != NULL; page = page->next) {
+		if (page->n == n)
+			break;
+	}
+	if (page == NULL) {
+		page = calloc(1, sizeof(*page));
+		if (page == NULL) {
+			perror("calloc");
+			exit(1);
+		}
+		page->n = n;
+		page->next = *bucket;
+		*bucket = page;
+	}
+	ddr_last_page = page;
+	return page->data;
+}
+
+void
+ddr_read(uint64_t addr, void *p, size_t n)
+{
+	uint8_t *dst = p;
+
+	while (n > 0) {
+		size_t off = addr & (DDR_PAGE_SIZE - 1);
+		size_t len = DDR_PAGE_SIZE - off;
+		if (len > n)
+			len = n;
+		memcpy(dst, ddr_page(addr) + off, len);
+		dst += len;
+		addr += len;
+		n -= len;
+	}
+}
+
+void
+ddr_write(uint64_t addr, const void *p, size_t n)
+{
+	const uint8_t *src = p;
+
+	while (n > 0) {
+		size_t off = addr & (DDR_PAGE_SIZE - 1);
+		size_t len = DDR_PAGE_SIZE - off;
+		if (len > n)
+			len = n;
+		memcpy(ddr_page(addr) + off, src, len);
+		src += len;
+		addr += len;
+		n -= len;
+	}
+}
+
+uint32_t
+ddr_read32(uint64_t addr)
+{
+	uint32_t x;
+
+	ddr_read(addr, &x, sizeof(x));
+	return x;
+}
+
+void
+ddr_write32(uint64_t addr, uint32_t x)
+{
+	ddr_write(addr, &x, sizeof(x));
+}
+
+static void
+serial_putc(int c)
+{
+	if (config.quiet || c == '\r')
+		return;
+	putchar(c);
+}
+
+static uint32_t
+io_load(uint32_t addr, int size)
+{
+	uint32_t base = addr & ~(uint32_t)(IO_DEV_SIZE - 1);
+	uint32_t off = addr & (IO_DEV_SIZE - 1);
+	uint32_t x = 0;
+
+	switch (base) {
+	case GEM3_BASE:
+		return gem_read_reg(off & ~(uint32_t)3);
+	// The serial ports are never busy.
+	case UART1_BASE:
+		return off == UART_SR_OFF ? UART_SR_TXEMPTY : 0;
+	case UARTLITE0_BASE:
+		return off == UARTLITE_STAT_REG_OFF ? UARTLITE_STAT_TXEMPTY : 0;
+	}
+	ddr_read(addr, &x, size);
+	return x;
+}
+
+static void
+io_store(uint32_t addr, uint32_t x, int size)
+{
+	uint32_t base = addr & ~(uint32_t)(IO_DEV_SIZE - 1);
+	uint32_t off = addr & (IO_DEV_SIZE - 1);
+
+	switch (base) {
+	case GEM3_BASE:
+		gem_write_reg(off & ~(uint32_t)3, x);
+		return;
+	case UART1_BASE:
+		if (off == UART_FIFO_OFF)
+			serial_putc(x & 0xff);
+		return;
+	case UARTLITE0_BASE:
+		if (off == UARTLITE_TX_FIFO_OFF)
+			serial_putc(x & 0xff);
+		return;
+	}
+	ddr_write(addr, &x, size);
+}
+
+static inline uint8_t *
+local_mem(uint32_t addr)
+{
+	if (addr - BRAM_ADDR < BRAM_SIZE)
+		return &bram[addr - BRAM_ADDR];
+	if (addr - ACPRAM_ADDR <= ACPRAM_ADDR_H - ACPRAM_ADDR)
+		return &acpram[(addr - ACPRAM_ADDR) & (ACPRAM_SIZE - 1)];
+	return NULL;
+}
+
+uint32_t
+mem_load(uint32_t addr, int size, unsigned *cycles)
+{
+	uint8_t *p = local_mem(addr);
+	uint32_t x = 0;
+
+	if (p != NULL) {
+		memcpy(&x, p, size);
+		return x;
+	}
+	*cycles += CYCLES_IO_LOAD;
+	return io_load(addr, size);
+}
+
+void
+mem_store(uint32_t addr, uint32_t x, int size, unsigned *cycles)
+{
+	uint8_t *p = local_mem(addr);
+
+	if (p != NULL) {
+		memcpy(p, &x, size);
+		return;
+	}
+	*cycles += CYCLES_IO_STORE;
+	io_store(addr, x, size);
+}
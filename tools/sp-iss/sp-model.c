@@ -0,0 +1,650 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Model of the SP unit (sp/sp_unit_*.sv)
+ *
+ * The commands act on the FIFOs right away. Only the DMA and ACP
+ * engines take time: they report busy for a number of cycles that
+ * grows with the length of the transfer, but the data is moved when
+ * the transfer starts.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iss.h"
+
+// RX
+#define FUNCT7_RX_META_NELEMS		0x00
+#define FUNCT7_RX_META_POP			0x01
+#define FUNCT7_RX_META_EMPTY		0x02
+#define FUNCT7_RX_META_GET			0x03
+#define FUNCT7_RX_DATA_SKIP			0x04
+#define FUNCT7_RX_DATA_DMA_START	0x05
+#define FUNCT7_RX_DATA_DMA_STATUS	0x06
+#define FUNCT7_RX_CONFIG			0x07
+#define FUNCT7_RX_FLOW_STATUS		0x20
+#define FUNCT7_RX_QUEUE_SELECT		0x21
+#define FUNCT7_RX_MIRROR_DMA_START	0x22
+#define FUNCT7_RX_META_PEEK			0x23
+// TX
+#define FUNCT7_TX_META_NFREE		0x08
+#define FUNCT7_TX_META_PUSH			0x09
+#define FUNCT7_TX_META_FULL			0x0a
+#define FUNCT7_TX_TS_EMPTY			0x0b
+#define FUNCT7_TX_DATA_COUNT		0x0c
+#define FUNCT7_TX_DATA_SKIP			0x0d
+#define FUNCT7_TX_DATA_DMA_START	0x0e
+#define FUNCT7_TX_DATA_DMA_STATUS	0x0f
+#define FUNCT7_TX_TS_POP			0x28
+#define FUNCT7_TX_TS_GET			0x29
+#define FUNCT7_TX_HDR_PUSH			0x2a
+#define FUNCT7_TX_CSUM_GET			0x2b
+#define FUNCT7_TX_CONFIG			0x2c
+#define FUNCT7_TX_LAUNCH_PUSH		0x2d
+#define FUNCT7_TX_TSU_GET			0x2e
+#define FUNCT7_TX_CTRL_PUSH			0x2f
+// Common
+#define FUNCT7_LOAD_REG				0x10
+#define FUNCT7_STORE_REG			0x11
+#define FUNCT7_INTR					0x12
+// ACP
+#define FUNCT7_ACP_READ_START		0x18
+#define FUNCT7_ACP_READ_STATUS		0x19
+#define FUNCT7_ACP_WRITE_START		0x1a
+#define FUNCT7_ACP_WRITE_STATUS		0x1b
+#define FUNCT7_ACP_SET_LOCAL_WSTRB	0x1c
+#define FUNCT7_ACP_SET_REMOTE_WSTRB	0x1d
+
+// FIFO sizes of sp/sp_unit_rx.sv and sp/sp_unit_tx.sv
+#define RX_META_FIFO_DEPTH			2048
+#define RX_DATA_FIFO_SIZE			(64 * 1024)
+#define TX_META_FIFO_DEPTH			2048
+#define TX_DATA_FIFO_SIZE			(64 * 1024)
+#define TX_TS_FIFO_DEPTH			16
+#define TX_HDR_FIFO_DEPTH			1024
+#define TX_LAUNCH_FIFO_DEPTH		16
+#define MAX_PACKET_LENGTH			10240
+#define RX_MIRROR_SIZE				256
+
+#define TX_META_DESC_TSTAMP_BITN	30
+#define TX_META_DESC_CUT_THROUGH_BITN	29
+#define TX_META_DESC_LAUNCH_BITN	28
+#define TX_META_DESC_TS_TAG_BITN	24
+#define TX_META_DESC_HDR_LEN_BITN	16
+
+// Bits of the IXR registers
+#define MACB_RXDONE_BITN			1
+#define MACB_TXDONE_BITN			7
+
+#define TSU_NSEC_PER_SEC			1000000000
+
+struct sp_mmr mmr;
+struct sp_stats sp_stats;
+
+struct rx_queue {
+	uint32_t (*meta)[RX_META_NWORDS];
+	unsigned meta_rd;
+	unsigned meta_count;
+	uint8_t *data;
+	unsigned data_rd;
+	unsigned data_count;
+};
+
+static struct {
+	// As in sp_unit_rx.sv, there is one pair of FIFOs per queue
+	// only with FIFOs of at least 128 bits.
+	int nqueues;
+	int meta_depth;
+	int data_size;
+	struct rx_queue queues[NQUEUES];
+	int sel;
+	uint32_t latched[RX_META_NWORDS];
+	uint32_t config;
+	bool flow_paused;
+	uint64_t dma_busy_until;
+	// The first bytes of the last transfer with the mirror bit set
+	uint8_t mirror[RX_MIRROR_SIZE];
+} rx;
+
+struct tx_meta {
+	uint32_t meta;
+	uint32_t vlan;
+};
+
+static struct {
+	struct tx_meta meta[TX_META_FIFO_DEPTH];
+	unsigned meta_rd;
+	unsigned meta_count;
+	// The words of the TX data FIFO held by complete frames
+	unsigned data_words;
+	// The bytes of the frame that is being transferred
+	unsigned frame_bytes;
+	unsigned hdr_count;
+	// The two time stamp words and the status word
+	uint32_t ts[TX_TS_FIFO_DEPTH][3];
+	unsigned ts_rd;
+	unsigned ts_count;
+	uint32_t latched_ts[3];
+	uint32_t launch[TX_LAUNCH_FIFO_DEPTH][2];
+	unsigned launch_rd;
+	unsigned launch_count;
+	// Word 1 of the TSU time, latched by reading word 0
+	uint32_t tsu_sec_shadow;
+	uint32_t config;
+	// The length of the frame in the control frame slot (0 if empty)
+	uint32_t ctrl_length;
+	uint64_t dma_busy_until;
+	// A transfer waiting for room in the TX data FIFO
+	bool dma_pending;
+	uint64_t dma_addr;
+	uint32_t dma_length;
+	bool dma_more;
+	// The checksum of the transferred data (see "TX CSUM GET")
+	uint32_t csum;
+	unsigned csum_off;
+} tx;
+
+static struct {
+	uint16_t local_wstrb[4];
+	uint16_t remote_wstrb_0;
+	uint8_t remote_wstrb_0123;
+	uint64_t busy_until;
+} acp;
+
+static inline int
+data_fifo_width(void)
+{
+	return config.data_fifo_width / 8;
+}
+
+static inline unsigned
+nwords(unsigned nbytes)
+{
+	return (nbytes + data_fifo_width() - 1) / data_fifo_width();
+}
+
+void
+sp_init(void)
+{
+	rx.nqueues = config.data_fifo_width >= 128 ? NQUEUES : 1;
+	rx.meta_depth = RX_META_FIFO_DEPTH / rx.nqueues;
+	rx.data_size = RX_DATA_FIFO_SIZE / rx.nqueues;
+	for (int q = 0; q < rx.nqueues; q++) {
+		rx.queues[q].meta = calloc(rx.meta_depth, sizeof(*rx.queues[q].meta));
+		rx.queues[q].data = calloc(1, rx.data_size);
+		if (rx.queues[q].meta == NULL || rx.queues[q].data == NULL) {
+			perror("calloc");
+			exit(1);
+		}
+	}
+
+	mmr.r[MMR_R_REGN_RX_DATA_FIFO_SIZE] = RX_DATA_FIFO_SIZE;
+	mmr.r[MMR_R_REGN_RX_DATA_FIFO_WIDTH] = config.data_fifo_width;
+	mmr.r[MMR_R_REGN_TX_DATA_FIFO_SIZE] = TX_DATA_FIFO_SIZE;
+	mmr.r[MMR_R_REGN_TX_DATA_FIFO_WIDTH] = config.data_fifo_width;
+	mmr.r[MMR_R_REGN_GEM_BASE] = GEM3_BASE;
+}
+
+void
+sp_tsu_time(uint64_t now, uint32_t *ts_1, uint32_t *ts_2)
+{
+	uint64_t nsec = now * 1000 / config.clk_mhz;
+	uint64_t sec = nsec / TSU_NSEC_PER_SEC;
+
+	nsec %= TSU_NSEC_PER_SEC;
+	*ts_1 = (uint32_t)(sec & 0x3) << 30 | (uint32_t)nsec;
+	*ts_2 = (uint32_t)(sec >> 2);
+}
+
+/*
+ * RX
+ */
+int
+sp_rx_nqueues(void)
+{
+	return rx.nqueues;
+}
+
+/*
+ * Called by the GEM model with a received frame.
+ * Returns false if the frame does not fit and has been dropped.
+ */
+bool
+sp_rx_push(uint64_t now, int q, const uint8_t *data, int length, const uint32_t *meta)
+{
+	struct rx_queue *rxq = &rx.queues[q];
+	// Each frame starts on a new word.
+	unsigned nbytes = nwords(length) * data_fifo_width();
+
+	if (rxq->meta_count == rx.meta_depth || rxq->data_count + nbytes > rx.data_size)
+		return false;
+
+	unsigned wr = (rxq->data_rd + rxq->data_count) % rx.data_size;
+	for (int i = 0; i < length; i++)
+		rxq->data[(wr + i) % rx.data_size] = data[i];
+	rxq->data_count += nbytes;
+
+	memcpy(rxq->meta[(rxq->meta_rd + rxq->meta_count) % rx.meta_depth],
+		meta, RX_META_NWORDS * sizeof(uint32_t));
+	rxq->meta_count++;
+	return true;
+}
+
+static void
+rx_data_pop(uint64_t addr, unsigned length, bool dma)
+{
+	struct rx_queue *rxq = &rx.queues[rx.sel];
+	unsigned nbytes = nwords(length) * data_fifo_width();
+
+	if (nbytes > rxq->data_count)
+		nbytes = rxq->data_count;
+	if (length > nbytes)
+		length = nbytes;
+	if (dma) {
+		for (unsigned i = 0; i < length; i++) {
+			uint8_t b = rxq->data[(rxq->data_rd + i) % rx.data_size];
+			ddr_write(addr + i, &b, 1);
+		}
+	}
+	rxq->data_rd = (rxq->data_rd + nbytes) % rx.data_size;
+	rxq->data_count -= nbytes;
+}
+
+static uint32_t
+rx_flow_status(void)
+{
+	uint32_t flow_ctrl = mmr.r[MMR_R_REGN_RX_FLOW_CTRL];
+	uint32_t high = flow_ctrl & 0xffff;
+	uint32_t low = flow_ctrl >> 16;
+	uint32_t high_max = (rx.data_size - (MAX_PACKET_LENGTH + config.data_fifo_width / 8)) / 64;
+	uint32_t level = 0;
+
+	// Like the hardware, leave room for a frame of maximum length.
+	if (high > high_max)
+		high = high_max;
+
+	for (int q = 0; q < rx.nqueues; q++)
+		level += rx.queues[q].data_count;
+	level /= 64;
+
+	if (high == 0)
+		rx.flow_paused = false;
+	else if (level >= high)
+		rx.flow_paused = true;
+	else if (level <= low)
+		rx.flow_paused = false;
+	return high << 16 | rx.flow_paused;
+}
+
+static uint32_t
+rx_exec(uint64_t now, int funct7, uint32_t rs1, uint32_t rs2, const char **halt)
+{
+	struct rx_queue *rxq = &rx.queues[rx.sel];
+
+	switch (funct7) {
+	case FUNCT7_RX_META_POP:
+		if (rxq->meta_count == 0)
+			return 0;
+		memcpy(rx.latched, rxq->meta[rxq->meta_rd], sizeof(rx.latched));
+		rxq->meta_rd = (rxq->meta_rd + 1) % rx.meta_depth;
+		rxq->meta_count--;
+		return rx.latched[0];
+	case FUNCT7_RX_META_EMPTY:
+		return rxq->meta_count == 0;
+	case FUNCT7_RX_META_PEEK:
+		return rxq->meta_count != 0 ? rxq->meta[rxq->meta_rd][0] : 0;
+	case FUNCT7_RX_META_GET:
+		return rx.latched[rs1 & (RX_META_NWORDS - 1)];
+	case FUNCT7_RX_DATA_SKIP:
+		rx_data_pop(0, rs1 & 0xffff, false);
+		rx.dma_busy_until = now + nwords(rs1 & 0xffff);
+		return 0;
+	case FUNCT7_RX_DATA_DMA_START: {
+		uint64_t addr = (uint64_t)((rs2 >> 16) & 0xff) << 32 | rs1;
+		unsigned length = rs2 & 0xffff;
+		if (rs2 >> 31) {
+			for (unsigned i = 0; i < length && i < RX_MIRROR_SIZE; i++)
+				rx.mirror[i] = rxq->data[(rxq->data_rd + i) % rx.data_size];
+		}
+		rx_data_pop(addr, length, true);
+		rx.dma_busy_until = now + CYCLES_DMA_SETUP + length / DMA_BYTES_PER_CYCLE;
+		sp_stats.rx_dma_bytes += length;
+		return 0;
+	}
+	case FUNCT7_RX_MIRROR_DMA_START: {
+		uint64_t addr = (uint64_t)((rs2 >> 16) & 0xff) << 32 | rs1;
+		unsigned length = rs2 & 0xffff;
+		if (length > RX_MIRROR_SIZE)
+			length = RX_MIRROR_SIZE;
+		ddr_write(addr, rx.mirror, length);
+		rx.dma_busy_until = now + CYCLES_DMA_SETUP + length / DMA_BYTES_PER_CYCLE;
+		return 0;
+	}
+	case FUNCT7_RX_DATA_DMA_STATUS:
+		return now < rx.dma_busy_until;
+	case FUNCT7_RX_CONFIG:
+		rx.config = rs1;
+		return 0;
+	case FUNCT7_RX_FLOW_STATUS:
+		return rx_flow_status();
+	case FUNCT7_RX_QUEUE_SELECT: {
+		uint32_t pending = 0;
+		for (int q = 0; q < rx.nqueues; q++) {
+			if (rx.queues[q].meta_count != 0)
+				pending |= 1 << q;
+		}
+		if (rs1 < (uint32_t)rx.nqueues)
+			rx.sel = rs1;
+		return pending;
+	}
+	}
+	*halt = "unsupported RX command";
+	return 0;
+}
+
+/*
+ * TX
+ */
+static void
+tx_csum_add(const uint8_t *p, unsigned length)
+{
+	for (unsigned i = 0; i < length; i++) {
+		tx.csum += (tx.csum_off & 1) ? p[i] : (uint32_t)p[i] << 8;
+		tx.csum_off++;
+	}
+}
+
+static bool
+tx_dma_try(uint64_t now)
+{
+	unsigned words = tx.data_words + nwords(tx.frame_bytes);
+	unsigned free_bytes = TX_DATA_FIFO_SIZE - words * data_fifo_width();
+
+	if (tx.dma_length + data_fifo_width() > free_bytes)
+		return false;
+
+	uint8_t buf[0x10000];
+	ddr_read(tx.dma_addr, buf, tx.dma_length);
+	tx_csum_add(buf, tx.dma_length);
+	tx.frame_bytes += tx.dma_length;
+	if (!tx.dma_more) {
+		tx.data_words += nwords(tx.frame_bytes);
+		tx.frame_bytes = 0;
+	}
+	tx.dma_pending = false;
+	tx.dma_busy_until = now + CYCLES_DMA_SETUP + tx.dma_length / DMA_BYTES_PER_CYCLE;
+	sp_stats.tx_dma_bytes += tx.dma_length;
+	return true;
+}
+
+/*
+ * Called by the GEM model when it is ready to send a frame.
+ * Returns false if the frame at the head of the TX meta FIFO
+ * is not complete yet, has to wait for its launch time or
+ * needs an entry in the full TX time stamp FIFO.
+ */
+bool
+sp_tx_pop(uint64_t now, uint32_t *meta)
+{
+	// A control frame goes ahead of the TX meta FIFO and is never
+	// time stamped.
+	if (tx.ctrl_length != 0) {
+		*meta = tx.ctrl_length;
+		tx.ctrl_length = 0;
+		return true;
+	}
+	if (tx.meta_count == 0)
+		return false;
+
+	struct tx_meta *m = &tx.meta[tx.meta_rd];
+	unsigned length = m->meta & 0x3fff;
+	unsigned hdr_length = (m->meta >> TX_META_DESC_HDR_LEN_BITN) & 0xff;
+	unsigned words = nwords(length > hdr_length ? length - hdr_length : 0);
+
+	bool tstamp = (m->meta & (1 << TX_META_DESC_TSTAMP_BITN | 1 << TX_META_DESC_CUT_THROUGH_BITN)) != 0;
+
+	if (words > tx.data_words)
+		return false;
+	if (tstamp && tx.ts_count == TX_TS_FIFO_DEPTH)
+		return false;
+	if (m->meta & (1 << TX_META_DESC_LAUNCH_BITN)) {
+		uint32_t ts_1, ts_2;
+		if (tx.launch_count == 0)
+			return false;
+		uint32_t *launch = tx.launch[tx.launch_rd];
+		sp_tsu_time(now, &ts_1, &ts_2);
+		if (ts_2 < launch[1] || (ts_2 == launch[1] && ts_1 < launch[0]))
+			return false;
+		tx.launch_rd = (tx.launch_rd + 1) % TX_LAUNCH_FIFO_DEPTH;
+		tx.launch_count--;
+	}
+
+	tx.data_words -= words;
+	hdr_length = (hdr_length + 3) / 4;
+	tx.hdr_count -= hdr_length < tx.hdr_count ? hdr_length : tx.hdr_count;
+	// Frames are only sent once they are complete in the TX data FIFO,
+	// so cut-through frames never underflow.
+	if (tstamp) {
+		uint32_t *ts = tx.ts[(tx.ts_rd + tx.ts_count) % TX_TS_FIFO_DEPTH];
+		sp_tsu_time(now, &ts[0], &ts[1]);
+		// The tag goes above the underflow bit.
+		ts[2] = ((m->meta >> TX_META_DESC_TS_TAG_BITN) & 0xf) << 1;
+		tx.ts_count++;
+	}
+	*meta = m->meta;
+	tx.meta_rd = (tx.meta_rd + 1) % TX_META_FIFO_DEPTH;
+	tx.meta_count--;
+	return true;
+}
+
+static uint32_t
+tx_exec(uint64_t now, int funct7, uint32_t rs1, uint32_t rs2, const char **halt)
+{
+	switch (funct7) {
+	case FUNCT7_TX_META_PUSH:
+		if (tx.meta_count < TX_META_FIFO_DEPTH) {
+			struct tx_meta *m = &tx.meta[(tx.meta_rd + tx.meta_count) % TX_META_FIFO_DEPTH];
+			m->meta = rs1;
+			m->vlan = rs2;
+			tx.meta_count++;
+		}
+		return 0;
+	case FUNCT7_TX_META_FULL:
+		return tx.meta_count == TX_META_FIFO_DEPTH;
+	case FUNCT7_TX_TS_EMPTY:
+		return tx.ts_count == 0;
+	case FUNCT7_TX_DATA_COUNT:
+		return (tx.data_words + nwords(tx.frame_bytes)) * data_fifo_width();
+	case FUNCT7_TX_DATA_SKIP: {
+		unsigned words = nwords(rs1 & 0xffff);
+		tx.data_words -= words < tx.data_words ? words : tx.data_words;
+		return 0;
+	}
+	case FUNCT7_TX_DATA_DMA_START:
+		tx.dma_addr = (uint64_t)((rs2 >> 16) & 0xff) << 32 | rs1;
+		tx.dma_length = rs2 & 0xffff;
+		tx.dma_more = (rs2 >> 31) & 1;
+		tx.dma_pending = true;
+		tx_dma_try(now);
+		return 0;
+	case FUNCT7_TX_DATA_DMA_STATUS:
+		return tx.dma_pending || now < tx.dma_busy_until;
+	case FUNCT7_TX_TS_POP:
+		if (tx.ts_count == 0)
+			return 0;
+		memcpy(tx.latched_ts, tx.ts[tx.ts_rd], sizeof(tx.latched_ts));
+		tx.ts_rd = (tx.ts_rd + 1) % TX_TS_FIFO_DEPTH;
+		tx.ts_count--;
+		return tx.latched_ts[0];
+	case FUNCT7_TX_TS_GET:
+		return (rs1 & 3) < 3 ? tx.latched_ts[rs1 & 3] : 0;
+	case FUNCT7_TX_HDR_PUSH:
+		if (tx.hdr_count == TX_HDR_FIFO_DEPTH)
+			return 1;
+		tx.hdr_count++;
+		return 0;
+	case FUNCT7_TX_CSUM_GET: {
+		uint32_t sum = tx.csum;
+		sum = (sum & 0xffff) + (sum >> 16);
+		sum = (sum & 0xffff) + (sum >> 16);
+		tx.csum = 0;
+		tx.csum_off = 0;
+		return sum;
+	}
+	case FUNCT7_TX_CONFIG:
+		tx.config = rs1;
+		return 0;
+	case FUNCT7_TX_LAUNCH_PUSH:
+		if (tx.launch_count == TX_LAUNCH_FIFO_DEPTH)
+			return 1;
+		uint32_t *launch = tx.launch[(tx.launch_rd + tx.launch_count) % TX_LAUNCH_FIFO_DEPTH];
+		launch[0] = rs1;
+		launch[1] = rs2;
+		tx.launch_count++;
+		return 0;
+	case FUNCT7_TX_TSU_GET:
+		if (!(rs1 & 1)) {
+			uint32_t ts_1;
+			sp_tsu_time(now, &ts_1, &tx.tsu_sec_shadow);
+			return ts_1;
+		}
+		return tx.tsu_sec_shadow;
+	case FUNCT7_TX_CTRL_PUSH:
+		if (tx.ctrl_length != 0)
+			return 1;
+		tx.ctrl_length = rs2;
+		return 0;
+	}
+	*halt = "unsupported TX command";
+	return 0;
+}
+
+/*
+ * Common
+ */
+static uint32_t
+common_exec(int funct7, uint32_t rs1, uint32_t rs2, const char **halt)
+{
+	switch (funct7) {
+	case FUNCT7_LOAD_REG:
+		if (rs1 & (1 << MMR_R_BITN)) {
+			rs1 &= (1 << MMR_R_BITN) - 1;
+			return rs1 < MMR_R_NREGS ? mmr.r[rs1] : 0;
+		}
+		return mmr.rw[rs1 & (MMR_RW_NREGS - 1)];
+	case FUNCT7_STORE_REG:
+		// Like the hardware, only the bits of the read/write register
+		// index are decoded.
+		rs1 &= MMR_RW_NREGS - 1;
+		// The TX SP sends a PAUSE frame whenever this bit gets set.
+		if (rs1 == MMR_RW_REGN_STATUS &&
+			(~mmr.rw[rs1] & rs2 & (1 << STATUS_RX_PAUSE_BITN)))
+			sp_stats.pause_requests++;
+		mmr.rw[rs1] = rs2;
+		return 0;
+	case FUNCT7_INTR:
+		rs1 &= NQUEUES - 1;
+		if (rs2 & (1 << MACB_RXDONE_BITN))
+			sp_stats.rx_intrs[rs1]++;
+		if (rs2 & (1 << MACB_TXDONE_BITN))
+			sp_stats.tx_intrs[rs1]++;
+		return 0;
+	}
+	*halt = "unsupported common command";
+	return 0;
+}
+
+/*
+ * ACP
+ */
+static uint32_t
+acp_exec(uint64_t now, int funct3, int funct7, uint32_t rs1, uint32_t rs2, const char **halt)
+{
+	int nbytes = funct3 == 1 ? 64 : 16;
+	uint32_t int_off = ((rs1 & 0xffffff) - ACPRAM_ADDR) & (ACPRAM_SIZE - 1) & ~(uint32_t)15;
+	// The address bits 39:32 are passed in bits 31:24 of rs1.
+	uint64_t ext_addr = (uint64_t)(rs1 >> 24) << 32 | rs2;
+
+	switch (funct7) {
+	case FUNCT7_ACP_READ_START: {
+		uint8_t buf[64];
+		ddr_read(ext_addr, buf, nbytes);
+		for (int i = 0; i < nbytes; i++) {
+			if (acp.local_wstrb[i / 16] & (1 << (i % 16)))
+				acpram[(int_off + i) & (ACPRAM_SIZE - 1)] = buf[i];
+		}
+		acp.busy_until = now + CYCLES_ACP_SETUP + nbytes / ACP_BYTES_PER_CYCLE;
+		sp_stats.acp_reads++;
+		return 0;
+	}
+	case FUNCT7_ACP_WRITE_START:
+		for (int i = 0; i < nbytes; i++) {
+			bool en = nbytes == 64 ?
+				(acp.remote_wstrb_0123 >> (i / 16)) & 1 :
+				(acp.remote_wstrb_0 >> i) & 1;
+			if (en)
+				ddr_write(ext_addr + i, &acpram[(int_off + i) & (ACPRAM_SIZE - 1)], 1);
+		}
+		acp.busy_until = now + CYCLES_ACP_SETUP + nbytes / ACP_BYTES_PER_CYCLE;
+		sp_stats.acp_writes++;
+		return 0;
+	// Reads and writes share the busy flag.
+	case FUNCT7_ACP_READ_STATUS:
+	case FUNCT7_ACP_WRITE_STATUS:
+		return now < acp.busy_until;
+	case FUNCT7_ACP_SET_LOCAL_WSTRB:
+		acp.local_wstrb[funct3 & 3] = rs1;
+		return 0;
+	case FUNCT7_ACP_SET_REMOTE_WSTRB:
+		if (funct3 == 1)
+			acp.remote_wstrb_0123 = rs1 & 0xf;
+		else
+			acp.remote_wstrb_0 = rs1;
+		return 0;
+	}
+	*halt = "unsupported ACP command";
+	return 0;
+}
+
+/*
+ * funct7 bits 4:3 select the unit (RX, TX, common, ACP).
+ * Bit 5 selects a second bank of commands.
+ */
+uint32_t
+sp_exec(uint64_t now, int funct3, int funct7, uint32_t rs1, uint32_t rs2, const char **halt)
+{
+	switch ((funct7 >> 3) & 0x3) {
+	case 0:
+		return rx_exec(now, funct7, rs1, rs2, halt);
+	case 1:
+		return tx_exec(now, funct7, rs1, rs2, halt);
+	case 2:
+		return common_exec(funct7, rs1, rs2, halt);
+	default:
+		return acp_exec(now, funct3, funct7, rs1, rs2, halt);
+	}
+}
+
+void
+sp_tick(uint64_t now)
+{
+	if (tx.dma_pending)
+		tx_dma_try(now);
+}
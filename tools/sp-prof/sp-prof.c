@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2023 Robert Drehmel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * sp-prof: Reads the histogram of the PC-sampling profiler of an SP
+ * and symbolises it against the firmware ELF file.
+ *
+ * On the target, the profiler is programmed and read through /dev/mem.
+ * The histogram can be saved with -o and symbolised on another machine
+ * with -i.
+ */
+#include <elf.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * MMR offsets and bits (see mmr/mmr_config.sv)
+ */
+#define REGOFF_PROF_CONTROL				0x180
+#define REGOFF_PROF_PERIOD				0x184
+#define REGOFF_PROF_NSAMPLES			0x188
+#define REGOFF_PROF_SIZE				0x18c
+#define REGOFF_PROF_ADDR				0x190
+#define REGOFF_PROF_DATA				0x194
+#define PROF_CONTROL_ENABLE				(1 << 0)
+#define PROF_CONTROL_CLEAR				(1 << 1)
+#define PROF_CONTROL_PC_SHIFT_BITN		8
+#define MMR_SIZE						0x1000
+
+/*
+ * Stall reasons (see sp/pc_profiler.sv), in the upper two bits of
+ * the counter index
+ */
+enum {
+	REASON_ISSUED,
+	REASON_OPERAND_STALL,
+	REASON_UNIT_STALL,
+	REASON_OTHER,
+	NREASONS
+};
+static const char *reason_names[NREASONS] = {
+	"issued", "operand", "unit", "other"
+};
+
+#define PROF_FILE_MAGIC					0x46525053	// "SPRF"
+
+struct prof_header {
+	uint32_t magic;
+	uint32_t size;
+	uint32_t pc_shift;
+	uint32_t period;
+	uint32_t nsamples;
+};
+
+struct symbol {
+	uint32_t addr;
+	uint32_t size;
+	const char *name;
+};
+
+static struct symbol *symbols;
+static int nsymbols;
+// The loaded segments of the firmware, for the instruction words
+static uint8_t *text;
+static uint32_t text_addr;
+static uint32_t text_size;
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"usage: sp-prof [-a mmr_addr] [-p period] [-s pc_shift] [-t seconds]\n"
+		"               [-b ibram_addr] [-o file] [-n npcs] [-f nfuncs] firmware.elf\n"
+		"       sp-prof -i file [-b ibram_addr] [-n npcs] [-f nfuncs] firmware.elf\n"
+		"\n"
+		"  -a mmr_addr   Physical address of the MMRs of the SP (default 0xa0007000).\n"
+		"  -p period     Clock cycles between two samples (default 1009).\n"
+		"  -s pc_shift   log2 of the instructions per histogram bin (default 0).\n"
+		"  -t seconds    Time to sample for (default 1).\n"
+		"  -b ibram_addr Address of the IBRAM in the firmware (default 0x20000).\n"
+		"  -o file       Also save the histogram to file.\n"
+		"  -i file       Read the histogram from file instead of the SP.\n"
+		"  -n npcs       Number of bins in the list of bins (default 30).\n"
+		"  -f nfuncs     Number of functions in the list of functions (default 30).\n");
+	exit(1);
+}
+
+static int
+symbol_cmp(const void *a, const void *b)
+{
+	const struct symbol *x = a;
+	const struct symbol *y = b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int
+load_elf(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	uint8_t *image = malloc(size);
+	if (image == NULL || fread(image, 1, size, fp) != (size_t)size) {
+		fprintf(stderr, "%s: Cannot read file\n", path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)image;
+	if (size < (long)sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+		ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_machine != EM_RISCV) {
+		fprintf(stderr, "%s: Not a 32-bit RISC-V ELF file\n", path);
+		return -1;
+	}
+
+	// The first executable segment holds the code.
+	const Elf32_Phdr *phdrs = (const Elf32_Phdr *)(image + ehdr->e_phoff);
+	for (int i = 0; i < ehdr->e_phnum; i++) {
+		if (phdrs[i].p_type != PT_LOAD || (phdrs[i].p_flags & PF_X) == 0)
+			continue;
+		text_addr = phdrs[i].p_vaddr;
+		text_size = phdrs[i].p_filesz;
+		text = malloc(text_size);
+		memcpy(text, image + phdrs[i].p_offset, text_size);
+		break;
+	}
+
+	const Elf32_Shdr *shdrs = (const Elf32_Shdr *)(image + ehdr->e_shoff);
+	for (int i = 0; ehdr->e_shoff != 0 && i < ehdr->e_shnum; i++) {
+		if (shdrs[i].sh_type != SHT_SYMTAB || shdrs[i].sh_link >= ehdr->e_shnum)
+			continue;
+		const Elf32_Shdr *strtab = &shdrs[shdrs[i].sh_link];
+		const Elf32_Sym *syms = (const Elf32_Sym *)(image + shdrs[i].sh_offset);
+		int n = shdrs[i].sh_size / sizeof(Elf32_Sym);
+
+		symbols = calloc(n, sizeof(*symbols));
+		for (int j = 0; j < n; j++) {
+			if (ELF32_ST_TYPE(syms[j].st_info) != STT_FUNC)
+				continue;
+			symbols[nsymbols].addr = syms[j].st_value;
+			symbols[nsymbols].size = syms[j].st_size;
+			symbols[nsymbols].name = strdup((const char *)image +
+				strtab->sh_offset + syms[j].st_name);
+			nsymbols++;
+		}
+		break;
+	}
+	qsort(symbols, nsymbols, sizeof(*symbols), symbol_cmp);
+
+	free(image);
+	return 0;
+}
+
+/*
+ * Returns the index of the function containing pc, or -1.
+ */
+static int
+find_symbol(uint32_t pc)
+{
+	int lo = 0;
+	int hi = nsymbols - 1;
+	int found = -1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (symbols[mid].addr <= pc) {
+			found = mid;
+			lo = mid + 1;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	if (found < 0)
+		return -1;
+	// Assembler functions often come without a size.
+	if (symbols[found].size != 0 && pc - symbols[found].addr >= symbols[found].size)
+		return -1;
+	return found;
+}
+
+/*
+ * Names the SP unit commands (see firmware/src/sp.h)
+ */
+static const char *
+sp_command_name(uint32_t insn)
+{
+	static const struct {
+		uint32_t funct7;
+		const char *name;
+	} commands[] = {
+		{ 0x00, "rx_meta_nelems" }, { 0x01, "rx_meta_pop" },
+		{ 0x02, "rx_meta_empty" }, { 0x03, "rx_meta_get" },
+		{ 0x04, "rx_data_skip" }, { 0x05, "rx_data_dma_start" },
+		{ 0x06, "rx_data_dma_status" }, { 0x07, "rx_config" },
+		{ 0x20, "rx_flow_status" }, { 0x21, "rx_queue_select" },
+		{ 0x22, "rx_mirror_dma_start" },
+		{ 0x08, "tx_meta_nfree" }, { 0x09, "tx_meta_push" },
+		{ 0x0a, "tx_meta_full" }, { 0x0b, "tx_ts_empty" },
+		{ 0x0c, "tx_data_count" }, { 0x0d, "tx_data_skip" },
+		{ 0x0e, "tx_data_dma_start" }, { 0x0f, "tx_data_dma_status" },
+		{ 0x28, "tx_ts_pop" }, { 0x29, "tx_ts_get" },
+		{ 0x2a, "tx_hdr_push" }, { 0x2b, "tx_csum_get" },
+		{ 0x2c, "tx_config" }, { 0x2d, "tx_launch_push" },
+		{ 0x10, "load_reg" }, { 0x11, "store_reg" }, { 0x12, "intr" },
+		{ 0x18, "acp_read_start" }, { 0x19, "acp_read_status" },
+		{ 0x1a, "acp_write_start" }, { 0x1b, "acp_write_status" },
+		{ 0x1c, "acp_set_local_wstrb" }, { 0x1d, "acp_set_remote_wstrb" },
+	};
+
+	// CUSTOM_0
+	if ((insn & 0x7f) != 0x0b)
+		return NULL;
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+		if (commands[i].funct7 == insn >> 25)
+			return commands[i].name;
+	}
+	return "sp";
+}
+
+static uint32_t
+mmr_read(volatile uint32_t *mmr, uint32_t off)
+{
+	return mmr[off / 4];
+}
+
+static void
+mmr_write(volatile uint32_t *mmr, uint32_t off, uint32_t x)
+{
+	mmr[off / 4] = x;
+}
+
+static uint32_t *
+prof_sample(uint64_t mmr_addr, uint32_t period, uint32_t pc_shift, unsigned seconds,
+	struct prof_header *hdr)
+{
+	int fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (fd < 0) {
+		perror("/dev/mem");
+		return NULL;
+	}
+	volatile uint32_t *mmr = mmap(NULL, MMR_SIZE, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, mmr_addr);
+	close(fd);
+	if (mmr == MAP_FAILED) {
+		perror("mmap");
+		return NULL;
+	}
+
+	hdr->magic = PROF_FILE_MAGIC;
+	hdr->size = mmr_read(mmr, REGOFF_PROF_SIZE);
+	hdr->pc_shift = pc_shift;
+	hdr->period = period;
+	if (hdr->size == 0) {
+		fprintf(stderr, "The SP at 0x%llx has no profiler\n", (unsigned long long)mmr_addr);
+		return NULL;
+	}
+
+	uint32_t control = pc_shift << PROF_CONTROL_PC_SHIFT_BITN;
+	mmr_write(mmr, REGOFF_PROF_PERIOD, period);
+	mmr_write(mmr, REGOFF_PROF_CONTROL, control | PROF_CONTROL_CLEAR);
+	while (mmr_read(mmr, REGOFF_PROF_CONTROL) & PROF_CONTROL_CLEAR)
+		;
+	mmr_write(mmr, REGOFF_PROF_CONTROL, control | PROF_CONTROL_ENABLE);
+	sleep(seconds);
+	mmr_write(mmr, REGOFF_PROF_CONTROL, control);
+	hdr->nsamples = mmr_read(mmr, REGOFF_PROF_NSAMPLES);
+
+	uint32_t n = hdr->size / 4;
+	uint32_t *counts = malloc(hdr->size);
+	mmr_write(mmr, REGOFF_PROF_ADDR, 0);
+	for (uint32_t i = 0; i < n; i++)
+		counts[i] = mmr_read(mmr, REGOFF_PROF_DATA);
+
+	munmap((void *)mmr, MMR_SIZE);
+	return counts;
+}
+
+static uint32_t *
+prof_read_file(const char *path, struct prof_header *hdr)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		perror(path);
+		return NULL;
+	}
+	if (fread(hdr, sizeof(*hdr), 1, fp) != 1 || hdr->magic != PROF_FILE_MAGIC) {
+		fprintf(stderr, "%s: Not a histogram file\n", path);
+		fclose(fp);
+		return NULL;
+	}
+	uint32_t *counts = malloc(hdr->size);
+	if (fread(counts, 1, hdr->size, fp) != hdr->size) {
+		fprintf(stderr, "%s: Short histogram\n", path);
+		fclose(fp);
+		return NULL;
+	}
+	fclose(fp);
+	return counts;
+}
+
+static int
+prof_write_file(const char *path, const struct prof_header *hdr, const uint32_t *counts)
+{
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+	if (fwrite(hdr, sizeof(*hdr), 1, fp) != 1 ||
+		fwrite(counts, 1, hdr->size, fp) != hdr->size || fclose(fp) != 0) {
+		fprintf(stderr, "%s: Cannot write file\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+struct row {
+	uint64_t counts[NREASONS];
+	uint64_t total;
+	int key;
+};
+
+static int
+row_cmp(const void *a, const void *b)
+{
+	const struct row *x = a;
+	const struct row *y = b;
+
+	return x->total < y->total ? 1 : x->total > y->total ? -1 : x->key - y->key;
+}
+
+static void
+print_counts(const struct row *row, uint64_t nsamples)
+{
+	printf("%6.2f%%", nsamples != 0 ? 100.0 * row->total / nsamples : 0.0);
+	for (int r = 0; r < NREASONS; r++)
+		printf(" %9llu", (unsigned long long)row->counts[r]);
+}
+
+static void
+print_header(const char *what)
+{
+	printf("%7s", "total");
+	for (int r = 0; r < NREASONS; r++)
+		printf(" %9s", reason_names[r]);
+	printf("  %s\n", what);
+}
+
+static void
+print_profile(const struct prof_header *hdr, const uint32_t *counts, uint32_t ibram_addr,
+	int npcs, int nfuncs)
+{
+	uint32_t nbins = hdr->size / 4 / NREASONS;
+	uint32_t bin_size = 4 << hdr->pc_shift;
+	struct row *bins = calloc(nbins, sizeof(*bins));
+	struct row *funcs = calloc(nsymbols + 1, sizeof(*funcs));
+	uint64_t total = 0;
+
+	for (int i = 0; i <= nsymbols; i++)
+		funcs[i].key = i;
+	for (uint32_t i = 0; i < nbins; i++) {
+		uint32_t pc = ibram_addr + i * bin_size;
+		int fn = find_symbol(pc) + 1;
+		bins[i].key = i;
+		for (int r = 0; r < NREASONS; r++) {
+			uint32_t c = counts[r * nbins + i];
+			bins[i].counts[r] = c;
+			bins[i].total += c;
+			funcs[fn].counts[r] += c;
+			funcs[fn].total += c;
+		}
+		total += bins[i].total;
+	}
+
+	printf("%u samples every %u cycles, %llu in the histogram",
+		hdr->nsamples, hdr->period, (unsigned long long)total);
+	if (total < hdr->nsamples)
+		printf(" (increase -s to cover the rest)");
+	printf("\n\n");
+
+	qsort(funcs, nsymbols + 1, sizeof(*funcs), row_cmp);
+	print_header("function");
+	for (int i = 0; i < nsymbols + 1 && i < nfuncs && funcs[i].total != 0; i++) {
+		print_counts(&funcs[i], total);
+		printf("  %s\n", funcs[i].key == 0 ? "(unknown)" : symbols[funcs[i].key - 1].name);
+	}
+	printf("\n");
+
+	qsort(bins, nbins, sizeof(*bins), row_cmp);
+	print_header("pc");
+	for (uint32_t i = 0; i < nbins && (int)i < npcs && bins[i].total != 0; i++) {
+		uint32_t pc = ibram_addr + bins[i].key * bin_size;
+		int fn = find_symbol(pc);
+		print_counts(&bins[i], total);
+		printf("  %08x", pc);
+		if (fn >= 0)
+			printf(" <%s+0x%x>", symbols[fn].name, pc - symbols[fn].addr);
+		if (hdr->pc_shift == 0 && pc - text_addr < text_size) {
+			uint32_t insn;
+			memcpy(&insn, &text[pc - text_addr], sizeof(insn));
+			const char *cmd = sp_command_name(insn);
+			printf(" %08x", insn);
+			if (cmd != NULL)
+				printf(" %s", cmd);
+		}
+		printf("\n");
+	}
+
+	free(bins);
+	free(funcs);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t mmr_addr = 0xa0007000;
+	uint32_t period = 1009;
+	uint32_t pc_shift = 0;
+	unsigned seconds = 1;
+	uint32_t ibram_addr = 0x20000;
+	const char *in_path = NULL;
+	const char *out_path = NULL;
+	int npcs = 30;
+	int nfuncs = 30;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "a:p:s:t:b:o:i:n:f:")) != -1) {
+		switch (ch) {
+		case 'a': mmr_addr = strtoull(optarg, NULL, 0); break;
+		case 'p': period = strtoul(optarg, NULL, 0); break;
+		case 's': pc_shift = strtoul(optarg, NULL, 0); break;
+		case 't': seconds = strtoul(optarg, NULL, 0); break;
+		case 'b': ibram_addr = strtoul(optarg, NULL, 0); break;
+		case 'o': out_path = optarg; break;
+		case 'i': in_path = optarg; break;
+		case 'n': npcs = atoi(optarg); break;
+		case 'f': nfuncs = atoi(optarg); break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (argc != 1 || pc_shift > 15 || period < 2)
+		usage();
+
+	if (load_elf(argv[0]) != 0)
+		return 1;
+
+	struct prof_header hdr;
+	uint32_t *counts;
+	if (in_path != NULL)
+		counts = prof_read_file(in_path, &hdr);
+	else
+		counts = prof_sample(mmr_addr, period, pc_shift, seconds, &hdr);
+	if (counts == NULL)
+		return 1;
+	if (out_path != NULL && prof_write_file(out_path, &hdr, counts) != 0)
+		return 1;
+
+	print_profile(&hdr, counts, ibram_addr, npcs, nfuncs);
+	free(counts);
+	return 0;
+}